@@ -0,0 +1,17 @@
+#
+# Config.mk
+#
+# Build options of the experiments, included by their Makefiles.
+#
+# The libraries from lib/, which the experiments link, have to be built
+# with the same options. "make circle" in experiments/ rebuilds them with
+# this file, other applications keep the default options of Rules.mk.
+#
+
+ifndef EXPERIMENT_CONFIG
+EXPERIMENT_CONFIG = 1
+
+# the kernels run on all cores (see parallel.h, taskpool.h)
+DEFINE	+= -DARM_ALLOW_MULTI_CORE
+
+endif
@@ -0,0 +1,107 @@
+//
+// comparator.cpp
+//
+#include "comparator.h"
+#include <assert.h>
+
+#if defined (__aarch64__)
+	#include <arm_neon.h>
+#endif
+
+#define GROUP_WORDS	(GOLD_COMPARE_GROUP_SIZE / sizeof (u32))
+
+CGoldComparator::CGoldComparator (const void *pData, const void *pGold, size_t nSize,
+				  unsigned nElementSize)
+:	m_pData ((const u32 *) pData),
+	m_pGold ((const u32 *) pGold),
+	m_nWords (nSize / sizeof (u32)),
+	m_nElementWords (nElementSize / sizeof (u32)),
+	m_nPosition (0),
+	m_nScalarEnd (0)
+{
+	assert (pData != 0);
+	assert (pGold != 0);
+	assert (nElementSize > 0);
+	assert (nElementSize % sizeof (u32) == 0);
+	assert (GOLD_COMPARE_GROUP_SIZE % nElementSize == 0);
+	assert (nSize % nElementSize == 0);
+}
+
+unsigned CGoldComparator::Next (unsigned *pIndices, unsigned nMaxIndices)
+{
+	assert (pIndices != 0);
+	assert (nMaxIndices > 0);
+
+	unsigned nIndices = 0;
+
+	while (m_nPosition < m_nWords)
+	{
+		if (m_nPosition >= m_nScalarEnd)
+		{
+			if (m_nWords - m_nPosition < GROUP_WORDS)
+			{
+				m_nScalarEnd = m_nWords;	// tail
+			}
+			else if (GroupDiffers (&m_pData[m_nPosition], &m_pGold[m_nPosition]))
+			{
+				m_nScalarEnd = m_nPosition + GROUP_WORDS;
+			}
+			else
+			{
+				m_nPosition += GROUP_WORDS;
+
+				continue;
+			}
+		}
+
+		for (; m_nPosition < m_nScalarEnd; m_nPosition += m_nElementWords)
+		{
+			for (unsigned i = 0; i < m_nElementWords; i++)
+			{
+				if (m_pData[m_nPosition + i] != m_pGold[m_nPosition + i])
+				{
+					if (nIndices == nMaxIndices)
+					{
+						return nIndices;	// continue here next time
+					}
+
+					pIndices[nIndices++] = m_nPosition / m_nElementWords;
+
+					break;
+				}
+			}
+		}
+	}
+
+	return nIndices;
+}
+
+boolean CGoldComparator::GroupDiffers (const u32 *pData, const u32 *pGold)
+{
+#if defined (__aarch64__)
+	uint32x4_t vAcc0 = veorq_u32 (vld1q_u32 (pData),      vld1q_u32 (pGold));
+	uint32x4_t vAcc1 = veorq_u32 (vld1q_u32 (pData + 4),  vld1q_u32 (pGold + 4));
+	uint32x4_t vAcc2 = veorq_u32 (vld1q_u32 (pData + 8),  vld1q_u32 (pGold + 8));
+	uint32x4_t vAcc3 = veorq_u32 (vld1q_u32 (pData + 12), vld1q_u32 (pGold + 12));
+
+	for (unsigned i = 16; i < GROUP_WORDS; i += 16)
+	{
+		vAcc0 = vorrq_u32 (vAcc0, veorq_u32 (vld1q_u32 (pData + i),      vld1q_u32 (pGold + i)));
+		vAcc1 = vorrq_u32 (vAcc1, veorq_u32 (vld1q_u32 (pData + i + 4),  vld1q_u32 (pGold + i + 4)));
+		vAcc2 = vorrq_u32 (vAcc2, veorq_u32 (vld1q_u32 (pData + i + 8),  vld1q_u32 (pGold + i + 8)));
+		vAcc3 = vorrq_u32 (vAcc3, veorq_u32 (vld1q_u32 (pData + i + 12), vld1q_u32 (pGold + i + 12)));
+	}
+
+	vAcc0 = vorrq_u32 (vorrq_u32 (vAcc0, vAcc1), vorrq_u32 (vAcc2, vAcc3));
+
+	return vmaxvq_u32 (vAcc0) != 0;
+#else
+	u32 nAcc = 0;
+	for (unsigned i = 0; i < GROUP_WORDS; i++)
+	{
+		nAcc |= pData[i] ^ pGold[i];
+	}
+
+	return nAcc != 0;
+#endif
+}
@@ -0,0 +1,42 @@
+//
+// comparator.h
+//
+// Bitwise comparison of output data with gold data. Groups of
+// GOLD_COMPARE_GROUP_SIZE bytes are XORed and ORed together with NEON and
+// only a group with a difference is searched element by element. The
+// mismatching elements are returned as a list of indices.
+//
+#ifndef _comparator_h
+#define _comparator_h
+
+#include <circle/types.h>
+
+#define GOLD_COMPARE_GROUP_SIZE		256		// 4 chunks of 64 bytes
+
+class CGoldComparator
+{
+public:
+	/// \param nSize Size of the data in bytes (multiple of nElementSize)
+	/// \param nElementSize Multiple of 4, has to divide GOLD_COMPARE_GROUP_SIZE
+	CGoldComparator (const void *pData, const void *pGold, size_t nSize, unsigned nElementSize);
+
+	/// \brief Find the next mismatching elements
+	/// \param pIndices Indices of the mismatching elements are written here
+	/// \param nMaxIndices Size of pIndices
+	/// \return Number of indices written (0 if there are no more mismatches)
+	unsigned Next (unsigned *pIndices, unsigned nMaxIndices);
+
+private:
+	static boolean GroupDiffers (const u32 *pData, const u32 *pGold);
+
+private:
+	const u32 *m_pData;
+	const u32 *m_pGold;
+	size_t m_nWords;
+	unsigned m_nElementWords;
+
+	size_t m_nPosition;			// in words
+	size_t m_nScalarEnd;			// search element by element up to here
+};
+
+#endif
@@ -95,6 +95,12 @@
 // Required for QEMU
 #define EMMC_ALLOW_OLD_SDHCI
 
+// Multi-block reads transfer the data with ADMA2 directly into the buffer
+// of the caller instead of reading the FIFO (EMMC2 only)
+#if RASPPI >= 4
+	#define EMMC_USE_ADMA2
+#endif
+
 #if RASPPI <= 3
 	#define EMMC_BASE	ARM_EMMC_BASE
 #else
@@ -130,6 +136,29 @@
 #define EMMC_SPI_INT_SPT	(EMMC_BASE + 0xF0)
 #define EMMC_SLOTISR_VER	(EMMC_BASE + 0xFC)
 
+#ifdef EMMC_USE_ADMA2
+#define EMMC_ADMA_ADDR		(EMMC_BASE + 0x58)
+
+#define CONTROL0_DMA_SEL_MASK	(3 << 3)
+#define CONTROL0_DMA_SEL_ADMA2	(2 << 3)
+
+struct TADMA2Descriptor			// HCSS 1.13.4
+{
+	u16	nAttribute;
+#define ADMA2_VALID		(1 << 0)
+#define ADMA2_END		(1 << 1)
+#define ADMA2_ACT_TRAN		(2 << 4)
+	u16	nLength;
+	u32	nAddress;			// bus address
+}
+PACKED;
+
+#define ADMA2_MAX_LENGTH	0x8000		// per descriptor
+#define ADMA2_DESCRIPTORS	(EMMC_MAX_MULTI_BLOCKS * SD_BLOCK_SIZE / ADMA2_MAX_LENGTH)
+
+#define ADMA2_MAX_ADDRESS	0x40000000	// EMMC2 can access the first GB only
+#endif
+
 #endif
 
 #define SD_CMD_INDEX(a)			((a) << 24)
@@ -597,16 +626,31 @@ int CEMMCDevice::Read (void *pBuffer, size_t nCount)
 
 	PeripheralEntry ();
 
-	if (DoRead ((u8 *) pBuffer, nCount, nBlock) != (int) nCount)
+	// multi-block transfers (CMD18) of up to EMMC_MAX_MULTI_BLOCKS
+	u8 *pTo = (u8 *) pBuffer;
+	for (size_t nRest = nCount; nRest > 0;)
 	{
-		PeripheralExit ();
+		size_t nChunk = nRest;
+		if (nChunk > EMMC_MAX_MULTI_BLOCKS * SD_BLOCK_SIZE)
+		{
+			nChunk = EMMC_MAX_MULTI_BLOCKS * SD_BLOCK_SIZE;
+		}
 
-		if (m_pActLED != 0)
+		if (DoRead (pTo, nChunk, nBlock) != (int) nChunk)
 		{
-			m_pActLED->Off ();
+			PeripheralExit ();
+
+			if (m_pActLED != 0)
+			{
+				m_pActLED->Off ();
+			}
+
+			return -1;
 		}
 
-		return -1;
+		pTo += nChunk;
+		nBlock += nChunk / SD_BLOCK_SIZE;
+		nRest -= nChunk;
 	}
 
 	PeripheralExit ();
@@ -920,6 +964,16 @@ void CEMMCDevice::IssueCommandInt (u32 cmd_reg, u32 argument, int timeout)
 	u32 blksizecnt = m_block_size | (m_blocks_to_transfer << 16);
 	write32 (EMMC_BLKSIZECNT, blksizecnt);
 
+#ifdef EMMC_USE_ADMA2
+	if (   (cmd_reg & SD_CMD_ISDATA)
+	    && (cmd_reg & SD_CMD_DAT_DIR_CH)
+	    && m_blocks_to_transfer > 1
+	    && SetupADMA2 (m_buf, m_blocks_to_transfer * m_block_size))
+	{
+		cmd_reg |= SD_CMD_DMA;
+	}
+#endif
+
 	// Set argument 1 reg
 	write32 (EMMC_ARG1, argument);
 
@@ -965,8 +1019,9 @@ void CEMMCDevice::IssueCommandInt (u32 cmd_reg, u32 argument, int timeout)
 		break;
 	}
 
-	// If with data, wait for the appropriate interrupt
-	if (cmd_reg & SD_CMD_ISDATA)
+	// If with data, wait for the appropriate interrupt (not with DMA)
+	if (   (cmd_reg & SD_CMD_ISDATA)
+	    && !(cmd_reg & SD_CMD_DMA))
 	{
 		u32 wr_irpt;
 		int is_write = 0;
@@ -1068,6 +1123,21 @@ void CEMMCDevice::IssueCommandInt (u32 cmd_reg, u32 argument, int timeout)
 		}
 	}
 
+#ifdef EMMC_USE_ADMA2
+	if (cmd_reg & SD_CMD_DMA)
+	{
+		// discard lines, which may have been fetched speculatively during the transfer,
+		// without writing them back over the transferred data
+#if AARCH == 64
+		InvalidateDataCacheRange ((uintptr) m_buf, m_blocks_to_transfer * m_block_size);
+#else
+		// there is no invalidate only on AArch32, the lines are clean, because the
+		// buffer is cache line aligned (see SetupADMA2())
+		CleanAndInvalidateDataCacheRange ((uintptr) m_buf, m_blocks_to_transfer * m_block_size);
+#endif
+	}
+#endif
+
 	// Return success
 	m_last_cmd_success = 1;
 }
@@ -2432,6 +2502,51 @@ int CEMMCDevice::DoWrite (u8 *buf, size_t buf_size, u32 block_no)
 	return buf_size;
 }
 
+#ifdef EMMC_USE_ADMA2
+
+static TADMA2Descriptor s_ADMA2Table[ADMA2_DESCRIPTORS] ALIGN (64);
+
+boolean CEMMCDevice::SetupADMA2 (void *buf, size_t buf_size)
+{
+	// A cache line, which is shared with other data, may be written back by the CPU
+	// during the transfer and would overwrite the transferred data then.
+	uintptr nAddress = (uintptr) buf;
+	if (   !IS_CACHE_ALIGNED (buf, buf_size)
+	    || nAddress + buf_size > ADMA2_MAX_ADDRESS
+	    || buf_size > ADMA2_DESCRIPTORS * ADMA2_MAX_LENGTH)
+	{
+		return FALSE;			// use the FIFO
+	}
+
+	TADMA2Descriptor *pDesc = s_ADMA2Table;
+	for (size_t nRest = buf_size; nRest > 0; pDesc++)
+	{
+		size_t nLength = nRest < ADMA2_MAX_LENGTH ? nRest : ADMA2_MAX_LENGTH;
+
+		pDesc->nAttribute = ADMA2_VALID | ADMA2_ACT_TRAN;
+		pDesc->nLength = (u16) nLength;
+		pDesc->nAddress = BUS_ADDRESS (nAddress);
+
+		nAddress += nLength;
+		nRest -= nLength;
+	}
+	pDesc[-1].nAttribute |= ADMA2_END;
+
+	CleanAndInvalidateDataCacheRange ((uintptr) s_ADMA2Table, sizeof s_ADMA2Table);
+	CleanAndInvalidateDataCacheRange ((uintptr) buf, buf_size);
+
+	write32 (EMMC_ADMA_ADDR, BUS_ADDRESS ((uintptr) s_ADMA2Table));
+
+	u32 control0 = read32 (EMMC_CONTROL0);
+	control0 &= ~CONTROL0_DMA_SEL_MASK;
+	control0 |= CONTROL0_DMA_SEL_ADMA2;
+	write32 (EMMC_CONTROL0, control0);
+
+	return TRUE;
+}
+
+#endif
+
 #ifndef USE_SDHOST
 
 int CEMMCDevice::TimeoutWait (unsigned reg, unsigned mask, int value, unsigned usec)
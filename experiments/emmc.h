@@ -42,6 +42,8 @@
 	#include <SDCard/sdhost.h>
 #endif
 
+#define EMMC_MAX_MULTI_BLOCKS	2048		// per command, larger reads are split
+
 struct TSCR			// SD configuration register
 {
 	u32	scr[2];
@@ -95,6 +97,10 @@ private:
 	int DoWrite (u8 *buf, size_t buf_size, u32 block_no);
 
 #ifndef USE_SDHOST
+#if RASPPI >= 4
+	boolean SetupADMA2 (void *buf, size_t buf_size);
+#endif
+
 	int TimeoutWait (unsigned reg, unsigned mask, int value, unsigned usec);
 #endif
 
@@ -0,0 +1,365 @@
+//
+// experiment.cpp
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+// Copyright (C) 2014-2015  R. Stange <rsta2@o2online.de>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include "experiment.h"
+#include "comparator.h"
+#include <circle/fs/fsdef.h>
+#include <assert.h>
+
+#define READ_CHUNK_SIZE		0x800000		// FAT_MAX_SECTOR_RUN sectors
+
+#define COMPARE_INDICES		64
+
+#if AARCH == 64
+#ifndef EXPERIMENT_PERF_TLB
+// IPC, cache miss rates and branch mispredictions can be derived from these
+static const TPerfEvent s_PerfEvents[] =
+{
+	PerfEventInstRetired,
+	PerfEventL1DCache,
+	PerfEventL1DCacheRefill,
+	PerfEventL2DCache,
+	PerfEventL2DCacheRefill,
+	PerfEventBranchMispredicted
+};
+#else
+// TLB refills, to compare the translation table with and without NO_MMU_BLOCK_MAPPINGS
+// (Cortex-A53/A72 do not implement PerfEventL2DTLBRefill, it is left out there)
+static const TPerfEvent s_PerfEvents[] =
+{
+	PerfEventInstRetired,
+	PerfEventL1ITLBRefill,
+	PerfEventL1DTLBRefill,
+	PerfEventL2DTLBRefill,
+	PerfEventL1DCacheRefill,
+	PerfEventL2DCacheRefill
+};
+#endif
+
+#define PERF_EVENTS	(sizeof s_PerfEvents / sizeof s_PerfEvents[0])
+#endif
+
+CExperiment::CExperiment (void)
+:	m_Screen (m_Options.GetWidth (), m_Options.GetHeight ()),
+	m_Timer (&m_Interrupt),
+	m_Logger (m_Options.GetLogLevel (), &m_Timer),
+	m_Reporter (&m_Interrupt),
+	m_EMMC (&m_Interrupt, &m_Timer, &m_ActLED),
+#if AARCH == 64
+	m_PerfCounters (&m_Interrupt),
+	m_bPerfCounters (FALSE),
+#endif
+	m_nIteration (0),
+	m_nErrors (0),
+	m_nExecuteTicks (0),
+	m_nCompareTicks (0)
+{
+	m_ActLED.Blink (5);	// show we are alive
+}
+
+CExperiment::~CExperiment (void)
+{
+}
+
+boolean CExperiment::Initialize (void)
+{
+	boolean bOK = TRUE;
+
+	if (bOK)
+	{
+		bOK = m_Serial.Initialize (EXPERIMENT_BAUD_RATE);
+	}
+
+	if (bOK)
+	{
+		bOK = m_Interrupt.Initialize ();
+	}
+
+	if (bOK)
+	{
+		bOK = m_Timer.Initialize ();
+	}
+
+	if (bOK)
+	{
+		bOK = m_EMMC.Initialize ();
+	}
+
+	if (bOK)
+	{
+		bOK = m_Reporter.Initialize ();
+	}
+
+	// The reporter owns the UART0 from now on. m_Serial has only set it up and
+	// must not be written, so that no text gets into the report frames. It is
+	// not registered as "ttyS1", so it cannot be selected as log device. The
+	// logger has no target and keeps its messages in its buffer only.
+	m_DeviceNameService.RemoveDevice ("ttyS1", FALSE);
+
+#if AARCH == 64
+	// the counters are optional, QEMU for instance may have less
+	TPerfEvent Events[PERF_EVENTS];
+	unsigned nEvents = 0;
+	for (unsigned i = 0; i < PERF_EVENTS; i++)
+	{
+		if (CPerfCounters::IsSupported (s_PerfEvents[i]))
+		{
+			Events[nEvents++] = s_PerfEvents[i];
+		}
+	}
+
+	if (   bOK
+	    && nEvents > 0
+	    && m_PerfCounters.Initialize (Events, nEvents))
+	{
+		m_PerfCounters.Start ();
+
+		m_bPerfCounters = TRUE;
+	}
+#endif
+
+	return bOK;
+}
+
+TShutdownMode CExperiment::Run (CWorkload *pWorkload)
+{
+	assert (pWorkload != 0);
+
+	CDevice *pPartition = m_DeviceNameService.GetDevice (EXPERIMENT_PARTITION, TRUE);
+	if (pPartition == 0)
+	{
+		ReportStatus (EXPERIMENT_STATUS_NO_PARTITION);
+	}
+	else if (!m_FileSystem.Mount (pPartition))
+	{
+		ReportStatus (EXPERIMENT_STATUS_MOUNT_FAILED);
+	}
+
+	if (!pWorkload->Setup (this))
+	{
+		ReportStatus (EXPERIMENT_STATUS_SETUP_FAILED);
+		m_Reporter.Flush ();
+
+		return ShutdownHalt;
+	}
+
+	while (1)
+	{
+		m_nErrors = 0;
+		m_Frame.Reset ();
+
+#if AARCH == 64
+		TPerfSample Sample;
+		CPerfCounters::ClearSample (&Sample);
+#endif
+
+		pWorkload->Prepare ();
+
+		unsigned nStartTicks = m_Timer.GetClockTicks ();
+		{
+#if AARCH == 64
+			CPerfScope Scope (&m_PerfCounters, &Sample);
+#endif
+			pWorkload->Execute ();
+		}
+		unsigned nExecuteEndTicks = m_Timer.GetClockTicks ();
+		pWorkload->Compare (this);
+		unsigned nCompareEndTicks = m_Timer.GetClockTicks ();
+
+		m_nExecuteTicks = nExecuteEndTicks - nStartTicks;
+		m_nCompareTicks = nCompareEndTicks - nExecuteEndTicks;
+
+		const u32 *pFrame = m_Frame.Finish (m_nIteration, m_nExecuteTicks, m_nCompareTicks,
+						    m_Reporter.GetOverflows ());
+		Send (pFrame, m_Frame.GetWords ());
+
+#if AARCH == 64
+		if (m_bPerfCounters)
+		{
+			ReportCounters (Sample);
+		}
+#endif
+
+		m_nIteration++;
+	}
+
+	return ShutdownHalt;
+}
+
+boolean CExperiment::LoadFile (const char *pFileName, void *pBuffer, size_t nSize,
+			       void *pBuffer2, size_t nSize2)
+{
+	assert (pFileName != 0);
+
+	unsigned hFile = m_FileSystem.FileOpen (pFileName);
+	if (hFile == 0)
+	{
+		ReportStatus (EXPERIMENT_STATUS_OPEN_FAILED);
+
+		return FALSE;
+	}
+
+	boolean bOK = ReadFile (hFile, pBuffer, nSize);
+	if (   bOK
+	    && pBuffer2 != 0)
+	{
+		bOK = ReadFile (hFile, pBuffer2, nSize2);
+	}
+
+	if (!m_FileSystem.FileClose (hFile))
+	{
+		ReportStatus (EXPERIMENT_STATUS_CLOSE_FAILED);
+
+		return FALSE;
+	}
+
+	return bOK;
+}
+
+boolean CExperiment::LoadFileBlock (const char *pFileName, size_t nOffset,
+				    void *pBuffer, size_t nSize)
+{
+	assert (pFileName != 0);
+
+	unsigned hFile = m_FileSystem.FileOpen (pFileName);
+	if (hFile == 0)
+	{
+		ReportStatus (EXPERIMENT_STATUS_OPEN_FAILED);
+
+		return FALSE;
+	}
+
+	boolean bOK = m_FileSystem.FileSeek (hFile, nOffset);
+	if (!bOK)
+	{
+		ReportStatus (EXPERIMENT_STATUS_READ_FAILED);
+	}
+	else
+	{
+		bOK = ReadFile (hFile, pBuffer, nSize);
+	}
+
+	if (!m_FileSystem.FileClose (hFile))
+	{
+		ReportStatus (EXPERIMENT_STATUS_CLOSE_FAILED);
+
+		return FALSE;
+	}
+
+	return bOK;
+}
+
+boolean CExperiment::ReadFile (unsigned hFile, void *pBuffer, size_t nSize)
+{
+	assert (pBuffer != 0);
+	u8 *pTo = (u8 *) pBuffer;
+
+	while (nSize > 0)
+	{
+		unsigned nCount = nSize < READ_CHUNK_SIZE ? nSize : READ_CHUNK_SIZE;
+
+		unsigned nResult = m_FileSystem.FileRead (hFile, pTo, nCount);
+		if (nResult == FS_ERROR)
+		{
+			ReportStatus (EXPERIMENT_STATUS_READ_FAILED);
+
+			return FALSE;
+		}
+
+		if (nResult == 0)		// end of file
+		{
+			break;
+		}
+
+		pTo += nResult;
+		nSize -= nResult;
+	}
+
+	return TRUE;
+}
+
+void CExperiment::SetReportLayout (unsigned nElementSize, unsigned nRowLength)
+{
+	m_Frame.SetLayout (nElementSize, nRowLength);
+}
+
+void CExperiment::ReportMismatch (unsigned nIndex, const void *pValue, const void *pGold)
+{
+	m_Frame.AddMismatch (nIndex, pValue, pGold);
+
+	m_nErrors++;
+}
+
+void CExperiment::CompareGold (const void *pData, const void *pGold, size_t nSize,
+				unsigned nFirstIndex)
+{
+	unsigned nElementSize = m_Frame.GetElementSize ();
+	CGoldComparator Comparator (pData, pGold, nSize, nElementSize);
+
+	unsigned Indices[COMPARE_INDICES];
+	unsigned nIndices;
+	while ((nIndices = Comparator.Next (Indices, COMPARE_INDICES)) > 0)
+	{
+		for (unsigned i = 0; i < nIndices; i++)
+		{
+			size_t nOffset = (size_t) Indices[i] * nElementSize;
+
+			ReportMismatch (nFirstIndex + Indices[i], (const u8 *) pData + nOffset,
+					(const u8 *) pGold + nOffset);
+		}
+	}
+}
+
+void CExperiment::ReportStatus (u32 nStatus)
+{
+	Send (&nStatus, 1);
+}
+
+void CExperiment::ReportPhase (const char *pName, u64 nBytes, u64 nCycles, unsigned nErrors)
+{
+	u32 Report[REPORT_PHASE_WORDS];
+	::ReportPhase (Report, m_nIteration, pName, nBytes, nCycles, nErrors);
+
+	Send (Report, REPORT_PHASE_WORDS);
+}
+
+#if AARCH == 64
+
+void CExperiment::ReportCounters (const TPerfSample &Sample)
+{
+	unsigned nEvents = m_PerfCounters.GetEvents ();
+
+	unsigned Events[PERF_EVENTS];
+	for (unsigned i = 0; i < nEvents; i++)
+	{
+		Events[i] = m_PerfCounters.GetEvent (i);
+	}
+
+	u32 Report[REPORT_COUNTER_WORDS];
+	::ReportCounters (Report, m_nIteration, Sample.nCycles, Events, Sample.Count, nEvents);
+
+	Send (Report, REPORT_COUNTER_WORDS);
+}
+
+#endif
+
+void CExperiment::Send (const u32 *pWords, unsigned nWords)
+{
+	m_Reporter.Write (pWords, nWords * sizeof (u32));
+}
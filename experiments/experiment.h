@@ -0,0 +1,175 @@
+//
+// experiment.h
+//
+// Common runtime of the experiments: owns the devices, mounts the SD card,
+// loads input and gold files, runs the iteration loop with timing and
+// reports the result of each iteration over the UART0 (TXD on GPIO 14,
+// EXPERIMENT_BAUD_RATE 8N1). Reporting is asynchronous (see uartreporter.h).
+//
+// Reports (sequences of 32-bit words, little endian):
+//	REPORT_FRAME_MAGIC ...			one frame per iteration (see reportframe.h)
+//	REPORT_PHASE_MAGIC ...			throughput of a phase (optional, see reportframe.h)
+//	REPORT_COUNTER_MAGIC ...		PMU counts of Execute() on core 0 (AArch64 only)
+//	0xFFxx0000				setup error (see EXPERIMENT_STATUS_*)
+//
+// Use host/decode to decode the reports.
+//
+#ifndef _experiment_h
+#define _experiment_h
+
+#include <circle/actled.h>
+#include <circle/koptions.h>
+#include <circle/devicenameservice.h>
+#include <circle/screen.h>
+#include <circle/serial.h>
+#include <circle/exceptionhandler.h>
+#include <circle/interrupt.h>
+#include <circle/timer.h>
+#include <circle/logger.h>
+#if AARCH == 64
+#include <circle/perfcounters.h>
+#endif
+#include <emmc.h>
+#include <circle/fs/fat/fatfs.h>
+#include <circle/types.h>
+#include <uartreporter.h>
+#include <reportframe.h>
+
+#define EXPERIMENT_PARTITION		"emmc1-1"
+#define EXPERIMENT_BAUD_RATE		115200
+
+#define EXPERIMENT_STATUS_NO_PARTITION	0xFF100000
+#define EXPERIMENT_STATUS_MOUNT_FAILED	0xFF200000
+#define EXPERIMENT_STATUS_OPEN_FAILED	0xFFF00000
+#define EXPERIMENT_STATUS_READ_FAILED	0xFFF10000
+#define EXPERIMENT_STATUS_CLOSE_FAILED	0xFFF40000
+#define EXPERIMENT_STATUS_SETUP_FAILED	0xFFF90000
+
+enum TShutdownMode
+{
+	ShutdownNone,
+	ShutdownHalt,
+	ShutdownReboot
+};
+
+class CExperiment;
+
+class CWorkload		/// Benchmark running in the experiment loop
+{
+public:
+	virtual ~CWorkload (void) {}
+
+	/// \brief Load input and gold data, is called once after the SD card has been mounted
+	/// \return FALSE on fatal error (status has been reported)
+	virtual boolean Setup (CExperiment *pExperiment) = 0;
+
+	/// \brief Wait for the input of the next Execute(), is called before each Execute()
+	/// \note Is not included in the measured time (e.g. for waiting on a reload in the background)
+	virtual void Prepare (void) {}
+
+	/// \brief One execution of the benchmark, this is the measured part
+	virtual void Execute (void) = 0;
+
+	/// \brief Compare the output against the gold data
+	/// \note Has to call pExperiment->ReportMismatch() for each mismatch
+	virtual void Compare (CExperiment *pExperiment) = 0;
+};
+
+class CExperiment
+{
+public:
+	CExperiment (void);
+	~CExperiment (void);
+
+	boolean Initialize (void);
+
+	/// \brief Mount the SD card, set up the workload and run it forever
+	TShutdownMode Run (CWorkload *pWorkload);
+
+	/// \brief Read a file into one or two consecutive buffers
+	/// \return FALSE on error (status has been reported)
+	/// \note A file shorter than the buffers leaves the remainder untouched.
+	boolean LoadFile (const char *pFileName, void *pBuffer, size_t nSize,
+			  void *pBuffer2 = 0, size_t nSize2 = 0);
+
+	/// \brief Read a part of a file
+	/// \return FALSE on error (status has been reported)
+	boolean LoadFileBlock (const char *pFileName, size_t nOffset, void *pBuffer, size_t nSize);
+
+	/// \brief Set the layout of the compared data, should be called in Setup()
+	/// \param nElementSize Size of the compared elements in bytes (multiple of 4)
+	/// \param nRowLength Elements per row (0 for one-dimensional data)
+	void SetReportLayout (unsigned nElementSize, unsigned nRowLength = 0);
+
+	/// \brief Report a mismatch of the current iteration
+	/// \param nIndex Index of the element (in ascending order for a compact report)
+	/// \param pValue Pointer to the wrong element
+	/// \param pGold Pointer to the expected element (0 if the gold data could not be read)
+	void ReportMismatch (unsigned nIndex, const void *pValue, const void *pGold);
+
+	/// \brief Compare data bitwise against gold data and report the mismatches
+	/// \param nSize Size of the data in bytes (multiple of the element size)
+	/// \param nFirstIndex Index of the first element (for comparing in parts)
+	/// \note The element size set with SetReportLayout() has to divide GOLD_COMPARE_GROUP_SIZE.
+	void CompareGold (const void *pData, const void *pGold, size_t nSize, unsigned nFirstIndex = 0);
+
+	/// \brief Send a single status word (e.g. EXPERIMENT_STATUS_*)
+	void ReportStatus (u32 nStatus);
+
+	/// \brief Report the throughput of a phase of the current iteration
+	/// \param pName Name of the phase (up to REPORT_PHASE_NAME_SIZE characters)
+	/// \param nBytes Number of bytes processed in the phase
+	/// \param nCycles Duration of the phase in CPU cycles
+	/// \param nErrors Number of errors found in the phase
+	/// \note Should be called from Compare(), so that it does not disturb the timing.
+	void ReportPhase (const char *pName, u64 nBytes, u64 nCycles, unsigned nErrors = 0);
+
+	/// \return Number of mismatches reported in the current iteration
+	unsigned GetErrorCount (void) const		{ return m_nErrors; }
+	/// \return Duration of the last Execute() in microseconds
+	unsigned GetExecuteTicks (void) const		{ return m_nExecuteTicks; }
+	/// \return Duration of the last Compare() in microseconds
+	unsigned GetCompareTicks (void) const		{ return m_nCompareTicks; }
+	/// \return Number of iterations run so far
+	unsigned GetIteration (void) const		{ return m_nIteration; }
+	/// \return Number of reports dropped, because the transmit queue was full
+	unsigned GetReportOverflows (void) const	{ return m_Reporter.GetOverflows (); }
+
+private:
+	boolean ReadFile (unsigned hFile, void *pBuffer, size_t nSize);
+
+	void Send (const u32 *pWords, unsigned nWords);
+
+#if AARCH == 64
+	void ReportCounters (const TPerfSample &Sample);
+#endif
+
+private:
+	// do not change this order
+	CActLED			m_ActLED;
+	CKernelOptions		m_Options;
+	CDeviceNameService	m_DeviceNameService;
+	CScreenDevice		m_Screen;
+	CSerialDevice		m_Serial;
+	CExceptionHandler	m_ExceptionHandler;
+	CInterruptSystem	m_Interrupt;
+	CTimer			m_Timer;
+	CLogger			m_Logger;
+	CUARTReporter		m_Reporter;
+	CEMMCDevice		m_EMMC;
+	CFATFileSystem		m_FileSystem;
+
+#if AARCH == 64
+	CPerfCounters		m_PerfCounters;
+	boolean			m_bPerfCounters;
+#endif
+
+	CReportFrame m_Frame;
+
+	unsigned m_nIteration;
+	unsigned m_nErrors;
+	unsigned m_nExecuteTicks;
+	unsigned m_nCompareTicks;
+};
+
+#endif
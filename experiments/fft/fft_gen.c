@@ -1,5 +1,22 @@
+/*
+**   Generates the input and the gold file of the fft experiment on the host:
+**
+**      g++ -O2 -c -ffp-contract=off -fno-associative-math -fno-reciprocal-math \
+**          -DNDEBUG -I ../../include fftengine.cpp
+**      g++ -O2 -o fft_gen -DNDEBUG -I ../../include \
+**          -x c++ fft_gen.c -x none fourier.cpp fftmisc.cpp fftengine.o
+**      ./fft_gen <bits> <waves> [fast]
+**
+**   With "fast" the gold file is computed with fft_float_fast() (for
+**   FFT_FAST in kernel.h) and named fft_gold_fast.bin, as it is loaded
+**   by the kernel. Rename the other files to fft_input.bin and
+**   fft_gold.bin for the SD card. Only
+**   fftengine.cpp needs the fixed operation order, fourier.cpp is built
+**   like in the kernel, so that fft_float() gives the original result.
+*/
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include "fourier.h"
 #include <time.h>
@@ -16,9 +33,10 @@ int main(int argc, char** argv){
     char name[2000];
     int MAXSIZE=1<<(atoi(argv[1]));
     int MAXWAVES=atoi(argv[2]);    
+    int fast=argc > 3 && strcmp(argv[3],"fast")==0;
     int *coeff=(int*)malloc(sizeof(int)*MAXWAVES);
     int *amp=(int*)malloc(sizeof(int)*MAXWAVES);
-    float *RealIn=(float*)malloc(sizeof(float)*MAXSIZE);
+    float *RealIn=(float*)calloc(MAXSIZE,sizeof(float));
     float *RealOut=(float*)malloc(sizeof(float)*MAXSIZE);
     float *ImagOut=(float*)malloc(sizeof(float)*MAXSIZE);
     float *ImagIn=(float*)malloc(sizeof(float)*MAXSIZE);
@@ -45,8 +63,16 @@ int main(int argc, char** argv){
     fd =fopen(name,"wb");
     fwrite(RealIn,sizeof(float),MAXSIZE,fd);
     fclose(fd);
-    sprintf(name,"fft_gold_%d.bin",MAXSIZE);
-    fft_float (MAXSIZE,0,RealIn,ImagIn,RealOut,ImagOut);
+    if(fast){
+        sprintf(name,"fft_gold_fast.bin");
+        if(!fft_float_fast (MAXSIZE,RealIn,ImagIn,RealOut,ImagOut)){
+            fprintf(stderr,"fft_float_fast: Cannot allocate the twiddle tables\n");
+            return 1;
+        }
+    }else{
+        sprintf(name,"fft_gold_%d.bin",MAXSIZE);
+        fft_float (MAXSIZE,0,RealIn,ImagIn,RealOut,ImagOut);
+    }
     fd =fopen(name,"wb");
     fwrite(RealOut,sizeof(float),MAXSIZE,fd);
     fwrite(ImagOut,sizeof(float),MAXSIZE,fd);
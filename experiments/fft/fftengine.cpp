@@ -0,0 +1,372 @@
+//
+// fftengine.cpp
+//
+// Radix-4 butterfly on the sub-transforms X0 .. X3 of size L (at the offsets
+// 0, L, 2L, 3L of a group of 4L samples in bit-reversed order, so that X1
+// is the transform of the samples 2 mod 4 and X2 of the samples 1 mod 4),
+// w = e^(2*pi*i/4L) (the sign of fft_float()), 0 <= k < L:
+//
+//	A0 = X0[k], A1 = w^k * X2[k], A2 = w^2k * X1[k], A3 = w^3k * X3[k]
+//	B0 = A0 + A2, B1 = A0 - A2, C0 = A1 + A3, C1 = A1 - A3
+//	Y[k] = B0 + C0, Y[k+L] = B1 + i*C1, Y[k+2L] = B0 - C0, Y[k+3L] = B1 - i*C1
+//
+// (x + iy) * (c + is) = fma (-y, s, x*c) + i * fma (y, c, x*s)
+//
+// This must be compiled with -ffp-contract=off -fno-associative-math
+// -fno-reciprocal-math (see fftengine.h).
+//
+#include "fftengine.h"
+#include "fourier.h"
+#include <assert.h>
+
+#if defined (__aarch64__)
+	#include <arm_neon.h>
+#endif
+
+#define TWIDDLE_GROUP	24			// floats per four k in a twiddle table
+
+#define TWO_PI		6.28318530717958647693
+
+// Taylor series of sin(x) and cos(x) for |x| <= pi/4
+#define SIN_C3		(-1.0 / 6.0)
+#define SIN_C5		(1.0 / 120.0)
+#define SIN_C7		(-1.0 / 5040.0)
+#define SIN_C9		(1.0 / 362880.0)
+#define SIN_C11		(-1.0 / 39916800.0)
+#define SIN_C13		(1.0 / 6227020800.0)
+#define SIN_C15		(-1.0 / 1307674368000.0)
+#define SIN_C17		(1.0 / 355687428096000.0)
+
+#define COS_C2		(-1.0 / 2.0)
+#define COS_C4		(1.0 / 24.0)
+#define COS_C6		(-1.0 / 720.0)
+#define COS_C8		(1.0 / 40320.0)
+#define COS_C10		(-1.0 / 3628800.0)
+#define COS_C12		(1.0 / 479001600.0)
+#define COS_C14		(-1.0 / 87178291200.0)
+#define COS_C16		(1.0 / 20922789888000.0)
+#define COS_C18		(-1.0 / 6402373705728000.0)
+
+static inline void Multiply (float *pReal, float *pImag, float x, float y, float c, float s)
+{
+	*pReal = __builtin_fmaf (-y, s, x * c);
+	*pImag = __builtin_fmaf (y, c, x * s);
+}
+
+CFFTEngine::CFFTEngine (void)
+:	m_nLog2Size (0),
+	m_nSize (0),
+	m_pTwiddles (0)
+{
+	for (unsigned i = 0; i < FFT_MAX_LOG2_SIZE/2; i++)
+	{
+		m_pStageTwiddles[i] = 0;
+	}
+}
+
+CFFTEngine::~CFFTEngine (void)
+{
+	delete [] m_pTwiddles;
+	m_pTwiddles = 0;
+}
+
+boolean CFFTEngine::Initialize (unsigned nLog2Size)
+{
+	assert (2 <= nLog2Size && nLog2Size <= FFT_MAX_LOG2_SIZE);
+	assert (m_pTwiddles == 0);
+
+	m_nLog2Size = nLog2Size;
+	m_nSize = 1 << nLog2Size;
+
+	unsigned nFirstSpan = nLog2Size & 1 ? 2 : 1;
+
+	unsigned nTableSize = 0;
+	for (unsigned nSpan = nFirstSpan; 4*nSpan <= m_nSize; nSpan *= 4)
+	{
+		nTableSize += (nSpan + 3) / 4 * TWIDDLE_GROUP;
+	}
+
+	m_pTwiddles = new float[nTableSize];
+	if (m_pTwiddles == 0)
+	{
+		return FALSE;
+	}
+
+	float *pTable = m_pTwiddles;
+	for (unsigned nSpan = nFirstSpan; 4*nSpan <= m_nSize; nSpan *= 4)
+	{
+		m_pStageTwiddles[__builtin_ctz (nSpan) / 2] = pTable;
+
+		for (unsigned k = 0; k < (nSpan + 3) / 4 * 4; k++)	// padded for nSpan < 4
+		{
+			float *pGroup = pTable + k/4 * TWIDDLE_GROUP + k%4;
+
+			for (unsigned j = 1; j <= 3; j++)
+			{
+				Twiddle (&pGroup[(j-1) * 8], &pGroup[(j-1) * 8 + 4], j*k % (4*nSpan), 4*nSpan);
+			}
+		}
+
+		pTable += (nSpan + 3) / 4 * TWIDDLE_GROUP;
+	}
+
+	return TRUE;
+}
+
+void CFFTEngine::Transform (float *pRealOut, float *pImagOut, const float *pRealIn, const float *pImagIn)
+{
+	assert (m_pTwiddles != 0);
+	assert (pRealOut != 0);
+	assert (pImagOut != 0);
+
+	BitReverseCopy (m_nLog2Size, pRealIn, pImagIn, pRealOut, pImagOut);
+
+	static const unsigned Limits[] = {FFT_L1_BLOCK_SIZE, FFT_L2_BLOCK_SIZE, 1 << FFT_MAX_LOG2_SIZE};
+
+	unsigned nFromSize = 1;
+	for (unsigned i = 0; i < sizeof Limits / sizeof Limits[0]; i++)
+	{
+		unsigned nToSize = GetStageSize (Limits[i]);
+		if (nToSize <= nFromSize)
+		{
+			continue;
+		}
+
+		for (unsigned nBlock = 0; nBlock < m_nSize; nBlock += nToSize)
+		{
+			TransformBlock (pRealOut + nBlock, pImagOut + nBlock, nFromSize, nToSize);
+		}
+
+		nFromSize = nToSize;
+	}
+}
+
+void CFFTEngine::TransformBlock (float *pReal, float *pImag, unsigned nFromSize, unsigned nToSize) const
+{
+	unsigned nSpan = nFromSize;
+
+	if (nSpan == 1 && (m_nLog2Size & 1))
+	{
+		Radix2Stage (pReal, pImag, nToSize);
+
+		nSpan = 2;
+	}
+
+	for (; 4*nSpan <= nToSize; nSpan *= 4)
+	{
+		Radix4Stage (pReal, pImag, nToSize, nSpan);
+	}
+
+	assert (nSpan == nToSize);
+}
+
+void CFFTEngine::Radix2Stage (float *pReal, float *pImag, unsigned nSize)
+{
+	unsigned i = 0;
+
+#if defined (__aarch64__)
+	for (; i+8 <= nSize; i += 8)
+	{
+		float32x4x2_t vReal = vld2q_f32 (&pReal[i]);	// even and odd samples
+		float32x4x2_t vImag = vld2q_f32 (&pImag[i]);
+
+		float32x4x2_t vRealOut = {{vaddq_f32 (vReal.val[0], vReal.val[1]),
+					   vsubq_f32 (vReal.val[0], vReal.val[1])}};
+		float32x4x2_t vImagOut = {{vaddq_f32 (vImag.val[0], vImag.val[1]),
+					   vsubq_f32 (vImag.val[0], vImag.val[1])}};
+
+		vst2q_f32 (&pReal[i], vRealOut);
+		vst2q_f32 (&pImag[i], vImagOut);
+	}
+#endif
+
+	for (; i < nSize; i += 2)
+	{
+		float fReal = pReal[i+1];
+		float fImag = pImag[i+1];
+
+		pReal[i+1] = pReal[i] - fReal;
+		pImag[i+1] = pImag[i] - fImag;
+		pReal[i] += fReal;
+		pImag[i] += fImag;
+	}
+}
+
+void CFFTEngine::Radix4Stage (float *pReal, float *pImag, unsigned nSize, unsigned nSpan) const
+{
+	const float *pTable = m_pStageTwiddles[__builtin_ctz (nSpan) / 2];
+	assert (pTable != 0);
+
+	for (unsigned nGroup = 0; nGroup < nSize; nGroup += 4*nSpan)
+	{
+		float *pR0 = pReal + nGroup;
+		float *pR1 = pR0 + nSpan;
+		float *pR2 = pR1 + nSpan;
+		float *pR3 = pR2 + nSpan;
+		float *pI0 = pImag + nGroup;
+		float *pI1 = pI0 + nSpan;
+		float *pI2 = pI1 + nSpan;
+		float *pI3 = pI2 + nSpan;
+
+		unsigned k = 0;
+
+#if defined (__aarch64__)
+		for (; k+4 <= nSpan; k += 4)
+		{
+			const float *pW = pTable + k/4 * TWIDDLE_GROUP;
+
+			float32x4_t vX0r = vld1q_f32 (&pR0[k]), vX0i = vld1q_f32 (&pI0[k]);
+			float32x4_t vX1r = vld1q_f32 (&pR1[k]), vX1i = vld1q_f32 (&pI1[k]);
+			float32x4_t vX2r = vld1q_f32 (&pR2[k]), vX2i = vld1q_f32 (&pI2[k]);
+			float32x4_t vX3r = vld1q_f32 (&pR3[k]), vX3i = vld1q_f32 (&pI3[k]);
+
+			float32x4_t vW1r = vld1q_f32 (pW),      vW1i = vld1q_f32 (pW + 4);
+			float32x4_t vW2r = vld1q_f32 (pW + 8),  vW2i = vld1q_f32 (pW + 12);
+			float32x4_t vW3r = vld1q_f32 (pW + 16), vW3i = vld1q_f32 (pW + 20);
+
+			float32x4_t vA1r = vfmsq_f32 (vmulq_f32 (vX2r, vW1r), vX2i, vW1i);
+			float32x4_t vA1i = vfmaq_f32 (vmulq_f32 (vX2r, vW1i), vX2i, vW1r);
+			float32x4_t vA2r = vfmsq_f32 (vmulq_f32 (vX1r, vW2r), vX1i, vW2i);
+			float32x4_t vA2i = vfmaq_f32 (vmulq_f32 (vX1r, vW2i), vX1i, vW2r);
+			float32x4_t vA3r = vfmsq_f32 (vmulq_f32 (vX3r, vW3r), vX3i, vW3i);
+			float32x4_t vA3i = vfmaq_f32 (vmulq_f32 (vX3r, vW3i), vX3i, vW3r);
+
+			float32x4_t vB0r = vaddq_f32 (vX0r, vA2r), vB0i = vaddq_f32 (vX0i, vA2i);
+			float32x4_t vB1r = vsubq_f32 (vX0r, vA2r), vB1i = vsubq_f32 (vX0i, vA2i);
+			float32x4_t vC0r = vaddq_f32 (vA1r, vA3r), vC0i = vaddq_f32 (vA1i, vA3i);
+			float32x4_t vC1r = vsubq_f32 (vA1r, vA3r), vC1i = vsubq_f32 (vA1i, vA3i);
+
+			vst1q_f32 (&pR0[k], vaddq_f32 (vB0r, vC0r));
+			vst1q_f32 (&pI0[k], vaddq_f32 (vB0i, vC0i));
+			vst1q_f32 (&pR1[k], vsubq_f32 (vB1r, vC1i));
+			vst1q_f32 (&pI1[k], vaddq_f32 (vB1i, vC1r));
+			vst1q_f32 (&pR2[k], vsubq_f32 (vB0r, vC0r));
+			vst1q_f32 (&pI2[k], vsubq_f32 (vB0i, vC0i));
+			vst1q_f32 (&pR3[k], vaddq_f32 (vB1r, vC1i));
+			vst1q_f32 (&pI3[k], vsubq_f32 (vB1i, vC1r));
+		}
+#endif
+
+		for (; k < nSpan; k++)
+		{
+			const float *pW = pTable + k/4 * TWIDDLE_GROUP + k%4;
+
+			float fA1r, fA1i, fA2r, fA2i, fA3r, fA3i;
+			Multiply (&fA1r, &fA1i, pR2[k], pI2[k], pW[0], pW[4]);
+			Multiply (&fA2r, &fA2i, pR1[k], pI1[k], pW[8], pW[12]);
+			Multiply (&fA3r, &fA3i, pR3[k], pI3[k], pW[16], pW[20]);
+
+			float fB0r = pR0[k] + fA2r, fB0i = pI0[k] + fA2i;
+			float fB1r = pR0[k] - fA2r, fB1i = pI0[k] - fA2i;
+			float fC0r = fA1r + fA3r, fC0i = fA1i + fA3i;
+			float fC1r = fA1r - fA3r, fC1i = fA1i - fA3i;
+
+			pR0[k] = fB0r + fC0r;
+			pI0[k] = fB0i + fC0i;
+			pR1[k] = fB1r - fC1i;
+			pI1[k] = fB1i + fC1r;
+			pR2[k] = fB0r - fC0r;
+			pI2[k] = fB0i - fC0i;
+			pR3[k] = fB1r + fC1i;
+			pI3[k] = fB1i - fC1r;
+		}
+	}
+}
+
+unsigned CFFTEngine::GetStageSize (unsigned nLimit) const
+{
+	unsigned nSize = m_nSize;
+	while (nSize > nLimit)
+	{
+		nSize >>= 2;			// the stages are radix-4, except the first one
+	}
+
+	return nSize;
+}
+
+void CFFTEngine::Twiddle (float *pReal, float *pImag, unsigned nIndex, unsigned nPeriod)
+{
+	assert (nPeriod % 4 == 0);
+	assert (nIndex < nPeriod);
+
+	// reduce the angle to [0, pi/4], the index arithmetic is exact
+	boolean bNegateSin = FALSE;
+	if (2*nIndex > nPeriod)			// sin (2pi - x) = -sin (x)
+	{
+		nIndex = nPeriod - nIndex;
+		bNegateSin = TRUE;
+	}
+
+	boolean bQuadrant = FALSE;
+	if (4*nIndex > nPeriod)			// cos (x + pi/2) = -sin (x)
+	{
+		nIndex -= nPeriod / 4;
+		bQuadrant = TRUE;
+	}
+
+	boolean bSwap = FALSE;
+	if (8*nIndex > nPeriod)			// cos (pi/2 - x) = sin (x)
+	{
+		nIndex = nPeriod / 4 - nIndex;
+		bSwap = TRUE;
+	}
+
+	double x = nIndex * (TWO_PI / nPeriod);
+	double x2 = x * x;
+
+	double p = __builtin_fma (SIN_C17, x2, SIN_C15);
+	p = __builtin_fma (p, x2, SIN_C13);
+	p = __builtin_fma (p, x2, SIN_C11);
+	p = __builtin_fma (p, x2, SIN_C9);
+	p = __builtin_fma (p, x2, SIN_C7);
+	p = __builtin_fma (p, x2, SIN_C5);
+	p = __builtin_fma (p, x2, SIN_C3);
+	double fSin = __builtin_fma (x * x2, p, x);
+
+	double q = __builtin_fma (COS_C18, x2, COS_C16);
+	q = __builtin_fma (q, x2, COS_C14);
+	q = __builtin_fma (q, x2, COS_C12);
+	q = __builtin_fma (q, x2, COS_C10);
+	q = __builtin_fma (q, x2, COS_C8);
+	q = __builtin_fma (q, x2, COS_C6);
+	q = __builtin_fma (q, x2, COS_C4);
+	q = __builtin_fma (q, x2, COS_C2);
+	double fCos = __builtin_fma (x2, q, 1.0);
+
+	if (bSwap)
+	{
+		double fTemp = fSin;
+		fSin = fCos;
+		fCos = fTemp;
+	}
+
+	if (bQuadrant)
+	{
+		double fTemp = fSin;
+		fSin = fCos;
+		fCos = -fTemp;
+	}
+
+	if (bNegateSin)
+	{
+		fSin = -fSin;
+	}
+
+	*pReal = (float) fCos;
+	*pImag = (float) fSin;
+}
+
+int fft_float_fast (unsigned NumSamples, float *RealIn, float *ImagIn, float *RealOut, float *ImagOut)
+{
+	assert (IsPowerOfTwo (NumSamples));
+
+	CFFTEngine Engine;
+	if (!Engine.Initialize (NumberOfBitsNeeded (NumSamples)))
+	{
+		return 0;
+	}
+
+	Engine.Transform (RealOut, ImagOut, RealIn, ImagIn);
+
+	return 1;
+}
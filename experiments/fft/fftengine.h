@@ -0,0 +1,69 @@
+//
+// fftengine.h
+//
+// Forward FFT of 2^n float samples, free of Circle dependencies, so that it
+// can be built for the host too (see fft_gen.c).
+//
+// After the bit-reversal copy the transform runs in place with radix-4
+// butterflies (plus one radix-2 stage, if n is odd), four butterflies at once
+// with NEON. The twiddle factors are precomputed per stage as float. The
+// stages are run block by block, first on blocks that fit into the L1 cache,
+// then on blocks that fit into the L2 cache and then on the whole array.
+//
+// The results differ from fft_float() (which computes the twiddle factors
+// with a recurrence in double), so this needs its own gold data. The
+// twiddle factors are computed with a fixed polynomial, the fused
+// multiply-adds are explicit and the operation order is fixed (compiled with
+// -ffp-contract=off -fno-associative-math -fno-reciprocal-math), so that the
+// NEON code and the scalar code give the same result on all machines.
+//
+#ifndef _fftengine_h
+#define _fftengine_h
+
+#include <circle/types.h>
+
+#define FFT_MAX_LOG2_SIZE	24
+
+#define FFT_L1_BLOCK_SIZE	2048		// complex samples, 16 KByte
+#define FFT_L2_BLOCK_SIZE	32768		// complex samples, 256 KByte
+
+class CFFTEngine
+{
+public:
+	CFFTEngine (void);
+	~CFFTEngine (void);
+
+	/// \brief Allocates the twiddle tables
+	/// \param nLog2Size Transform size is 2^nLog2Size (2 .. FFT_MAX_LOG2_SIZE)
+	boolean Initialize (unsigned nLog2Size);
+
+	/// \brief Forward transform as fft_float() (with e^(+2*pi*i*k*n/N)), not normalized
+	/// \param pImagIn 0 for real input
+	void Transform (float *pRealOut, float *pImagOut, const float *pRealIn, const float *pImagIn);
+
+private:
+	/// \brief Run the stages, which give sub-transforms of nFromSize .. nToSize samples
+	void TransformBlock (float *pReal, float *pImag, unsigned nFromSize, unsigned nToSize) const;
+
+	static void Radix2Stage (float *pReal, float *pImag, unsigned nSize);
+
+	/// \param nSpan Size of the sub-transforms before this stage
+	void Radix4Stage (float *pReal, float *pImag, unsigned nSize, unsigned nSpan) const;
+
+	/// \return Largest size of a sub-transform <= nLimit, which is produced by a stage
+	unsigned GetStageSize (unsigned nLimit) const;
+
+	/// \brief Computes e^(2*pi*i * nIndex/nPeriod) in double and rounds it to float
+	static void Twiddle (float *pReal, float *pImag, unsigned nIndex, unsigned nPeriod);
+
+private:
+	unsigned m_nLog2Size;
+	unsigned m_nSize;
+
+	// per radix-4 stage with span L: w^k, w^2k, w^3k with w = e^(2*pi*i/4L),
+	// 0 <= k < L, for groups of four k: real w^k, imag w^k, real w^2k, ...
+	float *m_pTwiddles;
+	float *m_pStageTwiddles[FFT_MAX_LOG2_SIZE/2];	// indexed by log4 (L)
+};
+
+#endif
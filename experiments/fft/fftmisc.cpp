@@ -68,6 +68,72 @@ unsigned ReverseBits ( unsigned index, unsigned NumBits )
 }
 
 
+/*
+**   Copies the samples to the outputs in bit-reversed order.  For more
+**   than 256 samples the index bits are split into the top, middle and
+**   bottom part (BITREV_BITS each for the top and bottom) and a tile of
+**   all top and bottom parts is copied for each middle part.  The tile
+**   touches only 2*16 cache lines per array, so that the scattered
+**   writes do not miss the cache (and the TLB) for every sample.
+*/
+
+#define BITREV_BITS   4
+#define BITREV_TILE   (1 << BITREV_BITS)
+
+static const unsigned char Reverse4[BITREV_TILE] =
+    { 0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15 };
+
+void BitReverseCopy (
+    unsigned     NumBits,
+    const float *RealIn,
+    const float *ImagIn,
+    float       *RealOut,
+    float       *ImagOut )
+{
+    unsigned NumSamples = 1 << NumBits;
+    unsigned i, j, k, a, b, m, rm;
+
+    if ( NumBits < 2*BITREV_BITS )
+    {
+        /* j is ReverseBits(i, NumBits), incremented from the top bit down */
+        for ( i=j=0; i < NumSamples; i++ )
+        {
+            RealOut[j] = RealIn[i];
+            ImagOut[j] = (ImagIn == NULL) ? 0.0 : ImagIn[i];
+
+            for ( k = NumSamples >> 1; j & k; k >>= 1 )
+                j ^= k;
+            j |= k;
+        }
+
+        return;
+    }
+
+    unsigned TopShift = NumBits - BITREV_BITS;
+    unsigned NumMiddle = 1 << (NumBits - 2*BITREV_BITS);
+
+    for ( m=rm=0; m < NumMiddle; m++ )
+    {
+        for ( a=0; a < BITREV_TILE; a++ )
+        {
+            for ( b=0; b < BITREV_TILE; b++ )
+            {
+                i = (a << TopShift) | (m << BITREV_BITS) | b;
+                j = (Reverse4[b] << TopShift) | (rm << BITREV_BITS) | Reverse4[a];
+
+                RealOut[j] = RealIn[i];
+                ImagOut[j] = (ImagIn == NULL) ? 0.0 : ImagIn[i];
+            }
+        }
+
+        /* rm is the bit-reversed m */
+        for ( k = NumMiddle >> 1; rm & k; k >>= 1 )
+            rm ^= k;
+        rm |= k;
+    }
+}
+
+
 double Index_to_frequency ( unsigned NumSamples, unsigned Index )
 {
     if ( Index >= NumSamples )
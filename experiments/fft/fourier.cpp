@@ -32,7 +32,6 @@ void fft_float (
     float    *RealOut,
     float    *ImagOut )
 {
-    unsigned NumBits;    /* Number of bits needed to store indices */
     unsigned i, j, k, n;
     unsigned BlockSize, BlockEnd;
 
@@ -43,18 +42,11 @@ void fft_float (
         angle_numerator = -angle_numerator;
 
 
-    NumBits = NumberOfBitsNeeded ( NumSamples );
-
     /*
     **   Do simultaneous data copy and bit-reversal ordering into outputs...
     */
 
-    for ( i=0; i < NumSamples; i++ )
-    {
-        j = ReverseBits ( i, NumBits );
-        RealOut[j] = RealIn[i];
-        ImagOut[j] = (ImagIn == NULL) ? 0.0 : ImagIn[i];
-    }
+    BitReverseCopy ( NumberOfBitsNeeded ( NumSamples ), RealIn, ImagIn, RealOut, ImagOut );
 
     /*
     **   Do the FFT itself...
@@ -70,7 +62,6 @@ void fft_float (
         double cm1 = cos ( -delta_angle );
         double w = 2 * cm1;
         double ar[3], ai[3];
-        double temp;
 
         for ( i=0; i < NumSamples; i += BlockSize )
         {
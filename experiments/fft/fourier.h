@@ -46,10 +46,32 @@ void fft_float (
     float    *ImaginaryOut );      /* array of output's imaginaries */
 
 
+/*
+**   fft_float_fast() computes the forward transform with the radix-4
+**   engine (see fftengine.h).  The results are rounded differently
+**   than those of fft_float().  It returns 0, if the twiddle tables
+**   cannot be allocated (the outputs are not written then).
+*/
+
+int fft_float_fast (
+    unsigned  NumSamples,          /* must be a power of 2, >= 4 */
+    float    *RealIn,              /* array of input's real samples */
+    float    *ImaginaryIn,         /* array of input's imag samples */
+    float    *RealOut,             /* array of output's reals */
+    float    *ImaginaryOut );      /* array of output's imaginaries */
+
+
 int IsPowerOfTwo ( unsigned x );
 unsigned NumberOfBitsNeeded ( unsigned PowerOfTwo );
 unsigned ReverseBits ( unsigned index, unsigned NumBits );
 
+void BitReverseCopy (
+    unsigned     NumBits,          /* copies 2^NumBits samples */
+    const float *RealIn,
+    const float *ImaginaryIn,      /* NULL for all zeroes */
+    float       *RealOut,
+    float       *ImaginaryOut );
+
 /*
 **   The following function returns an "abstract frequency" of a
 **   given index into a buffer with a given number of frequency samples.
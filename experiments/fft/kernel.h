@@ -20,58 +20,38 @@
 #ifndef _kernel_h
 #define _kernel_h
 
-#include <circle/actled.h>
-#include <circle/koptions.h>
-#include <circle/devicenameservice.h>
-#include <circle/screen.h>
-#include <circle/serial.h>
-#include <circle/exceptionhandler.h>
-#include <circle/interrupt.h>
-#include <circle/timer.h>
-#include <circle/logger.h>
-#include <emmc.h>
-#include <circle/fs/fat/fatfs.h>
+#include <experiment.h>
 #include <circle/types.h>
-#include <circle/gpiomanager.h>
-#include <softserial.h>
+#include "fftengine.h"
 
-enum TShutdownMode
-{
-	ShutdownNone,
-	ShutdownHalt,
-	ShutdownReboot
-};
+#define SIZE_ARRAY	21
+
+// Define FFT_FAST to use the radix-4 NEON engine (see fftengine.h), which
+// has its own gold file (fft_gen <bits> <waves> fast). Otherwise the original
+// fft_float() runs and gives the bit pattern of the original gold file.
+//#define FFT_FAST
+
+#define INPUT_FILENAME	"fft_input.bin"
+#ifdef FFT_FAST
+	#define GOLD_FILENAME	"fft_gold_fast.bin"
+#else
+	#define GOLD_FILENAME	"fft_gold.bin"
+#endif
 
-class CKernel
+class CFFT : public CWorkload
 {
 public:
-	CKernel (void);
-	~CKernel (void);
-
-	boolean Initialize (void);
-	void send_message(int size);
-	void init_input(void);
-	void init_gold(void);
-	TShutdownMode Run (void);
-	
-private:
-	// do not change this order
-	CActLED			m_ActLED;
-	CKernelOptions		m_Options;
-	CDeviceNameService	m_DeviceNameService;
-	CScreenDevice		m_Screen;
-	CSerialDevice		m_Serial;
-	CExceptionHandler	m_ExceptionHandler;
-	CInterruptSystem	m_Interrupt;
-	CTimer			m_Timer;
-	CLogger			m_Logger;
-	CGPIOManager		m_GPIOManager;	
-	CSoftSerialDevice	m_SoftSerial;
-	CEMMCDevice		m_EMMC;
-	CFATFileSystem		m_FileSystem;
-	unsigned int buffer[10];
+	CFFT (void);
+	~CFFT (void);
 
+	boolean Setup (CExperiment *pExperiment);
+	void Execute (void);
+	void Compare (CExperiment *pExperiment);
 
+#ifdef FFT_FAST
+private:
+	CFFTEngine m_Engine;
+#endif
 };
 
 #endif
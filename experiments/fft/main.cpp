@@ -22,16 +22,17 @@
 
 int main (void)
 {
-	// cannot return here because some destructors used in CKernel are not implemented
+	// cannot return here because some destructors used in CExperiment are not implemented
 
-	CKernel Kernel;
-	if (!Kernel.Initialize ())
+	CExperiment Experiment;
+	if (!Experiment.Initialize ())
 	{
 		halt ();
 		return EXIT_HALT;
 	}
-	
-	TShutdownMode ShutdownMode = Kernel.Run ();
+
+	CFFT Workload;
+	TShutdownMode ShutdownMode = Experiment.Run (&Workload);
 
 	switch (ShutdownMode)
 	{
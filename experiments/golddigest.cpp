@@ -0,0 +1,202 @@
+//
+// golddigest.cpp
+//
+// The hash uses 16 independent 32-bit lanes (the round of xxHash32), which are
+// processed as four NEON vectors per 64 bytes, and folds the lanes into
+// 64 bits at the end of a block. The scalar code gives the same result.
+//
+#include "golddigest.h"
+#include <experiment.h>
+#include <circle/synchronize.h>
+#include <assert.h>
+
+#if defined (__aarch64__)
+	#include <arm_neon.h>
+#endif
+
+#define PRIME32_1	0x9E3779B1U
+#define PRIME32_2	0x85EBCA77U
+#define PRIME64_1	0x9E3779B185EBCA87ULL
+#define PRIME64_2	0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3	0x165667B19E3779F9ULL
+
+#define LANES		16
+#define CHUNK_SIZE	(LANES * sizeof (u32))
+
+#define LOAD_SIZE	(64 * GOLD_DIGEST_BLOCK_SIZE)
+
+static u8 s_Buffer[LOAD_SIZE] ALIGN (64);
+
+CGoldDigest::CGoldDigest (void)
+:	m_pFileName (0),
+	m_nSize (0),
+	m_pDigests (0),
+	m_nBlocks (0)
+{
+}
+
+CGoldDigest::~CGoldDigest (void)
+{
+	delete [] m_pDigests;
+	m_pDigests = 0;
+}
+
+boolean CGoldDigest::Load (CExperiment *pExperiment, const char *pFileName, size_t nSize)
+{
+	assert (pExperiment != 0);
+	assert (pFileName != 0);
+	assert (nSize > 0);
+	assert (nSize % sizeof (u32) == 0);
+
+	m_pFileName = pFileName;
+	m_nSize = nSize;
+	m_nBlocks = (nSize + GOLD_DIGEST_BLOCK_SIZE-1) / GOLD_DIGEST_BLOCK_SIZE;
+
+	delete [] m_pDigests;
+	m_pDigests = new u64[m_nBlocks];
+	if (m_pDigests == 0)
+	{
+		return FALSE;
+	}
+
+	unsigned nBlock = 0;
+	for (size_t nOffset = 0; nOffset < nSize; nOffset += LOAD_SIZE)
+	{
+		size_t nLength = nSize - nOffset < LOAD_SIZE ? nSize - nOffset : LOAD_SIZE;
+
+		if (!pExperiment->LoadFileBlock (pFileName, nOffset, s_Buffer, nLength))
+		{
+			return FALSE;
+		}
+
+		for (size_t i = 0; i < nLength; i += GOLD_DIGEST_BLOCK_SIZE)
+		{
+			size_t nBlockSize =   nLength - i < GOLD_DIGEST_BLOCK_SIZE
+					    ? nLength - i : GOLD_DIGEST_BLOCK_SIZE;
+
+			assert (nBlock < m_nBlocks);
+			m_pDigests[nBlock++] = Hash (&s_Buffer[i], nBlockSize);
+		}
+	}
+
+	return TRUE;
+}
+
+void CGoldDigest::Compare (CExperiment *pExperiment, const void *pData, unsigned nElementSize)
+{
+	assert (pExperiment != 0);
+	assert (pData != 0);
+	assert (m_pDigests != 0);
+	assert (nElementSize > 0);
+	assert (nElementSize % sizeof (u32) == 0);
+	assert (GOLD_DIGEST_BLOCK_SIZE % nElementSize == 0);
+
+	const u8 *pBlock = (const u8 *) pData;
+	for (unsigned nBlock = 0; nBlock < m_nBlocks; nBlock++, pBlock += GOLD_DIGEST_BLOCK_SIZE)
+	{
+		size_t nOffset = (size_t) nBlock * GOLD_DIGEST_BLOCK_SIZE;
+		size_t nBlockSize =   m_nSize - nOffset < GOLD_DIGEST_BLOCK_SIZE
+				    ? m_nSize - nOffset : GOLD_DIGEST_BLOCK_SIZE;
+
+		if (Hash (pBlock, nBlockSize) == m_pDigests[nBlock])
+		{
+			continue;
+		}
+
+		// get the gold data of this block for the element-level report
+		if (!pExperiment->LoadFileBlock (m_pFileName, nOffset, s_Buffer, nBlockSize))
+		{
+			// the wrong elements are unknown, report the whole block
+			for (size_t i = 0; i < nBlockSize; i += nElementSize)
+			{
+				pExperiment->ReportMismatch ((nOffset + i) / nElementSize, pBlock + i, 0);
+			}
+
+			continue;
+		}
+
+		pExperiment->CompareGold (pBlock, s_Buffer, nBlockSize, nOffset / nElementSize);
+	}
+}
+
+#define ROTL32(x, n)	((x) << (n) | (x) >> (32-(n)))
+#define ROTL64(x, n)	((x) << (n) | (x) >> (64-(n)))
+
+u64 CGoldDigest::Hash (const void *pData, size_t nSize)
+{
+	assert (pData != 0);
+	assert (nSize % sizeof (u32) == 0);
+	const u32 *pWords = (const u32 *) pData;
+
+	u32 Lanes[LANES] ALIGN (16);
+	for (unsigned i = 0; i < LANES; i++)
+	{
+		Lanes[i] = PRIME32_1 * (i+1);
+	}
+
+	size_t nChunks = nSize / CHUNK_SIZE;
+
+#if defined (__aarch64__)
+	uint32x4_t vAcc0 = vld1q_u32 (&Lanes[0]);
+	uint32x4_t vAcc1 = vld1q_u32 (&Lanes[4]);
+	uint32x4_t vAcc2 = vld1q_u32 (&Lanes[8]);
+	uint32x4_t vAcc3 = vld1q_u32 (&Lanes[12]);
+	uint32x4_t vPrime1 = vdupq_n_u32 (PRIME32_1);
+	uint32x4_t vPrime2 = vdupq_n_u32 (PRIME32_2);
+
+#define HASH_ROUND(acc, offset)						\
+	do {								\
+		acc = vmlaq_u32 (acc, vld1q_u32 (pWords + (offset)), vPrime2); \
+		acc = vsriq_n_u32 (vshlq_n_u32 (acc, 13), acc, 19);	\
+		acc = vmulq_u32 (acc, vPrime1);				\
+	} while (0)
+
+	for (size_t n = 0; n < nChunks; n++, pWords += LANES)
+	{
+		HASH_ROUND (vAcc0, 0);
+		HASH_ROUND (vAcc1, 4);
+		HASH_ROUND (vAcc2, 8);
+		HASH_ROUND (vAcc3, 12);
+	}
+
+	vst1q_u32 (&Lanes[0], vAcc0);
+	vst1q_u32 (&Lanes[4], vAcc1);
+	vst1q_u32 (&Lanes[8], vAcc2);
+	vst1q_u32 (&Lanes[12], vAcc3);
+#else
+	for (size_t n = 0; n < nChunks; n++, pWords += LANES)
+	{
+		for (unsigned i = 0; i < LANES; i++)
+		{
+			u32 nLane = Lanes[i] + pWords[i] * PRIME32_2;
+			Lanes[i] = ROTL32 (nLane, 13) * PRIME32_1;
+		}
+	}
+#endif
+
+	// tail (less than one chunk), padded with zeros
+	unsigned nRest = (nSize % CHUNK_SIZE) / sizeof (u32);
+	if (nRest > 0)
+	{
+		for (unsigned i = 0; i < LANES; i++)
+		{
+			u32 nLane = Lanes[i] + (i < nRest ? pWords[i] : 0) * PRIME32_2;
+			Lanes[i] = ROTL32 (nLane, 13) * PRIME32_1;
+		}
+	}
+
+	u64 nHash = PRIME64_3 + nSize;
+	for (unsigned i = 0; i < LANES; i++)
+	{
+		nHash ^= Lanes[i] * PRIME64_2;
+		nHash = ROTL64 (nHash, 31) * PRIME64_1;
+	}
+
+	nHash ^= nHash >> 33;
+	nHash *= PRIME64_2;
+	nHash ^= nHash >> 29;
+	nHash *= PRIME64_3;
+	nHash ^= nHash >> 32;
+
+	return nHash;
+}
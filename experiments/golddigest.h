@@ -0,0 +1,47 @@
+//
+// golddigest.h
+//
+// Compares the output of a workload against a gold file, of which only one
+// 64-bit hash per GOLD_DIGEST_BLOCK_SIZE bytes is kept in memory. Only the
+// blocks with a different hash are read again from the SD card to find the
+// wrong elements. This saves the memory of the gold data.
+//
+#ifndef _golddigest_h
+#define _golddigest_h
+
+#include <circle/types.h>
+
+#define GOLD_DIGEST_BLOCK_SIZE	4096
+
+class CExperiment;
+
+class CGoldDigest
+{
+public:
+	CGoldDigest (void);
+	~CGoldDigest (void);
+
+	/// \brief Read the gold file once and compute the block hashes
+	/// \param pFileName Gold file (must remain valid)
+	/// \param nSize Size of the compared data in bytes (multiple of 4)
+	/// \return FALSE on error (status has been reported)
+	boolean Load (CExperiment *pExperiment, const char *pFileName, size_t nSize);
+
+	/// \brief Compare data against the gold file and report the wrong elements
+	/// \param nElementSize Size of the elements in bytes (as set with SetReportLayout())
+	/// \note All elements of a block with a different hash are reported, if its gold
+	///	  data cannot be read again.
+	void Compare (CExperiment *pExperiment, const void *pData, unsigned nElementSize);
+
+	/// \return 64-bit hash of nSize bytes (multiple of 4) of data
+	static u64 Hash (const void *pData, size_t nSize);
+
+private:
+	const char *m_pFileName;
+	size_t m_nSize;
+
+	u64 *m_pDigests;			// one per block
+	unsigned m_nBlocks;
+};
+
+#endif
@@ -0,0 +1,796 @@
+//
+// bench.cpp
+//
+// Host driver for the compute kernels of the experiments. Runs each workload
+// with the same problem size as on the Raspberry Pi, checks the output
+// against gold data and reports the time per iteration and the throughput.
+//
+// usage: bench [-n iterations] [-d dir] [-w dir] [workload...]
+//
+//	-n	number of timed iterations (default 5)
+//	-d	load input and gold files from dir (same names as on the SD card)
+//	-w	write the generated input and the gold output to dir
+//
+// Without -d synthetic input is generated and the output of the first
+// iteration is the gold for all further iterations.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "../fft/fourier.h"
+#include "../fft/fftengine.h"
+#include "../lud/common.h"
+#include "../lud/blocklu.h"
+#include "../lavaMD/kernel_cpu.h"
+#include "../qsort/qsort.h"
+#include "../qsort/sorter.h"
+#include "../hotspot/hotspot.h"
+#include "../matmul/sgemm.h"
+#include "../susan/susan.h"
+
+#define MAX_SEGMENTS		4
+
+struct TSegment			// part of an input or gold file
+{
+	const char	*pFileName;	// consecutive segments of one file have the same name
+	void		*pData;
+	size_t		 nSize;
+};
+
+class CHostWorkload
+{
+public:
+	CHostWorkload (const char *pName, const char *pUnit)
+	:	m_pName (pName),
+		m_pUnit (pUnit),
+		m_nInputs (0),
+		m_nOutputs (0)
+	{
+	}
+
+	virtual ~CHostWorkload (void) {}
+
+	const char *GetName (void) const	{ return m_pName; }
+	const char *GetUnit (void) const	{ return m_pUnit; }
+
+	virtual double GetWork (void) const = 0;	// units per iteration
+	virtual void Generate (void) = 0;		// synthetic input
+	virtual void Execute (void) = 0;
+
+	boolean Load (const char *pDir, boolean bGold = TRUE);
+	boolean Save (const char *pDir, boolean bGold);
+	void SetGoldFromOutput (void);
+	size_t Compare (void);				// returns number of wrong bytes
+
+protected:
+	void AddInput (const char *pFileName, void *pData, size_t nSize);
+	void AddOutput (const char *pFileName, void *pData, void *pGold, size_t nSize);
+
+protected:
+	static unsigned Random (void);
+	static double RandomDouble (double fMin, double fMax);
+
+private:
+	const char *m_pName;
+	const char *m_pUnit;
+
+	TSegment m_Inputs[MAX_SEGMENTS];
+	unsigned m_nInputs;
+
+	TSegment m_Outputs[MAX_SEGMENTS];
+	TSegment m_Golds[MAX_SEGMENTS];
+	unsigned m_nOutputs;
+
+	static unsigned s_nSeed;
+};
+
+unsigned CHostWorkload::s_nSeed = 1;
+
+static boolean ReadSegments (const char *pDir, const TSegment *pSegments, unsigned nSegments)
+{
+	FILE *pFile = 0;
+	for (unsigned i = 0; i < nSegments; i++)
+	{
+		if (   i == 0
+		    || strcmp (pSegments[i].pFileName, pSegments[i-1].pFileName) != 0)
+		{
+			if (pFile != 0)
+			{
+				fclose (pFile);
+			}
+
+			char Path[512];
+			snprintf (Path, sizeof Path, "%s/%s", pDir, pSegments[i].pFileName);
+			pFile = fopen (Path, "rb");
+			if (pFile == 0)
+			{
+				fprintf (stderr, "Cannot open %s\n", Path);
+
+				return FALSE;
+			}
+		}
+
+		if (fread (pSegments[i].pData, 1, pSegments[i].nSize, pFile) != pSegments[i].nSize)
+		{
+			fprintf (stderr, "%s: File too short\n", pSegments[i].pFileName);
+		}
+	}
+
+	if (pFile != 0)
+	{
+		fclose (pFile);
+	}
+
+	return TRUE;
+}
+
+static boolean WriteSegments (const char *pDir, const TSegment *pSegments, unsigned nSegments)
+{
+	FILE *pFile = 0;
+	for (unsigned i = 0; i < nSegments; i++)
+	{
+		if (   i == 0
+		    || strcmp (pSegments[i].pFileName, pSegments[i-1].pFileName) != 0)
+		{
+			if (pFile != 0)
+			{
+				fclose (pFile);
+			}
+
+			char Path[512];
+			snprintf (Path, sizeof Path, "%s/%s", pDir, pSegments[i].pFileName);
+			pFile = fopen (Path, "wb");
+			if (pFile == 0)
+			{
+				fprintf (stderr, "Cannot create %s\n", Path);
+
+				return FALSE;
+			}
+		}
+
+		fwrite (pSegments[i].pData, 1, pSegments[i].nSize, pFile);
+	}
+
+	if (pFile != 0)
+	{
+		fclose (pFile);
+	}
+
+	return TRUE;
+}
+
+boolean CHostWorkload::Load (const char *pDir, boolean bGold)
+{
+	return    ReadSegments (pDir, m_Inputs, m_nInputs)
+	       && (!bGold || ReadSegments (pDir, m_Golds, m_nOutputs));
+}
+
+boolean CHostWorkload::Save (const char *pDir, boolean bGold)
+{
+	return bGold ? WriteSegments (pDir, m_Golds, m_nOutputs)
+		     : WriteSegments (pDir, m_Inputs, m_nInputs);
+}
+
+void CHostWorkload::SetGoldFromOutput (void)
+{
+	for (unsigned i = 0; i < m_nOutputs; i++)
+	{
+		memcpy (m_Golds[i].pData, m_Outputs[i].pData, m_Outputs[i].nSize);
+	}
+}
+
+size_t CHostWorkload::Compare (void)
+{
+	size_t nErrors = 0;
+
+	for (unsigned i = 0; i < m_nOutputs; i++)
+	{
+		const unsigned char *pOut = (const unsigned char *) m_Outputs[i].pData;
+		const unsigned char *pGold = (const unsigned char *) m_Golds[i].pData;
+
+		for (size_t j = 0; j < m_Outputs[i].nSize; j++)
+		{
+			nErrors += pOut[j] != pGold[j];
+		}
+	}
+
+	return nErrors;
+}
+
+void CHostWorkload::AddInput (const char *pFileName, void *pData, size_t nSize)
+{
+	if (m_nInputs < MAX_SEGMENTS)
+	{
+		TSegment Segment = {pFileName, pData, nSize};
+		m_Inputs[m_nInputs++] = Segment;
+	}
+}
+
+void CHostWorkload::AddOutput (const char *pFileName, void *pData, void *pGold, size_t nSize)
+{
+	if (m_nOutputs < MAX_SEGMENTS)
+	{
+		TSegment Output = {pFileName, pData, nSize};
+		TSegment Gold = {pFileName, pGold, nSize};
+		m_Outputs[m_nOutputs] = Output;
+		m_Golds[m_nOutputs++] = Gold;
+	}
+}
+
+unsigned CHostWorkload::Random (void)		// deterministic on all hosts
+{
+	s_nSeed = s_nSeed * 1103515245 + 12345;
+
+	return (s_nSeed >> 8) & 0xFFFFFF;
+}
+
+double CHostWorkload::RandomDouble (double fMin, double fMax)
+{
+	return fMin + (fMax - fMin) * Random () / (double) 0x1000000;
+}
+
+//
+// fft (experiments/fft)
+//
+#define FFT_BITS	21
+#define FFT_SIZE	(1 << FFT_BITS)
+
+class CFFTWorkload : public CHostWorkload
+{
+public:
+	CFFTWorkload (boolean bFast)
+	:	CHostWorkload (bFast ? "fftfast" : "fft", "MFLOP/s"),
+		m_bFast (bFast)
+	{
+		m_pRealIn = new float[FFT_SIZE];
+		m_pImagIn = new float[FFT_SIZE];
+		m_pRealOut = new float[FFT_SIZE];
+		m_pImagOut = new float[FFT_SIZE];
+		m_pGoldReal = new float[FFT_SIZE];
+		m_pGoldImag = new float[FFT_SIZE];
+		memset (m_pImagIn, 0, FFT_SIZE * sizeof (float));
+
+		AddInput ("fft_input.bin", m_pRealIn, FFT_SIZE * sizeof (float));
+
+		const char *pGoldFile = bFast ? "fft_gold_fast.bin" : "fft_gold.bin";
+		AddOutput (pGoldFile, m_pRealOut, m_pGoldReal, FFT_SIZE * sizeof (float));
+		AddOutput (pGoldFile, m_pImagOut, m_pGoldImag, FFT_SIZE * sizeof (float));
+
+		if (   bFast
+		    && !m_Engine.Initialize (FFT_BITS))
+		{
+			fprintf (stderr, "fftfast: Cannot initialize the FFT engine\n");
+			exit (1);
+		}
+	}
+
+	double GetWork (void) const	{ return 5.0 * FFT_SIZE * FFT_BITS / 1e6; }
+
+	void Generate (void)
+	{
+		for (unsigned i = 0; i < FFT_SIZE; i++)
+		{
+			m_pRealIn[i] = (float) RandomDouble (-1000.0, 1000.0);
+		}
+	}
+
+	void Execute (void)
+	{
+		if (m_bFast)
+		{
+			m_Engine.Transform (m_pRealOut, m_pImagOut, m_pRealIn, m_pImagIn);
+		}
+		else
+		{
+			fft_float (FFT_SIZE, 0, m_pRealIn, m_pImagIn, m_pRealOut, m_pImagOut);
+		}
+	}
+
+private:
+	boolean m_bFast;
+	CFFTEngine m_Engine;
+	float *m_pRealIn, *m_pImagIn, *m_pRealOut, *m_pImagOut;
+	float *m_pGoldReal, *m_pGoldImag;
+};
+
+//
+// lud (experiments/lud)
+//
+#define LUD_SIZE	1024
+
+class CLUDWorkload : public CHostWorkload
+{
+public:
+	CLUDWorkload (void)
+	:	CHostWorkload ("lud", "MFLOP/s"),
+		m_Parallel (0),
+		m_LU (&m_Parallel)
+	{
+		m_pInput = new FP[LUD_SIZE * LUD_SIZE];
+		m_pMatrix = new FP[LUD_SIZE * LUD_SIZE];
+		m_pGold = new FP[LUD_SIZE * LUD_SIZE];
+
+		AddInput ("input_1024_th_1", m_pInput, LUD_SIZE * LUD_SIZE * sizeof (FP));
+		AddOutput ("gold_1024_th_1", m_pMatrix, m_pGold, LUD_SIZE * LUD_SIZE * sizeof (FP));
+	}
+
+	double GetWork (void) const	{ return 2.0 / 3.0 * LUD_SIZE * LUD_SIZE * LUD_SIZE / 1e6; }
+
+	void Generate (void)		// diagonally dominant, no pivoting required
+	{
+		for (unsigned i = 0; i < LUD_SIZE; i++)
+		{
+			for (unsigned j = 0; j < LUD_SIZE; j++)
+			{
+				m_pInput[i*LUD_SIZE + j] = RandomDouble (0.0, 1.0) + (i == j ? LUD_SIZE : 0);
+			}
+		}
+	}
+
+	void Execute (void)
+	{
+		memcpy (m_pMatrix, m_pInput, LUD_SIZE * LUD_SIZE * sizeof (FP));
+
+		m_LU.Decompose (m_pMatrix, LUD_SIZE);
+	}
+
+private:
+	CParallel m_Parallel;
+	CBlockLU m_LU;
+	FP *m_pInput, *m_pMatrix, *m_pGold;
+};
+
+//
+// lavaMD (experiments/lavaMD)
+//
+#define LAVAMD_BOXES1D	5
+
+class CLavaMDWorkload : public CHostWorkload
+{
+public:
+	CLavaMDWorkload (void)
+	:	CHostWorkload ("lavaMD", "Mpairs/s"),
+		m_Parallel (0),
+		m_Kernel (&m_Parallel),
+		m_nPairs (0)
+	{
+		m_Par.alpha = 0.5;
+
+		m_Dim.boxes1d_arg = LAVAMD_BOXES1D;
+		m_Dim.number_boxes = LAVAMD_BOXES1D * LAVAMD_BOXES1D * LAVAMD_BOXES1D;
+		m_Dim.space_elem = m_Dim.number_boxes * NUMBER_PAR_PER_BOX;
+		m_Dim.space_mem = m_Dim.space_elem * sizeof (FOUR_VECTOR);
+		m_Dim.space_mem2 = m_Dim.space_elem * sizeof (fp);
+		m_Dim.box_mem = m_Dim.number_boxes * sizeof (box_str);
+
+		m_pBox = new box_str[m_Dim.number_boxes];
+		init_boxes (m_Dim, m_pBox);
+
+		m_pRV = new FOUR_VECTOR[m_Dim.space_elem];
+		m_pQV = new fp[m_Dim.space_elem];
+		m_pFV = new FOUR_VECTOR[m_Dim.space_elem];
+		m_pGold = new FOUR_VECTOR[m_Dim.space_elem];
+
+		AddInput ("input_distance_1_5", m_pRV, m_Dim.space_mem);
+		AddInput ("input_charge_1_5", m_pQV, m_Dim.space_mem2);
+		AddOutput ("output_gold_1_5_fast", m_pFV, m_pGold, m_Dim.space_mem);
+	}
+
+	double GetWork (void) const	{ return m_nPairs / 1e6; }
+
+	void Generate (void)		// like the original lavaMD input generator
+	{
+		for (long i = 0; i < m_Dim.space_elem; i++)
+		{
+			m_pRV[i].v = (Random () % 10 + 1) / 10.0;
+			m_pRV[i].x = (Random () % 10 + 1) / 10.0;
+			m_pRV[i].y = (Random () % 10 + 1) / 10.0;
+			m_pRV[i].z = (Random () % 10 + 1) / 10.0;
+			m_pQV[i] = (Random () % 10 + 1) / 10.0;
+		}
+	}
+
+	void Execute (void)
+	{
+		m_nPairs = m_Kernel.Compute (m_Par, m_Dim, m_pBox, m_pRV, m_pQV, m_pFV);
+	}
+
+private:
+	CParallel m_Parallel;
+	CLavaMDKernel m_Kernel;
+	u64 m_nPairs;
+
+	par_str m_Par;
+	dim_str m_Dim;
+	box_str *m_pBox;
+	FOUR_VECTOR *m_pRV;
+	fp *m_pQV;
+	FOUR_VECTOR *m_pFV, *m_pGold;
+};
+
+//
+// qsort (experiments/qsort)
+//
+#define QSORT_SIZE	2000000
+
+class CQSortWorkload : public CHostWorkload
+{
+public:
+	CQSortWorkload (const char *pName)
+	:	CHostWorkload (pName, "Melements/s"),
+		m_Algorithm (  strcmp (pName, "radixsort") == 0 ? AlgorithmRadix
+			     : strcmp (pName, "introsort") == 0 ? AlgorithmIntro : AlgorithmQSort),
+		m_Parallel (0),
+		m_Sorter (&m_Parallel)
+	{
+		m_pInput = new double[QSORT_SIZE];
+		m_pData = new double[QSORT_SIZE];
+		m_pTemp = new double[QSORT_SIZE];
+		m_pGold = new double[QSORT_SIZE];
+
+		AddInput ("qsort_input_2000000.bin", m_pInput, QSORT_SIZE * sizeof (double));
+		AddOutput ("qsort_gold_2000000.bin", m_pData, m_pGold, QSORT_SIZE * sizeof (double));
+	}
+
+	double GetWork (void) const	{ return QSORT_SIZE / 1e6; }
+
+	void Generate (void)
+	{
+		for (unsigned i = 0; i < QSORT_SIZE; i++)
+		{
+			m_pInput[i] = RandomDouble (0.0, 1e6);
+		}
+	}
+
+	void Execute (void)
+	{
+		switch (m_Algorithm)
+		{
+		case AlgorithmRadix:
+			m_Sorter.RadixSort (m_pData, m_pInput, m_pTemp, QSORT_SIZE);
+			break;
+
+		case AlgorithmIntro:
+			m_Sorter.IntroSort (m_pData, m_pInput, m_pTemp, QSORT_SIZE);
+			break;
+
+		default:
+			memcpy (m_pData, m_pInput, QSORT_SIZE * sizeof (double));
+
+			qsort (m_pData, QSORT_SIZE, sizeof (double));
+			break;
+		}
+	}
+
+private:
+	enum TAlgorithm
+	{
+		AlgorithmQSort,
+		AlgorithmIntro,
+		AlgorithmRadix
+	};
+
+	TAlgorithm m_Algorithm;
+	CParallel m_Parallel;
+	CParallelSorter m_Sorter;
+	double *m_pInput, *m_pData, *m_pTemp, *m_pGold;
+};
+
+//
+// hotspot (experiments/hotspot)
+//
+#define HOTSPOT_STEPS	100
+
+class CHotspotWorkload : public CHostWorkload
+{
+public:
+	CHotspotWorkload (void)
+	:	CHostWorkload ("hotspot", "Mcells/s"),
+		m_Parallel (0),
+		m_Stencil (&m_Parallel)
+	{
+		m_pTempInput = new FLOAT[MAX_SIZE * MAX_SIZE];
+		m_pTemp = new FLOAT[MAX_SIZE * MAX_SIZE];
+		m_pPower = new FLOAT[MAX_SIZE * MAX_SIZE];
+		m_pResult = new FLOAT[MAX_SIZE * MAX_SIZE];
+		m_pGold = new FLOAT[MAX_SIZE * MAX_SIZE];
+
+		AddInput ("temp_1024", m_pTempInput, MAX_SIZE * MAX_SIZE * sizeof (FLOAT));
+		AddInput ("power_1024", m_pPower, MAX_SIZE * MAX_SIZE * sizeof (FLOAT));
+		AddOutput ("hotspot_gold.bin", m_pResult, m_pGold, MAX_SIZE * MAX_SIZE * sizeof (FLOAT));
+	}
+
+	double GetWork (void) const	{ return (double) MAX_SIZE * MAX_SIZE * HOTSPOT_STEPS / 1e6; }
+
+	void Generate (void)
+	{
+		for (unsigned i = 0; i < MAX_SIZE * MAX_SIZE; i++)
+		{
+			m_pTempInput[i] = RandomDouble (323.0, 343.0);
+			m_pPower[i] = RandomDouble (0.0, 0.01);
+		}
+	}
+
+	void Execute (void)
+	{
+		memcpy (m_pTemp, m_pTempInput, MAX_SIZE * MAX_SIZE * sizeof (FLOAT));
+
+		m_Stencil.Compute (m_pResult, HOTSPOT_STEPS, m_pTemp, m_pPower, MAX_SIZE, MAX_SIZE);
+	}
+
+private:
+	CParallel m_Parallel;
+	CHotspotStencil m_Stencil;
+
+	FLOAT *m_pTempInput, *m_pTemp, *m_pPower, *m_pResult, *m_pGold;
+};
+
+//
+// matmul (experiments/matmul)
+//
+#define MATMUL_SIZE	600
+
+class CMatMulWorkload : public CHostWorkload
+{
+public:
+	CMatMulWorkload (void)
+	:	CHostWorkload ("matmul", "MFLOP/s"),
+		m_Parallel (0),
+		m_SGEMM (&m_Parallel)
+	{
+		m_pA = new float[MATMUL_SIZE * MATMUL_SIZE];
+		m_pB = new float[MATMUL_SIZE * MATMUL_SIZE];
+		m_pC = new float[MATMUL_SIZE * MATMUL_SIZE];
+		m_pGold = new float[MATMUL_SIZE * MATMUL_SIZE];
+
+		AddInput ("matmul_input_600.bin", m_pA, MATMUL_SIZE * MATMUL_SIZE * sizeof (float));
+		AddInput ("matmul_input_600.bin", m_pB, MATMUL_SIZE * MATMUL_SIZE * sizeof (float));
+		AddOutput ("matmul_gold_600.bin", m_pC, m_pGold, MATMUL_SIZE * MATMUL_SIZE * sizeof (float));
+	}
+
+	double GetWork (void) const	{ return 2.0 * MATMUL_SIZE * MATMUL_SIZE * MATMUL_SIZE / 1e6; }
+
+	void Generate (void)
+	{
+		for (unsigned i = 0; i < MATMUL_SIZE * MATMUL_SIZE; i++)
+		{
+			m_pA[i] = (float) RandomDouble (-1.0, 1.0);
+			m_pB[i] = (float) RandomDouble (-1.0, 1.0);
+		}
+	}
+
+	void Execute (void)
+	{
+		m_SGEMM.Multiply (m_pA, m_pB, m_pC, MATMUL_SIZE, MATMUL_SIZE, MATMUL_SIZE);
+	}
+
+private:
+	CParallel m_Parallel;
+	CSGEMM m_SGEMM;
+	float *m_pA, *m_pB, *m_pC, *m_pGold;
+};
+
+//
+// susan (experiments/susan)
+//
+#define SUSAN_WIDTH	2048
+#define SUSAN_HEIGHT	2048
+#define SUSAN_SIZE	(SUSAN_WIDTH * SUSAN_HEIGHT)
+
+class CSusanWorkload : public CHostWorkload
+{
+public:
+	CSusanWorkload (void)
+	:	CHostWorkload ("susan", "Mpixels/s"),
+		m_Parallel (0),
+		m_Filter (&m_Parallel)
+	{
+		m_pImage = new u8[SUSAN_SIZE];
+		m_pOutput = new u8[3 * SUSAN_SIZE];
+		m_pGold = new u8[3 * SUSAN_SIZE];
+
+		AddInput ("susan_input_2048.bin", m_pImage, SUSAN_SIZE);
+		AddOutput ("susan_gold_2048.bin", m_pOutput, m_pGold, 3 * SUSAN_SIZE);
+
+		m_Filter.Initialize (SUSAN_WIDTH, SUSAN_HEIGHT);
+	}
+
+	double GetWork (void) const	{ return SUSAN_SIZE / 1e6; }
+
+	void Generate (void)		// rectangles and discs on a gradient with noise
+	{
+		for (unsigned y = 0; y < SUSAN_HEIGHT; y++)
+		{
+			for (unsigned x = 0; x < SUSAN_WIDTH; x++)
+			{
+				m_pImage[y*SUSAN_WIDTH + x] = 64 + 128 * (x + y) / (SUSAN_WIDTH + SUSAN_HEIGHT);
+			}
+		}
+
+		for (unsigned n = 0; n < 400; n++)
+		{
+			int nX = Random () % SUSAN_WIDTH;
+			int nY = Random () % SUSAN_HEIGHT;
+			int nSize = 8 + Random () % 120;
+			u8 uchValue = Random () % 256;
+			boolean bDisc = Random () % 2;
+
+			for (int y = nY - nSize; y <= nY + nSize; y++)
+			{
+				for (int x = nX - nSize; x <= nX + nSize; x++)
+				{
+					if (   0 <= x && x < SUSAN_WIDTH
+					    && 0 <= y && y < SUSAN_HEIGHT
+					    && (   !bDisc
+						|| (x-nX)*(x-nX) + (y-nY)*(y-nY) <= nSize*nSize))
+					{
+						m_pImage[y*SUSAN_WIDTH + x] = uchValue;
+					}
+				}
+			}
+		}
+
+		for (unsigned i = 0; i < SUSAN_SIZE; i++)
+		{
+			int nValue = m_pImage[i] + (int) (Random () % 9) - 4;
+			m_pImage[i] = nValue < 0 ? 0 : (nValue > 255 ? 255 : nValue);
+		}
+	}
+
+	void Execute (void)
+	{
+		m_Filter.Process (m_pOutput, m_pOutput + SUSAN_SIZE, m_pOutput + 2*SUSAN_SIZE, m_pImage);
+	}
+
+private:
+	CParallel m_Parallel;
+	CSusanFilter m_Filter;
+	u8 *m_pImage, *m_pOutput, *m_pGold;
+};
+
+static double GetNanoseconds (void)
+{
+	struct timespec Time;
+	clock_gettime (CLOCK_MONOTONIC, &Time);
+
+	return Time.tv_sec * 1e9 + Time.tv_nsec;
+}
+
+static CHostWorkload *CreateWorkload (const char *pName)
+{
+	if (strcmp (pName, "fft") == 0)		return new CFFTWorkload (FALSE);
+	if (strcmp (pName, "fftfast") == 0)	return new CFFTWorkload (TRUE);
+	if (strcmp (pName, "lud") == 0)		return new CLUDWorkload;
+	if (strcmp (pName, "lavaMD") == 0)	return new CLavaMDWorkload;
+	if (   strcmp (pName, "qsort") == 0
+	    || strcmp (pName, "introsort") == 0
+	    || strcmp (pName, "radixsort") == 0)	return new CQSortWorkload (pName);
+	if (strcmp (pName, "hotspot") == 0)	return new CHotspotWorkload;
+	if (strcmp (pName, "matmul") == 0)	return new CMatMulWorkload;
+	if (strcmp (pName, "susan") == 0)	return new CSusanWorkload;
+
+	return 0;
+}
+
+static const char *s_pAllWorkloads[] = {"fft", "fftfast", "lud", "lavaMD", "qsort", "introsort", "radixsort", "hotspot", "matmul", "susan", 0};
+
+int main (int argc, char **argv)
+{
+	unsigned nIterations = 5;
+	const char *pLoadDir = 0;
+	const char *pWriteDir = 0;
+	boolean bMakeGold = FALSE;
+
+	int nArg;
+	for (nArg = 1; nArg < argc && argv[nArg][0] == '-'; nArg++)
+	{
+		if (strcmp (argv[nArg], "-g") == 0)
+		{
+			bMakeGold = TRUE;
+
+			continue;
+		}
+
+		if (nArg+1 >= argc)
+		{
+			fprintf (stderr, "Option %s requires an argument\n", argv[nArg]);
+
+			return 1;
+		}
+
+		if (strcmp (argv[nArg], "-n") == 0)
+		{
+			nIterations = atoi (argv[++nArg]);
+		}
+		else if (strcmp (argv[nArg], "-d") == 0)
+		{
+			pLoadDir = argv[++nArg];
+		}
+		else if (strcmp (argv[nArg], "-w") == 0)
+		{
+			pWriteDir = argv[++nArg];
+		}
+		else
+		{
+			fprintf (stderr, "usage: %s [-n iterations] [-d dir [-g]] [-w dir] [workload...]\n", argv[0]);
+
+			return 1;
+		}
+	}
+
+	const char **ppNames = nArg < argc ? (const char **) &argv[nArg] : s_pAllWorkloads;
+	unsigned nNames = nArg < argc ? argc - nArg : sizeof s_pAllWorkloads / sizeof s_pAllWorkloads[0] - 1;
+
+	int nResult = 0;
+	for (unsigned i = 0; i < nNames; i++)
+	{
+		CHostWorkload *pWorkload = CreateWorkload (ppNames[i]);
+		if (pWorkload == 0)
+		{
+			fprintf (stderr, "Unknown workload: %s\n", ppNames[i]);
+
+			return 1;
+		}
+
+		if (pLoadDir != 0)
+		{
+			if (!pWorkload->Load (pLoadDir, !bMakeGold))
+			{
+				return 1;
+			}
+
+			if (bMakeGold)
+			{
+				pWorkload->Execute ();
+				pWorkload->SetGoldFromOutput ();
+			}
+		}
+		else
+		{
+			pWorkload->Generate ();
+			pWorkload->Execute ();			// untimed warm-up, defines the gold
+			pWorkload->SetGoldFromOutput ();
+		}
+
+		if (pWriteDir != 0)
+		{
+			pWorkload->Save (pWriteDir, FALSE);
+			pWorkload->Save (pWriteDir, TRUE);
+		}
+
+		double fMin = 0.0, fSum = 0.0;
+		size_t nErrors = 0;
+		for (unsigned n = 0; n < nIterations; n++)
+		{
+			double fStart = GetNanoseconds ();
+			pWorkload->Execute ();
+			double fTime = GetNanoseconds () - fStart;
+
+			fSum += fTime;
+			if (n == 0 || fTime < fMin)
+			{
+				fMin = fTime;
+			}
+
+			nErrors += pWorkload->Compare ();
+		}
+
+		double fAvg = nIterations > 0 ? fSum / nIterations : 0.0;
+		printf ("%-8s %14.0f ns/iter (min %14.0f) %10.1f %-12s %s\n",
+			pWorkload->GetName (), fAvg, fMin,
+			fMin > 0.0 ? pWorkload->GetWork () / (fMin / 1e9) : 0.0,
+			pWorkload->GetUnit (), nErrors == 0 ? "gold ok" : "GOLD MISMATCH");
+
+		if (nErrors != 0)
+		{
+			nResult = 2;
+		}
+
+		delete pWorkload;
+	}
+
+	return nResult;
+}
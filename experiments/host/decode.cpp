@@ -0,0 +1,401 @@
+//
+// decode.cpp
+//
+// Decodes the reports of the experiments (see experiment.h and reportframe.h)
+// from a capture file or a serial device (e.g. /dev/ttyUSB0, configured with
+// stty before) and prints one line per frame, per phase report and per
+// counter report. IPC, miss rates and mispredictions per 1000 instructions
+// are derived from the counter report, if the required events are present.
+//
+// usage: decode [-c MHz] [file]	(reads stdin, if no file is given)
+//
+//	-c	CPU clock, phase reports are printed with the throughput in GB/s
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../reportframe.h"
+
+static double s_fClockMHz = 0.0;
+
+static void PrintIndex (unsigned nIndex, unsigned nRowLength)
+{
+	if (nRowLength != 0)
+	{
+		printf ("%u(%u,%u)", nIndex, nIndex / nRowLength, nIndex % nRowLength);
+	}
+	else
+	{
+		printf ("%u", nIndex);
+	}
+}
+
+static void PrintFrame (const u32 *pFrame)
+{
+	unsigned nSequence = pFrame[2];
+	unsigned nMismatches = pFrame[5];
+	unsigned nElementSize = pFrame[7] & 0xFF;
+	unsigned nFlags = (pFrame[7] >> 8) & 0xFF;
+	unsigned nRanges = pFrame[7] >> 16;
+	unsigned nRowLength = pFrame[8];
+
+	printf ("#%u exec %u us compare %u us", nSequence, pFrame[3], pFrame[4]);
+	if (pFrame[6] != 0)
+	{
+		printf (" dropped %u", pFrame[6]);
+	}
+
+	if (nMismatches == 0)
+	{
+		printf (" ok\n");
+
+		return;
+	}
+
+	const u32 *pSummary = &pFrame[REPORT_HEADER_WORDS];
+	printf (" mismatches %u size %u xor-or 0x%08X%08X xor-and 0x%08X%08X first ",
+		nMismatches, nElementSize, pSummary[1], pSummary[0], pSummary[3], pSummary[2]);
+	PrintIndex (pSummary[4], nRowLength);
+	printf (" value 0x%08X%08X ranges", pSummary[6], pSummary[5]);
+
+	const u32 *pRange = &pSummary[REPORT_SUMMARY_WORDS];
+	for (unsigned i = 0; i < nRanges; i++, pRange += REPORT_RANGE_WORDS)
+	{
+		printf (" ");
+		PrintIndex (pRange[0], nRowLength);
+		if (pRange[1] > 1)
+		{
+			printf ("+%ux%u", pRange[1], pRange[2]);
+		}
+	}
+
+	if (nFlags & REPORT_FLAG_TRUNCATED)
+	{
+		printf (" ...");
+	}
+
+	if (nFlags & REPORT_FLAG_NO_GOLD)
+	{
+		printf (" (gold not read)");
+	}
+
+	printf ("\n");
+}
+
+static void PrintPhase (const u32 *pReport)
+{
+	char Name[REPORT_PHASE_NAME_SIZE+1];
+	memcpy (Name, &pReport[2], REPORT_PHASE_NAME_SIZE);
+	Name[REPORT_PHASE_NAME_SIZE] = '\0';
+
+	unsigned long long nBytes = pReport[6] | (unsigned long long) pReport[7] << 32;
+	unsigned long long nCycles = pReport[8] | (unsigned long long) pReport[9] << 32;
+
+	printf ("#%u phase %-*s %llu bytes %llu cycles %.3f cycles/byte", pReport[1],
+		REPORT_PHASE_NAME_SIZE, Name, nBytes, nCycles,
+		nBytes != 0 ? (double) nCycles / nBytes : 0.0);
+	if (   s_fClockMHz > 0.0
+	    && nCycles != 0)
+	{
+		printf (" %.2f GB/s", nBytes * s_fClockMHz / nCycles / 1000.0);
+	}
+
+	if (pReport[10] != 0)
+	{
+		printf (" errors %u", pReport[10]);
+	}
+
+	printf ("\n");
+}
+
+// ARMv8 common event numbers (see circle/perfcounters.h)
+#define EVENT_L1I_TLB_REFILL	0x02
+#define EVENT_L1D_CACHE_REFILL	0x03
+#define EVENT_L1D_CACHE		0x04
+#define EVENT_L1D_TLB_REFILL	0x05
+#define EVENT_INST_RETIRED	0x08
+#define EVENT_BR_MIS_PRED	0x10
+#define EVENT_L2D_CACHE		0x16
+#define EVENT_L2D_CACHE_REFILL	0x17
+#define EVENT_L2D_TLB_REFILL	0x2D
+
+static const char *GetEventName (unsigned nEvent)
+{
+	switch (nEvent)
+	{
+	case 0x01:			return "l1i-refill";
+	case EVENT_L1I_TLB_REFILL:	return "l1i-tlb-refill";
+	case EVENT_L1D_CACHE_REFILL:	return "l1d-refill";
+	case EVENT_L1D_CACHE:		return "l1d-access";
+	case EVENT_L1D_TLB_REFILL:	return "l1d-tlb-refill";
+	case EVENT_INST_RETIRED:	return "instructions";
+	case EVENT_BR_MIS_PRED:		return "br-mispred";
+	case 0x11:			return "cycles";
+	case 0x13:			return "mem-access";
+	case EVENT_L2D_CACHE:		return "l2d-access";
+	case EVENT_L2D_CACHE_REFILL:	return "l2d-refill";
+	case 0x19:			return "bus-access";
+	case 0x23:			return "stall-frontend";
+	case 0x24:			return "stall-backend";
+	case EVENT_L2D_TLB_REFILL:	return "l2d-tlb-refill";
+	default:			return 0;
+	}
+}
+
+static void PrintCounters (const u32 *pReport)
+{
+	unsigned long long nCycles = pReport[2] | (unsigned long long) pReport[3] << 32;
+	unsigned nCounters = pReport[4];
+
+	printf ("#%u counters cycles %llu", pReport[1], nCycles);
+
+	// counts by event number, -1 if not counted
+	long long Counts[0x100];
+	for (unsigned i = 0; i < 0x100; i++)
+	{
+		Counts[i] = -1;
+	}
+
+	const u32 *pEntry = &pReport[5];
+	for (unsigned i = 0; i < nCounters; i++, pEntry += 3)
+	{
+		unsigned long long nCount = pEntry[1] | (unsigned long long) pEntry[2] << 32;
+
+		const char *pName = GetEventName (pEntry[0]);
+		if (pName != 0)
+		{
+			printf (" %s %llu", pName, nCount);
+		}
+		else
+		{
+			printf (" event-0x%X %llu", pEntry[0], nCount);
+		}
+
+		if (pEntry[0] < 0x100)
+		{
+			Counts[pEntry[0]] = nCount;
+		}
+	}
+
+	long long nInstructions = Counts[EVENT_INST_RETIRED];
+	if (   nInstructions >= 0
+	    && nCycles != 0)
+	{
+		printf (" ipc %.3f", (double) nInstructions / nCycles);
+	}
+
+	if (   Counts[EVENT_L1D_CACHE_REFILL] >= 0
+	    && Counts[EVENT_L1D_CACHE] > 0)
+	{
+		printf (" l1d-miss %.2f%%",
+			100.0 * Counts[EVENT_L1D_CACHE_REFILL] / Counts[EVENT_L1D_CACHE]);
+	}
+
+	if (   Counts[EVENT_L2D_CACHE_REFILL] >= 0
+	    && Counts[EVENT_L2D_CACHE] > 0)
+	{
+		printf (" l2d-miss %.2f%%",
+			100.0 * Counts[EVENT_L2D_CACHE_REFILL] / Counts[EVENT_L2D_CACHE]);
+	}
+
+	if (   Counts[EVENT_BR_MIS_PRED] >= 0
+	    && nInstructions > 0)
+	{
+		printf (" mpki %.2f", 1000.0 * Counts[EVENT_BR_MIS_PRED] / nInstructions);
+	}
+
+	// TLB refills per 1000 instructions
+	if (   Counts[EVENT_L1D_TLB_REFILL] >= 0
+	    && nInstructions > 0)
+	{
+		printf (" dtlb-pki %.3f", 1000.0 * Counts[EVENT_L1D_TLB_REFILL] / nInstructions);
+	}
+
+	if (   Counts[EVENT_L2D_TLB_REFILL] >= 0
+	    && nInstructions > 0)
+	{
+		printf (" l2tlb-pki %.3f", 1000.0 * Counts[EVENT_L2D_TLB_REFILL] / nInstructions);
+	}
+
+	printf ("\n");
+}
+
+static const char *GetStatusText (u32 nStatus)
+{
+	switch (nStatus)
+	{
+	case 0xFF100000:	return "partition not found";
+	case 0xFF200000:	return "mount failed";
+	case 0xFFF00000:	return "file open failed";
+	case 0xFFF10000:	return "file read failed";
+	case 0xFFF40000:	return "file close failed";
+	case 0xFFF90000:	return "setup failed";
+	default:		return 0;
+	}
+}
+
+static boolean ReadWords (FILE *pFile, u32 *pWords, unsigned nWords)
+{
+	return fread (pWords, sizeof (u32), nWords, pFile) == nWords;
+}
+
+int main (int argc, char **argv)
+{
+	if (   argc > 2
+	    && strcmp (argv[1], "-c") == 0)
+	{
+		s_fClockMHz = atof (argv[2]);
+		argc -= 2;
+		argv += 2;
+	}
+
+	FILE *pFile = stdin;
+	if (argc > 1)
+	{
+		pFile = fopen (argv[1], "rb");
+		if (pFile == 0)
+		{
+			fprintf (stderr, "Cannot open %s\n", argv[1]);
+
+			return 1;
+		}
+	}
+
+	setvbuf (stdout, 0, _IOLBF, 0);
+
+	u32 Frame[REPORT_MAX_WORDS];
+	unsigned nErrors = 0;
+
+	// the stream is scanned byte-wise to synchronize to the start of a report
+	u32 nWindow = 0;
+	int nChar;
+	while ((nChar = getc (pFile)) != EOF)
+	{
+		nWindow = nWindow >> 8 | (u32) nChar << 24;	// little endian
+
+		const char *pStatus = GetStatusText (nWindow);
+		if (pStatus != 0)
+		{
+			printf ("status 0x%08X: %s\n", nWindow, pStatus);
+			nWindow = 0;
+
+			continue;
+		}
+
+		if (nWindow == REPORT_PHASE_MAGIC)
+		{
+			nWindow = 0;
+
+			u32 Report[REPORT_PHASE_WORDS];
+			Report[0] = REPORT_PHASE_MAGIC;
+			if (!ReadWords (pFile, &Report[1], REPORT_PHASE_WORDS-1))
+			{
+				break;
+			}
+
+			if (ReportCRC32 (Report, (REPORT_PHASE_WORDS-1) * sizeof (u32))
+			    != Report[REPORT_PHASE_WORDS-1])
+			{
+				fprintf (stderr, "CRC error in phase report #%u\n", Report[1]);
+				nErrors++;
+
+				continue;
+			}
+
+			PrintPhase (Report);
+
+			continue;
+		}
+
+		if (nWindow == REPORT_COUNTER_MAGIC)
+		{
+			nWindow = 0;
+
+			u32 Report[REPORT_COUNTER_WORDS];
+			Report[0] = REPORT_COUNTER_MAGIC;
+			if (!ReadWords (pFile, &Report[1], REPORT_COUNTER_WORDS-1))
+			{
+				break;
+			}
+
+			if (ReportCRC32 (Report, (REPORT_COUNTER_WORDS-1) * sizeof (u32))
+			    != Report[REPORT_COUNTER_WORDS-1])
+			{
+				fprintf (stderr, "CRC error in counter report #%u\n", Report[1]);
+				nErrors++;
+
+				continue;
+			}
+
+			if (Report[4] > REPORT_MAX_COUNTERS)
+			{
+				fprintf (stderr, "Inconsistent counter report #%u\n", Report[1]);
+				nErrors++;
+
+				continue;
+			}
+
+			PrintCounters (Report);
+
+			continue;
+		}
+
+		if (nWindow != REPORT_FRAME_MAGIC)
+		{
+			continue;
+		}
+		nWindow = 0;
+
+		Frame[0] = REPORT_FRAME_MAGIC;
+		if (!ReadWords (pFile, &Frame[1], 1))
+		{
+			break;
+		}
+
+		unsigned nWords = Frame[1];
+		if (   nWords < REPORT_HEADER_WORDS + 1
+		    || nWords > REPORT_MAX_WORDS)
+		{
+			fprintf (stderr, "Invalid frame length (%u)\n", nWords);
+			nErrors++;
+
+			continue;
+		}
+
+		if (!ReadWords (pFile, &Frame[2], nWords-2))
+		{
+			break;
+		}
+
+		if (ReportCRC32 (Frame, (nWords-1) * sizeof (u32)) != Frame[nWords-1])
+		{
+			fprintf (stderr, "CRC error in frame #%u\n", Frame[2]);
+			nErrors++;
+
+			continue;
+		}
+
+		unsigned nExpected = REPORT_HEADER_WORDS + 1;
+		if (Frame[5] != 0)
+		{
+			nExpected += REPORT_SUMMARY_WORDS + REPORT_RANGE_WORDS * (Frame[7] >> 16);
+		}
+
+		if (nWords != nExpected)
+		{
+			fprintf (stderr, "Inconsistent frame #%u\n", Frame[2]);
+			nErrors++;
+
+			continue;
+		}
+
+		PrintFrame (Frame);
+	}
+
+	if (pFile != stdin)
+	{
+		fclose (pFile);
+	}
+
+	return nErrors != 0 ? 2 : 0;
+}
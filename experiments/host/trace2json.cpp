@@ -0,0 +1,309 @@
+//
+// trace2json.cpp
+//
+// Converts the binary stream of CBinaryTracer::Dump() (see
+// include/circle/binarytracer.h) from a file or a serial capture into the
+// Chrome trace event format (JSON), which can be loaded into chrome://tracing
+// or https://ui.perfetto.dev. Each core is shown as one thread. Text before
+// the stream (e.g. log messages on the same serial line) is skipped.
+//
+// usage: trace2json [-p] [file]	(reads stdin, if no file is given)
+//
+//	-p	add the parameter of each record to its arguments
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#define TRACE_STREAM_MAGIC	0x43525443	// "CTRC"
+#define TRACE_STREAM_VERSION	1
+#define TRACE_HEADER_SIZE	20
+#define TRACE_RECORD_SIZE	16
+#define TRACE_MAX_EVENTS	256
+
+enum TTraceRecordType
+{
+	TraceRecordEnter,
+	TraceRecordExit,
+	TraceRecordInstant,
+	TraceRecordCounter,
+	TraceRecordUnknown
+};
+
+struct TRecord
+{
+	unsigned long long	nTimestamp;
+	unsigned		nEvent;
+	unsigned		nType;
+	unsigned		nCore;
+	unsigned		nParam;
+};
+
+static bool s_bParam = false;
+
+static std::vector<unsigned char> s_Input;
+static size_t s_nOffset;
+
+static bool Available (size_t nBytes)
+{
+	return s_nOffset + nBytes <= s_Input.size ();
+}
+
+static unsigned GetU16 (void)
+{
+	unsigned nValue = s_Input[s_nOffset] | s_Input[s_nOffset+1] << 8;
+	s_nOffset += 2;
+
+	return nValue;
+}
+
+static unsigned GetU32 (void)
+{
+	unsigned nValue = GetU16 ();
+
+	return nValue | GetU16 () << 16;
+}
+
+static unsigned long long GetU64 (void)
+{
+	unsigned long long nValue = GetU32 ();
+
+	return nValue | (unsigned long long) GetU32 () << 32;
+}
+
+static bool FindStream (void)
+{
+	for (; Available (TRACE_HEADER_SIZE); s_nOffset++)
+	{
+		size_t nOffset = s_nOffset;
+		if (GetU32 () == TRACE_STREAM_MAGIC)
+		{
+			s_nOffset = nOffset;
+
+			return true;
+		}
+
+		s_nOffset = nOffset;
+	}
+
+	return false;
+}
+
+static void PrintName (const std::string &Name)
+{
+	putchar ('"');
+	for (char c : Name)
+	{
+		if (c == '"' || c == '\\')
+		{
+			putchar ('\\');
+		}
+
+		putchar ((unsigned char) c >= ' ' ? c : '?');
+	}
+	putchar ('"');
+}
+
+int main (int argc, char **argv)
+{
+	int nArg = 1;
+	if (nArg < argc && strcmp (argv[nArg], "-p") == 0)
+	{
+		s_bParam = true;
+		nArg++;
+	}
+
+	FILE *pFile = stdin;
+	if (nArg < argc)
+	{
+		pFile = fopen (argv[nArg], "rb");
+		if (pFile == 0)
+		{
+			fprintf (stderr, "Cannot open %s\n", argv[nArg]);
+
+			return 1;
+		}
+	}
+
+	unsigned char Buffer[4096];
+	size_t nRead;
+	while ((nRead = fread (Buffer, 1, sizeof Buffer, pFile)) > 0)
+	{
+		s_Input.insert (s_Input.end (), Buffer, Buffer + nRead);
+	}
+
+	if (pFile != stdin)
+	{
+		fclose (pFile);
+	}
+
+	if (!FindStream ())
+	{
+		fprintf (stderr, "No trace stream found\n");
+
+		return 1;
+	}
+
+	GetU32 ();				// magic
+	unsigned nVersion = GetU16 ();
+	unsigned nRecordSize = GetU16 ();
+	unsigned nFrequency = GetU32 ();
+	unsigned nCores = GetU32 ();
+	unsigned nNames = GetU32 ();
+
+	if (   nVersion != TRACE_STREAM_VERSION
+	    || nRecordSize != TRACE_RECORD_SIZE
+	    || nFrequency == 0
+	    || nCores == 0)
+	{
+		fprintf (stderr, "Unsupported trace stream (version %u, record size %u)\n",
+			 nVersion, nRecordSize);
+
+		return 1;
+	}
+
+	std::vector<std::string> EventName (TRACE_MAX_EVENTS);
+	for (unsigned i = 0; i < TRACE_MAX_EVENTS; i++)
+	{
+		EventName[i] = "event" + std::to_string (i);
+	}
+
+	for (unsigned i = 0; i < nNames; i++)
+	{
+		if (!Available (4))
+		{
+			fprintf (stderr, "Truncated name table\n");
+
+			return 1;
+		}
+
+		unsigned nEvent = GetU16 ();
+		unsigned nLength = GetU16 ();
+		if (!Available (nLength))
+		{
+			fprintf (stderr, "Truncated name table\n");
+
+			return 1;
+		}
+
+		if (nEvent < TRACE_MAX_EVENTS)
+		{
+			EventName[nEvent].assign ((const char *) &s_Input[s_nOffset], nLength);
+		}
+		s_nOffset += nLength;
+	}
+
+	std::vector<TRecord> Records;
+	unsigned long long nFirstTimestamp = ~0ULL;
+	bool bTruncated = false;
+
+	for (unsigned i = 0; i < nCores && !bTruncated; i++)
+	{
+		if (!Available (8))
+		{
+			bTruncated = true;
+
+			break;
+		}
+
+		unsigned nCore = GetU32 ();
+		unsigned nRecords = GetU32 ();
+
+		// records of one core are in write order, an IRQ may have interrupted the writing
+		size_t nCoreStart = Records.size ();
+		for (unsigned j = 0; j < nRecords; j++)
+		{
+			if (!Available (TRACE_RECORD_SIZE))
+			{
+				bTruncated = true;
+
+				break;
+			}
+
+			TRecord Record;
+			Record.nTimestamp = GetU64 ();
+			Record.nEvent = GetU16 ();
+			Record.nType = s_Input[s_nOffset++];
+			s_nOffset++;			// core, is given by the core header
+			Record.nCore = nCore;
+			Record.nParam = GetU32 ();
+
+			if (Record.nTimestamp < nFirstTimestamp)
+			{
+				nFirstTimestamp = Record.nTimestamp;
+			}
+
+			Records.push_back (Record);
+		}
+
+		std::stable_sort (Records.begin () + nCoreStart, Records.end (),
+				  [] (const TRecord &a, const TRecord &b)
+				  { return a.nTimestamp < b.nTimestamp; });
+	}
+
+	if (bTruncated)
+	{
+		fprintf (stderr, "Trace stream truncated, converting %zu records\n", Records.size ());
+	}
+
+	printf ("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+	for (unsigned nCore = 0; nCore < nCores; nCore++)
+	{
+		printf ("%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,"
+			"\"args\":{\"name\":\"core %u\"}}", nCore > 0 ? ",\n" : "", nCore, nCore);
+	}
+
+	static const char Phase[] = "BEiC";
+	const double fMicrosPerTick = 1e6 / nFrequency;
+
+	for (size_t i = 0; i < Records.size (); i++)
+	{
+		const TRecord &Record = Records[i];
+		if (Record.nType >= TraceRecordUnknown)
+		{
+			continue;
+		}
+
+		printf (",\n{\"name\":");
+		PrintName (Record.nEvent < TRACE_MAX_EVENTS
+			   ? EventName[Record.nEvent] : "event" + std::to_string (Record.nEvent));
+		printf (",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":0,\"tid\":%u",
+			Phase[Record.nType], (Record.nTimestamp - nFirstTimestamp) * fMicrosPerTick,
+			Record.nCore);
+
+		switch (Record.nType)
+		{
+		case TraceRecordInstant:
+			printf (",\"s\":\"t\"");
+			if (s_bParam)
+			{
+				printf (",\"args\":{\"param\":%u}", Record.nParam);
+			}
+			break;
+
+		case TraceRecordCounter:
+			printf (",\"args\":{\"value\":%u}", Record.nParam);
+			break;
+
+		case TraceRecordEnter:
+			if (s_bParam)
+			{
+				printf (",\"args\":{\"param\":%u}", Record.nParam);
+			}
+			break;
+
+		default:
+			break;
+		}
+
+		printf ("}");
+	}
+
+	printf ("\n]}\n");
+
+	return bTruncated ? 2 : 0;
+}
@@ -0,0 +1,281 @@
+//
+// hotspot.cpp
+//
+// Cells of a row r (0 < r < R-1) with R rows, C columns, B = BLOCK_SIZE:
+//
+//	c = 0, C-1		edge 4, edge 2
+//	1 <= c < B		delta of (r, 0)
+//	C-B <= c < C-1		delta of (r-1, C-1), if r % B != 0
+//				delta of (r+B-1, 0), if r % B == 0 (last of the left chunk)
+//				delta of (R-1, C-B-1), if r == R-B
+//	B <= c < C-B		delta of (0, cb+B-1), if r < B (cb: first column of chunk)
+//				delta of (R-1, cb-1), if r >= R-B
+//				interior formula otherwise
+//
+// This must be compiled with -ffp-contract=off -fno-associative-math
+// -fno-reciprocal-math (see hotspot.h).
+//
+#include "hotspot.h"
+#include <assert.h>
+
+#if defined (__aarch64__)
+	#include <arm_neon.h>
+#endif
+
+CHotspotStencil::CHotspotStencil (CParallel *pParallel)
+:	m_pParallel (pParallel),
+	m_pPower (0),
+	m_nSteps (0),
+	m_nRows (0),
+	m_nCols (0)
+{
+	m_pBuffer[0] = 0;
+	m_pBuffer[1] = 0;
+}
+
+CHotspotStencil::~CHotspotStencil (void)
+{
+	m_pParallel = 0;
+}
+
+void CHotspotStencil::Compute (FLOAT *pResult, unsigned nSteps, FLOAT *pTemp, const FLOAT *pPower,
+			       unsigned nRows, unsigned nCols)
+{
+	assert (m_pParallel != 0);
+	assert (pResult != 0);
+	assert (pTemp != 0);
+	assert (pPower != 0);
+	assert (nRows % BLOCK_SIZE_R == 0 && nRows >= 2*BLOCK_SIZE_R);
+	assert (nCols % BLOCK_SIZE_C == 0 && nCols >= 2*BLOCK_SIZE_C);
+
+	// same expressions as in the Rodinia source
+	FLOAT grid_height = chip_height / nRows;
+	FLOAT grid_width = chip_width / nCols;
+
+	FLOAT Cap = FACTOR_CHIP * SPEC_HEAT_SI * t_chip * grid_width * grid_height;
+	FLOAT Rx = grid_width / (2.0 * K_SI * t_chip * grid_height);
+	FLOAT Ry = grid_height / (2.0 * K_SI * t_chip * grid_width);
+	FLOAT Rz = t_chip / (K_SI * grid_height * grid_width);
+
+	FLOAT max_slope = MAX_PD / (FACTOR_CHIP * t_chip * SPEC_HEAT_SI);
+	FLOAT step = PRECISION / max_slope / 1000.0;
+
+	m_Rx_1 = 1.f/Rx;
+	m_Ry_1 = 1.f/Ry;
+	m_Rz_1 = 1.f/Rz;
+	m_Cap_1 = step/Cap;
+
+	m_pBuffer[0] = pResult;
+	m_pBuffer[1] = pTemp;
+	m_pPower = pPower;
+	m_nSteps = nSteps;
+	m_nRows = nRows;
+	m_nCols = nCols;
+
+	m_pParallel->Execute (ComputeStub, this);
+}
+
+void CHotspotStencil::ComputeStub (unsigned nCore, void *pParam)
+{
+	CHotspotStencil *pThis = (CHotspotStencil *) pParam;
+	assert (pThis != 0);
+
+	pThis->Compute (nCore);
+}
+
+void CHotspotStencil::Compute (unsigned nCore)
+{
+	assert (nCore < PARALLEL_CORES);
+
+	unsigned nFirstRow = m_nRows * nCore / PARALLEL_CORES;
+	unsigned nEndRow = m_nRows * (nCore+1) / PARALLEL_CORES;
+
+	for (unsigned nStep = 0; nStep < m_nSteps; nStep++)
+	{
+		const FLOAT *pIn = m_pBuffer[(nStep+1) % 2];
+		FLOAT *pOut = m_pBuffer[nStep % 2];
+
+		for (unsigned nRow = nFirstRow; nRow < nEndRow; nRow++)
+		{
+			ComputeRow (pOut, pIn, nRow);
+		}
+
+		m_pParallel->Barrier ();
+	}
+}
+
+void CHotspotStencil::ComputeRow (FLOAT *pOut, const FLOAT *pIn, unsigned nRow) const
+{
+	unsigned nRows = m_nRows;
+	unsigned nCols = m_nCols;
+	unsigned nLast = nCols-1;
+
+	const FLOAT *pRow = pIn + nRow * nCols;
+	const FLOAT *pPower = m_pPower + nRow * nCols;
+	pOut += nRow * nCols;
+
+	// edge 1 (top) and edge 3 (bottom) with the corners
+	if (   nRow == 0
+	    || nRow == nRows-1)
+	{
+		for (unsigned c = 0; c < nCols; c++)
+		{
+			pOut[c] = pRow[c] + EdgeRowDelta (pIn, nRow, c);
+		}
+
+		return;
+	}
+
+	// edge 4 (left) and the rest of the left boundary chunk
+	FLOAT LastDelta = EdgeColumnDelta (pIn, nRow, FALSE);
+	for (unsigned c = 0; c < BLOCK_SIZE_C; c++)
+	{
+		pOut[c] = pRow[c] + LastDelta;
+	}
+
+	// rest of the right boundary chunk and edge 2 (right)
+	if (nRow % BLOCK_SIZE_R != 0)
+	{
+		LastDelta = nRow > 1 ? EdgeColumnDelta (pIn, nRow-1, TRUE) : EdgeRowDelta (pIn, 0, nLast);
+	}
+	else if (nRow == nRows - BLOCK_SIZE_R)
+	{
+		LastDelta = EdgeRowDelta (pIn, nRows-1, nCols - BLOCK_SIZE_C - 1);
+	}
+	else
+	{
+		LastDelta = EdgeColumnDelta (pIn, nRow + BLOCK_SIZE_R-1, FALSE);
+	}
+
+	for (unsigned c = nCols - BLOCK_SIZE_C; c < nLast; c++)
+	{
+		pOut[c] = pRow[c] + LastDelta;
+	}
+
+	pOut[nLast] = pRow[nLast] + EdgeColumnDelta (pIn, nRow, TRUE);
+
+	// boundary chunks of the first and last row of chunks
+	if (nRow < BLOCK_SIZE_R)
+	{
+		for (unsigned cb = BLOCK_SIZE_C; cb < nCols - BLOCK_SIZE_C; cb += BLOCK_SIZE_C)
+		{
+			LastDelta = EdgeRowDelta (pIn, 0, cb + BLOCK_SIZE_C-1);
+			for (unsigned c = cb; c < cb + BLOCK_SIZE_C; c++)
+			{
+				pOut[c] = pRow[c] + LastDelta;
+			}
+		}
+
+		return;
+	}
+
+	if (nRow >= nRows - BLOCK_SIZE_R)
+	{
+		for (unsigned cb = BLOCK_SIZE_C; cb < nCols - BLOCK_SIZE_C; cb += BLOCK_SIZE_C)
+		{
+			LastDelta = EdgeRowDelta (pIn, nRows-1, cb-1);
+			for (unsigned c = cb; c < cb + BLOCK_SIZE_C; c++)
+			{
+				pOut[c] = pRow[c] + LastDelta;
+			}
+		}
+
+		return;
+	}
+
+	// interior
+	const FLOAT *pAbove = pRow - nCols;
+	const FLOAT *pBelow = pRow + nCols;
+	unsigned nEnd = nCols - BLOCK_SIZE_C;
+	unsigned c = BLOCK_SIZE_C;
+
+#if defined (__aarch64__)
+	float64x2_t vMinus2 = vdupq_n_f64 (-2.0);
+	float64x2_t vAmbient = vdupq_n_f64 (amb_temp);
+	float64x2_t vRx = vdupq_n_f64 (m_Rx_1);
+	float64x2_t vRy = vdupq_n_f64 (m_Ry_1);
+	float64x2_t vRz = vdupq_n_f64 (m_Rz_1);
+	float64x2_t vCap = vdupq_n_f64 (m_Cap_1);
+
+	for (; c+2 <= nEnd; c += 2)
+	{
+		float64x2_t vT = vld1q_f64 (&pRow[c]);
+
+		float64x2_t vV = vfmaq_f64 (vaddq_f64 (vld1q_f64 (&pBelow[c]), vld1q_f64 (&pAbove[c])),
+					    vT, vMinus2);
+		float64x2_t vH = vfmaq_f64 (vaddq_f64 (vld1q_f64 (&pRow[c+1]), vld1q_f64 (&pRow[c-1])),
+					    vT, vMinus2);
+
+		float64x2_t vS = vfmaq_f64 (vld1q_f64 (&pPower[c]), vV, vRy);
+		vS = vfmaq_f64 (vS, vH, vRx);
+		vS = vfmaq_f64 (vS, vsubq_f64 (vAmbient, vT), vRz);
+
+		vst1q_f64 (&pOut[c], vfmaq_f64 (vT, vS, vCap));
+	}
+#endif
+
+	for (; c < nEnd; c++)
+	{
+		FLOAT t = pRow[c];
+
+		pOut[c] = Cell (t, pPower[c], __builtin_fma (-2.0, t, pBelow[c] + pAbove[c]), m_Ry_1,
+				__builtin_fma (-2.0, t, pRow[c+1] + pRow[c-1]), m_Rx_1);
+	}
+}
+
+FLOAT CHotspotStencil::EdgeRowDelta (const FLOAT *pIn, unsigned nRow, unsigned nCol) const
+{
+	assert (nRow == 0 || nRow == m_nRows-1);
+	assert (nCol < m_nCols);
+
+	const FLOAT *pRow = pIn + nRow * m_nCols;
+	const FLOAT *pNeighbour = nRow == 0 ? pRow + m_nCols : pRow - m_nCols;
+	FLOAT t = pRow[nCol];
+
+	FLOAT a;
+	if (nCol == 0)
+	{
+		a = pRow[1] - t;			// corner 1 or 4
+	}
+	else if (nCol == m_nCols-1)
+	{
+		a = pRow[nCol-1] - t;			// corner 2 or 3
+	}
+	else
+	{
+		a = __builtin_fma (-2.0, t, pRow[nCol+1] + pRow[nCol-1]);
+	}
+
+	return Delta (t, m_pPower[nRow * m_nCols + nCol], a, m_Rx_1, pNeighbour[nCol] - t, m_Ry_1);
+}
+
+FLOAT CHotspotStencil::EdgeColumnDelta (const FLOAT *pIn, unsigned nRow, boolean bRight) const
+{
+	assert (0 < nRow && nRow < m_nRows-1);
+
+	unsigned nCol = bRight ? m_nCols-1 : 0;
+	const FLOAT *pCell = pIn + nRow * m_nCols + nCol;
+	FLOAT t = *pCell;
+
+	return Delta (t, m_pPower[nRow * m_nCols + nCol],
+		      __builtin_fma (-2.0, t, pCell[m_nCols] + pCell[-(int) m_nCols]), m_Ry_1,
+		      (bRight ? pCell[-1] : pCell[1]) - t, m_Rx_1);
+}
+
+inline FLOAT CHotspotStencil::Delta (FLOAT t, FLOAT power, FLOAT a, FLOAT Ka, FLOAT b, FLOAT Kb) const
+{
+	FLOAT s = __builtin_fma (a, Ka, power);
+	s = __builtin_fma (b, Kb, s);
+	s = __builtin_fma (amb_temp - t, m_Rz_1, s);
+
+	return m_Cap_1 * s;
+}
+
+inline FLOAT CHotspotStencil::Cell (FLOAT t, FLOAT power, FLOAT a, FLOAT Ka, FLOAT b, FLOAT Kb) const
+{
+	FLOAT s = __builtin_fma (a, Ka, power);
+	s = __builtin_fma (b, Kb, s);
+	s = __builtin_fma (amb_temp - t, m_Rz_1, s);
+
+	return __builtin_fma (m_Cap_1, s, t);
+}
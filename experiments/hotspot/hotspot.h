@@ -0,0 +1,109 @@
+//
+// hotspot.h
+//
+// Transient thermal solver of the hotspot experiment, free of Circle
+// dependencies (except CParallel), so that it can be built for the host too.
+//
+// The rows of the grid are split into one band per core with a barrier
+// after each time step. The edges and corners are computed in own loops and
+// the interior of a row with NEON.
+//
+// The result is the same as of the BLOCK_SIZE_R x BLOCK_SIZE_C chunk loop of
+// the Rodinia code, which generated the gold data. There the cells of the
+// boundary chunks, which are not on the edge, get the delta of the edge
+// cell computed last before ("stale delta"), this is reproduced here.
+//
+// Arithmetic (compiled with -ffp-contract=off -fno-associative-math
+// -fno-reciprocal-math, the fma operations are explicit):
+//	edge cell	delta = Cap_1 * s, t' = t + delta
+//	interior cell	t' = fma (Cap_1, s, t)
+//	s = fma (amb_temp - t, Rz_1, fma (b, Kb, fma (a, Ka, power)))
+//	a, b: (n1 + n2) - 2*t or n1 - t, in the order of the Rodinia source
+// This is the reference code with fused multiply-add contraction within a
+// statement. The explicit operations keep the result independent of the
+// number of cores and of the vector width.
+//
+#ifndef _hotspot_h
+#define _hotspot_h
+
+#include <parallel.h>
+#include <circle/types.h>
+
+#define MAX_ERR_ITER_LOG 500
+
+#define BLOCK_SIZE 16
+#define BLOCK_SIZE_C BLOCK_SIZE
+#define BLOCK_SIZE_R BLOCK_SIZE
+
+#define STR_SIZE	256
+
+/* maximum power density possible (say 300W for a 10mm x 10mm chip)	*/
+#define MAX_PD	(3.0e6)
+/* required precision in degrees	*/
+#define PRECISION	0.001
+#define SPEC_HEAT_SI 1.75e6
+#define K_SI 100
+/* capacitance fitting factor	*/
+#define FACTOR_CHIP	0.5
+
+//#define NUM_THREAD 4
+
+/* Define the precision to float or double depending on compiling flags */
+
+#define FLOAT double 
+#define MAX_SIZE 256
+
+/* chip parameters	*/
+const FLOAT t_chip = 0.0005;
+const FLOAT chip_height = 0.016;
+const FLOAT chip_width = 0.016;
+
+/* ambient temperature, assuming no package at all	*/
+const FLOAT amb_temp = 80.0;
+
+class CHotspotStencil
+{
+public:
+	CHotspotStencil (CParallel *pParallel);
+	~CHotspotStencil (void);
+
+	/// \brief Run the transient solver (all cores)
+	/// \param pResult Buffer for the result
+	/// \param nSteps Number of time steps
+	/// \param pTemp Initial temperatures, is used as second buffer
+	/// \param nRows Grid rows (multiple of BLOCK_SIZE_R, >= 2*BLOCK_SIZE_R)
+	/// \param nCols Grid columns (multiple of BLOCK_SIZE_C, >= 2*BLOCK_SIZE_C)
+	/// \note Step i writes to pResult for even i and to pTemp for odd i (like Rodinia).
+	void Compute (FLOAT *pResult, unsigned nSteps, FLOAT *pTemp, const FLOAT *pPower,
+		      unsigned nRows, unsigned nCols);
+
+private:
+	static void ComputeStub (unsigned nCore, void *pParam);
+	void Compute (unsigned nCore);
+
+	void ComputeRow (FLOAT *pOut, const FLOAT *pIn, unsigned nRow) const;
+
+	// delta of a cell of the first or last row
+	FLOAT EdgeRowDelta (const FLOAT *pIn, unsigned nRow, unsigned nCol) const;
+	// delta of the first (bRight = FALSE) or last cell of an inner row
+	FLOAT EdgeColumnDelta (const FLOAT *pIn, unsigned nRow, boolean bRight) const;
+
+	FLOAT Delta (FLOAT t, FLOAT power, FLOAT a, FLOAT Ka, FLOAT b, FLOAT Kb) const;
+	FLOAT Cell (FLOAT t, FLOAT power, FLOAT a, FLOAT Ka, FLOAT b, FLOAT Kb) const;
+
+private:
+	CParallel *m_pParallel;
+
+	FLOAT *m_pBuffer[2];			// step i writes m_pBuffer[i % 2]
+	const FLOAT *m_pPower;
+	unsigned m_nSteps;
+	unsigned m_nRows;
+	unsigned m_nCols;
+
+	FLOAT m_Cap_1;
+	FLOAT m_Rx_1;
+	FLOAT m_Ry_1;
+	FLOAT m_Rz_1;
+};
+
+#endif
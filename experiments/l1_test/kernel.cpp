@@ -19,119 +19,57 @@
 //
 #include "kernel.h"
 #include <circle/string.h>
-#include <circle/util.h>
 
-#include <math.h>
-
-static const char FromKernel[] = "kernel";
-
-
-/* Single iteration of the transient solver in the grid model.
- * advances the solution of the discretized difference equations
- * by one time step*/
-
-
-
-
-
-CKernel::CKernel (void):
-	m_Screen (m_Options.GetWidth (), m_Options.GetHeight ()),	
-	m_Timer (&m_Interrupt),
-	m_Logger (m_Options.GetLogLevel (), &m_Timer),
-	m_EMMC (&m_Interrupt, &m_Timer, &m_ActLED),
-	m_GPIOManager (&m_Interrupt),
-	m_SoftSerial (17, 18, &m_GPIOManager)	
+CL1Test::CL1Test (void)
 {
-
-	m_ActLED.Blink (5);	// show we are alive
 }
 
-CKernel::~CKernel (void)
+CL1Test::~CL1Test (void)
 {
 }
 
-#define ARRAY_SIZE 32*1024
-volatile unsigned char array[ARRAY_SIZE];
-void CKernel::send_message(int size){
-	m_SoftSerial.Write ((char*)buffer, size*4);
-}
-
-boolean CKernel::Initialize (void)
+boolean CL1Test::Setup (CExperiment *pExperiment)
 {
-	boolean bOK = TRUE;
-
+	pExperiment->SetReportLayout (sizeof (u64));	// index of the word in the buffer
 
-	if (bOK)
-	{
-		bOK = m_Serial.Initialize (115200);
-	}
+	return m_MemoryTest.Initialize ();
+}
 
+void CL1Test::Execute (void)
+{
+	m_MemoryTest.ResetResults ();
 
-	if (bOK)
+	for (unsigned nLevel = 0; nLevel < MemoryLevelUnknown; nLevel++)
 	{
-		bOK = m_Interrupt.Initialize ();
+		for (unsigned nPattern = 0; nPattern < PatternUnknown; nPattern++)
+		{
+			if (   (TEST_LEVELS & MEMTEST_LEVEL (nLevel))
+			    && (TEST_PATTERNS & MEMTEST_PATTERN (nPattern)))
+			{
+				m_MemoryTest.Run ((TMemoryLevel) nLevel, (TMemoryPattern) nPattern,
+						  HOLD_LOOPS);
+			}
+		}
 	}
+}
 
-	if (bOK)
+void CL1Test::Compare (CExperiment *pExperiment)
+{
+	for (unsigned i = 0; i < m_MemoryTest.GetRecordedErrors (); i++)
 	{
-		bOK = m_Timer.Initialize ();
-	}
+		const TMemoryTestError *pError = m_MemoryTest.GetError (i);
 
-	if (bOK)
-	{
-		bOK = m_EMMC.Initialize ();
-	}
-	if (bOK)
-	{
-		bOK = m_GPIOManager.Initialize ();
+		pExperiment->ReportMismatch (pError->nIndex, &pError->nValue, &pError->nExpected);
 	}
 
-	if (bOK)
+	for (unsigned i = 0; i < m_MemoryTest.GetPhases (); i++)
 	{
-		bOK = m_SoftSerial.Initialize ();
-	}
+		const TMemoryTestPhase *pPhase = m_MemoryTest.GetPhase (i);
 
-	return bOK;
-}
+		CString Name;
+		Name.Format ("%s %s M%u", CMemoryTest::GetLevelName (pPhase->Level),
+			     CMemoryTest::GetPatternName (pPhase->Pattern), pPhase->nElement);
 
-
-TShutdownMode CKernel::Run (void)
-{
-	int i;
-  while(1)
-    {
-        for(i=0;i<ARRAY_SIZE;i++)
-        {
-            array[i]=0xA5A5A5A5;
-        }
-
-        for(i=0;i<ARRAY_SIZE;i++){
-        	__asm__("nop");
-        }
-        int flag=0;
-        for(i=0;i<ARRAY_SIZE;i++)
-        {
-            if(array[i]!=0xA5A5A5A5){
-                 if(flag==0){
-                buffer[0] = 0xDD000000;
-                flag=1;
-                }else{
-                    buffer[0] = 0xCC000000;
-                }
-                buffer[1] = *((unsigned int*)&i);
-                unsigned int temp=array[i]^(0xA5A5A5A5);
-                buffer[2] = *((unsigned int*)&temp);
-                send_message(3);
-            }
-           
-        }       
-      if(flag==0){
-        buffer[0] = 0xAA000000;
-          send_message(1); 
-        }
-
-
-    }
-
-	return ShutdownHalt;
+		pExperiment->ReportPhase (Name, pPhase->nBytes, pPhase->nCycles, pPhase->nErrors);
+	}
 }
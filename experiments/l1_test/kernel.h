@@ -20,57 +20,32 @@
 #ifndef _kernel_h
 #define _kernel_h
 
-#include <circle/actled.h>
-#include <circle/koptions.h>
-#include <circle/devicenameservice.h>
-#include <circle/screen.h>
-#include <circle/serial.h>
-#include <circle/exceptionhandler.h>
-#include <circle/interrupt.h>
-#include <circle/timer.h>
-#include <circle/logger.h>
-#include <emmc.h>
-#include <circle/fs/fat/fatfs.h>
+#include <experiment.h>
 #include <circle/types.h>
-#include <circle/gpiomanager.h>
-#include <softserial.h>
+#include "memtest.h"
 
+// working sets and patterns of the march tests (see memtest.h)
+#define TEST_LEVELS	(  MEMTEST_LEVEL (MemoryL1)		\
+			 | MEMTEST_LEVEL (MemoryL2)		\
+			 | MEMTEST_LEVEL (MemoryDRAM))
+#define TEST_PATTERNS	(  MEMTEST_PATTERN (PatternCheckerboard)	\
+			 | MEMTEST_PATTERN (PatternWalkingOnes)	\
+			 | MEMTEST_PATTERN (PatternAddress))
 
+#define HOLD_LOOPS	(32*1024)	// delay between writing and reading the pattern
 
-
-enum TShutdownMode
-{
-	ShutdownNone,
-	ShutdownHalt,
-	ShutdownReboot
-};
-
-class CKernel
+class CL1Test : public CWorkload
 {
 public:
-	CKernel (void);
-	~CKernel (void);
+	CL1Test (void);
+	~CL1Test (void);
+
+	boolean Setup (CExperiment *pExperiment);
+	void Execute (void);
+	void Compare (CExperiment *pExperiment);
 
-	boolean Initialize (void);
-	void send_message(int size);
-	TShutdownMode Run (void);
-	
 private:
-	// do not change this order
-	CActLED			m_ActLED;
-	CKernelOptions		m_Options;
-	CDeviceNameService	m_DeviceNameService;
-	CScreenDevice		m_Screen;
-	CSerialDevice		m_Serial;
-	CExceptionHandler	m_ExceptionHandler;
-	CInterruptSystem	m_Interrupt;
-	CTimer			m_Timer;
-	CLogger			m_Logger;
-	CGPIOManager		m_GPIOManager;	
-	CSoftSerialDevice	m_SoftSerial;
-	CEMMCDevice		m_EMMC;
-	CFATFileSystem		m_FileSystem;
-	unsigned int buffer[10];
+	CMemoryTest m_MemoryTest;
 };
 
 #endif
@@ -0,0 +1,406 @@
+//
+// memtest.cpp
+//
+#include "memtest.h"
+#include <assert.h>
+
+#if defined (__aarch64__)
+	#include <arm_neon.h>
+#endif
+
+#define CHECKERBOARD_EVEN	0xAAAAAAAAAAAAAAAAULL
+#define CHECKERBOARD_ODD	0x5555555555555555ULL
+
+static const char *s_pLevelName[MemoryLevelUnknown] = {"L1", "L2", "DRAM"};
+static const char *s_pPatternName[PatternUnknown] = {"checker", "walking1", "address"};
+
+CMemoryTest::CMemoryTest (void)
+:	m_pMemory (0),
+	m_pBuffer (0),
+	m_nIncrement (0),
+	m_nPhases (0),
+	m_nErrors (0)
+{
+	for (unsigned i = 0; i < MemoryLevelUnknown; i++)
+	{
+		m_SetSize[i] = 0;
+	}
+}
+
+CMemoryTest::~CMemoryTest (void)
+{
+	delete [] m_pMemory;
+	m_pMemory = 0;
+	m_pBuffer = 0;
+}
+
+boolean CMemoryTest::Initialize (void)
+{
+	assert (m_pMemory == 0);
+
+	size_t nL1Size = GetCacheSize (1);
+	size_t nL2Size = GetCacheSize (2);
+	if (   nL1Size == 0
+	    || nL2Size == 0)
+	{
+		return FALSE;
+	}
+
+	// the rest of the cache is left for the stack, the tables and the kernel
+	m_SetSize[MemoryL1] = nL1Size / 2;
+	m_SetSize[MemoryL2] = nL2Size / 2;
+	m_SetSize[MemoryDRAM] = nL2Size * MEMTEST_DRAM_FACTOR;
+
+	const size_t nBlockSize = MEMTEST_BLOCK_WORDS * sizeof (u64);
+	for (unsigned i = 0; i < MemoryLevelUnknown; i++)
+	{
+		m_SetSize[i] -= m_SetSize[i] % nBlockSize;
+		if (m_SetSize[i] == 0)
+		{
+			return FALSE;
+		}
+	}
+
+	m_pMemory = new u8[m_SetSize[MemoryDRAM] + nBlockSize];
+	if (m_pMemory == 0)
+	{
+		return FALSE;
+	}
+
+	uintptr nAddress = (uintptr) m_pMemory;
+	m_pBuffer = (u64 *) ((nAddress + nBlockSize-1) & ~(nBlockSize-1));
+
+	EnableCycleCounter ();
+
+	return TRUE;
+}
+
+size_t CMemoryTest::GetSetSize (TMemoryLevel Level) const
+{
+	assert (Level < MemoryLevelUnknown);
+
+	return m_SetSize[Level];
+}
+
+void CMemoryTest::Run (TMemoryLevel Level, TMemoryPattern Pattern, unsigned nHoldLoops)
+{
+	assert (m_pBuffer != 0);
+	assert (Level < MemoryLevelUnknown);
+	assert (Pattern < PatternUnknown);
+
+	size_t nWords = m_SetSize[Level] / sizeof (u64);
+	u64 nBytes = m_SetSize[Level];
+
+	SetupPattern (Pattern, m_pBuffer);
+
+	if (Level != MemoryDRAM)
+	{
+		// pull the set into the cache, so that the timed elements do not include the misses
+		Write (m_pBuffer, nWords, m_InverseTable, -m_nIncrement);
+	}
+
+	u64 nStart = GetCycles ();
+	Write (m_pBuffer, nWords, m_Table, m_nIncrement);
+	u64 nEnd = GetCycles ();
+	AddPhase (Level, Pattern, 0, nBytes, nEnd - nStart, 0);
+
+	for (unsigned i = 0; i < nHoldLoops; i++)
+	{
+		asm volatile ("nop");
+	}
+
+	nStart = GetCycles ();
+	unsigned nErrors = Verify (m_pBuffer, nWords, m_Table, m_nIncrement,
+				   m_InverseTable, -m_nIncrement, FALSE);
+	nEnd = GetCycles ();
+	AddPhase (Level, Pattern, 1, 2*nBytes, nEnd - nStart, nErrors);
+
+	nStart = GetCycles ();
+	nErrors = Verify (m_pBuffer, nWords, m_InverseTable, -m_nIncrement,
+			  m_Table, m_nIncrement, TRUE);
+	nEnd = GetCycles ();
+	AddPhase (Level, Pattern, 2, 2*nBytes, nEnd - nStart, nErrors);
+
+	nStart = GetCycles ();
+	nErrors = Verify (m_pBuffer, nWords, m_Table, m_nIncrement, 0, 0, FALSE);
+	nEnd = GetCycles ();
+	AddPhase (Level, Pattern, 3, nBytes, nEnd - nStart, nErrors);
+}
+
+void CMemoryTest::ResetResults (void)
+{
+	m_nPhases = 0;
+	m_nErrors = 0;
+}
+
+const TMemoryTestPhase *CMemoryTest::GetPhase (unsigned nPhase) const
+{
+	assert (nPhase < m_nPhases);
+
+	return &m_Phases[nPhase];
+}
+
+unsigned CMemoryTest::GetRecordedErrors (void) const
+{
+	return m_nErrors < MEMTEST_MAX_ERRORS ? m_nErrors : MEMTEST_MAX_ERRORS;
+}
+
+const TMemoryTestError *CMemoryTest::GetError (unsigned nError) const
+{
+	assert (nError < GetRecordedErrors ());
+
+	return &m_Errors[nError];
+}
+
+const char *CMemoryTest::GetLevelName (TMemoryLevel Level)
+{
+	assert (Level < MemoryLevelUnknown);
+
+	return s_pLevelName[Level];
+}
+
+const char *CMemoryTest::GetPatternName (TMemoryPattern Pattern)
+{
+	assert (Pattern < PatternUnknown);
+
+	return s_pPatternName[Pattern];
+}
+
+void CMemoryTest::SetupPattern (TMemoryPattern Pattern, u64 *pWords)
+{
+	for (unsigned i = 0; i < MEMTEST_BLOCK_WORDS; i++)
+	{
+		switch (Pattern)
+		{
+		case PatternCheckerboard:
+			m_Table[i] = i & 1 ? CHECKERBOARD_ODD : CHECKERBOARD_EVEN;
+			break;
+
+		case PatternWalkingOnes:
+			m_Table[i] = 1ULL << (i % 64);
+			break;
+
+		case PatternAddress:
+			m_Table[i] = (u64) (uintptr) &pWords[i];
+			break;
+
+		default:
+			assert (0);
+			break;
+		}
+
+		// ~(a + n*b) = ~a - n*b
+		m_InverseTable[i] = ~m_Table[i];
+	}
+
+	m_nIncrement = Pattern == PatternAddress ? MEMTEST_BLOCK_WORDS * sizeof (u64) : 0;
+}
+
+void CMemoryTest::Write (u64 *pWords, size_t nWords, const u64 *pTable, u64 nIncrement)
+{
+	assert (nWords % MEMTEST_BLOCK_WORDS == 0);
+
+	u64 nOffset = 0;
+	for (u64 *pBlock = pWords; pBlock < pWords + nWords; pBlock += MEMTEST_BLOCK_WORDS)
+	{
+#if defined (__aarch64__)
+		uint64x2_t vOffset = vdupq_n_u64 (nOffset);
+		for (unsigned i = 0; i < MEMTEST_BLOCK_WORDS; i += 8)
+		{
+			vst1q_u64 (pBlock + i,     vaddq_u64 (vld1q_u64 (pTable + i),     vOffset));
+			vst1q_u64 (pBlock + i + 2, vaddq_u64 (vld1q_u64 (pTable + i + 2), vOffset));
+			vst1q_u64 (pBlock + i + 4, vaddq_u64 (vld1q_u64 (pTable + i + 4), vOffset));
+			vst1q_u64 (pBlock + i + 6, vaddq_u64 (vld1q_u64 (pTable + i + 6), vOffset));
+		}
+#else
+		for (unsigned i = 0; i < MEMTEST_BLOCK_WORDS; i++)
+		{
+			((volatile u64 *) pBlock)[i] = pTable[i] + nOffset;
+		}
+#endif
+
+		nOffset += nIncrement;
+	}
+}
+
+unsigned CMemoryTest::Verify (u64 *pWords, size_t nWords, const u64 *pTable, u64 nIncrement,
+			      const u64 *pWriteTable, u64 nWriteIncrement, boolean bDescending)
+{
+	assert (nWords % MEMTEST_BLOCK_WORDS == 0);
+
+	size_t nBlocks = nWords / MEMTEST_BLOCK_WORDS;
+	unsigned nErrors = 0;
+	for (size_t n = 0; n < nBlocks; n++)
+	{
+		size_t nBlock = bDescending ? nBlocks-1 - n : n;
+		u64 *pBlock = pWords + nBlock * MEMTEST_BLOCK_WORDS;
+		u64 nOffset = nBlock * nIncrement;
+
+		// the whole block is read before it is written
+		boolean bMismatch;
+#if defined (__aarch64__)
+		uint64x2_t vOffset = vdupq_n_u64 (nOffset);
+		uint64x2_t vDiff0 = vdupq_n_u64 (0), vDiff1 = vDiff0, vDiff2 = vDiff0, vDiff3 = vDiff0;
+		for (unsigned i = 0; i < MEMTEST_BLOCK_WORDS; i += 8)
+		{
+			unsigned j = bDescending ? MEMTEST_BLOCK_WORDS-8 - i : i;
+
+			vDiff0 = vorrq_u64 (vDiff0, veorq_u64 (vld1q_u64 (pBlock + j),
+					    vaddq_u64 (vld1q_u64 (pTable + j), vOffset)));
+			vDiff1 = vorrq_u64 (vDiff1, veorq_u64 (vld1q_u64 (pBlock + j + 2),
+					    vaddq_u64 (vld1q_u64 (pTable + j + 2), vOffset)));
+			vDiff2 = vorrq_u64 (vDiff2, veorq_u64 (vld1q_u64 (pBlock + j + 4),
+					    vaddq_u64 (vld1q_u64 (pTable + j + 4), vOffset)));
+			vDiff3 = vorrq_u64 (vDiff3, veorq_u64 (vld1q_u64 (pBlock + j + 6),
+					    vaddq_u64 (vld1q_u64 (pTable + j + 6), vOffset)));
+		}
+
+		uint64x2_t vDiff = vorrq_u64 (vorrq_u64 (vDiff0, vDiff1), vorrq_u64 (vDiff2, vDiff3));
+		bMismatch = (vgetq_lane_u64 (vDiff, 0) | vgetq_lane_u64 (vDiff, 1)) != 0;
+#else
+		u64 nDiff = 0;
+		for (unsigned i = 0; i < MEMTEST_BLOCK_WORDS; i++)
+		{
+			unsigned j = bDescending ? MEMTEST_BLOCK_WORDS-1 - i : i;
+
+			nDiff |= ((volatile u64 *) pBlock)[j] ^ (pTable[j] + nOffset);
+		}
+
+		bMismatch = nDiff != 0;
+#endif
+
+		if (bMismatch)
+		{
+			nErrors += CheckBlock (pBlock, pTable, nOffset);
+		}
+
+		if (pWriteTable == 0)
+		{
+			continue;
+		}
+
+		u64 nWriteOffset = nBlock * nWriteIncrement;
+#if defined (__aarch64__)
+		uint64x2_t vWriteOffset = vdupq_n_u64 (nWriteOffset);
+		for (unsigned i = 0; i < MEMTEST_BLOCK_WORDS; i += 8)
+		{
+			unsigned j = bDescending ? MEMTEST_BLOCK_WORDS-8 - i : i;
+
+			vst1q_u64 (pBlock + j,     vaddq_u64 (vld1q_u64 (pWriteTable + j),     vWriteOffset));
+			vst1q_u64 (pBlock + j + 2, vaddq_u64 (vld1q_u64 (pWriteTable + j + 2), vWriteOffset));
+			vst1q_u64 (pBlock + j + 4, vaddq_u64 (vld1q_u64 (pWriteTable + j + 4), vWriteOffset));
+			vst1q_u64 (pBlock + j + 6, vaddq_u64 (vld1q_u64 (pWriteTable + j + 6), vWriteOffset));
+		}
+#else
+		for (unsigned i = 0; i < MEMTEST_BLOCK_WORDS; i++)
+		{
+			unsigned j = bDescending ? MEMTEST_BLOCK_WORDS-1 - i : i;
+
+			((volatile u64 *) pBlock)[j] = pWriteTable[j] + nWriteOffset;
+		}
+#endif
+	}
+
+	return nErrors;
+}
+
+unsigned CMemoryTest::CheckBlock (const u64 *pBlock, const u64 *pTable, u64 nOffset)
+{
+	unsigned nErrors = 0;
+	for (unsigned i = 0; i < MEMTEST_BLOCK_WORDS; i++)
+	{
+		u64 nValue = ((volatile const u64 *) pBlock)[i];
+		u64 nExpected = pTable[i] + nOffset;
+		if (nValue == nExpected)
+		{
+			continue;
+		}
+
+		if (m_nErrors < MEMTEST_MAX_ERRORS)
+		{
+			TMemoryTestError *pError = &m_Errors[m_nErrors];
+
+			pError->nIndex = pBlock + i - m_pBuffer;
+			pError->nValue = nValue;
+			pError->nExpected = nExpected;
+		}
+
+		m_nErrors++;
+		nErrors++;
+	}
+
+	return nErrors;
+}
+
+void CMemoryTest::AddPhase (TMemoryLevel Level, TMemoryPattern Pattern, unsigned nElement,
+			    u64 nBytes, u64 nCycles, unsigned nErrors)
+{
+	if (m_nPhases >= MEMTEST_MAX_PHASES)
+	{
+		return;
+	}
+
+	TMemoryTestPhase *pPhase = &m_Phases[m_nPhases++];
+
+	pPhase->Level = Level;
+	pPhase->Pattern = Pattern;
+	pPhase->nElement = nElement;
+	pPhase->nBytes = nBytes;
+	pPhase->nCycles = nCycles;
+	pPhase->nErrors = nErrors;
+}
+
+size_t CMemoryTest::GetCacheSize (unsigned nLevel)
+{
+	assert (1 <= nLevel && nLevel <= 7);
+
+#if defined (__aarch64__)
+	u64 nCLIDR;
+	asm volatile ("mrs %0, clidr_el1" : "=r" (nCLIDR));
+
+	unsigned nType = (nCLIDR >> (3 * (nLevel-1))) & 7;
+	if (nType < 2)				// no cache or instruction cache only
+	{
+		return 0;
+	}
+
+	// data or unified cache of this level
+	asm volatile ("msr csselr_el1, %0; isb" :: "r" ((u64) (nLevel-1) << 1));
+
+	u64 nCCSIDR;
+	asm volatile ("mrs %0, ccsidr_el1" : "=r" (nCCSIDR));
+
+	size_t nLineSize = 16 << (nCCSIDR & 7);
+	size_t nWays = ((nCCSIDR >> 3) & 0x3FF) + 1;
+	size_t nSets = ((nCCSIDR >> 13) & 0x7FFF) + 1;
+
+	return nLineSize * nWays * nSets;
+#else
+	return nLevel == 1 ? 32*1024 : (nLevel == 2 ? 1024*1024 : 0);
+#endif
+}
+
+void CMemoryTest::EnableCycleCounter (void)
+{
+#if defined (__aarch64__)
+	u64 nPMCR;
+	asm volatile ("mrs %0, pmcr_el0" : "=r" (nPMCR));
+	nPMCR |= 1 << 0 | 1 << 6;		// enable, 64-bit overflow
+	asm volatile ("msr pmcr_el0, %0" :: "r" (nPMCR));
+
+	asm volatile ("msr pmccfiltr_el0, %0" :: "r" (0ULL));	// count at EL0 and EL1
+	asm volatile ("msr pmcntenset_el0, %0; isb" :: "r" (1ULL << 31));
+#endif
+}
+
+u64 CMemoryTest::GetCycles (void)
+{
+#if defined (__aarch64__)
+	u64 nCycles;
+	asm volatile ("isb; mrs %0, pmccntr_el0" : "=r" (nCycles) :: "memory");
+
+	return nCycles;
+#else
+	return 0;
+#endif
+}
@@ -0,0 +1,147 @@
+//
+// memtest.h
+//
+// Memory test engine of the l1_test experiment. Runs march tests with
+// different data patterns on working sets, which are sized from the cache
+// geometry (CLIDR_EL1, CCSIDR_EL1), so that they stay in the L1 data cache or
+// in the L2 cache or stream through the DRAM. Each march element is timed
+// with the cycle counter (PMCCNTR_EL0), so that the throughput and the errors
+// of each memory level can be measured separately.
+//
+// March elements on the 64-bit words w[0] .. w[n-1] with the pattern P:
+//	M0	ascending:	write P
+//			hold (spin for a number of loops)
+//	M1	ascending:	read P, write ~P
+//	M2	descending:	read ~P, write P
+//	M3	ascending:	read P
+//
+// Patterns:
+//	checkerboard	0xAAAA... and 0x5555... alternating
+//	walking ones	1 << (i % 64)
+//	address		address of w[i]
+//
+// The loads, stores and compares are done with NEON, 64 words at once. A
+// block with a mismatch is checked again word by word to record the errors.
+//
+#ifndef _memtest_h
+#define _memtest_h
+
+#include <circle/macros.h>
+#include <circle/types.h>
+
+enum TMemoryLevel
+{
+	MemoryL1,			// half of the L1 data cache
+	MemoryL2,			// half of the L2 cache
+	MemoryDRAM,			// MEMTEST_DRAM_FACTOR times the L2 cache
+	MemoryLevelUnknown
+};
+
+enum TMemoryPattern
+{
+	PatternCheckerboard,
+	PatternWalkingOnes,
+	PatternAddress,
+	PatternUnknown
+};
+
+#define MEMTEST_LEVEL(level)		(1 << (level))
+#define MEMTEST_PATTERN(pattern)	(1 << (pattern))
+
+#define MEMTEST_DRAM_FACTOR		8
+#define MEMTEST_MARCH_ELEMENTS		4
+#define MEMTEST_MAX_PHASES		(MemoryLevelUnknown * PatternUnknown * MEMTEST_MARCH_ELEMENTS)
+#define MEMTEST_MAX_ERRORS		64		// recorded with index and value
+
+#define MEMTEST_BLOCK_WORDS		64		// period of the pattern table
+
+struct TMemoryTestPhase
+{
+	TMemoryLevel	Level;
+	TMemoryPattern	Pattern;
+	unsigned	nElement;			// M0 .. M3
+	u64		nBytes;				// read and written
+	u64		nCycles;
+	unsigned	nErrors;
+};
+
+struct TMemoryTestError
+{
+	unsigned	nIndex;				// word index in the buffer
+	u64		nValue;
+	u64		nExpected;
+};
+
+class CMemoryTest
+{
+public:
+	CMemoryTest (void);
+	~CMemoryTest (void);
+
+	/// \brief Reads the cache geometry, allocates the buffer and enables the cycle counter
+	boolean Initialize (void);
+
+	/// \return Size of the working set of Level in bytes
+	size_t GetSetSize (TMemoryLevel Level) const;
+
+	/// \brief Run the march test with Pattern on the working set of Level
+	/// \param nHoldLoops Delay between M0 and M1
+	void Run (TMemoryLevel Level, TMemoryPattern Pattern, unsigned nHoldLoops);
+
+	/// \brief Clear the phases and errors of the previous runs
+	void ResetResults (void);
+
+	unsigned GetPhases (void) const			{ return m_nPhases; }
+	const TMemoryTestPhase *GetPhase (unsigned nPhase) const;
+
+	/// \return Number of mismatching words found in all phases
+	unsigned GetErrors (void) const			{ return m_nErrors; }
+	/// \return Number of errors, which have been recorded (up to MEMTEST_MAX_ERRORS)
+	unsigned GetRecordedErrors (void) const;
+	const TMemoryTestError *GetError (unsigned nError) const;
+
+	static const char *GetLevelName (TMemoryLevel Level);
+	static const char *GetPatternName (TMemoryPattern Pattern);
+
+private:
+	void SetupPattern (TMemoryPattern Pattern, u64 *pWords);
+
+	/// \brief Write the pattern (Table, nIncrement) to nWords words
+	void Write (u64 *pWords, size_t nWords, const u64 *pTable, u64 nIncrement);
+
+	/// \brief Verify the pattern (Table, nIncrement), optionally write the pattern (WriteTable, ...)
+	/// \return Number of mismatches
+	unsigned Verify (u64 *pWords, size_t nWords, const u64 *pTable, u64 nIncrement,
+			 const u64 *pWriteTable, u64 nWriteIncrement, boolean bDescending);
+
+	/// \return Number of mismatches in a block (recorded)
+	unsigned CheckBlock (const u64 *pBlock, const u64 *pTable, u64 nOffset);
+
+	void AddPhase (TMemoryLevel Level, TMemoryPattern Pattern, unsigned nElement,
+		       u64 nBytes, u64 nCycles, unsigned nErrors);
+
+	static size_t GetCacheSize (unsigned nLevel);	// 1: L1 data, 2: L2
+
+	static void EnableCycleCounter (void);
+	static u64 GetCycles (void);
+
+private:
+	size_t m_SetSize[MemoryLevelUnknown];
+
+	u8 *m_pMemory;
+	u64 *m_pBuffer;				// aligned to a cache line
+
+	// pattern P(i) = m_Table[i % MEMTEST_BLOCK_WORDS] + i / MEMTEST_BLOCK_WORDS * m_nIncrement,
+	// ~P(i) = m_InverseTable[...] - ... * m_nIncrement
+	u64 m_Table[MEMTEST_BLOCK_WORDS] ALIGN (64);
+	u64 m_InverseTable[MEMTEST_BLOCK_WORDS] ALIGN (64);
+	u64 m_nIncrement;
+
+	TMemoryTestPhase m_Phases[MEMTEST_MAX_PHASES];
+	unsigned m_nPhases;
+
+	TMemoryTestError m_Errors[MEMTEST_MAX_ERRORS];
+	unsigned m_nErrors;
+};
+
+#endif
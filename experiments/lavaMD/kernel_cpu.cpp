@@ -1,98 +1,346 @@
+//
+// kernel_cpu.cpp
+//
+// This must be compiled with -ffp-contract=off -fno-associative-math
+// -fno-reciprocal-math (see kernel_cpu.h).
+//
 #include <stdlib.h>
 #include <stdio.h>
-#include <math.h>
-#include "kernel.h"
+#include "lavamd.h"
 #include "kernel_cpu.h"
+#include <circle/util.h>
+#include <assert.h>
 
-void  kernel_cpu( par_str par, dim_str dim, box_str* box, FOUR_VECTOR* rv, fp* qv, FOUR_VECTOR* fv)
+#if defined (__aarch64__)
+	#include <arm_neon.h>
+#endif
+
+#define CONVERT_GRAIN	1024		// particles
+
+// sets up the home boxes and their neighbor lists for dim.boxes1d_arg^3 boxes
+void init_boxes(dim_str dim, box_str* box)
 {
+    int i, j, k, l, m, n;
+    int nh;
 
+    nh = 0;
 
-    // parameters
-    fp alpha;
-    fp a2;
+    for(i=0; i<dim.boxes1d_arg; i++) {
 
-    // counters
-    int i, j, k, l;
+        for(j=0; j<dim.boxes1d_arg; j++) {
 
-    // home box
-    long first_i;
-    FOUR_VECTOR* rA;
-    FOUR_VECTOR* fA;
+            for(k=0; k<dim.boxes1d_arg; k++) {
 
-    // neighbor box
-    int pointer;
-    long first_j;
-    FOUR_VECTOR* rB;
-    fp* qB;
+                box[nh].x = k;
+                box[nh].y = j;
+                box[nh].z = i;
+                box[nh].number = nh;
+                box[nh].offset = nh * NUMBER_PAR_PER_BOX;
 
-    // common
-    fp r2;
-    fp u2;
-    fp fs;
-    fp vij;
-    fp fxij,fyij,fzij;
-    THREE_VECTOR d;
+                box[nh].nn = 0;
 
+                for(l=-1; l<2; l++) {
 
+                    for(m=-1; m<2; m++) {
 
-    alpha = par.alpha;
-    a2 = 2.0*alpha*alpha;
+                        for(n=-1; n<2; n++) {
 
+                            if((((i+l)>=0 && (j+m)>=0 && (k+n)>=0)==true && ((i+l)<dim.boxes1d_arg && (j+m)<dim.boxes1d_arg && (k+n)<dim.boxes1d_arg)==true) && (l==0 && m==0 && n==0)==false) {
 
-    for(l=0; l<dim.number_boxes; l=l+1) {
+                                box[nh].nei[box[nh].nn].x = (k+n);
+                                box[nh].nei[box[nh].nn].y = (j+m);
+                                box[nh].nei[box[nh].nn].z = (i+l);
+                                box[nh].nei[box[nh].nn].number = (box[nh].nei[box[nh].nn].z * dim.boxes1d_arg * dim.boxes1d_arg) + (box[nh].nei[box[nh].nn].y * dim.boxes1d_arg) + box[nh].nei[box[nh].nn].x;
+                                box[nh].nei[box[nh].nn].offset = box[nh].nei[box[nh].nn].number * NUMBER_PAR_PER_BOX;
 
-        first_i = box[l].offset;
+                                box[nh].nn = box[nh].nn + 1;
 
+                            }
+                        }
+                    }
+                }
 
-        rA = &rv[first_i];
-        fA = &fv[first_i];
+                nh = nh + 1;
+            }
+        }
+    }
+}
 
+#define EXP_MIN		-708.0
+#define EXP_MAX		709.0
 
-        for (k=0; k<(1+box[l].nn); k++) {
+#define LOG2E		1.44269504088896338700e+00
+#define LN2_HI		6.93147180369123816490e-01	// upper bits of ln(2), n*LN2_HI is exact
+#define LN2_LO		1.90821492927058770002e-10
 
-            if(k==0) {
-                pointer = l;
-            } else {
-                pointer = box[l].nei[k-1].number;
-            }
+// Taylor series of e^r for |r| <= ln(2)/2
+#define EXP_C2		(1.0 / 2.0)
+#define EXP_C3		(1.0 / 6.0)
+#define EXP_C4		(1.0 / 24.0)
+#define EXP_C5		(1.0 / 120.0)
+#define EXP_C6		(1.0 / 720.0)
+#define EXP_C7		(1.0 / 5040.0)
+#define EXP_C8		(1.0 / 40320.0)
+#define EXP_C9		(1.0 / 362880.0)
+#define EXP_C10		(1.0 / 3628800.0)
+#define EXP_C11		(1.0 / 39916800.0)
+#define EXP_C12		(1.0 / 479001600.0)
+#define EXP_C13		(1.0 / 6227020800.0)
 
+#if defined (__aarch64__)
 
-            first_j = box[pointer].offset;
+// two lanes of CLavaMDKernel::Exp()
+static inline float64x2_t ExpNEON (float64x2_t vX)
+{
+	uint64x2_t vUnderflow = vcltq_f64 (vX, vdupq_n_f64 (EXP_MIN));
+	vX = vminq_f64 (vX, vdupq_n_f64 (EXP_MAX));
 
-            rB = &rv[first_j];
-            qB = &qv[first_j];
+	float64x2_t vN = vrndnq_f64 (vmulq_f64 (vX, vdupq_n_f64 (LOG2E)));
+	float64x2_t vR = vfmsq_f64 (vX, vN, vdupq_n_f64 (LN2_HI));
+	vR = vfmsq_f64 (vR, vN, vdupq_n_f64 (LN2_LO));
 
+	float64x2_t vP = vdupq_n_f64 (EXP_C13);
+	vP = vfmaq_f64 (vdupq_n_f64 (EXP_C12), vP, vR);
+	vP = vfmaq_f64 (vdupq_n_f64 (EXP_C11), vP, vR);
+	vP = vfmaq_f64 (vdupq_n_f64 (EXP_C10), vP, vR);
+	vP = vfmaq_f64 (vdupq_n_f64 (EXP_C9), vP, vR);
+	vP = vfmaq_f64 (vdupq_n_f64 (EXP_C8), vP, vR);
+	vP = vfmaq_f64 (vdupq_n_f64 (EXP_C7), vP, vR);
+	vP = vfmaq_f64 (vdupq_n_f64 (EXP_C6), vP, vR);
+	vP = vfmaq_f64 (vdupq_n_f64 (EXP_C5), vP, vR);
+	vP = vfmaq_f64 (vdupq_n_f64 (EXP_C4), vP, vR);
+	vP = vfmaq_f64 (vdupq_n_f64 (EXP_C3), vP, vR);
+	vP = vfmaq_f64 (vdupq_n_f64 (EXP_C2), vP, vR);
+	vP = vfmaq_f64 (vdupq_n_f64 (1.0), vP, vR);
+	vP = vfmaq_f64 (vdupq_n_f64 (1.0), vP, vR);
 
-            for (i=0; i<NUMBER_PAR_PER_BOX; i=i+1) {
+	int64x2_t vScale = vshlq_n_s64 (vaddq_s64 (vcvtq_s64_f64 (vN), vdupq_n_s64 (1023)), 52);
+	float64x2_t vResult = vmulq_f64 (vP, vreinterpretq_f64_s64 (vScale));
 
-                // do for the # of particles in current (home or neighbor) box
-                for (j=0; j<NUMBER_PAR_PER_BOX; j=j+1) {
+	return vbslq_f64 (vUnderflow, vdupq_n_f64 (0.0), vResult);
+}
 
-                    // // coefficients
-                    r2 = rA[i].v + rB[j].v - (rA[i].x * rB[j].x + rA[i].y * rB[j].y + rA[i].z * rB[j].z);
-                    u2 = a2*r2;
-                    vij= exp(-u2);
-                    fs = 2.*vij;
-                    d.x = rA[i].x  - rB[j].x;
-                    d.y = rA[i].y  - rB[j].y;
-                    d.z = rA[i].z  - rB[j].z;
-                    fxij=fs*d.x;
-                    fyij=fs*d.y;
-                    fzij=fs*d.z;
+#endif
 
-                    // forces
-                    fA[i].v +=  qB[j]*vij;
-                    fA[i].x +=  qB[j]*fxij;
-                    fA[i].y +=  qB[j]*fyij;
-                    fA[i].z +=  qB[j]*fzij;
+CLavaMDKernel::CLavaMDKernel (CParallel *pParallel)
+:	m_TaskPool (pParallel),
+	m_a2 (0.0),
+	m_pDim (0),
+	m_pBox (0),
+	m_pRV (0),
+	m_pQV (0),
+	m_pFV (0),
+	m_pRVSoA (0),
+	m_nSoAElements (0)
+{
+}
 
-                }
+CLavaMDKernel::~CLavaMDKernel (void)
+{
+	delete [] m_pRVSoA;
+	m_pRVSoA = 0;
+}
 
-            }
+u64 CLavaMDKernel::Compute (const par_str &par, const dim_str &dim, const box_str *box,
+			    const FOUR_VECTOR *rv, const fp *qv, FOUR_VECTOR *fv)
+{
+	assert (box != 0);
+	assert (rv != 0);
+	assert (qv != 0);
+	assert (fv != 0);
 
-        }
+	if (dim.space_elem > m_nSoAElements)
+	{
+		delete [] m_pRVSoA;
 
-    }
+		m_pRVSoA = new fp[4 * dim.space_elem];
+		assert (m_pRVSoA != 0);
+		m_nSoAElements = dim.space_elem;
+	}
+
+	m_a2 = 2.0*par.alpha*par.alpha;
+	m_pDim = &dim;
+	m_pBox = box;
+	m_pRV = rv;
+	m_pQV = qv;
+	m_pFV = fv;
+
+	TConvertParticle Convert = {this};
+	m_TaskPool.ParallelFor (0, dim.space_elem, CONVERT_GRAIN, Convert);
+
+	TComputeBoxes Compute = {this};
+	TSumPairs Sum;
+	return m_TaskPool.ParallelReduce (0, dim.number_boxes, 1, (u64) 0, Compute, Sum);
+}
+
+void CLavaMDKernel::Convert (long nParticle)
+{
+	long nElements = m_pDim->space_elem;
+	fp *pV = m_pRVSoA;
+	fp *pX = pV + nElements;
+	fp *pY = pX + nElements;
+	fp *pZ = pY + nElements;
+
+	pV[nParticle] = m_pRV[nParticle].v;
+	pX[nParticle] = m_pRV[nParticle].x;
+	pY[nParticle] = m_pRV[nParticle].y;
+	pZ[nParticle] = m_pRV[nParticle].z;
+}
+
+u64 CLavaMDKernel::TComputeBoxes::operator() (unsigned nFirst, unsigned nEnd) const
+{
+	assert (pThis != 0);
+
+	u64 nPairs = 0;
+	for (unsigned nBox = nFirst; nBox < nEnd; nBox++)
+	{
+		pThis->ComputeBox (nBox);
+
+		nPairs += (1 + pThis->m_pBox[nBox].nn) * (u64) (NUMBER_PAR_PER_BOX * NUMBER_PAR_PER_BOX);
+	}
+
+	return nPairs;
+}
+
+void CLavaMDKernel::ComputeBox (long nBox)
+{
+	long nElements = m_pDim->space_elem;
+	const fp *pV = m_pRVSoA;
+	const fp *pX = pV + nElements;
+	const fp *pY = pX + nElements;
+	const fp *pZ = pY + nElements;
+
+	const box_str *pHome = &m_pBox[nBox];
+	long first_i = pHome->offset;
+	FOUR_VECTOR *fA = &m_pFV[first_i];
+
+	int i = 0;
+
+#if defined (__aarch64__)
+	float64x2_t va2 = vdupq_n_f64 (m_a2);
+
+	for (; i+2 <= NUMBER_PAR_PER_BOX; i += 2)
+	{
+		float64x2_t vAv = vld1q_f64 (&pV[first_i + i]);
+		float64x2_t vAx = vld1q_f64 (&pX[first_i + i]);
+		float64x2_t vAy = vld1q_f64 (&pY[first_i + i]);
+		float64x2_t vAz = vld1q_f64 (&pZ[first_i + i]);
+
+		float64x2_t vFv = vdupq_n_f64 (0.0);
+		float64x2_t vFx = vdupq_n_f64 (0.0);
+		float64x2_t vFy = vdupq_n_f64 (0.0);
+		float64x2_t vFz = vdupq_n_f64 (0.0);
+
+		for (int k = 0; k < 1 + pHome->nn; k++)
+		{
+			long first_j = k == 0 ? first_i : m_pBox[pHome->nei[k-1].number].offset;
+
+			for (long j = first_j; j < first_j + NUMBER_PAR_PER_BOX; j++)
+			{
+				float64x2_t vBx = vld1q_dup_f64 (&pX[j]);
+				float64x2_t vBy = vld1q_dup_f64 (&pY[j]);
+				float64x2_t vBz = vld1q_dup_f64 (&pZ[j]);
+				float64x2_t vQ = vld1q_dup_f64 (&m_pQV[j]);
+
+				float64x2_t vDot = vmulq_f64 (vAx, vBx);
+				vDot = vfmaq_f64 (vDot, vAy, vBy);
+				vDot = vfmaq_f64 (vDot, vAz, vBz);
+
+				float64x2_t vR2 = vsubq_f64 (vaddq_f64 (vAv, vld1q_dup_f64 (&pV[j])), vDot);
+				float64x2_t vVij = ExpNEON (vnegq_f64 (vmulq_f64 (va2, vR2)));
+				float64x2_t vFs = vaddq_f64 (vVij, vVij);
+
+				vFv = vfmaq_f64 (vFv, vQ, vVij);
+				vFx = vfmaq_f64 (vFx, vQ, vmulq_f64 (vFs, vsubq_f64 (vAx, vBx)));
+				vFy = vfmaq_f64 (vFy, vQ, vmulq_f64 (vFs, vsubq_f64 (vAy, vBy)));
+				vFz = vfmaq_f64 (vFz, vQ, vmulq_f64 (vFs, vsubq_f64 (vAz, vBz)));
+			}
+		}
+
+		fA[i].v = vgetq_lane_f64 (vFv, 0);
+		fA[i].x = vgetq_lane_f64 (vFx, 0);
+		fA[i].y = vgetq_lane_f64 (vFy, 0);
+		fA[i].z = vgetq_lane_f64 (vFz, 0);
+		fA[i+1].v = vgetq_lane_f64 (vFv, 1);
+		fA[i+1].x = vgetq_lane_f64 (vFx, 1);
+		fA[i+1].y = vgetq_lane_f64 (vFy, 1);
+		fA[i+1].z = vgetq_lane_f64 (vFz, 1);
+	}
+#endif
+
+	for (; i < NUMBER_PAR_PER_BOX; i++)
+	{
+		fp Av = pV[first_i + i];
+		fp Ax = pX[first_i + i];
+		fp Ay = pY[first_i + i];
+		fp Az = pZ[first_i + i];
+
+		fp Fv = 0.0, Fx = 0.0, Fy = 0.0, Fz = 0.0;
+
+		for (int k = 0; k < 1 + pHome->nn; k++)
+		{
+			long first_j = k == 0 ? first_i : m_pBox[pHome->nei[k-1].number].offset;
+
+			for (long j = first_j; j < first_j + NUMBER_PAR_PER_BOX; j++)
+			{
+				fp Dot = Ax * pX[j];
+				Dot = __builtin_fma (Ay, pY[j], Dot);
+				Dot = __builtin_fma (Az, pZ[j], Dot);
+
+				fp r2 = (Av + pV[j]) - Dot;
+				fp vij = Exp (-(m_a2 * r2));
+				fp fs = vij + vij;
+
+				fp q = m_pQV[j];
+				Fv = __builtin_fma (q, vij, Fv);
+				Fx = __builtin_fma (q, fs * (Ax - pX[j]), Fx);
+				Fy = __builtin_fma (q, fs * (Ay - pY[j]), Fy);
+				Fz = __builtin_fma (q, fs * (Az - pZ[j]), Fz);
+			}
+		}
+
+		fA[i].v = Fv;
+		fA[i].x = Fx;
+		fA[i].y = Fy;
+		fA[i].z = Fz;
+	}
+}
+
+// e^x = 2^n * e^r with n = round (x / ln(2)), r = x - n*ln(2)
+fp CLavaMDKernel::Exp (fp x)
+{
+	if (x < EXP_MIN)
+	{
+		return 0.0;
+	}
+
+	if (x > EXP_MAX)
+	{
+		x = EXP_MAX;
+	}
+
+	fp n = __builtin_rint (x * LOG2E);
+	fp r = __builtin_fma (-n, LN2_HI, x);
+	r = __builtin_fma (-n, LN2_LO, r);
+
+	fp p = EXP_C13;
+	p = __builtin_fma (p, r, EXP_C12);
+	p = __builtin_fma (p, r, EXP_C11);
+	p = __builtin_fma (p, r, EXP_C10);
+	p = __builtin_fma (p, r, EXP_C9);
+	p = __builtin_fma (p, r, EXP_C8);
+	p = __builtin_fma (p, r, EXP_C7);
+	p = __builtin_fma (p, r, EXP_C6);
+	p = __builtin_fma (p, r, EXP_C5);
+	p = __builtin_fma (p, r, EXP_C4);
+	p = __builtin_fma (p, r, EXP_C3);
+	p = __builtin_fma (p, r, EXP_C2);
+	p = __builtin_fma (p, r, 1.0);
+	p = __builtin_fma (p, r, 1.0);
+
+	u64 nScale = (u64) ((s64) n + 1023) << 52;
+	fp Scale;
+	memcpy (&Scale, &nScale, sizeof Scale);
 
+	return p * Scale;
 }
@@ -1,14 +1,93 @@
+//
+// kernel_cpu.h
+//
+// Force computation of lavaMD, free of Circle dependencies (except
+// CParallel and CTaskPool), so that it can be built for the host too.
+//
+// The home boxes are distributed across the cores with the work-stealing
+// CTaskPool (ParallelReduce(), which also counts the particle pairs),
+// because the boxes on the border have less neighbors. Each box writes only
+// the forces of its own particles. The particle data is converted to a
+// structure of arrays (ParallelFor()) and two home particles are computed at
+// once with NEON (the interactions of a particle are accumulated in the same
+// order as in the Rodinia code).
+//
+// exp() is computed with a fixed polynomial (see Exp()) and the fused
+// multiply-adds are explicit (compiled with -ffp-contract=off and without
+// reassociation and reciprocals), so that the NEON code and the scalar code
+// give the same result on all machines.
+// The result differs from the original lavaMD, so the gold file has an own
+// name (output_gold_1_5_fast). It can be generated on the host from the
+// input files with host/bench -g (see host/README).
+//
+#ifndef _kernel_cpu_h
+#define _kernel_cpu_h
+
+#include "lavamd.h"
+#include <parallel.h>
+#include <taskpool.h>
+#include <circle/types.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-void  kernel_cpu(	par_str par,
-                    dim_str dim,
-                    box_str* box,
-                    FOUR_VECTOR* rv,
-                    fp* qv,
-                    FOUR_VECTOR* fv);
+void init_boxes(dim_str dim, box_str* box);
 
 #ifdef __cplusplus
 }
 #endif
+
+class CLavaMDKernel
+{
+public:
+	CLavaMDKernel (CParallel *pParallel);
+	~CLavaMDKernel (void);
+
+	/// \brief Compute the forces of all particles (all cores)
+	/// \param fv Forces, will be overwritten
+	/// \return Number of particle pairs computed
+	u64 Compute (const par_str &par, const dim_str &dim, const box_str *box,
+		     const FOUR_VECTOR *rv, const fp *qv, FOUR_VECTOR *fv);
+
+	/// \return e^x, relative error < 1e-15, 0 for x < -708
+	static fp Exp (fp x);
+
+private:
+	void Convert (long nParticle);
+	void ComputeBox (long nBox);
+
+	struct TConvertParticle			// for ParallelFor()
+	{
+		CLavaMDKernel *pThis;
+
+		void operator() (unsigned nParticle) const	{ pThis->Convert (nParticle); }
+	};
+
+	struct TComputeBoxes			// for ParallelReduce(), returns the pairs
+	{
+		CLavaMDKernel *pThis;
+
+		u64 operator() (unsigned nFirst, unsigned nEnd) const;
+	};
+
+	struct TSumPairs
+	{
+		u64 operator() (const u64 &nA, const u64 &nB) const	{ return nA + nB; }
+	};
+
+private:
+	CTaskPool m_TaskPool;
+
+	fp m_a2;
+	const dim_str *m_pDim;
+	const box_str *m_pBox;
+	const FOUR_VECTOR *m_pRV;
+	const fp *m_pQV;
+	FOUR_VECTOR *m_pFV;
+
+	fp *m_pRVSoA;				// v, x, y and z of all particles in sequence
+	long m_nSoAElements;
+};
+
+#endif
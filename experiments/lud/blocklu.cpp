@@ -0,0 +1,85 @@
+//
+// blocklu.cpp
+//
+#include "blocklu.h"
+#include <assert.h>
+
+#define BLOCK_SIZE	16			// BS in common.cpp
+
+CBlockLU::CBlockLU (CParallel *pParallel)
+:	m_pParallel (pParallel),
+	m_pMatrix (0),
+	m_nSize (0),
+	m_nOffset (0)
+{
+}
+
+CBlockLU::~CBlockLU (void)
+{
+	m_pParallel = 0;
+}
+
+void CBlockLU::Decompose (FP *pMatrix, int nSize)
+{
+	assert (m_pParallel != 0);
+	assert (pMatrix != 0);
+	assert (nSize > 0 && nSize % BLOCK_SIZE == 0);
+
+	m_pMatrix = pMatrix;
+	m_nSize = nSize;
+
+	m_pParallel->Execute (DecomposeStub, this);
+}
+
+void CBlockLU::DecomposeStub (unsigned nCore, void *pParam)
+{
+	CBlockLU *pThis = (CBlockLU *) pParam;
+	assert (pThis != 0);
+
+	pThis->Decompose (nCore);
+}
+
+void CBlockLU::Decompose (unsigned nCore)
+{
+	assert (nCore < PARALLEL_CORES);
+
+	int nOffset;
+	for (nOffset = 0; nOffset < m_nSize - BLOCK_SIZE; nOffset += BLOCK_SIZE)
+	{
+		if (nCore == 0)
+		{
+			m_nOffset = nOffset;
+
+			lud_diagonal_omp (m_pMatrix, m_nSize, nOffset);
+		}
+
+		m_pParallel->Barrier ();
+
+		unsigned nChunks = (m_nSize - nOffset - BLOCK_SIZE) / BLOCK_SIZE;
+
+		m_pParallel->For (nCore, 0, nChunks, PerimeterStub, this);
+
+		m_pParallel->For (nCore, 0, nChunks * nChunks, InteriorStub, this);
+	}
+
+	if (nCore == 0)
+	{
+		lud_diagonal_omp (m_pMatrix, m_nSize, nOffset);
+	}
+}
+
+void CBlockLU::PerimeterStub (unsigned nChunk, void *pParam)
+{
+	CBlockLU *pThis = (CBlockLU *) pParam;
+	assert (pThis != 0);
+
+	lud_perimeter_omp (pThis->m_pMatrix, pThis->m_nSize, pThis->m_nOffset, nChunk);
+}
+
+void CBlockLU::InteriorStub (unsigned nChunk, void *pParam)
+{
+	CBlockLU *pThis = (CBlockLU *) pParam;
+	assert (pThis != 0);
+
+	lud_interior_omp (pThis->m_pMatrix, pThis->m_nSize, pThis->m_nOffset, nChunk);
+}
@@ -0,0 +1,44 @@
+//
+// blocklu.h
+//
+// Blocked LU decomposition of lud_omp() on all cores, free of Circle
+// dependencies (except CParallel), so that it can be built for the host too.
+//
+// For each block offset core 0 decomposes the diagonal block, then the
+// perimeter chunks and then the interior chunks are distributed across the
+// cores with a barrier after each phase. The chunks are computed with the
+// same functions as in lud_omp(), so that the result is the same.
+//
+#ifndef _blocklu_h
+#define _blocklu_h
+
+#include "common.h"
+#include <parallel.h>
+#include <circle/types.h>
+
+class CBlockLU
+{
+public:
+	CBlockLU (CParallel *pParallel);
+	~CBlockLU (void);
+
+	/// \brief Decompose the matrix pMatrix in place (all cores)
+	/// \param nSize Number of rows and columns, multiple of 16
+	void Decompose (FP *pMatrix, int nSize);
+
+private:
+	static void DecomposeStub (unsigned nCore, void *pParam);
+	void Decompose (unsigned nCore);
+
+	static void PerimeterStub (unsigned nChunk, void *pParam);
+	static void InteriorStub (unsigned nChunk, void *pParam);
+
+private:
+	CParallel *m_pParallel;
+
+	FP *m_pMatrix;
+	int m_nSize;
+	int m_nOffset;				// of the current diagonal block
+};
+
+#endif
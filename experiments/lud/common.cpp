@@ -6,6 +6,10 @@
 
 #include "common.h"
 
+#if defined (__aarch64__)
+	#include <arm_neon.h>
+#endif
+
 #define BS 16
 
 #define AA(_i,_j) a[offset*size+_i*size+_j+offset]
@@ -39,25 +43,9 @@ void lud_diagonal_omp (FP* a, int size, int offset)
 
 
 
-// implements block LU factorization
-void lud_omp(FP *a, int size)
+// perimeter blocks of chunk chunk_idx right of and below the diagonal block at offset
+void lud_perimeter_omp (FP* a, int size, int offset, int chunk_idx)
 {
-    int offset, chunk_idx, size_inter, chunks_in_inter_row, chunks_per_inter;
-
-
-        for (offset = 0; offset < size - BS ; offset += BS)
-        {
-            // lu factorization of left-top corner block diagonal matrix
-            //
-            lud_diagonal_omp(a, size, offset);
-
-            size_inter = size - offset -  BS;
-            chunks_in_inter_row  = size_inter/BS;
-
-            // calculate perimeter block matrices
-            //            
-            for ( chunk_idx = 0; chunk_idx < chunks_in_inter_row; chunk_idx++)
-            {
                 int i, j, k, i_global, j_global, i_here, j_here;
                 FP sum;
                 FP temp[BS*BS] __attribute__ ((aligned (64)));
@@ -101,22 +89,73 @@ void lud_omp(FP *a, int size)
                         a[size*i_here + j_here] = ( a[size*i_here+j_here] - sum ) / a[size*(offset+j) + offset+j];
                     }
                 }
+}
 
+#if defined (__aarch64__) && PRECISION != 32
+
+// NEON micro-kernel of lud_interior_omp() for double, two rows at once. Each
+// element is accumulated with fused multiply-adds in the order of k, like the
+// contracted scalar loop, so that the result is the same.
+static void lud_interior_neon (FP* a, int size, int offset, int i_global, int j_global)
+{
+    FP temp_top[BS*BS] __attribute__ ((aligned (64)));
+    FP temp_left[BS*BS] __attribute__ ((aligned (64)));
+    int i, j, k;
+
+    for (i = 0; i < BS; i++) {
+        for (j = 0; j < BS; j += 2) {
+            vst1q_f64 (&temp_top[i*BS + j], vld1q_f64 (&a[size*(i + offset) + j + j_global]));
+            vst1q_f64 (&temp_left[i*BS + j], vld1q_f64 (&a[size*(i + i_global) + offset + j]));
+        }
+    }
+
+    for (i = 0; i < BS; i += 2)
+    {
+        float64x2_t sum0[BS/2], sum1[BS/2];
+        for (j = 0; j < BS/2; j++) {
+            sum0[j] = vdupq_n_f64 (0.0);
+            sum1[j] = vdupq_n_f64 (0.0);
+        }
+
+        for (k = 0; k < BS; k++) {
+            float64x2_t left0 = vdupq_n_f64 (temp_left[BS*i + k]);
+            float64x2_t left1 = vdupq_n_f64 (temp_left[BS*(i+1) + k]);
+
+            for (j = 0; j < BS/2; j++) {
+                float64x2_t top = vld1q_f64 (&temp_top[BS*k + 2*j]);
+
+                sum0[j] = vfmaq_f64 (sum0[j], left0, top);
+                sum1[j] = vfmaq_f64 (sum1[j], left1, top);
             }
+        }
 
-            // update interior block matrices
-            //
-            chunks_per_inter = chunks_in_inter_row*chunks_in_inter_row;
-            for  (chunk_idx =0; chunk_idx < chunks_per_inter; chunk_idx++)
-            {
+        FP *row0 = &BB((i+i_global), j_global);
+        FP *row1 = row0 + size;
+        for (j = 0; j < BS/2; j++) {
+            vst1q_f64 (&row0[2*j], vsubq_f64 (vld1q_f64 (&row0[2*j]), sum0[j]));
+            vst1q_f64 (&row1[2*j], vsubq_f64 (vld1q_f64 (&row1[2*j]), sum1[j]));
+        }
+    }
+}
+
+#endif
+
+// interior block chunk_idx (row major) of the chunks_in_inter_row^2 blocks at offset
+void lud_interior_omp (FP* a, int size, int offset, int chunk_idx)
+{
+                int chunks_in_inter_row = (size - offset - BS) / BS;
                 int i, j, k, i_global, j_global;
-                FP temp_top[BS*BS] __attribute__ ((aligned (64)));
-                FP temp_left[BS*BS] __attribute__ ((aligned (64)));
-                FP sum[BS] __attribute__ ((aligned (64))) = {0.f};
 
                 i_global = offset + BS * (1 +  chunk_idx/chunks_in_inter_row);
                 j_global = offset + BS * (1 + chunk_idx%chunks_in_inter_row);
 
+#if defined (__aarch64__) && PRECISION != 32
+                lud_interior_neon (a, size, offset, i_global, j_global);
+#else
+                FP temp_top[BS*BS] __attribute__ ((aligned (64)));
+                FP temp_left[BS*BS] __attribute__ ((aligned (64)));
+                FP sum[BS] __attribute__ ((aligned (64))) = {0.f};
+
                 for (i = 0; i < BS; i++) {
                     #pragma omp simd
                     for (j =0; j < BS; j++) {
@@ -139,6 +178,37 @@ void lud_omp(FP *a, int size)
                         sum[j] = 0.f;
                     }
                 }
+#endif
+}
+
+// implements block LU factorization (single core, see blocklu.h for all cores)
+void lud_omp(FP *a, int size)
+{
+    int offset, chunk_idx, size_inter, chunks_in_inter_row, chunks_per_inter;
+
+
+        for (offset = 0; offset < size - BS ; offset += BS)
+        {
+            // lu factorization of left-top corner block diagonal matrix
+            //
+            lud_diagonal_omp(a, size, offset);
+
+            size_inter = size - offset -  BS;
+            chunks_in_inter_row  = size_inter/BS;
+
+            // calculate perimeter block matrices
+            //            
+            for ( chunk_idx = 0; chunk_idx < chunks_in_inter_row; chunk_idx++)
+            {
+                lud_perimeter_omp(a, size, offset, chunk_idx);
+            }
+
+            // update interior block matrices
+            //
+            chunks_per_inter = chunks_in_inter_row*chunks_in_inter_row;
+            for  (chunk_idx =0; chunk_idx < chunks_per_inter; chunk_idx++)
+            {
+                lud_interior_omp(a, size, offset, chunk_idx);
             }
         }
 
@@ -60,6 +60,11 @@ lud_verify(FP *m, FP *lu, int size);
 
 void lud_omp(FP *a, int size);
 
+/* the steps of lud_omp() for block offset */
+void lud_diagonal_omp (FP* a, int size, int offset);
+void lud_perimeter_omp (FP* a, int size, int offset, int chunk_idx);
+void lud_interior_omp (FP* a, int size, int offset, int chunk_idx);
+
 void
 matrix_duplicate(FP *src, FP **dst, int matrix_dim);
 
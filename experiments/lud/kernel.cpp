@@ -18,151 +18,92 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 #include "kernel.h"
+#include <circle/interrupt.h>
 #include <circle/string.h>
 #include <circle/util.h>
-#include "common.h"
-#include <math.h>
 
-static const char FromKernel[] = "kernel";
-
-
-/* Single iteration of the transient solver in the grid model.
- * advances the solution of the discretized difference equations
- * by one time step*/
-
-
-
-
-
-CKernel::CKernel (void):
-	m_Screen (m_Options.GetWidth (), m_Options.GetHeight ()),	
-	m_Timer (&m_Interrupt),
-	m_Logger (m_Options.GetLogLevel (), &m_Timer),
-	m_EMMC (&m_Interrupt, &m_Timer, &m_ActLED),
-	m_GPIOManager (&m_Interrupt),
-	m_SoftSerial (17, 18, &m_GPIOManager)	
+#ifdef LUD_DMA_RELOAD
+static FP m[LUD_BUFFERS][N*N];
+#else
+static FP m[1][N*N];
+#endif
+static FP gold[N*N], m_input[N*N];
+
+CLUD::CLUD (void)
+:
+#ifdef LUD_DMA_RELOAD
+	m_DMACopy (CInterruptSystem::Get ()),
+	m_nCurrent (0),
+#endif
+	m_Parallel (CMemorySystem::Get ()),
+	m_LU (&m_Parallel)
 {
-
-	m_ActLED.Blink (5);	// show we are alive
+#ifdef LUD_DMA_RELOAD
+	for (unsigned i = 0; i < LUD_BUFFERS; i++)
+	{
+		m_hReload[i] = DMA_COPY_HANDLE_DONE;
+	}
+#endif
 }
 
-CKernel::~CKernel (void)
+CLUD::~CLUD (void)
 {
 }
 
-void CKernel::send_message(int size){
-	m_SoftSerial.Write ((char*)buffer, size*4);
-}
-
-boolean CKernel::Initialize (void)
+boolean CLUD::Setup (CExperiment *pExperiment)
 {
-	boolean bOK = TRUE;
-
+	pExperiment->SetReportLayout (sizeof (FP), N);
 
-	if (bOK)
+	if (   !m_Parallel.Initialize ()
+	    || !pExperiment->LoadFile (INPUT_FILENAME, m_input, sizeof m_input)
+	    || !pExperiment->LoadFile (GOLD_FILENAME, gold, sizeof gold))
 	{
-		bOK = m_Serial.Initialize (115200);
+		return FALSE;
 	}
 
+#ifdef LUD_DMA_RELOAD
+	// without a DMA channel all copies are done by the CPU
+	m_DMACopy.Initialize ();
 
-	if (bOK)
-	{
-		bOK = m_Interrupt.Initialize ();
-	}
+	// the other buffer is loaded by the first Compare()
+	m_hReload[m_nCurrent] = m_DMACopy.Copy (m[m_nCurrent], m_input, sizeof m[0]);
+#endif
 
-	if (bOK)
-	{
-		bOK = m_Timer.Initialize ();
-	}
-
-	if (bOK)
-	{
-		bOK = m_EMMC.Initialize ();
-	}
-	if (bOK)
-	{
-		bOK = m_GPIOManager.Initialize ();
-	}
-
-	if (bOK)
-	{
-		bOK = m_SoftSerial.Initialize ();
-	}
-
-	return bOK;
+	return TRUE;
 }
-#define N 1024
 
-TShutdownMode CKernel::Run (void)
+void CLUD::Prepare (void)
 {
+#ifdef LUD_DMA_RELOAD
+	// a failed reload shows up as mismatches in Compare()
+	m_DMACopy.Wait (m_hReload[m_nCurrent]);
+	m_hReload[m_nCurrent] = DMA_COPY_HANDLE_DONE;
+#endif
+}
 
-	int opt, option_index=0;
-    func_ret_t ret;
-    const char *input_file = "input_1024_th_1";
-    const char *gold_file = "gold_1024_th_1";
-
-    FP m[N*N], gold[N*N], m_input[N*N];
-    stopwatch sw;
-
-    
-      unsigned hFile = m_FileSystem.FileOpen (input_file);
-
-	if (hFile == 0)
-	{
-		buffer[0]=0xFFF00000;
-		send_message(1);
-	}
-	  m_FileSystem.FileRead(hFile,m_input, sizeof(FP) * N * N);
-  
-     hFile = m_FileSystem.FileOpen (gold_file);
-
-	if (hFile == 0)
-	{
-		buffer[0]=0xFFF00000;
-		send_message(1);
-	}
-     m_FileSystem.FileRead(hFile,gold, sizeof(FP) * N * N);
-   
-    while(1) {
-        memcpy(m,m_input,sizeof(FP)*N*N);
-        
-
-        lud_omp(m, N);
-
-        int i, flag = 0;        
-        for ( i = 0; i < N; i++) {
-            int j;
-            for ( j = 0; j < N; j++) {
-               
-                if(m[i + N * j] != gold[i + N * j])
-                {
-                     if(flag==0){
-                        buffer[0] = 0xDD000000;
-                        flag=1;
-                    }else{
-                        buffer[0] = 0xCC000000;
-                    }
-                    buffer[1]=*((unsigned int*)&i); 
-                    buffer[2]=*((unsigned int*)&j); 
-                    unsigned long long aux=*((unsigned long long*)&m[i + N * j]);
-                    buffer[3] = (unsigned int)((aux & 0xFFFFFFFF00000000LL) >> 32);                      
-                    buffer[4] = (unsigned int)(aux & 0xFFFFFFFFLL);
-                    send_message(5); 
-                }
-                    
-            }
-        }
-         if(flag==0){
-            buffer[0] = 0xAA000000;
-              send_message(1); 
-        }
-
-       
-
-        // read inputs again
-
+void CLUD::Execute (void)
+{
+#ifdef LUD_DMA_RELOAD
+	m_LU.Decompose (m[m_nCurrent], N);
+#else
+	memcpy (m[0], m_input, sizeof m[0]);
 
-    }
+	m_LU.Decompose (m[0], N);
+#endif
+}
 
-	return ShutdownHalt;
+void CLUD::Compare (CExperiment *pExperiment)
+{
+#ifdef LUD_DMA_RELOAD
+	// the idle buffer has been compared in the previous iteration,
+	// it is reloaded while the current one is compared
+	unsigned nIdle = (m_nCurrent + 1) % LUD_BUFFERS;
+	m_hReload[nIdle] = m_DMACopy.Copy (m[nIdle], m_input, sizeof m[0]);
+
+	pExperiment->CompareGold (m[m_nCurrent], gold, sizeof m[0]);
+
+	m_nCurrent = nIdle;
+#else
+	pExperiment->CompareGold (m[0], gold, sizeof m[0]);
+#endif
 }
@@ -20,57 +20,45 @@
 #ifndef _kernel_h
 #define _kernel_h
 
-#include <circle/actled.h>
-#include <circle/koptions.h>
-#include <circle/devicenameservice.h>
-#include <circle/screen.h>
-#include <circle/serial.h>
-#include <circle/exceptionhandler.h>
-#include <circle/interrupt.h>
-#include <circle/timer.h>
-#include <circle/logger.h>
-#include <emmc.h>
-#include <circle/fs/fat/fatfs.h>
+#include <experiment.h>
+#include <parallel.h>
+#include <circle/dmacopyengine.h>
 #include <circle/types.h>
-#include <circle/gpiomanager.h>
-#include <softserial.h>
+#include "common.h"
+#include "blocklu.h"
 
+#define N		1024
 
+#define INPUT_FILENAME	"input_1024_th_1"
+#define GOLD_FILENAME	"gold_1024_th_1"
 
+// Reload the matrix with the DMA copy engine (see circle/dmacopyengine.h)
+// into a second buffer, while the previous result is compared, comment this
+// out to reload it with memcpy() at the begin of each decomposition
+#define LUD_DMA_RELOAD
 
-enum TShutdownMode
-{
-	ShutdownNone,
-	ShutdownHalt,
-	ShutdownReboot
-};
+#define LUD_BUFFERS	2		// decomposed and reloaded alternately
 
-class CKernel
+class CLUD : public CWorkload
 {
 public:
-	CKernel (void);
-	~CKernel (void);
+	CLUD (void);
+	~CLUD (void);
+
+	boolean Setup (CExperiment *pExperiment);
+	void Prepare (void);
+	void Execute (void);
+	void Compare (CExperiment *pExperiment);
 
-	boolean Initialize (void);
-	void send_message(int size);
-	TShutdownMode Run (void);
-	
 private:
-	// do not change this order
-	CActLED			m_ActLED;
-	CKernelOptions		m_Options;
-	CDeviceNameService	m_DeviceNameService;
-	CScreenDevice		m_Screen;
-	CSerialDevice		m_Serial;
-	CExceptionHandler	m_ExceptionHandler;
-	CInterruptSystem	m_Interrupt;
-	CTimer			m_Timer;
-	CLogger			m_Logger;
-	CGPIOManager		m_GPIOManager;	
-	CSoftSerialDevice	m_SoftSerial;
-	CEMMCDevice		m_EMMC;
-	CFATFileSystem		m_FileSystem;
-	unsigned int buffer[10];
+#ifdef LUD_DMA_RELOAD
+	CDMACopyEngine m_DMACopy;
+	TDMACopyHandle m_hReload[LUD_BUFFERS];	// started by Setup() and Compare()
+	unsigned m_nCurrent;			// buffer of the next Execute()
+#endif
+
+	CParallel m_Parallel;
+	CBlockLU m_LU;
 };
 
 #endif
@@ -0,0 +1,324 @@
+//
+// sgemm.cpp
+//
+// Loop structure (per core, see sgemm.h for the accumulation order):
+//
+//	B is packed once per Multiply() into column panels of K x NR, the
+//	panels are shared by all cores (packed cooperatively, then a barrier).
+//	Each core owns a contiguous range of MR row blocks of C and runs
+//
+//	for each K-block pc (KC)
+//		for each M-block ic of own rows (MC)
+//			pack A[ic..ic+MC][pc..pc+KC] into MR row micro-panels
+//			for each panel jr (NR)		B slice KC x NR stays in L1
+//				for each micro-panel ir (MR)
+//					C[ir][jr] += A[ir][pc..] * B[pc..][jr]
+//
+#include "sgemm.h"
+#include <circle/macros.h>
+#include <assert.h>
+
+#if defined (__aarch64__)
+	#include <arm_neon.h>
+#endif
+
+#define SGEMM_CORES	PARALLEL_CORES
+
+static float s_PackedA[SGEMM_CORES][SGEMM_MC * SGEMM_KC] ALIGN (64);
+
+CSGEMM::CSGEMM (CParallel *pParallel)
+:	m_pParallel (pParallel),
+	m_pA (0),
+	m_pB (0),
+	m_pC (0),
+	m_nM (0),
+	m_nN (0),
+	m_nK (0),
+	m_pPackedB (0),
+	m_nPackedBSize (0)
+{
+}
+
+CSGEMM::~CSGEMM (void)
+{
+	delete [] m_pPackedB;
+	m_pPackedB = 0;
+
+	m_pParallel = 0;
+}
+
+void CSGEMM::Multiply (const float *pA, const float *pB, float *pC,
+		       unsigned nM, unsigned nN, unsigned nK)
+{
+	assert (m_pParallel != 0);
+	assert (pA != 0);
+	assert (pB != 0);
+	assert (pC != 0);
+	assert (nM > 0 && nN > 0 && nK > 0);
+
+	size_t nPackedBSize = (size_t) (nN + SGEMM_NR-1) / SGEMM_NR * SGEMM_NR * nK;
+	if (nPackedBSize > m_nPackedBSize)
+	{
+		delete [] m_pPackedB;
+
+		m_pPackedB = new float[nPackedBSize];
+		assert (m_pPackedB != 0);
+		m_nPackedBSize = nPackedBSize;
+	}
+
+	m_pA = pA;
+	m_pB = pB;
+	m_pC = pC;
+	m_nM = nM;
+	m_nN = nN;
+	m_nK = nK;
+
+	m_pParallel->Execute (ComputeStub, this);
+}
+
+void CSGEMM::ComputeStub (unsigned nCore, void *pParam)
+{
+	CSGEMM *pThis = (CSGEMM *) pParam;
+	assert (pThis != 0);
+
+	pThis->Compute (nCore);
+}
+
+void CSGEMM::Compute (unsigned nCore)
+{
+	assert (nCore < SGEMM_CORES);
+
+	// phase 1: pack the shared B panels
+	unsigned nPanels = (m_nN + SGEMM_NR-1) / SGEMM_NR;
+	PackB (nPanels * nCore / SGEMM_CORES, nPanels * (nCore+1) / SGEMM_CORES);
+
+	m_pParallel->Barrier ();
+
+	// phase 2: compute own row range of C
+	unsigned nBlocks = (m_nM + SGEMM_MR-1) / SGEMM_MR;
+	unsigned nFirstRow = nBlocks * nCore / SGEMM_CORES * SGEMM_MR;
+	unsigned nLastRow = nBlocks * (nCore+1) / SGEMM_CORES * SGEMM_MR;
+	if (nLastRow > m_nM)
+	{
+		nLastRow = m_nM;
+	}
+
+	float *pPackedA = s_PackedA[nCore];
+
+	for (unsigned pc = 0; pc < m_nK; pc += SGEMM_KC)
+	{
+		unsigned kc = m_nK - pc < SGEMM_KC ? m_nK - pc : SGEMM_KC;
+		boolean bAccumulate = pc > 0;
+
+		for (unsigned ic = nFirstRow; ic < nLastRow; ic += SGEMM_MC)
+		{
+			unsigned mc = nLastRow - ic < SGEMM_MC ? nLastRow - ic : SGEMM_MC;
+
+			PackA (pPackedA, ic, mc, pc, kc);
+
+			for (unsigned jr = 0; jr < m_nN; jr += SGEMM_NR)
+			{
+				unsigned nc = m_nN - jr < SGEMM_NR ? m_nN - jr : SGEMM_NR;
+				const float *pBPanel =   m_pPackedB + (size_t) (jr / SGEMM_NR) * m_nK * SGEMM_NR
+						       + (size_t) pc * SGEMM_NR;
+
+				for (unsigned ir = 0; ir < mc; ir += SGEMM_MR)
+				{
+					unsigned mr = mc - ir < SGEMM_MR ? mc - ir : SGEMM_MR;
+					const float *pAPanel = pPackedA + ir * kc;
+					float *pC = m_pC + (size_t) (ic + ir) * m_nN + jr;
+
+					if (   mr == SGEMM_MR
+					    && nc == SGEMM_NR)
+					{
+						MicroKernel (kc, pAPanel, pBPanel, pC, m_nN, bAccumulate);
+
+						continue;
+					}
+
+					// edge tile: work on a local copy of the valid part
+					float Tile[SGEMM_MR * SGEMM_NR] ALIGN (16);
+					for (unsigned i = 0; i < SGEMM_MR; i++)
+					{
+						for (unsigned j = 0; j < SGEMM_NR; j++)
+						{
+							Tile[i*SGEMM_NR + j] =    bAccumulate && i < mr && j < nc
+									       ? pC[(size_t) i * m_nN + j] : 0.0f;
+						}
+					}
+
+					MicroKernel (kc, pAPanel, pBPanel, Tile, SGEMM_NR, TRUE);
+
+					for (unsigned i = 0; i < mr; i++)
+					{
+						for (unsigned j = 0; j < nc; j++)
+						{
+							pC[(size_t) i * m_nN + j] = Tile[i*SGEMM_NR + j];
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+// packs B panels [nFirstPanel, nLastPanel) as K x NR, columns beyond N are zero
+void CSGEMM::PackB (unsigned nFirstPanel, unsigned nLastPanel)
+{
+	for (unsigned nPanel = nFirstPanel; nPanel < nLastPanel; nPanel++)
+	{
+		unsigned nCol = nPanel * SGEMM_NR;
+		unsigned nc = m_nN - nCol < SGEMM_NR ? m_nN - nCol : SGEMM_NR;
+
+		float *pTo = m_pPackedB + (size_t) nPanel * m_nK * SGEMM_NR;
+		const float *pFrom = m_pB + nCol;
+
+		for (unsigned k = 0; k < m_nK; k++)
+		{
+			unsigned j;
+			for (j = 0; j < nc; j++)
+			{
+				pTo[j] = pFrom[j];
+			}
+
+			for (; j < SGEMM_NR; j++)
+			{
+				pTo[j] = 0.0f;
+			}
+
+			pTo += SGEMM_NR;
+			pFrom += m_nN;
+		}
+	}
+}
+
+// packs A[nRow..nRow+nRows][nCol..nCol+nCols] into micro-panels of nCols x MR,
+// rows beyond nRows are zero
+void CSGEMM::PackA (float *pBuffer, unsigned nRow, unsigned nRows, unsigned nCol, unsigned nCols)
+{
+	assert (nRows <= SGEMM_MC);
+	assert (nCols <= SGEMM_KC);
+
+	for (unsigned ir = 0; ir < nRows; ir += SGEMM_MR)
+	{
+		unsigned mr = nRows - ir < SGEMM_MR ? nRows - ir : SGEMM_MR;
+		float *pTo = pBuffer + ir * nCols;
+
+		for (unsigned i = 0; i < SGEMM_MR; i++)
+		{
+			if (i >= mr)
+			{
+				for (unsigned k = 0; k < nCols; k++)
+				{
+					pTo[k*SGEMM_MR + i] = 0.0f;
+				}
+
+				continue;
+			}
+
+			const float *pFrom = m_pA + (size_t) (nRow + ir + i) * m_nK + nCol;
+			for (unsigned k = 0; k < nCols; k++)
+			{
+				pTo[k*SGEMM_MR + i] = pFrom[k];
+			}
+		}
+	}
+}
+
+// C[MR][NR] (+)= A[MR][nKC] * B[nKC][NR], one fused multiply-add per k in ascending order
+void CSGEMM::MicroKernel (unsigned nKC, const float *pA, const float *pB,
+			  float *pC, unsigned nLDC, boolean bAccumulate)
+{
+#if defined (__aarch64__)
+	float32x4_t c0[SGEMM_MR], c1[SGEMM_MR], c2[SGEMM_MR];
+
+	// constant indices only, so that the accumulators are kept in registers
+#define SGEMM_LOAD(i)							\
+		c0[i] = vld1q_f32 (pC + i*nLDC);			\
+		c1[i] = vld1q_f32 (pC + i*nLDC + 4);			\
+		c2[i] = vld1q_f32 (pC + i*nLDC + 8);
+#define SGEMM_ZERO(i)							\
+		c0[i] = c1[i] = c2[i] = vdupq_n_f32 (0.0f);
+#define SGEMM_STORE(i)							\
+		vst1q_f32 (pC + i*nLDC, c0[i]);				\
+		vst1q_f32 (pC + i*nLDC + 4, c1[i]);			\
+		vst1q_f32 (pC + i*nLDC + 8, c2[i]);
+#define SGEMM_ROW(i, a, lane)						\
+		c0[i] = vfmaq_laneq_f32 (c0[i], b0, a, lane);		\
+		c1[i] = vfmaq_laneq_f32 (c1[i], b1, a, lane);		\
+		c2[i] = vfmaq_laneq_f32 (c2[i], b2, a, lane);
+#define SGEMM_ALL(op)	op (0) op (1) op (2) op (3) op (4) op (5) op (6) op (7)
+
+	if (bAccumulate)
+	{
+		SGEMM_ALL (SGEMM_LOAD)
+	}
+	else
+	{
+		SGEMM_ALL (SGEMM_ZERO)
+	}
+
+	for (unsigned k = 0; k < nKC; k++)
+	{
+		float32x4_t a0 = vld1q_f32 (pA);
+		float32x4_t a1 = vld1q_f32 (pA + 4);
+		float32x4_t b0 = vld1q_f32 (pB);
+		float32x4_t b1 = vld1q_f32 (pB + 4);
+		float32x4_t b2 = vld1q_f32 (pB + 8);
+
+		__builtin_prefetch (pB + 8*SGEMM_NR);
+
+		SGEMM_ROW (0, a0, 0)
+		SGEMM_ROW (1, a0, 1)
+		SGEMM_ROW (2, a0, 2)
+		SGEMM_ROW (3, a0, 3)
+		SGEMM_ROW (4, a1, 0)
+		SGEMM_ROW (5, a1, 1)
+		SGEMM_ROW (6, a1, 2)
+		SGEMM_ROW (7, a1, 3)
+
+		pA += SGEMM_MR;
+		pB += SGEMM_NR;
+	}
+
+	SGEMM_ALL (SGEMM_STORE)
+
+#undef SGEMM_LOAD
+#undef SGEMM_ZERO
+#undef SGEMM_STORE
+#undef SGEMM_ROW
+#undef SGEMM_ALL
+#else
+	float Acc[SGEMM_MR][SGEMM_NR];
+
+	for (unsigned i = 0; i < SGEMM_MR; i++)
+	{
+		for (unsigned j = 0; j < SGEMM_NR; j++)
+		{
+			Acc[i][j] = bAccumulate ? pC[i*nLDC + j] : 0.0f;
+		}
+	}
+
+	for (unsigned k = 0; k < nKC; k++)
+	{
+		for (unsigned i = 0; i < SGEMM_MR; i++)
+		{
+			for (unsigned j = 0; j < SGEMM_NR; j++)
+			{
+				Acc[i][j] = __builtin_fmaf (pA[i], pB[j], Acc[i][j]);
+			}
+		}
+
+		pA += SGEMM_MR;
+		pB += SGEMM_NR;
+	}
+
+	for (unsigned i = 0; i < SGEMM_MR; i++)
+	{
+		for (unsigned j = 0; j < SGEMM_NR; j++)
+		{
+			pC[i*nLDC + j] = Acc[i][j];
+		}
+	}
+#endif
+}
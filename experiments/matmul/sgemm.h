@@ -0,0 +1,62 @@
+//
+// sgemm.h
+//
+// Cache-blocked, register-tiled single precision matrix multiplication,
+// which is distributed across all CPU cores with CParallel.
+//
+// Accumulation order (required to be bit-exact with matmul_gold_600.bin):
+//	Each element C[i][j] is computed as
+//		c = +0.0f; for (k = 0; k < K; k++) c = fmaf (A[i][k], B[k][j], c);
+//	i.e. the products are accumulated in ascending k order with one fused
+//	multiply-add (FMLA) per step, exactly as the reference i-j-k loop
+//	compiled with -Ofast (-ffp-contract=fast) on AArch64. K-blocking only
+//	stores the partial sum to C and reloads it, which does not change the
+//	rounding, because the accumulator is single precision all the time.
+//
+#ifndef _sgemm_h
+#define _sgemm_h
+
+#include <parallel.h>
+#include <circle/types.h>
+
+#define SGEMM_MR	8		// micro tile rows (2 NEON registers of A)
+#define SGEMM_NR	12		// micro tile columns (3 NEON registers of B)
+#define SGEMM_KC	256		// K-block, a packed B panel slice fits into L1
+#define SGEMM_MC	64		// M-block, the packed A block fits into L2
+
+class CSGEMM
+{
+public:
+	CSGEMM (CParallel *pParallel);
+	~CSGEMM (void);
+
+	// C = A * B, all matrices in row-major order without padding
+	// A is nM x nK, B is nK x nN, C is nM x nN
+	void Multiply (const float *pA, const float *pB, float *pC,
+		       unsigned nM, unsigned nN, unsigned nK);
+
+private:
+	static void ComputeStub (unsigned nCore, void *pParam);
+	void Compute (unsigned nCore);
+
+	void PackB (unsigned nFirstPanel, unsigned nLastPanel);
+	void PackA (float *pBuffer, unsigned nRow, unsigned nRows, unsigned nCol, unsigned nCols);
+
+	static void MicroKernel (unsigned nKC, const float *pA, const float *pB,
+				 float *pC, unsigned nLDC, boolean bAccumulate);
+
+private:
+	CParallel *m_pParallel;
+
+	const float *m_pA;
+	const float *m_pB;
+	float *m_pC;
+	unsigned m_nM;
+	unsigned m_nN;
+	unsigned m_nK;
+
+	float *m_pPackedB;			// ceil(N/NR) panels of K x NR
+	size_t m_nPackedBSize;			// in floats
+};
+
+#endif
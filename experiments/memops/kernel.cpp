@@ -0,0 +1,649 @@
+//
+// kernel.cpp
+//
+#include "kernel.h"
+#include <circle/memory.h>
+#include <circle/string.h>
+#include <circle/util.h>
+#include <assert.h>
+
+static const size_t s_Sizes[MEMOPS_SIZES] =
+{
+	256,				// L1 data cache
+	16*1024,
+	256*1024,			// L2 cache
+	MEMOPS_MAX_SIZE			// DRAM
+};
+
+CMemOpsBench::CMemOpsBench (void)
+:	m_pMemory (0),
+	m_pDest (0),
+	m_pSrc (0),
+	m_pDevice (0),
+	m_nPhases (0)
+{
+}
+
+CMemOpsBench::~CMemOpsBench (void)
+{
+	delete [] m_pMemory;
+	m_pMemory = 0;
+}
+
+boolean CMemOpsBench::Setup (CExperiment *pExperiment)
+{
+	pExperiment->SetReportLayout (sizeof (u32));	// index of the phase
+
+	const size_t nBufferSize = MEMOPS_MAX_SIZE + 2*MEMOPS_PADDING;
+	m_pMemory = new u8[2*nBufferSize + MEMOPS_PADDING];
+	if (m_pMemory == 0)
+	{
+		return FALSE;
+	}
+
+	uintptr nAddress = (uintptr) m_pMemory;
+	nAddress = (nAddress + MEMOPS_PADDING-1) & ~(MEMOPS_PADDING-1);
+	m_pDest = (u8 *) nAddress + MEMOPS_PADDING;
+	m_pSrc = m_pDest + nBufferSize;
+
+	// no zero bytes for strlen() and memchr()
+	for (size_t i = 0; i < MEMOPS_MAX_SIZE + MEMOPS_PADDING; i++)
+	{
+		m_pSrc[i] = (u8) (i % 251 + 1);
+	}
+
+	m_pDevice = (u8 *) CMemorySystem::GetCoherentPage (MEMOPS_COHERENT_SLOT) + MEMOPS_PADDING;
+
+	EnableCycleCounter ();
+
+	return TRUE;
+}
+
+void CMemOpsBench::Execute (void)
+{
+	m_nPhases = 0;
+
+	for (unsigned nOp = 0; nOp < MemOpUnknown; nOp++)
+	{
+		for (unsigned nSize = 0; nSize < MEMOPS_SIZES; nSize++)
+		{
+			for (unsigned nAlignment = 0; nAlignment < MEMOPS_ALIGNMENTS; nAlignment++)
+			{
+				Run ((TMemOp) nOp, s_Sizes[nSize], nAlignment);
+			}
+		}
+	}
+
+	for (unsigned nOp = 0; nOp < MemOpUnknown; nOp++)
+	{
+		Sweep ((TMemOp) nOp, m_pDest, m_pSrc, 1, FALSE);
+	}
+
+	// the compare and search functions are not used on Device memory
+	for (unsigned nOp = 0; nOp <= MemOpSetBlk; nOp++)
+	{
+		Sweep ((TMemOp) nOp, m_pDevice, m_pSrc, MEMOPS_SWEEP_DEV_STEP, TRUE);
+	}
+}
+
+void CMemOpsBench::Compare (CExperiment *pExperiment)
+{
+	for (unsigned i = 0; i < m_nPhases; i++)
+	{
+		const TMemOpsPhase *pPhase = &m_Phases[i];
+
+		if (pPhase->nErrors != 0)
+		{
+			u32 nValue = pPhase->nErrors;
+			u32 nExpected = 0;
+			pExperiment->ReportMismatch (i, &nValue, &nExpected);
+		}
+
+		CString Size;
+		if (pPhase->nSize >= 1024*1024)
+		{
+			Size.Format ("%uM", (unsigned) (pPhase->nSize / (1024*1024)));
+		}
+		else if (pPhase->nSize >= 1024)
+		{
+			Size.Format ("%uK", (unsigned) (pPhase->nSize / 1024));
+		}
+		else
+		{
+			Size.Format ("%u", (unsigned) pPhase->nSize);
+		}
+
+		CString Name;
+		if (pPhase->bSweep)
+		{
+			Name.Format ("%s sweep%s", GetOpName (pPhase->Op), pPhase->bDevice ? " dev" : "");
+		}
+		else
+		{
+			Name.Format ("%s %s %c", GetOpName (pPhase->Op), (const char *) Size,
+				     pPhase->nAlignment ? 'u' : 'a');
+		}
+
+		pExperiment->ReportPhase (Name, pPhase->nBytes, pPhase->nCycles, pPhase->nErrors);
+	}
+}
+
+void CMemOpsBench::Run (TMemOp Op, size_t nSize, unsigned nAlignment)
+{
+	assert (m_nPhases < MEMOPS_MAX_PHASES);
+	assert (nSize <= MEMOPS_MAX_SIZE);
+
+	u8 *pDest = m_pDest + (nAlignment ? 1 : 0);
+	u8 *pSrc = m_pSrc + (nAlignment ? 3 : 0);
+
+	unsigned nRepeat = MEMOPS_BYTES_PER_PHASE / nSize;
+	if (nRepeat == 0)
+	{
+		nRepeat = 1;
+	}
+
+	// prepare the buffers, guard bytes are checked afterwards
+	pDest[-1] = 0xEE;
+	pDest[nSize] = 0xEE;
+
+	u8 uchTerminator = pSrc[nSize];
+	if (Op == MemOpStrlen)
+	{
+		pSrc[nSize] = '\0';
+	}
+	else if (Op == MemOpCompare)
+	{
+		memcpy (pDest, pSrc, nSize);
+	}
+
+	// the empty asm statements keep the compiler from merging or removing the calls
+	u64 nResult = 0;
+	u64 nStart = GetCycles ();
+
+	switch (Op)
+	{
+	case MemOpCopy:
+		for (unsigned i = 0; i < nRepeat; i++)
+		{
+			nResult = (uintptr) memcpy (pDest, pSrc, nSize);
+			asm volatile ("" :: "r" (nResult) : "memory");
+		}
+		break;
+
+	case MemOpCopyNT:
+		for (unsigned i = 0; i < nRepeat; i++)
+		{
+			nResult = (uintptr) memcpy_nt (pDest, pSrc, nSize);
+			asm volatile ("" :: "r" (nResult) : "memory");
+		}
+		break;
+
+	case MemOpCopyBlk:
+		for (unsigned i = 0; i < nRepeat; i++)
+		{
+			nResult = (uintptr) memcpyblk (pDest, pSrc, nSize);
+			asm volatile ("" :: "r" (nResult) : "memory");
+		}
+		break;
+
+	case MemOpMove:
+		for (unsigned i = 0; i < nRepeat; i++)
+		{
+			nResult = (uintptr) memmove (pDest, pSrc, nSize);
+			asm volatile ("" :: "r" (nResult) : "memory");
+		}
+		break;
+
+	case MemOpSet:
+		for (unsigned i = 0; i < nRepeat; i++)
+		{
+			nResult = (uintptr) memset (pDest, GetSetValue (Op), nSize);
+			asm volatile ("" :: "r" (nResult) : "memory");
+		}
+		break;
+
+	case MemOpZero:
+		for (unsigned i = 0; i < nRepeat; i++)
+		{
+			nResult = (uintptr) memset (pDest, GetSetValue (Op), nSize);
+			asm volatile ("" :: "r" (nResult) : "memory");
+		}
+		break;
+
+	case MemOpSetNT:
+		for (unsigned i = 0; i < nRepeat; i++)
+		{
+			nResult = (uintptr) memset_nt (pDest, GetSetValue (Op), nSize);
+			asm volatile ("" :: "r" (nResult) : "memory");
+		}
+		break;
+
+	case MemOpSetBlk:
+		for (unsigned i = 0; i < nRepeat; i++)
+		{
+			nResult = (uintptr) memsetblk (pDest, GetSetValue (Op), nSize);
+			asm volatile ("" :: "r" (nResult) : "memory");
+		}
+		break;
+
+	case MemOpCompare:
+		for (unsigned i = 0; i < nRepeat; i++)
+		{
+			nResult = memcmp (pDest, pSrc, nSize);
+			asm volatile ("" :: "r" (nResult) : "memory");
+		}
+		break;
+
+	case MemOpChr:
+		for (unsigned i = 0; i < nRepeat; i++)
+		{
+			nResult = (uintptr) memchr (pSrc, 0, nSize);
+			asm volatile ("" :: "r" (nResult) : "memory");
+		}
+		break;
+
+	case MemOpStrlen:
+		for (unsigned i = 0; i < nRepeat; i++)
+		{
+			nResult = strlen ((const char *) pSrc);
+			asm volatile ("" :: "r" (nResult) : "memory");
+		}
+		break;
+
+	default:
+		assert (0);
+		break;
+	}
+
+	u64 nCycles = GetCycles () - nStart;
+
+	TMemOpsPhase *pPhase = &m_Phases[m_nPhases++];
+	pPhase->Op = Op;
+	pPhase->nSize = nSize;
+	pPhase->nAlignment = nAlignment;
+	pPhase->bSweep = FALSE;
+	pPhase->bDevice = FALSE;
+	pPhase->nBytes = (u64) nSize * nRepeat;
+	pPhase->nCycles = nCycles;
+	pPhase->nErrors = Check (Op, pDest, pSrc, nSize, nResult);
+
+	pSrc[nSize] = uchTerminator;
+}
+
+unsigned CMemOpsBench::Check (TMemOp Op, u8 *pDest, const u8 *pSrc, size_t nSize, u64 nResult)
+{
+	unsigned nErrors = 0;
+
+	switch (Op)
+	{
+	case MemOpCopy:
+	case MemOpCopyNT:
+	case MemOpCopyBlk:
+	case MemOpMove:
+	case MemOpSet:
+	case MemOpZero:
+	case MemOpSetNT:
+	case MemOpSetBlk:
+		if (nResult != (uintptr) pDest)
+		{
+			nErrors++;
+		}
+
+		for (size_t i = 0; i < nSize; i++)
+		{
+			u8 uchExpected = Op < MemOpSet ? pSrc[i] : GetSetValue (Op);
+
+			if (pDest[i] != uchExpected)
+			{
+				nErrors++;
+			}
+		}
+		break;
+
+	case MemOpCompare:
+	case MemOpChr:
+		if (nResult != 0)
+		{
+			nErrors++;
+		}
+		break;
+
+	case MemOpStrlen:
+		if (nResult != nSize)
+		{
+			nErrors++;
+		}
+		break;
+
+	default:
+		assert (0);
+		break;
+	}
+
+	if (   pDest[-1] != 0xEE
+	    || pDest[nSize] != 0xEE)
+	{
+		nErrors++;
+	}
+
+	return nErrors;
+}
+
+void CMemOpsBench::Sweep (TMemOp Op, u8 *pDest, u8 *pSrc, unsigned nStep, boolean bDevice)
+{
+	assert (m_nPhases < MEMOPS_MAX_PHASES);
+	assert (nStep > 0);
+
+	unsigned nErrors = 0;
+	u64 nBytes = 0;
+	u64 nStart = GetCycles ();
+
+	for (size_t nSize = 0; nSize <= MEMOPS_SWEEP_SIZE; nSize++)
+	{
+		for (unsigned nAlign1 = 0; nAlign1 < 16; nAlign1 += nStep)
+		{
+			switch (Op)
+			{
+			case MemOpSet:
+			case MemOpZero:
+			case MemOpSetNT:
+			case MemOpSetBlk:
+				nErrors += SweepSet (Op, pDest + nAlign1, nSize);
+				nBytes += nSize;
+				break;
+
+			case MemOpChr:
+				nErrors += SweepChr (pSrc + nAlign1, nSize);
+				nBytes += nSize;
+				break;
+
+			case MemOpStrlen:
+				nErrors += SweepStrlen (pSrc + nAlign1, nSize);
+				nBytes += nSize;
+				break;
+
+			default:
+				if (Op == MemOpMove)
+				{
+					for (int nDistance = -MEMOPS_SWEEP_OVERLAP;
+					     nDistance <= MEMOPS_SWEEP_OVERLAP; nDistance++)
+					{
+						nErrors += SweepMove (pDest + nAlign1, nDistance, nSize);
+						nBytes += nSize;
+					}
+				}
+
+				for (unsigned nAlign2 = 0; nAlign2 < 16; nAlign2 += nStep)
+				{
+					if (Op == MemOpCompare)
+					{
+						nErrors += SweepCompare (pDest + nAlign1, pSrc + nAlign2, nSize);
+					}
+					else
+					{
+						nErrors += SweepCopy (Op, pDest + nAlign1, pSrc + nAlign2, nSize);
+					}
+
+					nBytes += nSize;
+				}
+				break;
+			}
+		}
+	}
+
+	u64 nCycles = GetCycles () - nStart;
+
+	TMemOpsPhase *pPhase = &m_Phases[m_nPhases++];
+	pPhase->Op = Op;
+	pPhase->nSize = MEMOPS_SWEEP_SIZE;
+	pPhase->nAlignment = 0;
+	pPhase->bSweep = TRUE;
+	pPhase->bDevice = bDevice;
+	pPhase->nBytes = nBytes;
+	pPhase->nCycles = nCycles;
+	pPhase->nErrors = nErrors;
+}
+
+// The Sweep*() functions prepare and check the buffers with volatile accesses,
+// so that the compiler does not replace these loops with the tested functions.
+
+unsigned CMemOpsBench::SweepCopy (TMemOp Op, u8 *pDest, const u8 *pSrc, size_t nSize)
+{
+	volatile u8 *pGuarded = pDest - 1;
+	for (size_t i = 0; i < nSize + 2; i++)
+	{
+		pGuarded[i] = 0xEE;
+	}
+
+	void *pResult = 0;
+	switch (Op)
+	{
+	case MemOpCopy:		pResult = memcpy (pDest, pSrc, nSize);		break;
+	case MemOpCopyNT:	pResult = memcpy_nt (pDest, pSrc, nSize);	break;
+	case MemOpCopyBlk:	pResult = memcpyblk (pDest, pSrc, nSize);	break;
+	case MemOpMove:		pResult = memmove (pDest, pSrc, nSize);		break;
+	default:		assert (0);					break;
+	}
+
+	unsigned nErrors = pResult != pDest ? 1 : 0;
+
+	const volatile u8 *pSource = pSrc;
+	for (size_t i = 0; i < nSize; i++)
+	{
+		if (pGuarded[i+1] != pSource[i])
+		{
+			nErrors++;
+		}
+	}
+
+	if (   pGuarded[0] != 0xEE
+	    || pGuarded[nSize+1] != 0xEE)
+	{
+		nErrors++;
+	}
+
+	return nErrors;
+}
+
+unsigned CMemOpsBench::SweepSet (TMemOp Op, u8 *pDest, size_t nSize)
+{
+	volatile u8 *pGuarded = pDest - 1;
+	for (size_t i = 0; i < nSize + 2; i++)
+	{
+		pGuarded[i] = 0xEE;
+	}
+
+	u8 uchValue = GetSetValue (Op);
+
+	void *pResult = 0;
+	switch (Op)
+	{
+	case MemOpSet:
+	case MemOpZero:		pResult = memset (pDest, uchValue, nSize);	break;
+	case MemOpSetNT:	pResult = memset_nt (pDest, uchValue, nSize);	break;
+	case MemOpSetBlk:	pResult = memsetblk (pDest, uchValue, nSize);	break;
+	default:		assert (0);					break;
+	}
+
+	unsigned nErrors = pResult != pDest ? 1 : 0;
+
+	for (size_t i = 0; i < nSize; i++)
+	{
+		if (pGuarded[i+1] != uchValue)
+		{
+			nErrors++;
+		}
+	}
+
+	if (   pGuarded[0] != 0xEE
+	    || pGuarded[nSize+1] != 0xEE)
+	{
+		nErrors++;
+	}
+
+	return nErrors;
+}
+
+unsigned CMemOpsBench::SweepCompare (u8 *pBuffer1, const u8 *pBuffer2, size_t nSize)
+{
+	volatile u8 *p1 = pBuffer1;
+	const volatile u8 *p2 = pBuffer2;
+	for (size_t i = 0; i < nSize; i++)
+	{
+		p1[i] = p2[i];
+	}
+
+	unsigned nErrors = memcmp (pBuffer1, pBuffer2, nSize) != 0 ? 1 : 0;
+
+	if (nSize > 0)
+	{
+		// a greater byte at the begin, in the middle and at the end
+		const size_t Pos[] = {0, nSize / 2, nSize - 1};
+		for (unsigned i = 0; i < sizeof Pos / sizeof Pos[0]; i++)
+		{
+			p1[Pos[i]] = p2[Pos[i]] + 1;		// no overflow, the bytes are < 0xFF
+
+			if (   memcmp (pBuffer1, pBuffer2, nSize) <= 0
+			    || memcmp (pBuffer2, pBuffer1, nSize) >= 0)
+			{
+				nErrors++;
+			}
+
+			p1[Pos[i]] = p2[Pos[i]];
+		}
+	}
+
+	return nErrors;
+}
+
+unsigned CMemOpsBench::SweepChr (u8 *pBuffer, size_t nSize)
+{
+	unsigned nErrors = memchr (pBuffer, 0, nSize) != 0 ? 1 : 0;
+
+	if (nSize > 0)
+	{
+		volatile u8 *p = pBuffer;
+
+		// the char at the begin, in the middle and at the end (0 and 0xFF do not occur)
+		const size_t Pos[] = {0, nSize / 2, nSize - 1};
+		for (unsigned i = 0; i < sizeof Pos / sizeof Pos[0]; i++)
+		{
+			u8 uchSave = p[Pos[i]];
+
+			p[Pos[i]] = 0;
+			if (memchr (pBuffer, 0, nSize) != pBuffer + Pos[i])
+			{
+				nErrors++;
+			}
+
+			p[Pos[i]] = 0xFF;
+			if (memchr (pBuffer, -1, nSize) != pBuffer + Pos[i])
+			{
+				nErrors++;
+			}
+
+			p[Pos[i]] = uchSave;
+		}
+	}
+
+	return nErrors;
+}
+
+unsigned CMemOpsBench::SweepStrlen (u8 *pString, size_t nSize)
+{
+	volatile u8 *p = pString;
+
+	u8 uchSave = p[nSize];
+	p[nSize] = '\0';
+
+	unsigned nErrors = strlen ((const char *) pString) != nSize ? 1 : 0;
+
+	p[nSize] = uchSave;
+
+	return nErrors;
+}
+
+unsigned CMemOpsBench::SweepMove (u8 *pBuffer, int nDistance, size_t nSize)
+{
+	assert (-MEMOPS_SWEEP_OVERLAP <= nDistance && nDistance <= MEMOPS_SWEEP_OVERLAP);
+	assert (nSize <= MEMOPS_SWEEP_SIZE);
+
+	// the source starts behind MEMOPS_SWEEP_OVERLAP bytes and one guard byte,
+	// the content of the region is a function of the index
+	volatile u8 *pRegion = pBuffer;
+	size_t nRegionSize = nSize + 2*MEMOPS_SWEEP_OVERLAP + 2;
+	for (size_t i = 0; i < nRegionSize; i++)
+	{
+		pRegion[i] = (u8) (i * 7 + nSize);
+	}
+
+	size_t nSrcOffset = MEMOPS_SWEEP_OVERLAP + 1;
+	size_t nDestOffset = nSrcOffset + nDistance;
+
+	void *pResult = memmove (pBuffer + nDestOffset, pBuffer + nSrcOffset, nSize);
+
+	unsigned nErrors = pResult != pBuffer + nDestOffset ? 1 : 0;
+
+	for (size_t i = 0; i < nRegionSize; i++)
+	{
+		size_t nIndex = i;
+		if (   nDestOffset <= i
+		    && i < nDestOffset + nSize)
+		{
+			nIndex = i - nDestOffset + nSrcOffset;
+		}
+
+		if (pRegion[i] != (u8) (nIndex * 7 + nSize))
+		{
+			nErrors++;
+		}
+	}
+
+	return nErrors;
+}
+
+const char *CMemOpsBench::GetOpName (TMemOp Op)
+{
+	static const char *Names[] = {"cpy", "cpynt", "cpyblk", "move", "set", "zero", "setnt",
+				      "setblk", "cmp", "chr", "len"};
+	assert (Op < MemOpUnknown);
+
+	return Names[Op];
+}
+
+u8 CMemOpsBench::GetSetValue (TMemOp Op)
+{
+	switch (Op)
+	{
+	case MemOpSet:		return 0xA5;
+	case MemOpZero:		return 0;
+	case MemOpSetNT:	return 0x5A;
+	case MemOpSetBlk:	return 0xC3;
+	default:		assert (0);	return 0;
+	}
+}
+
+void CMemOpsBench::EnableCycleCounter (void)
+{
+#if defined (__aarch64__)
+	u64 nPMCR;
+	asm volatile ("mrs %0, pmcr_el0" : "=r" (nPMCR));
+	nPMCR |= 1 << 0 | 1 << 6;		// enable, 64-bit overflow
+	asm volatile ("msr pmcr_el0, %0" :: "r" (nPMCR));
+
+	asm volatile ("msr pmccfiltr_el0, %0" :: "r" (0ULL));	// count at EL0 and EL1
+	asm volatile ("msr pmcntenset_el0, %0; isb" :: "r" (1ULL << 31));
+#endif
+}
+
+u64 CMemOpsBench::GetCycles (void)
+{
+#if defined (__aarch64__)
+	u64 nCycles;
+	asm volatile ("isb; mrs %0, pmccntr_el0" : "=r" (nCycles) :: "memory");
+
+	return nCycles;
+#else
+	return 0;
+#endif
+}
@@ -0,0 +1,114 @@
+//
+// kernel.h
+//
+// Micro-benchmark of the memory and string functions of the Circle library
+// (memcpy, memmove, memset, memcmp, memchr, strlen, the non-temporal and the
+// Device memory variants, see lib/util_fast.S). Each function is timed on
+// buffers of different sizes (from L1 cache to DRAM) with aligned and
+// misaligned addresses. Each combination is reported as one phase with the
+// bytes processed and the CPU cycles, "host/decode -c MHz" shows the
+// throughput in GB/s.
+//
+// Afterwards the results of each function are checked for all lengths up to
+// MEMOPS_SWEEP_SIZE and all 16 alignments of both buffers, memmove() with
+// overlapping ranges in both directions too. The copy and fill functions are
+// checked again on a page of the coherent region, which is Device memory and
+// takes the same aligned code paths as with the MMU disabled.
+//
+// Phase names: "<function> <size> <alignment>", e.g. "cpy 16K u"
+//	a	buffers 64-byte aligned
+//	u	destination + 1, source + 3 (memcmp: second buffer + 3)
+// or "<function> sweep" and "<function> sweep dev" (coherent region)
+//
+#ifndef _kernel_h
+#define _kernel_h
+
+#include <experiment.h>
+#include <circle/types.h>
+
+#define MEMOPS_MAX_SIZE		(8*1024*1024)
+#define MEMOPS_BYTES_PER_PHASE	(32*1024*1024)	// repetitions are derived from this
+#define MEMOPS_PADDING		64
+
+#define MEMOPS_SWEEP_SIZE	256		// lengths 0..MEMOPS_SWEEP_SIZE are checked
+#define MEMOPS_SWEEP_OVERLAP	33		// memmove() distances -33..33 are checked
+#define MEMOPS_SWEEP_DEV_STEP	3		// alignment step on Device memory (slow)
+
+#define MEMOPS_COHERENT_SLOT	3		// not used by the library (see circle/memory.h)
+
+enum TMemOp
+{
+	MemOpCopy,
+	MemOpCopyNT,
+	MemOpCopyBlk,
+	MemOpMove,			// timed without overlap
+	MemOpSet,
+	MemOpZero,
+	MemOpSetNT,
+	MemOpSetBlk,
+	MemOpCompare,
+	MemOpChr,
+	MemOpStrlen,
+	MemOpUnknown
+};
+
+#define MEMOPS_SIZES		4
+#define MEMOPS_ALIGNMENTS	2
+#define MEMOPS_MAX_PHASES	(MemOpUnknown * (MEMOPS_SIZES * MEMOPS_ALIGNMENTS + 2))
+
+struct TMemOpsPhase
+{
+	TMemOp		Op;
+	size_t		nSize;
+	unsigned	nAlignment;		// 0: aligned, 1: misaligned
+	boolean		bSweep;			// nSize is MEMOPS_SWEEP_SIZE then
+	boolean		bDevice;		// sweep on the coherent region
+	u64		nBytes;
+	u64		nCycles;
+	unsigned	nErrors;
+};
+
+class CMemOpsBench : public CWorkload
+{
+public:
+	CMemOpsBench (void);
+	~CMemOpsBench (void);
+
+	boolean Setup (CExperiment *pExperiment);
+	void Execute (void);
+	void Compare (CExperiment *pExperiment);
+
+private:
+	void Run (TMemOp Op, size_t nSize, unsigned nAlignment);
+
+	/// \return Number of wrong results of the last repetition
+	unsigned Check (TMemOp Op, u8 *pDest, const u8 *pSrc, size_t nSize, u64 nResult);
+
+	/// \brief Check the results for all lengths up to MEMOPS_SWEEP_SIZE and all alignments
+	/// \param nStep Step between the checked alignments (1 for all)
+	void Sweep (TMemOp Op, u8 *pDest, u8 *pSrc, unsigned nStep, boolean bDevice);
+	/// \return Number of wrong results
+	static unsigned SweepCopy (TMemOp Op, u8 *pDest, const u8 *pSrc, size_t nSize);
+	static unsigned SweepSet (TMemOp Op, u8 *pDest, size_t nSize);
+	static unsigned SweepCompare (u8 *pBuffer1, const u8 *pBuffer2, size_t nSize);
+	static unsigned SweepChr (u8 *pBuffer, size_t nSize);
+	static unsigned SweepStrlen (u8 *pString, size_t nSize);
+	static unsigned SweepMove (u8 *pBuffer, int nDistance, size_t nSize);
+
+	static const char *GetOpName (TMemOp Op);
+	static u8 GetSetValue (TMemOp Op);
+
+	static void EnableCycleCounter (void);
+	static u64 GetCycles (void);
+
+private:
+	u8 *m_pMemory;
+	u8 *m_pDest;
+	u8 *m_pSrc;
+	u8 *m_pDevice;				// in the coherent region
+
+	TMemOpsPhase m_Phases[MEMOPS_MAX_PHASES];
+	unsigned m_nPhases;
+};
+
+#endif
@@ -0,0 +1,121 @@
+//
+// parallel.cpp
+//
+#include "parallel.h"
+#include <circle/atomic.h>
+#include <circle/synchronize.h>
+#include <assert.h>
+
+CParallel::CParallel (CMemorySystem *pMemorySystem)
+#ifdef PARALLEL_MULTI_CORE
+:	CMultiCoreSupport (pMemorySystem),
+#else
+:
+#endif
+	m_pFunction (0),
+	m_pParam (0),
+	m_nJob (0),
+	m_nBarrierCount (0),
+	m_nBarrierGeneration (0)
+{
+#ifndef PARALLEL_MULTI_CORE
+	(void) pMemorySystem;
+#endif
+}
+
+CParallel::~CParallel (void)
+{
+}
+
+boolean CParallel::Initialize (void)
+{
+#ifdef PARALLEL_MULTI_CORE
+	return CMultiCoreSupport::Initialize ();
+#else
+	return TRUE;
+#endif
+}
+
+void CParallel::Execute (TParallelFunction *pFunction, void *pParam)
+{
+	assert (pFunction != 0);
+
+	m_pFunction = pFunction;
+	m_pParam = pParam;
+
+#ifdef PARALLEL_MULTI_CORE
+	DataSyncBarrier ();
+	AtomicIncrement (&m_nJob);		// release the secondary cores
+	DataSyncBarrier ();
+	SendEvent ();
+#endif
+
+	(*pFunction) (0, pParam);
+
+	Barrier ();				// join
+}
+
+void CParallel::For (unsigned nCore, unsigned nFirst, unsigned nEnd,
+		     TParallelForFunction *pFunction, void *pParam)
+{
+	assert (nCore < PARALLEL_CORES);
+	assert (nFirst <= nEnd);
+	assert (pFunction != 0);
+
+	unsigned nCount = nEnd - nFirst;
+	unsigned nPartEnd = nFirst + (u64) nCount * (nCore+1) / PARALLEL_CORES;
+	for (unsigned i = nFirst + (u64) nCount * nCore / PARALLEL_CORES; i < nPartEnd; i++)
+	{
+		(*pFunction) (i, pParam);
+	}
+
+	Barrier ();
+}
+
+#ifdef PARALLEL_MULTI_CORE
+
+void CParallel::Run (unsigned nCore)
+{
+	assert (1 <= nCore && nCore < CORES);
+
+	int nLastJob = 0;
+	while (1)
+	{
+		int nJob;
+		while ((nJob = AtomicGet (&m_nJob)) == nLastJob)
+		{
+			WaitForEvent ();
+		}
+		nLastJob = nJob;
+
+		assert (m_pFunction != 0);
+		(*m_pFunction) (nCore, m_pParam);
+
+		Barrier ();
+	}
+}
+
+#endif
+
+void CParallel::Barrier (void)
+{
+#ifdef PARALLEL_MULTI_CORE
+	int nGeneration = AtomicGet (&m_nBarrierGeneration);
+
+	if (AtomicIncrement (&m_nBarrierCount) == PARALLEL_CORES)
+	{
+		AtomicSet (&m_nBarrierCount, 0);
+		AtomicIncrement (&m_nBarrierGeneration);
+
+		DataSyncBarrier ();
+		SendEvent ();
+
+		return;
+	}
+
+	while (AtomicGet (&m_nBarrierGeneration) == nGeneration)
+	{
+		WaitForEvent ();
+	}
+#endif
+}
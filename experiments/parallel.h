@@ -0,0 +1,71 @@
+//
+// parallel.h
+//
+// Runs a function on all CPU cores at the same time and returns, when it has
+// returned on all cores (fork/join). The cores can synchronize meanwhile with
+// Barrier() and share loops with For(). There can be only one instance,
+// because it owns the secondary cores. In the host build the function runs
+// on the calling core only.
+//
+#ifndef _parallel_h
+#define _parallel_h
+
+#include <circle/sysconfig.h>
+#include <circle/memory.h>
+#include <circle/types.h>
+
+#if defined (ARM_ALLOW_MULTI_CORE) && defined (__circle__)	// single core in the host build
+	#define PARALLEL_MULTI_CORE
+	#include <circle/multicore.h>
+
+	#define PARALLEL_CORES	CORES
+#else
+	#define PARALLEL_CORES	1
+#endif
+
+/// \param nCore Number of the calling core (0 .. PARALLEL_CORES-1)
+typedef void TParallelFunction (unsigned nCore, void *pParam);
+
+/// \param nIndex Loop index
+typedef void TParallelForFunction (unsigned nIndex, void *pParam);
+
+class CParallel
+#ifdef PARALLEL_MULTI_CORE
+	: public CMultiCoreSupport
+#endif
+{
+public:
+	CParallel (CMemorySystem *pMemorySystem);
+	~CParallel (void);
+
+	boolean Initialize (void);		// starts the secondary cores
+
+	/// \brief Call pFunction on all cores, returns when all calls have returned
+	/// \note Must be called on core 0.
+	void Execute (TParallelFunction *pFunction, void *pParam);
+
+	/// \brief Call pFunction for nFirst .. nEnd-1, each core calls it for a contiguous
+	///	   part of the indices, returns when all cores are done
+	/// \param nCore Number of the calling core
+	/// \note Must be called by pFunction of Execute() on all cores with the same indices.
+	void For (unsigned nCore, unsigned nFirst, unsigned nEnd,
+		  TParallelForFunction *pFunction, void *pParam);
+
+	/// \brief Wait until all cores have reached this point
+	/// \note Must be called by pFunction on all cores the same number of times.
+	void Barrier (void);
+
+#ifdef PARALLEL_MULTI_CORE
+	void Run (unsigned nCore);		// secondary cores wait for jobs here
+#endif
+
+private:
+	TParallelFunction *volatile m_pFunction;
+	void *volatile m_pParam;
+
+	volatile int m_nJob;			// incremented for each new job
+	volatile int m_nBarrierCount;
+	volatile int m_nBarrierGeneration;
+};
+
+#endif
@@ -0,0 +1,192 @@
+//
+// introsort.h
+//
+// Introsort with an inlined comparison: quicksort with a median-of-three
+// pivot, heapsort when the recursion gets too deep and insertion sort for
+// small partitions. Like qsort() it is not stable.
+//
+// TLess is a function object with boolean operator() (const T &, const T &),
+// which returns TRUE if the first argument has to be sorted before the second.
+//
+#ifndef _introsort_h
+#define _introsort_h
+
+#include <circle/types.h>
+#include <stddef.h>
+
+#define INTROSORT_THRESHOLD	16		// partitions up to this size are left to the insertion sort
+
+template <class T, class TLess>
+class CIntroSort
+{
+public:
+	static void Sort (T *pData, size_t nCount, TLess Less = TLess ())
+	{
+		if (nCount < 2)
+		{
+			return;
+		}
+
+		unsigned nDepthLimit = 0;
+		for (size_t n = nCount; n > 1; n >>= 1)
+		{
+			nDepthLimit += 2;
+		}
+
+		Loop (pData, pData + nCount, nDepthLimit, Less);
+
+		InsertionSort (pData, pData + nCount, Less);
+	}
+
+private:
+	static void Loop (T *pFirst, T *pLast, unsigned nDepthLimit, TLess &Less)
+	{
+		while (pLast - pFirst > INTROSORT_THRESHOLD)
+		{
+			if (nDepthLimit-- == 0)
+			{
+				HeapSort (pFirst, pLast, Less);
+
+				return;
+			}
+
+			T *pCut = Partition (pFirst, pLast, Less);
+
+			// recurse into the smaller part, so that the stack depth is O(log n)
+			if (pCut - pFirst < pLast - pCut)
+			{
+				Loop (pFirst, pCut, nDepthLimit, Less);
+				pFirst = pCut;
+			}
+			else
+			{
+				Loop (pCut, pLast, nDepthLimit, Less);
+				pLast = pCut;
+			}
+		}
+	}
+
+	// returns the first element of the right part, both parts are not empty
+	static T *Partition (T *pFirst, T *pLast, TLess &Less)
+	{
+		T *pMid = pFirst + (pLast - pFirst) / 2;
+
+		// median of three at *pFirst, which is the sentinel of both scans
+		T *pA = pFirst + 1;
+		T *pC = pLast - 1;
+		if (Less (*pA, *pMid))
+		{
+			if (Less (*pMid, *pC))		Swap (pFirst, pMid);
+			else if (Less (*pA, *pC))	Swap (pFirst, pC);
+			else				Swap (pFirst, pA);
+		}
+		else
+		{
+			if (Less (*pA, *pC))		Swap (pFirst, pA);
+			else if (Less (*pMid, *pC))	Swap (pFirst, pC);
+			else				Swap (pFirst, pMid);
+		}
+
+		const T Pivot = *pFirst;
+
+		T *pLeft = pFirst + 1;
+		T *pRight = pLast;
+		while (1)
+		{
+			while (Less (*pLeft, Pivot))
+			{
+				pLeft++;
+			}
+
+			do
+			{
+				pRight--;
+			}
+			while (Less (Pivot, *pRight));
+
+			if (pLeft >= pRight)
+			{
+				return pLeft;
+			}
+
+			Swap (pLeft, pRight);
+			pLeft++;
+		}
+	}
+
+	static void HeapSort (T *pFirst, T *pLast, TLess &Less)
+	{
+		size_t nCount = pLast - pFirst;
+
+		for (size_t i = nCount / 2; i-- > 0; )
+		{
+			SiftDown (pFirst, i, nCount, Less);
+		}
+
+		while (nCount > 1)
+		{
+			Swap (pFirst, pFirst + --nCount);
+			SiftDown (pFirst, 0, nCount, Less);
+		}
+	}
+
+	static void SiftDown (T *pHeap, size_t nRoot, size_t nCount, TLess &Less)
+	{
+		T Value = pHeap[nRoot];
+
+		size_t nChild;
+		while ((nChild = 2*nRoot + 1) < nCount)
+		{
+			if (   nChild+1 < nCount
+			    && Less (pHeap[nChild], pHeap[nChild+1]))
+			{
+				nChild++;
+			}
+
+			if (!Less (Value, pHeap[nChild]))
+			{
+				break;
+			}
+
+			pHeap[nRoot] = pHeap[nChild];
+			nRoot = nChild;
+		}
+
+		pHeap[nRoot] = Value;
+	}
+
+	static void InsertionSort (T *pFirst, T *pLast, TLess &Less)
+	{
+		for (T *p = pFirst + 1; p < pLast; p++)
+		{
+			T Value = *p;
+
+			T *q = p;
+			if (Less (Value, *pFirst))
+			{
+				for (; q > pFirst; q--)
+				{
+					q[0] = q[-1];
+				}
+			}
+			else
+			{
+				for (; Less (Value, q[-1]); q--)	// stops at *pFirst at the latest
+				{
+					q[0] = q[-1];
+				}
+			}
+
+			*q = Value;
+		}
+	}
+
+	static void Swap (T *pA, T *pB)
+	{
+		T Temp = *pA;
+		*pA = *pB;
+		*pB = Temp;
+	}
+};
+
+#endif
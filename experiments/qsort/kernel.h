@@ -20,59 +20,47 @@
 #ifndef _kernel_h
 #define _kernel_h
 
-#include <circle/actled.h>
-#include <circle/koptions.h>
-#include <circle/devicenameservice.h>
-#include <circle/screen.h>
-#include <circle/serial.h>
-#include <circle/exceptionhandler.h>
-#include <circle/interrupt.h>
-#include <circle/timer.h>
-#include <circle/logger.h>
-#include <emmc.h>
-#include <circle/fs/fat/fatfs.h>
+#include <experiment.h>
+#include <golddigest.h>
+#include <parallel.h>
 #include <circle/types.h>
-#include <circle/gpiomanager.h>
-#include <softserial.h>
+#include "qsort.h"
+#include "sorter.h"
 
+#define MAXARRAY	2000000
 
+// Sort algorithm: SORT_QSORT is the original glibc style qsort() on one core,
+// SORT_INTROSORT and SORT_RADIX run on all cores (see sorter.h)
+#define SORT_QSORT	0
+#define SORT_INTROSORT	1
+#define SORT_RADIX	2
 
+#define SORT_ALGORITHM	SORT_RADIX
 
-enum TShutdownMode
-{
-	ShutdownNone,
-	ShutdownHalt,
-	ShutdownReboot
-};
+#define INPUT_FILENAME	"qsort_input_2000000.bin"
+#define GOLD_FILENAME	"qsort_gold_2000000.bin"
+
+// Keep only block hashes of the gold data in memory (see golddigest.h),
+// comment this out to compare against the whole gold data
+#define GOLD_DIGEST
 
-class CKernel
+class CQSort : public CWorkload
 {
 public:
-	CKernel (void);
-	~CKernel (void);
+	CQSort (void);
+	~CQSort (void);
+
+	boolean Setup (CExperiment *pExperiment);
+	void Execute (void);
+	void Compare (CExperiment *pExperiment);
 
-	boolean Initialize (void);
-	void send_message(int size);
-	TShutdownMode Run (void);
-	void initGold(char* gold_file);
-	void initInput(char* input_file);
-	
 private:
-	// do not change this order
-	CActLED			m_ActLED;
-	CKernelOptions		m_Options;
-	CDeviceNameService	m_DeviceNameService;
-	CScreenDevice		m_Screen;
-	CSerialDevice		m_Serial;
-	CExceptionHandler	m_ExceptionHandler;
-	CInterruptSystem	m_Interrupt;
-	CTimer			m_Timer;
-	CLogger			m_Logger;
-	CGPIOManager		m_GPIOManager;	
-	CSoftSerialDevice	m_SoftSerial;
-	CEMMCDevice		m_EMMC;
-	CFATFileSystem		m_FileSystem;
-	unsigned int buffer[10];
+	CParallel m_Parallel;
+	CParallelSorter m_Sorter;
+
+#ifdef GOLD_DIGEST
+	CGoldDigest m_GoldDigest;
+#endif
 };
 
 #endif
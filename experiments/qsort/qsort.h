@@ -0,0 +1,16 @@
+//
+// qsort.h
+//
+// Sort of the qsort experiment (glibc style quicksort on doubles), free of
+// Circle dependencies, so that it can be built for the host too.
+//
+#ifndef _qsort_h
+#define _qsort_h
+
+#include <stddef.h>
+
+int compare(const void *elem1, const void *elem2);
+
+void qsort (void *const pbase, size_t total_elems, size_t size);
+
+#endif
@@ -0,0 +1,304 @@
+//
+// sorter.cpp
+//
+#include "sorter.h"
+#include "introsort.h"
+#include <assert.h>
+
+#define RADIX_MASK	(SORTER_RADIX_SIZE - 1)
+
+struct TDoubleLess			// same order as compare() in qsort.cpp
+{
+	boolean operator() (double fA, double fB) const	{ return fA < fB; }
+};
+
+CParallelSorter::CParallelSorter (CParallel *pParallel)
+:	m_pParallel (pParallel),
+	m_pOut (0),
+	m_pIn (0),
+	m_pTemp (0),
+	m_nCount (0)
+{
+	m_pHistogram = new u32[PARALLEL_CORES * SORTER_DIGITS * SORTER_RADIX_SIZE];
+	assert (m_pHistogram != 0);
+
+	m_pOffset = new size_t[PARALLEL_CORES * SORTER_RADIX_SIZE];
+	assert (m_pOffset != 0);
+}
+
+CParallelSorter::~CParallelSorter (void)
+{
+	delete [] m_pOffset;
+	m_pOffset = 0;
+
+	delete [] m_pHistogram;
+	m_pHistogram = 0;
+
+	m_pParallel = 0;
+}
+
+void CParallelSorter::IntroSort (double *pOut, const double *pIn, double *pTemp, size_t nCount)
+{
+	assert (m_pParallel != 0);
+	assert (pOut != 0);
+	assert (pIn != 0);
+	assert (pTemp != 0);
+
+	m_pOut = pOut;
+	m_pIn = pIn;
+	m_pTemp = pTemp;
+	m_nCount = nCount;
+
+	m_pParallel->Execute (IntroSortStub, this);
+}
+
+void CParallelSorter::IntroSortStub (unsigned nCore, void *pParam)
+{
+	CParallelSorter *pThis = (CParallelSorter *) pParam;
+	assert (pThis != 0);
+
+	pThis->IntroSort (nCore);
+}
+
+void CParallelSorter::IntroSort (unsigned nCore)
+{
+	assert (nCore < PARALLEL_CORES);
+
+	size_t nFirst = GetBound (nCore);
+	size_t nEnd = GetBound (nCore+1);
+
+	for (size_t i = nFirst; i < nEnd; i++)
+	{
+		m_pOut[i] = m_pIn[i];
+	}
+
+	CIntroSort<double, TDoubleLess>::Sort (m_pOut + nFirst, nEnd - nFirst);
+
+	// merge pairs of runs of nWidth parts, the cores of both runs work on the merge
+	double *pSrc = m_pOut;
+	double *pDst = m_pTemp;
+	for (unsigned nWidth = 1; nWidth < PARALLEL_CORES; nWidth *= 2)
+	{
+		m_pParallel->Barrier ();		// the runs are complete
+
+		unsigned nPairFirst = nCore / (2*nWidth) * (2*nWidth);
+		unsigned nPairMid = nPairFirst + nWidth < PARALLEL_CORES ? nPairFirst + nWidth : PARALLEL_CORES;
+		unsigned nPairEnd = nPairFirst + 2*nWidth < PARALLEL_CORES ? nPairFirst + 2*nWidth : PARALLEL_CORES;
+		unsigned nPairCores = nPairEnd - nPairFirst;
+		unsigned nPairCore = nCore - nPairFirst;
+
+		size_t nA = GetBound (nPairFirst);
+		size_t nB = GetBound (nPairMid);
+		size_t nTotal = GetBound (nPairEnd) - nA;
+
+		Merge (pDst + nA, pSrc + nA, nB - nA, pSrc + nB, nTotal - (nB - nA),
+		       nTotal * nPairCore / nPairCores, nTotal * (nPairCore+1) / nPairCores);
+
+		double *pTemp = pSrc;
+		pSrc = pDst;
+		pDst = pTemp;
+	}
+
+	if (pSrc != m_pOut)
+	{
+		m_pParallel->Barrier ();
+
+		for (size_t i = nFirst; i < nEnd; i++)
+		{
+			m_pOut[i] = pSrc[i];
+		}
+	}
+}
+
+void CParallelSorter::Merge (double *pOut, const double *pA, size_t nA, const double *pB, size_t nB,
+			     size_t nFrom, size_t nTo)
+{
+	assert (nTo <= nA + nB);
+
+	// i elements of A and nFrom-i elements of B come before the output position nFrom,
+	// find the largest i, for which A[i-1] is taken before B[nFrom-i] (A is taken first if equal)
+	size_t nLow = nFrom > nB ? nFrom - nB : 0;
+	size_t nHigh = nFrom < nA ? nFrom : nA;
+	while (nLow < nHigh)
+	{
+		size_t i = (nLow + nHigh + 1) / 2;
+
+		if (   nFrom - i >= nB
+		    || !(pB[nFrom - i] < pA[i-1]))
+		{
+			nLow = i;
+		}
+		else
+		{
+			nHigh = i-1;
+		}
+	}
+
+	size_t i = nLow;
+	size_t j = nFrom - nLow;
+	for (size_t k = nFrom; k < nTo; k++)
+	{
+		if (   j >= nB
+		    || (   i < nA
+			&& !(pB[j] < pA[i])))
+		{
+			pOut[k] = pA[i++];
+		}
+		else
+		{
+			pOut[k] = pB[j++];
+		}
+	}
+}
+
+void CParallelSorter::RadixSort (double *pOut, const double *pIn, double *pTemp, size_t nCount)
+{
+	assert (m_pParallel != 0);
+	assert (pOut != 0);
+	assert (pIn != 0);
+	assert (pTemp != 0);
+	assert (nCount <= 0xFFFFFFFFU);
+
+	m_pOut = pOut;
+	m_pIn = pIn;
+	m_pTemp = pTemp;
+	m_nCount = nCount;
+
+	m_pParallel->Execute (RadixSortStub, this);
+}
+
+void CParallelSorter::RadixSortStub (unsigned nCore, void *pParam)
+{
+	CParallelSorter *pThis = (CParallelSorter *) pParam;
+	assert (pThis != 0);
+
+	pThis->RadixSort (nCore);
+}
+
+void CParallelSorter::RadixSort (unsigned nCore)
+{
+	assert (nCore < PARALLEL_CORES);
+
+	size_t nFirst = GetBound (nCore);
+	size_t nEnd = GetBound (nCore+1);
+
+	// count all digits of the own elements
+	u32 *pHistogram = GetHistogram (nCore, 0);
+	for (unsigned i = 0; i < SORTER_DIGITS * SORTER_RADIX_SIZE; i++)
+	{
+		pHistogram[i] = 0;
+	}
+
+	for (size_t i = nFirst; i < nEnd; i++)
+	{
+		u64 nKey = GetKey (m_pIn[i]);
+
+		for (unsigned nDigit = 0; nDigit < SORTER_DIGITS; nDigit++)
+		{
+			pHistogram[nDigit * SORTER_RADIX_SIZE + ((nKey >> (nDigit * SORTER_RADIX_BITS)) & RADIX_MASK)]++;
+		}
+	}
+
+	m_pParallel->Barrier ();
+
+	// find the digits, which do not have all elements in one bucket (same on all cores)
+	unsigned Digits[SORTER_DIGITS];
+	unsigned nPasses = 0;
+	for (unsigned nDigit = 0; nDigit < SORTER_DIGITS; nDigit++)
+	{
+		boolean bSingleBucket = FALSE;
+		for (unsigned nBucket = 0; nBucket < SORTER_RADIX_SIZE && !bSingleBucket; nBucket++)
+		{
+			size_t nTotal = 0;
+			for (unsigned nCore2 = 0; nCore2 < PARALLEL_CORES; nCore2++)
+			{
+				nTotal += GetHistogram (nCore2, nDigit)[nBucket];
+			}
+
+			bSingleBucket = nTotal == m_nCount;
+		}
+
+		if (!bSingleBucket)
+		{
+			Digits[nPasses++] = nDigit;
+		}
+	}
+
+	if (nPasses == 0)
+	{
+		for (size_t i = nFirst; i < nEnd; i++)
+		{
+			m_pOut[i] = m_pIn[i];
+		}
+
+		return;
+	}
+
+	// the last pass has to write to m_pOut
+	const double *pSrc = m_pIn;
+	double *pDst = nPasses % 2 ? m_pOut : m_pTemp;
+	for (unsigned nPass = 0; nPass < nPasses; nPass++)
+	{
+		unsigned nDigit = Digits[nPass];
+		unsigned nShift = nDigit * SORTER_RADIX_BITS;
+
+		if (nPass > 0)			// the elements have moved, count again
+		{
+			pHistogram = GetHistogram (nCore, nDigit);
+			for (unsigned i = 0; i < SORTER_RADIX_SIZE; i++)
+			{
+				pHistogram[i] = 0;
+			}
+
+			for (size_t i = nFirst; i < nEnd; i++)
+			{
+				pHistogram[(GetKey (pSrc[i]) >> nShift) & RADIX_MASK]++;
+			}
+
+			m_pParallel->Barrier ();
+		}
+
+		// a bucket starts after the lower buckets and after the part of the lower cores
+		size_t *pOffset = GetOffsets (nCore);
+		size_t nSum = 0;
+		for (unsigned nBucket = 0; nBucket < SORTER_RADIX_SIZE; nBucket++)
+		{
+			for (unsigned nCore2 = 0; nCore2 < PARALLEL_CORES; nCore2++)
+			{
+				if (nCore2 == nCore)
+				{
+					pOffset[nBucket] = nSum;
+				}
+
+				nSum += GetHistogram (nCore2, nDigit)[nBucket];
+			}
+		}
+
+		for (size_t i = nFirst; i < nEnd; i++)
+		{
+			double fValue = pSrc[i];
+
+			pDst[pOffset[(GetKey (fValue) >> nShift) & RADIX_MASK]++] = fValue;
+		}
+
+		m_pParallel->Barrier ();		// the pass is complete
+
+		pSrc = pDst;
+		pDst = pDst == m_pOut ? m_pTemp : m_pOut;
+	}
+}
+
+u64 CParallelSorter::GetKey (double fValue)
+{
+	union
+	{
+		double	fValue;
+		u64	nBits;
+	}
+	Value;
+
+	Value.fValue = fValue;
+
+	// negative numbers: reverse the order, positive numbers: above the negative
+	return Value.nBits & (1ULL << 63) ? ~Value.nBits : Value.nBits | (1ULL << 63);
+}
@@ -0,0 +1,82 @@
+//
+// sorter.h
+//
+// Multi-core sorts of doubles for the qsort experiment, free of Circle
+// dependencies (except CParallel), so that they can be built for the host too.
+//
+// IntroSort():	Each core copies its part of the input and sorts it with
+//		CIntroSort, then the parts are merged pairwise. Each merge is
+//		distributed across the cores by splitting the output and searching
+//		the matching split points of the two inputs.
+// RadixSort():	Stable LSD radix sort on the IEEE-754 bit pattern (with the sign
+//		handled, so that the unsigned order is the numeric order) with
+//		11-bit digits. All digit histograms are counted in one pass, digits
+//		with a single bucket are skipped. Each core counts and scatters its
+//		part of the elements, a core writes a bucket after the lower cores.
+//
+// Both give the order of qsort(), if there is no NaN and not +0 and -0 together
+// in the input (elements, which compare equal, have the same bit pattern then).
+//
+#ifndef _sorter_h
+#define _sorter_h
+
+#include <parallel.h>
+#include <circle/types.h>
+#include <stddef.h>
+
+#define SORTER_RADIX_BITS	11
+#define SORTER_RADIX_SIZE	(1 << SORTER_RADIX_BITS)
+#define SORTER_DIGITS		((64 + SORTER_RADIX_BITS-1) / SORTER_RADIX_BITS)
+
+class CParallelSorter
+{
+public:
+	CParallelSorter (CParallel *pParallel);
+	~CParallelSorter (void);
+
+	/// \brief Sort nCount elements from pIn into pOut (all cores)
+	/// \param pTemp Buffer of nCount elements
+	void IntroSort (double *pOut, const double *pIn, double *pTemp, size_t nCount);
+
+	/// \brief Sort nCount elements from pIn into pOut (all cores)
+	/// \param pTemp Buffer of nCount elements
+	void RadixSort (double *pOut, const double *pIn, double *pTemp, size_t nCount);
+
+private:
+	static void IntroSortStub (unsigned nCore, void *pParam);
+	void IntroSort (unsigned nCore);
+
+	static void RadixSortStub (unsigned nCore, void *pParam);
+	void RadixSort (unsigned nCore);
+
+	/// \brief Merge the output range nFrom .. nTo-1 of the sorted runs A and B (stable)
+	static void Merge (double *pOut, const double *pA, size_t nA, const double *pB, size_t nB,
+			   size_t nFrom, size_t nTo);
+
+	size_t GetBound (unsigned nPart) const	{ return m_nCount * nPart / PARALLEL_CORES; }
+
+	static u64 GetKey (double fValue);
+
+	u32 *GetHistogram (unsigned nCore, unsigned nDigit) const
+	{
+		return m_pHistogram + (nCore * SORTER_DIGITS + nDigit) * SORTER_RADIX_SIZE;
+	}
+
+	size_t *GetOffsets (unsigned nCore) const
+	{
+		return m_pOffset + nCore * SORTER_RADIX_SIZE;
+	}
+
+private:
+	CParallel *m_pParallel;
+
+	double *m_pOut;
+	const double *m_pIn;
+	double *m_pTemp;
+	size_t m_nCount;
+
+	u32 *m_pHistogram;			// [core][digit][bucket]
+	size_t *m_pOffset;			// [core][bucket], scatter position (16 KB per core)
+};
+
+#endif
@@ -0,0 +1,235 @@
+//
+// reportframe.cpp
+//
+#include "reportframe.h"
+#include <assert.h>
+
+CReportFrame::CReportFrame (void)
+:	m_nElementSize (4),
+	m_nRowLength (0),
+	m_nWords (0)
+{
+	Reset ();
+}
+
+void CReportFrame::SetLayout (unsigned nElementSize, unsigned nRowLength)
+{
+	assert (nElementSize > 0);
+	assert (nElementSize % 4 == 0);
+	assert (nElementSize <= REPORT_MAX_ELEMENT_SIZE);
+
+	m_nElementSize = nElementSize;
+	m_nRowLength = nRowLength;
+}
+
+void CReportFrame::Reset (void)
+{
+	m_nMismatches = 0;
+	m_nFlags = 0;
+	m_nXOROr = 0;
+	m_nXORAnd = 0;
+	m_nFirstIndex = 0;
+	m_nFirstValue = 0;
+	m_nRanges = 0;
+}
+
+void CReportFrame::AddMismatch (unsigned nIndex, const void *pValue, const void *pGold)
+{
+	assert (pValue != 0);
+	const u32 *pValueWords = (const u32 *) pValue;
+	const u32 *pGoldWords = (const u32 *) pGold;
+
+	u64 nOr = 0;
+	u64 nAnd = (u64) -1;
+	if (pGold == 0)
+	{
+		m_nFlags |= REPORT_FLAG_NO_GOLD;	// leaves the XOR patterns unchanged
+	}
+	else for (unsigned i = 0; i < m_nElementSize / 4; i += 2)
+	{
+		u64 nXOR = pValueWords[i] ^ pGoldWords[i];
+		if (i+1 < m_nElementSize / 4)
+		{
+			nXOR |= (u64) (pValueWords[i+1] ^ pGoldWords[i+1]) << 32;
+		}
+
+		nOr |= nXOR;
+		nAnd &= nXOR;
+	}
+
+	if (m_nMismatches++ == 0)
+	{
+		m_nXOROr = nOr;
+		m_nXORAnd = nAnd;
+		m_nFirstIndex = nIndex;
+		m_nFirstValue = pValueWords[0];
+		if (m_nElementSize >= 8)
+		{
+			m_nFirstValue |= (u64) pValueWords[1] << 32;
+		}
+	}
+	else
+	{
+		m_nXOROr |= nOr;
+		m_nXORAnd &= nAnd;
+	}
+
+	if (m_nRanges > 0)
+	{
+		TRange *pRange = &m_Ranges[m_nRanges-1];
+
+		if (pRange->nCount == 1)
+		{
+			if (nIndex > pRange->nStart)
+			{
+				pRange->nStride = nIndex - pRange->nStart;
+				pRange->nCount = 2;
+
+				return;
+			}
+		}
+		else if (nIndex == pRange->nStart + pRange->nCount * pRange->nStride)
+		{
+			pRange->nCount++;
+
+			return;
+		}
+	}
+
+	if (m_nRanges < REPORT_MAX_RANGES)
+	{
+		TRange *pRange = &m_Ranges[m_nRanges++];
+
+		pRange->nStart = nIndex;
+		pRange->nCount = 1;
+		pRange->nStride = 1;
+	}
+	else
+	{
+		m_nFlags |= REPORT_FLAG_TRUNCATED;
+	}
+}
+
+const u32 *CReportFrame::Finish (unsigned nSequence, unsigned nExecuteTicks,
+				 unsigned nCompareTicks, unsigned nDropped)
+{
+	u32 *pWord = m_Frame;
+
+	*pWord++ = REPORT_FRAME_MAGIC;
+	*pWord++ = 0;				// length, set below
+	*pWord++ = nSequence;
+	*pWord++ = nExecuteTicks;
+	*pWord++ = nCompareTicks;
+	*pWord++ = m_nMismatches;
+	*pWord++ = nDropped;
+	*pWord++ = m_nElementSize | m_nFlags << 8 | m_nRanges << 16;
+	*pWord++ = m_nRowLength;
+
+	if (m_nMismatches > 0)
+	{
+		*pWord++ = (u32) m_nXOROr;
+		*pWord++ = (u32) (m_nXOROr >> 32);
+		*pWord++ = (u32) m_nXORAnd;
+		*pWord++ = (u32) (m_nXORAnd >> 32);
+		*pWord++ = m_nFirstIndex;
+		*pWord++ = (u32) m_nFirstValue;
+		*pWord++ = (u32) (m_nFirstValue >> 32);
+
+		for (unsigned i = 0; i < m_nRanges; i++)
+		{
+			*pWord++ = m_Ranges[i].nStart;
+			*pWord++ = m_Ranges[i].nCount;
+			*pWord++ = m_Ranges[i].nStride;
+		}
+	}
+
+	m_nWords = pWord - m_Frame + 1;
+	assert (m_nWords <= REPORT_MAX_WORDS);
+	m_Frame[1] = m_nWords;
+
+	*pWord = ReportCRC32 (m_Frame, (m_nWords-1) * sizeof (u32));
+
+	return m_Frame;
+}
+
+void ReportPhase (u32 *pReport, unsigned nSequence, const char *pName,
+		  u64 nBytes, u64 nCycles, unsigned nErrors)
+{
+	assert (pReport != 0);
+	assert (pName != 0);
+
+	pReport[0] = REPORT_PHASE_MAGIC;
+	pReport[1] = nSequence;
+
+	u8 *pChar = (u8 *) &pReport[2];
+	for (unsigned i = 0; i < REPORT_PHASE_NAME_SIZE; i++)
+	{
+		pChar[i] = *pName;
+		if (*pName != '\0')
+		{
+			pName++;
+		}
+	}
+
+	pReport[6] = (u32) nBytes;
+	pReport[7] = (u32) (nBytes >> 32);
+	pReport[8] = (u32) nCycles;
+	pReport[9] = (u32) (nCycles >> 32);
+	pReport[10] = nErrors;
+
+	pReport[11] = ReportCRC32 (pReport, (REPORT_PHASE_WORDS-1) * sizeof (u32));
+}
+
+void ReportCounters (u32 *pReport, unsigned nSequence, u64 nCycles,
+		     const unsigned *pEvents, const u64 *pCounts, unsigned nCounters)
+{
+	assert (pReport != 0);
+	assert (nCounters <= REPORT_MAX_COUNTERS);
+	assert (pEvents != 0 || nCounters == 0);
+	assert (pCounts != 0 || nCounters == 0);
+
+	pReport[0] = REPORT_COUNTER_MAGIC;
+	pReport[1] = nSequence;
+	pReport[2] = (u32) nCycles;
+	pReport[3] = (u32) (nCycles >> 32);
+	pReport[4] = nCounters;
+
+	u32 *pEntry = &pReport[5];
+	for (unsigned i = 0; i < REPORT_MAX_COUNTERS; i++, pEntry += 3)
+	{
+		if (i < nCounters)
+		{
+			pEntry[0] = pEvents[i];
+			pEntry[1] = (u32) pCounts[i];
+			pEntry[2] = (u32) (pCounts[i] >> 32);
+		}
+		else
+		{
+			pEntry[0] = 0;
+			pEntry[1] = 0;
+			pEntry[2] = 0;
+		}
+	}
+
+	pReport[REPORT_COUNTER_WORDS-1] =
+		ReportCRC32 (pReport, (REPORT_COUNTER_WORDS-1) * sizeof (u32));
+}
+
+u32 ReportCRC32 (const void *pBuffer, unsigned nLength)
+{
+	assert (pBuffer != 0);
+	const u8 *pByte = (const u8 *) pBuffer;
+
+	u32 nCRC = 0xFFFFFFFF;
+	while (nLength-- > 0)
+	{
+		nCRC ^= *pByte++;
+
+		for (unsigned i = 0; i < 8; i++)
+		{
+			nCRC = nCRC >> 1 ^ (nCRC & 1 ? 0xEDB88320 : 0);
+		}
+	}
+
+	return ~nCRC;
+}
@@ -0,0 +1,152 @@
+//
+// reportframe.h
+//
+// Report frame, which summarizes the result of one iteration of an
+// experiment. The size of a frame is bounded, independent of the number
+// of mismatches. This file is shared with the host decoder (host/decode.cpp).
+//
+// Frame layout (32-bit words, little endian):
+//	 0	REPORT_FRAME_MAGIC
+//	 1	length of the frame in words (including magic and CRC)
+//	 2	sequence number (iteration)
+//	 3	duration of Execute() in microseconds
+//	 4	duration of Compare() in microseconds
+//	 5	number of mismatches
+//	 6	number of reports dropped so far, because the link was busy
+//	 7	element size in bytes (bits 0-7), flags (bits 8-15), number of ranges (bits 16-31)
+//	 8	row length in elements (0 for one-dimensional data)
+// only if there are mismatches:
+//	 9-10	OR of all XOR patterns (value ^ gold), low word first
+//	11-12	AND of all XOR patterns
+//	13	index of the first mismatch
+//	14-15	value of the first mismatch (first 8 bytes of the element)
+//	16...	ranges of mismatch indices: start, count, stride
+// last	CRC-32 (IEEE 802.3) over all preceding bytes
+//
+// XOR patterns of elements larger than 8 bytes are folded into 64 bits by
+// combining the 64-bit words of the element in the same way (OR, AND).
+// Mismatch indices i, which follow start + n * stride (n < count), are
+// encoded as one range. The indices have to be reported in ascending order
+// to give long ranges. If more than REPORT_MAX_RANGES ranges are required,
+// REPORT_FLAG_TRUNCATED is set and the further indices are only counted.
+// Mismatches without gold data (the gold file could not be read) are counted
+// and encoded in the ranges, but not in the XOR patterns. REPORT_FLAG_NO_GOLD
+// is set then.
+//
+// Phase report (REPORT_PHASE_WORDS words), throughput of a part of an iteration:
+//	 0	REPORT_PHASE_MAGIC
+//	 1	sequence number (iteration)
+//	 2-5	name (REPORT_PHASE_NAME_SIZE characters, padded with 0)
+//	 6-7	number of bytes processed, low word first
+//	 8-9	duration in CPU cycles, low word first
+//	10	number of errors found in this phase
+//	11	CRC-32 (IEEE 802.3) over all preceding bytes
+//
+// Counter report (REPORT_COUNTER_WORDS words), PMU counts of an iteration:
+//	 0	REPORT_COUNTER_MAGIC
+//	 1	sequence number (iteration)
+//	 2-3	CPU cycles, low word first
+//	 4	number of event counters n (up to REPORT_MAX_COUNTERS)
+//	 5...	REPORT_MAX_COUNTERS times: ARMv8 event number, count (low word first),
+//		the entries from n on are 0
+//	23	CRC-32 (IEEE 802.3) over all preceding bytes
+//
+#ifndef _reportframe_h
+#define _reportframe_h
+
+#include <circle/types.h>
+
+#define REPORT_FRAME_MAGIC	0x314D5246		// "FRM1"
+
+#define REPORT_HEADER_WORDS	9
+#define REPORT_SUMMARY_WORDS	7
+#define REPORT_RANGE_WORDS	3
+#define REPORT_MAX_RANGES	32
+#define REPORT_MAX_WORDS	(  REPORT_HEADER_WORDS + REPORT_SUMMARY_WORDS \
+				 + REPORT_RANGE_WORDS * REPORT_MAX_RANGES + 1)
+
+#define REPORT_FLAG_TRUNCATED	(1 << 0)		// not all indices are in the ranges
+#define REPORT_FLAG_NO_GOLD	(1 << 1)		// not all mismatches are in the XOR patterns
+
+#define REPORT_MAX_ELEMENT_SIZE	255
+
+#define REPORT_PHASE_MAGIC	0x31534850		// "PHS1"
+
+#define REPORT_PHASE_NAME_SIZE	16
+#define REPORT_PHASE_WORDS	(7 + REPORT_PHASE_NAME_SIZE/4 + 1)
+
+#define REPORT_COUNTER_MAGIC	0x31554D50		// "PMU1"
+
+#define REPORT_MAX_COUNTERS	6
+#define REPORT_COUNTER_WORDS	(5 + 3*REPORT_MAX_COUNTERS + 1)
+
+u32 ReportCRC32 (const void *pBuffer, unsigned nLength);
+
+/// \brief Build a phase report
+/// \param pReport Buffer of REPORT_PHASE_WORDS words
+/// \param pName Name of the phase (truncated to REPORT_PHASE_NAME_SIZE characters)
+void ReportPhase (u32 *pReport, unsigned nSequence, const char *pName,
+		  u64 nBytes, u64 nCycles, unsigned nErrors);
+
+/// \brief Build a counter report
+/// \param pReport Buffer of REPORT_COUNTER_WORDS words
+/// \param pEvents Event numbers of the nCounters counters
+/// \param pCounts Counts of the nCounters counters
+void ReportCounters (u32 *pReport, unsigned nSequence, u64 nCycles,
+		     const unsigned *pEvents, const u64 *pCounts, unsigned nCounters);
+
+class CReportFrame
+{
+public:
+	CReportFrame (void);
+
+	/// \param nElementSize Size of the compared elements in bytes (multiple of 4)
+	/// \param nRowLength Elements per row (0 for one-dimensional data)
+	void SetLayout (unsigned nElementSize, unsigned nRowLength);
+
+	/// \brief Start a new frame
+	void Reset (void);
+
+	/// \brief Add a mismatching element
+	/// \param pGold Pointer to the expected element (0 if the gold data is not available)
+	void AddMismatch (unsigned nIndex, const void *pValue, const void *pGold);
+
+	/// \brief Complete the frame
+	/// \return Pointer to the frame
+	const u32 *Finish (unsigned nSequence, unsigned nExecuteTicks, unsigned nCompareTicks,
+			   unsigned nDropped);
+
+	/// \return Size of the compared elements in bytes
+	unsigned GetElementSize (void) const	{ return m_nElementSize; }
+
+	/// \return Size of the completed frame in words
+	unsigned GetWords (void) const		{ return m_nWords; }
+
+	/// \return Number of mismatches in the current frame
+	unsigned GetMismatches (void) const	{ return m_nMismatches; }
+
+private:
+	unsigned m_nElementSize;
+	unsigned m_nRowLength;
+
+	unsigned m_nMismatches;
+	unsigned m_nFlags;
+	u64 m_nXOROr;
+	u64 m_nXORAnd;
+	unsigned m_nFirstIndex;
+	u64 m_nFirstValue;
+
+	struct TRange
+	{
+		unsigned nStart;
+		unsigned nCount;
+		unsigned nStride;
+	}
+	m_Ranges[REPORT_MAX_RANGES];
+	unsigned m_nRanges;
+
+	u32 m_Frame[REPORT_MAX_WORDS];
+	unsigned m_nWords;
+};
+
+#endif
@@ -20,59 +20,42 @@
 #ifndef _kernel_h
 #define _kernel_h
 
-#include <circle/actled.h>
-#include <circle/koptions.h>
-#include <circle/devicenameservice.h>
-#include <circle/screen.h>
-#include <circle/serial.h>
-#include <circle/exceptionhandler.h>
-#include <circle/interrupt.h>
-#include <circle/timer.h>
-#include <circle/logger.h>
-#include <emmc.h>
-#include <circle/fs/fat/fatfs.h>
+#include <experiment.h>
+#include <golddigest.h>
+#include <parallel.h>
 #include <circle/types.h>
-#include <circle/gpiomanager.h>
-#include <softserial.h>
+#include "susan.h"
 
+#define IMAGE_WIDTH	2048
+#define IMAGE_HEIGHT	2048
+#define IMAGE_SIZE	(IMAGE_WIDTH * IMAGE_HEIGHT)
 
+// 8-bit grey image, generated with: experiments/host/bench -w dir susan
+#define INPUT_FILENAME	"susan_input_2048.bin"
+// smoothed image, edge image and corner image (see susan.h)
+#define GOLD_FILENAME	"susan_gold_2048.bin"
 
+// Keep only block hashes of the gold data in memory (see golddigest.h),
+// comment this out to compare against the whole gold data
+#define GOLD_DIGEST
 
-enum TShutdownMode
-{
-	ShutdownNone,
-	ShutdownHalt,
-	ShutdownReboot
-};
-
-class CKernel
+class CSusan : public CWorkload
 {
 public:
-	CKernel (void);
-	~CKernel (void);
+	CSusan (void);
+	~CSusan (void);
+
+	boolean Setup (CExperiment *pExperiment);
+	void Execute (void);
+	void Compare (CExperiment *pExperiment);
 
-	boolean Initialize (void);
-	void send_message(int size);
-	TShutdownMode Run (void);
-	void initGold(char* gold_file);
-	void initInput(char* input_file);
-	
 private:
-	// do not change this order
-	CActLED			m_ActLED;
-	CKernelOptions		m_Options;
-	CDeviceNameService	m_DeviceNameService;
-	CScreenDevice		m_Screen;
-	CSerialDevice		m_Serial;
-	CExceptionHandler	m_ExceptionHandler;
-	CInterruptSystem	m_Interrupt;
-	CTimer			m_Timer;
-	CLogger			m_Logger;
-	CGPIOManager		m_GPIOManager;	
-	CSoftSerialDevice	m_SoftSerial;
-	CEMMCDevice		m_EMMC;
-	CFATFileSystem		m_FileSystem;
-	unsigned int buffer[10];
+	CParallel m_Parallel;
+	CSusanFilter m_Filter;
+
+#ifdef GOLD_DIGEST
+	CGoldDigest m_GoldDigest;
+#endif
 };
 
 #endif
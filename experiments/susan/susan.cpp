@@ -0,0 +1,661 @@
+//
+// susan.cpp
+//
+#include "susan.h"
+#include <assert.h>
+
+#if defined (__aarch64__)
+	#include <arm_neon.h>
+#endif
+
+static const struct
+{
+	int dx;
+	int dy;
+}
+s_Mask[SUSAN_MASK_POINTS] =		// the circular mask of MiBench in its order
+{
+			{-1, -3}, {0, -3}, {1, -3},
+		{-2, -2}, {-1, -2}, {0, -2}, {1, -2}, {2, -2},
+	{-3, -1}, {-2, -1}, {-1, -1}, {0, -1}, {1, -1}, {2, -1}, {3, -1},
+	{-3,  0}, {-2,  0}, {-1,  0},          {1,  0}, {2,  0}, {3,  0},
+	{-3,  1}, {-2,  1}, {-1,  1}, {0,  1}, {1,  1}, {2,  1}, {3,  1},
+		{-2,  2}, {-1,  2}, {0,  2}, {1,  2}, {2,  2},
+			{-1,  3}, {0,  3}, {1,  3}
+};
+
+#if defined (__aarch64__)
+
+struct TLookupTable			// 256 bytes in 16 registers
+{
+	uint8x16x4_t Part[4];
+};
+
+static inline void LoadTable (TLookupTable *pTable, const u8 *pData)
+{
+	for (unsigned i = 0; i < 4; i++)
+	{
+		for (unsigned j = 0; j < 4; j++)
+		{
+			pTable->Part[i].val[j] = vld1q_u8 (pData + i*64 + j*16);
+		}
+	}
+}
+
+// an index out of the range of a TBX leaves the result byte as it is
+static inline uint8x16_t Lookup (const TLookupTable &Table, uint8x16_t vIndex)
+{
+	const uint8x16_t v64 = vdupq_n_u8 (64);
+
+	uint8x16_t vResult = vqtbl4q_u8 (Table.Part[0], vIndex);
+	vIndex = vsubq_u8 (vIndex, v64);
+	vResult = vqtbx4q_u8 (vResult, Table.Part[1], vIndex);
+	vIndex = vsubq_u8 (vIndex, v64);
+	vResult = vqtbx4q_u8 (vResult, Table.Part[2], vIndex);
+	vIndex = vsubq_u8 (vIndex, v64);
+
+	return vqtbx4q_u8 (vResult, Table.Part[3], vIndex);
+}
+
+#endif
+
+CSusanFilter::CSusanFilter (CParallel *pParallel)
+:	m_pParallel (pParallel),
+	m_nWidth (0),
+	m_nHeight (0),
+	m_nEnlargedWidth (0),
+	m_pSmooth (0),
+	m_pEdges (0),
+	m_pCorners (0),
+	m_pIn (0),
+	m_pEnlarged (0),
+	m_pUSAN (0),
+	m_pCornerResponse (0),
+	m_nSmoothPoints (0)
+{
+}
+
+CSusanFilter::~CSusanFilter (void)
+{
+	delete [] m_pCornerResponse;
+	m_pCornerResponse = 0;
+
+	delete [] m_pUSAN;
+	m_pUSAN = 0;
+
+	delete [] m_pEnlarged;
+	m_pEnlarged = 0;
+
+	m_pParallel = 0;
+}
+
+boolean CSusanFilter::Initialize (unsigned nWidth, unsigned nHeight)
+{
+	assert (m_pEnlarged == 0);
+	assert (nWidth >= 16);
+	assert (nHeight >= 16);
+
+	m_nWidth = nWidth;
+	m_nHeight = nHeight;
+	m_nEnlargedWidth = nWidth + 2*SUSAN_SMOOTH_RADIUS;
+
+	m_pEnlarged = new u8[m_nEnlargedWidth * (nHeight + 2*SUSAN_SMOOTH_RADIUS)];
+	m_pUSAN = new u16[nWidth * nHeight];
+	m_pCornerResponse = new u16[nWidth * nHeight];
+	if (   m_pEnlarged == 0
+	    || m_pUSAN == 0
+	    || m_pCornerResponse == 0)
+	{
+		return FALSE;
+	}
+
+	SetupBrightness (m_Brightness, 6);
+	SetupBrightness (m_SmoothBrightness, 2);
+
+	for (unsigned i = 0; i < SUSAN_MASK_POINTS; i++)
+	{
+		m_MaskOffset[i] = s_Mask[i].dy * (int) nWidth + s_Mask[i].dx;
+	}
+
+	// the points with a weight of 0 do not contribute
+	m_nSmoothPoints = 0;
+	for (int y = -SUSAN_SMOOTH_RADIUS; y <= SUSAN_SMOOTH_RADIUS; y++)
+	{
+		for (int x = -SUSAN_SMOOTH_RADIUS; x <= SUSAN_SMOOTH_RADIUS; x++)
+		{
+			double fDistance = (double) (x*x + y*y)
+					 / (SUSAN_DISTANCE_THRESHOLD * SUSAN_DISTANCE_THRESHOLD);
+			u8 uchWeight = (u8) (100.0 * Exp (fDistance));
+			if (uchWeight != 0)
+			{
+				m_SmoothOffset[m_nSmoothPoints] = y * (int) m_nEnlargedWidth + x;
+				m_SmoothWeight[m_nSmoothPoints++] = uchWeight;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+void CSusanFilter::Process (u8 *pSmooth, u8 *pEdges, u8 *pCorners, const u8 *pIn)
+{
+	assert (m_pParallel != 0);
+	assert (m_pEnlarged != 0);
+	assert (pSmooth != 0);
+	assert (pEdges != 0);
+	assert (pCorners != 0);
+	assert (pIn != 0);
+
+	m_pSmooth = pSmooth;
+	m_pEdges = pEdges;
+	m_pCorners = pCorners;
+	m_pIn = pIn;
+
+	m_pParallel->Execute (ProcessStub, this);
+}
+
+void CSusanFilter::ProcessStub (unsigned nCore, void *pParam)
+{
+	CSusanFilter *pThis = (CSusanFilter *) pParam;
+	assert (pThis != 0);
+
+	// each pass needs the rows of the previous pass above and below the own band
+	CParallel *pParallel = pThis->m_pParallel;
+	pParallel->For (nCore, 0, pThis->m_nHeight + 2*SUSAN_SMOOTH_RADIUS, EnlargeRowStub, pThis);
+	pParallel->For (nCore, 0, pThis->m_nHeight, ResponseRowStub, pThis);
+	pParallel->For (nCore, 0, pThis->m_nHeight, CandidateRowStub, pThis);
+	pParallel->For (nCore, 0, pThis->m_nHeight, CornerRowStub, pThis);
+}
+
+void CSusanFilter::EnlargeRowStub (unsigned nRow, void *pParam)
+{
+	((CSusanFilter *) pParam)->EnlargeRow (nRow);
+}
+
+void CSusanFilter::ResponseRowStub (unsigned nRow, void *pParam)
+{
+	((CSusanFilter *) pParam)->ResponseRow (nRow);
+}
+
+void CSusanFilter::CandidateRowStub (unsigned nRow, void *pParam)
+{
+	((CSusanFilter *) pParam)->CandidateRow (nRow);
+}
+
+void CSusanFilter::CornerRowStub (unsigned nRow, void *pParam)
+{
+	((CSusanFilter *) pParam)->CornerRow (nRow);
+}
+
+void CSusanFilter::EnlargeRow (unsigned nRow)
+{
+	const int nBorder = SUSAN_SMOOTH_RADIUS;
+
+	// the border rows mirror the rows of the image as enlarge() of MiBench
+	int nSource = (int) nRow - nBorder;
+	if (nSource < 0)
+	{
+		nSource = -1 - nSource;
+	}
+	else if (nSource >= (int) m_nHeight)
+	{
+		nSource = 2*m_nHeight - 1 - nSource;
+	}
+	assert (0 <= nSource && nSource < (int) m_nHeight);
+
+	u8 *pTo = m_pEnlarged + nRow * m_nEnlargedWidth;
+	const u8 *pFrom = m_pIn + nSource * m_nWidth;
+	for (unsigned j = 0; j < m_nWidth; j++)
+	{
+		pTo[nBorder + j] = pFrom[j];
+	}
+
+	for (int i = 0; i < nBorder; i++)
+	{
+		pTo[nBorder - 1 - i] = pTo[nBorder + i];
+		pTo[m_nWidth + nBorder + i] = pTo[m_nWidth + nBorder - 1 - i];
+	}
+}
+
+void CSusanFilter::ResponseRow (unsigned nRow)
+{
+	SmoothRow (nRow);
+	USANRow (nRow);
+}
+
+void CSusanFilter::SmoothRow (unsigned nRow)
+{
+	const u8 *pCentre = m_pEnlarged + (nRow + SUSAN_SMOOTH_RADIUS) * m_nEnlargedWidth
+			  + SUSAN_SMOOTH_RADIUS;
+	u8 *pOut = m_pSmooth + nRow * m_nWidth;
+
+	unsigned j = 0;
+#if defined (__aarch64__)
+	TLookupTable Table;
+	LoadTable (&Table, m_SmoothBrightness);
+
+	for (; j + 16 <= m_nWidth; j += 16)
+	{
+		uint8x16_t vCentre = vld1q_u8 (pCentre + j);
+
+		uint32x4_t vArea0 = vdupq_n_u32 (0), vArea1 = vArea0, vArea2 = vArea0, vArea3 = vArea0;
+		uint32x4_t vTotal0 = vArea0, vTotal1 = vArea0, vTotal2 = vArea0, vTotal3 = vArea0;
+		for (unsigned k = 0; k < m_nSmoothPoints; k++)
+		{
+			uint8x16_t vPixel = vld1q_u8 (pCentre + j + m_SmoothOffset[k]);
+			uint8x16_t vBrightness = Lookup (Table, vabdq_u8 (vCentre, vPixel));
+
+			// weight <= 10000, area and total as in MiBench
+			uint8x16_t vDistance = vdupq_n_u8 (m_SmoothWeight[k]);
+			uint16x8_t vWeightLow = vmull_u8 (vget_low_u8 (vBrightness), vget_low_u8 (vDistance));
+			uint16x8_t vWeightHigh = vmull_high_u8 (vBrightness, vDistance);
+			uint16x8_t vPixelLow = vmovl_u8 (vget_low_u8 (vPixel));
+			uint16x8_t vPixelHigh = vmovl_high_u8 (vPixel);
+
+			vArea0 = vaddw_u16 (vArea0, vget_low_u16 (vWeightLow));
+			vArea1 = vaddw_high_u16 (vArea1, vWeightLow);
+			vArea2 = vaddw_u16 (vArea2, vget_low_u16 (vWeightHigh));
+			vArea3 = vaddw_high_u16 (vArea3, vWeightHigh);
+
+			vTotal0 = vmlal_u16 (vTotal0, vget_low_u16 (vWeightLow), vget_low_u16 (vPixelLow));
+			vTotal1 = vmlal_high_u16 (vTotal1, vWeightLow, vPixelLow);
+			vTotal2 = vmlal_u16 (vTotal2, vget_low_u16 (vWeightHigh), vget_low_u16 (vPixelHigh));
+			vTotal3 = vmlal_high_u16 (vTotal3, vWeightHigh, vPixelHigh);
+		}
+
+		u32 Area[16], Total[16];
+		vst1q_u32 (Area, vArea0);
+		vst1q_u32 (Area + 4, vArea1);
+		vst1q_u32 (Area + 8, vArea2);
+		vst1q_u32 (Area + 12, vArea3);
+		vst1q_u32 (Total, vTotal0);
+		vst1q_u32 (Total + 4, vTotal1);
+		vst1q_u32 (Total + 8, vTotal2);
+		vst1q_u32 (Total + 12, vTotal3);
+
+		for (unsigned i = 0; i < 16; i++)
+		{
+			// the centre alone has the weight 10000
+			u32 nArea = Area[i] - 10000;
+			pOut[j + i] =   nArea != 0
+				      ? (Total[i] - pCentre[j + i] * 10000) / nArea
+				      : Median (pCentre + j + i);
+		}
+	}
+#endif
+
+	for (; j < m_nWidth; j++)
+	{
+		unsigned nCentre = pCentre[j];
+
+		u32 nArea = 0;
+		u32 nTotal = 0;
+		for (unsigned k = 0; k < m_nSmoothPoints; k++)
+		{
+			unsigned nPixel = (pCentre + j)[m_SmoothOffset[k]];
+			unsigned nDiff = nCentre > nPixel ? nCentre - nPixel : nPixel - nCentre;
+			u32 nWeight = m_SmoothWeight[k] * m_SmoothBrightness[nDiff];
+
+			nArea += nWeight;
+			nTotal += nWeight * nPixel;
+		}
+
+		nArea -= 10000;
+		pOut[j] = nArea != 0 ? (nTotal - nCentre * 10000) / nArea : Median (pCentre + j);
+	}
+}
+
+void CSusanFilter::USANRow (unsigned nRow)
+{
+	u16 *pUSAN = m_pUSAN + nRow * m_nWidth;
+
+	const unsigned nFirst = SUSAN_MASK_RADIUS;
+	const unsigned nEnd = m_nWidth - SUSAN_MASK_RADIUS;
+	if (   nRow < SUSAN_MASK_RADIUS
+	    || nRow >= m_nHeight - SUSAN_MASK_RADIUS)
+	{
+		for (unsigned j = 0; j < m_nWidth; j++)
+		{
+			pUSAN[j] = SUSAN_USAN_NONE;
+		}
+
+		return;
+	}
+
+	for (unsigned j = 0; j < nFirst; j++)
+	{
+		pUSAN[j] = SUSAN_USAN_NONE;
+		pUSAN[nEnd + j] = SUSAN_USAN_NONE;
+	}
+
+	const u8 *pCentre = m_pIn + nRow * m_nWidth;
+
+	unsigned j = nFirst;
+#if defined (__aarch64__)
+	TLookupTable Table;
+	LoadTable (&Table, m_Brightness);
+
+	for (; j + 16 <= nEnd; j += 16)
+	{
+		uint8x16_t vCentre = vld1q_u8 (pCentre + j);
+
+		uint16x8_t vLow = vdupq_n_u16 (100);
+		uint16x8_t vHigh = vLow;
+		for (unsigned k = 0; k < SUSAN_MASK_POINTS; k++)
+		{
+			uint8x16_t vPixel = vld1q_u8 (pCentre + j + m_MaskOffset[k]);
+			uint8x16_t vBrightness = Lookup (Table, vabdq_u8 (vCentre, vPixel));
+
+			vLow = vaddw_u8 (vLow, vget_low_u8 (vBrightness));
+			vHigh = vaddw_high_u8 (vHigh, vBrightness);
+		}
+
+		vst1q_u16 (pUSAN + j, vLow);
+		vst1q_u16 (pUSAN + j + 8, vHigh);
+	}
+#endif
+
+	for (; j < nEnd; j++)
+	{
+		unsigned nCentre = pCentre[j];
+
+		unsigned n = 100;
+		for (unsigned k = 0; k < SUSAN_MASK_POINTS; k++)
+		{
+			unsigned nPixel = (pCentre + j)[m_MaskOffset[k]];
+
+			n += m_Brightness[nCentre > nPixel ? nCentre - nPixel : nPixel - nCentre];
+		}
+
+		pUSAN[j] = n;
+	}
+}
+
+void CSusanFilter::CandidateRow (unsigned nRow)
+{
+	u8 *pEdges = m_pEdges + nRow * m_nWidth;
+	u16 *pCornerResponse = m_pCornerResponse + nRow * m_nWidth;
+
+	for (unsigned j = 0; j < m_nWidth; j++)
+	{
+		pEdges[j] = 0;
+		pCornerResponse[j] = 0;
+	}
+
+	if (   nRow >= 4
+	    && nRow < m_nHeight - 4)
+	{
+		for (unsigned j = 4; j < m_nWidth - 4; j++)
+		{
+			if (GetEdgeResponse (nRow, j) > 0)
+			{
+				pEdges[j] = GetEdge (nRow, j);
+			}
+		}
+	}
+
+	if (   nRow >= 5
+	    && nRow < m_nHeight - 5)
+	{
+		for (unsigned j = 5; j < m_nWidth - 5; j++)
+		{
+			if (m_pUSAN[nRow * m_nWidth + j] < SUSAN_CORNER_MAX)
+			{
+				pCornerResponse[j] = GetCornerResponse (nRow, j);
+			}
+		}
+	}
+}
+
+u8 CSusanFilter::GetEdge (int i, int j) const
+{
+	int m = GetEdgeResponse (i, j);
+	int n = SUSAN_EDGE_MAX - m;
+
+	const u8 *pCentre = m_pIn + i*m_nWidth + j;
+	unsigned nCentre = *pCentre;
+
+	int a = 0, b = 0;
+	u8 uchType = 1;
+	boolean bSymmetry = TRUE;
+	if (n > 600)
+	{
+		// the centroid of the USAN is far away from the centre: the edge is across it
+		int x = 0, y = 0;
+		for (unsigned k = 0; k < SUSAN_MASK_POINTS; k++)
+		{
+			unsigned nPixel = pCentre[m_MaskOffset[k]];
+			int c = m_Brightness[nCentre > nPixel ? nCentre - nPixel : nPixel - nCentre];
+
+			x += s_Mask[k].dx * c;
+			y += s_Mask[k].dy * c;
+		}
+
+		// sqrt (x^2 + y^2) > 0.9 * n
+		if (100 * ((s64) x*x + (s64) y*y) > 81 * (s64) n*n)
+		{
+			bSymmetry = FALSE;
+
+			int ax = x < 0 ? -x : x;
+			int ay = y < 0 ? -y : y;
+			if (x != 0 && 2*ay < ax)	{ a = 0; b = 1; }	// vertical edge (|y/x| < 0.5)
+			else if (x == 0 || ay > 2*ax)	{ a = 1; b = 0; }	// horizontal edge (|y/x| > 2)
+			else if ((x < 0) == (y < 0))	{ a = 1; b = 1; }	// diagonal edges
+			else				{ a = -1; b = 1; }
+		}
+	}
+
+	if (bSymmetry)
+	{
+		// the second moments of the USAN give the orientation
+		int x = 0, y = 0, w = 0;
+		for (unsigned k = 0; k < SUSAN_MASK_POINTS; k++)
+		{
+			unsigned nPixel = pCentre[m_MaskOffset[k]];
+			int c = m_Brightness[nCentre > nPixel ? nCentre - nPixel : nPixel - nCentre];
+			int dx = s_Mask[k].dx;
+			int dy = s_Mask[k].dy;
+
+			x += dx*dx * c;
+			y += dy*dy * c;
+			w += dx*dy * c;
+		}
+
+		if (y != 0 && 2*x < y)		{ a = 0; b = 1; }	// x/y < 0.5
+		else if (y == 0 || x > 2*y)	{ a = 1; b = 0; }	// x/y > 2
+		else if (w > 0)			{ a = -1; b = 1; }
+		else				{ a = 1; b = 1; }
+
+		uchType = 2;
+	}
+
+	// non-maximum suppression across the edge
+	if (   m >  GetEdgeResponse (i + a, j + b)
+	    && m >= GetEdgeResponse (i - a, j - b)
+	    && m >  GetEdgeResponse (i + 2*a, j + 2*b)
+	    && m >= GetEdgeResponse (i - 2*a, j - 2*b))
+	{
+		return uchType;
+	}
+
+	return 0;
+}
+
+u16 CSusanFilter::GetCornerResponse (int i, int j) const
+{
+	int n = m_pUSAN[i*m_nWidth + j];
+
+	const u8 *pCentre = m_pIn + i*m_nWidth + j;
+	unsigned nCentre = *pCentre;
+
+	int x = 0, y = 0;
+	for (unsigned k = 0; k < SUSAN_MASK_POINTS; k++)
+	{
+		unsigned nPixel = pCentre[m_MaskOffset[k]];
+		int c = m_Brightness[nCentre > nPixel ? nCentre - nPixel : nPixel - nCentre];
+
+		x += s_Mask[k].dx * c;
+		y += s_Mask[k].dy * c;
+	}
+
+	// the centroid has to be away from the centre
+	if (x*x + y*y <= n*n / 2)
+	{
+		return 0;
+	}
+
+	// and the pixels in its direction have to be different from the centre
+	int nSum = 0;
+	int ax = x < 0 ? -x : x;
+	int ay = y < 0 ? -y : y;
+	for (int k = 1; k <= 3; k++)
+	{
+		int nRow, nColumn;
+		if (ay < ax)
+		{
+			nRow = i + RoundDiv (k*y, ax);
+			nColumn = j + (x < 0 ? -k : k);
+		}
+		else
+		{
+			nRow = i + (y < 0 ? -k : k);
+			nColumn = j + RoundDiv (k*x, ay);
+		}
+
+		unsigned nPixel = m_pIn[nRow*m_nWidth + nColumn];
+		nSum += m_Brightness[nCentre > nPixel ? nCentre - nPixel : nPixel - nCentre];
+	}
+
+	if (nSum <= 290)
+	{
+		return 0;
+	}
+
+	return SUSAN_CORNER_MAX - n;
+}
+
+void CSusanFilter::CornerRow (unsigned nRow)
+{
+	u8 *pCorners = m_pCorners + nRow * m_nWidth;
+
+	for (unsigned j = 0; j < m_nWidth; j++)
+	{
+		pCorners[j] = 0;
+	}
+
+	if (   nRow < 5
+	    || nRow >= m_nHeight - 5)
+	{
+		return;
+	}
+
+	// 7x7 local maximum, equal values before the centre (in raster order) suppress it
+	for (unsigned j = 5; j < m_nWidth - 5; j++)
+	{
+		const u16 *pCentre = m_pCornerResponse + nRow * m_nWidth + j;
+		unsigned nResponse = *pCentre;
+		if (nResponse == 0)
+		{
+			continue;
+		}
+
+		boolean bMaximum = TRUE;
+		for (int dy = -3; dy <= 3 && bMaximum; dy++)
+		{
+			for (int dx = -3; dx <= 3; dx++)
+			{
+				unsigned nOther = pCentre[dy * (int) m_nWidth + dx];
+				if (  (dy < 0 || (dy == 0 && dx < 0))
+				    ? nResponse <= nOther
+				    : nResponse < nOther)
+				{
+					bMaximum = FALSE;
+
+					break;
+				}
+			}
+		}
+
+		pCorners[j] = bMaximum;
+	}
+}
+
+u8 CSusanFilter::Median (const u8 *pCentre) const
+{
+	int w = m_nEnlargedWidth;
+	u8 p[8] = {pCentre[-w-1], pCentre[-w], pCentre[-w+1], pCentre[-1],
+		   pCentre[1], pCentre[w-1], pCentre[w], pCentre[w+1]};
+
+	for (unsigned k = 0; k < 7; k++)
+	{
+		for (unsigned l = 0; l < 7 - k; l++)
+		{
+			if (p[l] > p[l+1])
+			{
+				u8 uchTemp = p[l];
+				p[l] = p[l+1];
+				p[l+1] = uchTemp;
+			}
+		}
+	}
+
+	return (p[3] + p[4]) / 2;
+}
+
+void CSusanFilter::SetupBrightness (u8 *pTable, unsigned nPower)
+{
+	for (unsigned d = 0; d < 256; d++)
+	{
+		double x = (double) d / SUSAN_BRIGHTNESS_THRESHOLD;
+		x = x*x;
+		if (nPower == 6)
+		{
+			x = x*x*x;
+		}
+
+		pTable[d] = (u8) (100.0 * Exp (x));
+	}
+}
+
+double CSusanFilter::Exp (double x)
+{
+	assert (x >= 0.0);
+	if (x > 30.0)				// 100 * e^(-x) < 1
+	{
+		return 0.0;
+	}
+
+	// e^(-x) = e^(-x/2^n)^(2^n), the halving is exact
+	unsigned n = 0;
+	while (x > 1.0/16)
+	{
+		x *= 0.5;
+		n++;
+	}
+
+	// Taylor series
+	double p = __builtin_fma (-x, 1.0/3628800, 1.0/362880);
+	p = __builtin_fma (-x, p, 1.0/40320);
+	p = __builtin_fma (-x, p, 1.0/5040);
+	p = __builtin_fma (-x, p, 1.0/720);
+	p = __builtin_fma (-x, p, 1.0/120);
+	p = __builtin_fma (-x, p, 1.0/24);
+	p = __builtin_fma (-x, p, 1.0/6);
+	p = __builtin_fma (-x, p, 1.0/2);
+	p = __builtin_fma (-x, p, 1.0);
+	p = __builtin_fma (-x, p, 1.0);
+
+	while (n-- > 0)
+	{
+		p *= p;
+	}
+
+	return p;
+}
+
+int CSusanFilter::RoundDiv (int nNum, int nDen)
+{
+	assert (nDen > 0);
+
+	return nNum >= 0 ? (2*nNum + nDen) / (2*nDen) : -((-2*nNum + nDen) / (2*nDen));
+}
@@ -0,0 +1,131 @@
+//
+// susan.h
+//
+// SUSAN image processing of 8-bit grey images (S. M. Smith, after the MiBench
+// version): smoothing, edge and corner detection, free of Circle dependencies
+// (except CParallel), so that it can be built for the host too.
+//
+// The brightness similarity of two pixels is looked up in a table (indexed by
+// the absolute difference), the circular mask of 37 pixels and the distance
+// weights of the smoothing mask are precomputed. The USAN area of each pixel
+// and the smoothing sums are computed for 16 pixels of a row at once with
+// NEON (table lookups with TBL), the few edge and corner candidates are
+// examined with scalar code. The cores work on bands of rows with a barrier
+// between the passes.
+//
+// Differences to MiBench: The comparisons, which MiBench does in float
+// (direction of the edges, sqrt (x^2+y^2) > 0.9*n, FTOI() of the corner
+// test), are done with exact integer arithmetic. The look-up tables are
+// computed with a fixed polynomial instead of exp(). The smoothing sums are
+// integers. So the result is the same on all machines and with NEON.
+// The edges are only thinned by the non-maximum suppression of
+// susan_edges(). The post-processing with susan_thin() (-t of MiBench) is not
+// done, it works sequentially on the changed edge image.
+//
+// Output (one byte per pixel): smoothed image, edge image (1: edge found with
+// the centroid, 2: edge found with the symmetry of the USAN, 0: none) and
+// corner image (1: corner, 0: none).
+//
+#ifndef _susan_h
+#define _susan_h
+
+#include <parallel.h>
+#include <circle/types.h>
+
+#define SUSAN_BRIGHTNESS_THRESHOLD	20	// bt of MiBench
+#define SUSAN_DISTANCE_THRESHOLD	4	// dt of MiBench (smoothing)
+#define SUSAN_SMOOTH_RADIUS		((int) (1.5 * SUSAN_DISTANCE_THRESHOLD) + 1)
+#define SUSAN_SMOOTH_SIZE		(2*SUSAN_SMOOTH_RADIUS + 1)
+
+#define SUSAN_EDGE_MAX			2650	// geometric thresholds (max_no)
+#define SUSAN_CORNER_MAX		1850
+
+#define SUSAN_MASK_POINTS		36	// circular mask without the centre
+#define SUSAN_MASK_RADIUS		3
+
+#define SUSAN_USAN_NONE			0xFFFF	// USAN area not computed (border)
+
+class CSusanFilter
+{
+public:
+	CSusanFilter (CParallel *pParallel);
+	~CSusanFilter (void);
+
+	/// \brief Allocates the buffers and computes the look-up tables
+	/// \param nWidth Image width in pixels (>= 16)
+	/// \param nHeight Image height in pixels (>= 16)
+	boolean Initialize (unsigned nWidth, unsigned nHeight);
+
+	/// \brief Process the image pIn (all cores)
+	/// \param pSmooth, pEdges, pCorners Output images of the same size as pIn
+	void Process (u8 *pSmooth, u8 *pEdges, u8 *pCorners, const u8 *pIn);
+
+private:
+	static void ProcessStub (unsigned nCore, void *pParam);
+
+	static void EnlargeRowStub (unsigned nRow, void *pParam);
+	static void ResponseRowStub (unsigned nRow, void *pParam);
+	static void CandidateRowStub (unsigned nRow, void *pParam);
+	static void CornerRowStub (unsigned nRow, void *pParam);
+
+	/// \brief Copies a row of the input with mirrored borders to m_pEnlarged
+	void EnlargeRow (unsigned nRow);
+
+	/// \brief Smoothing and USAN area of a row
+	void ResponseRow (unsigned nRow);
+	void SmoothRow (unsigned nRow);
+	void USANRow (unsigned nRow);
+
+	/// \brief Non-maximum suppression of the edges and corner test of a row
+	void CandidateRow (unsigned nRow);
+	u8 GetEdge (int i, int j) const;
+	u16 GetCornerResponse (int i, int j) const;
+
+	/// \brief Non-maximum suppression of the corner response of a row
+	void CornerRow (unsigned nRow);
+
+	u8 Median (const u8 *pCentre) const;
+
+	int GetEdgeResponse (int i, int j) const
+	{
+		unsigned nUSAN = m_pUSAN[i*m_nWidth + j];
+
+		return nUSAN <= SUSAN_EDGE_MAX ? SUSAN_EDGE_MAX - nUSAN : 0;
+	}
+
+	/// \brief Builds a table of 100 * e^(-(d/bt)^nPower), d = 0 .. 255
+	static void SetupBrightness (u8 *pTable, unsigned nPower);
+
+	/// \return e^(-x) for x >= 0, computed with a fixed operation order
+	static double Exp (double x);
+
+	/// \return nNum / nDen rounded half away from zero (nDen > 0)
+	static int RoundDiv (int nNum, int nDen);
+
+private:
+	CParallel *m_pParallel;
+
+	unsigned m_nWidth;
+	unsigned m_nHeight;
+	unsigned m_nEnlargedWidth;
+
+	u8 *m_pSmooth;
+	u8 *m_pEdges;
+	u8 *m_pCorners;
+	const u8 *m_pIn;
+
+	u8 *m_pEnlarged;		// input with a mirrored border of SUSAN_SMOOTH_RADIUS
+	u16 *m_pUSAN;			// 100 + similarity of the mask pixels
+	u16 *m_pCornerResponse;		// SUSAN_CORNER_MAX - USAN area of the corner candidates
+
+	u8 m_Brightness[256];		// edges and corners: 100 * e^(-(d/bt)^6)
+	u8 m_SmoothBrightness[256];	// smoothing: 100 * e^(-(d/bt)^2)
+
+	int m_MaskOffset[SUSAN_MASK_POINTS];	// in m_pIn
+
+	int m_SmoothOffset[SUSAN_SMOOTH_SIZE * SUSAN_SMOOTH_SIZE];	// in m_pEnlarged
+	u8 m_SmoothWeight[SUSAN_SMOOTH_SIZE * SUSAN_SMOOTH_SIZE];	// 100 * e^(-r^2/dt^2)
+	unsigned m_nSmoothPoints;				// with a weight != 0
+};
+
+#endif
@@ -0,0 +1,216 @@
+//
+// taskpool.cpp
+//
+#include "taskpool.h"
+#include <circle/atomic.h>
+#include <circle/synchronize.h>
+
+CTaskPool::CTaskPool (CParallel *pParallel)
+:	m_pParallel (pParallel),
+	m_pFunction (0),
+	m_pParam (0),
+	m_nFirst (0),
+	m_nGrain (1),
+	m_nRemaining (0)
+{
+	for (unsigned i = 0; i < PARALLEL_CORES; i++)
+	{
+		m_Deques[i].nTop = 0;
+		m_Deques[i].nBottom = 0;
+	}
+}
+
+CTaskPool::~CTaskPool (void)
+{
+	m_pParallel = 0;
+}
+
+void CTaskPool::For (unsigned nFirst, unsigned nEnd, unsigned nGrain,
+		     TTaskRangeFunction *pFunction, void *pParam)
+{
+	assert (m_pParallel != 0);
+	assert (nFirst <= nEnd);
+	assert (nEnd - nFirst <= 0x7FFFFFFFU);
+	assert (nGrain > 0);
+	assert (pFunction != 0);
+
+	if (nFirst == nEnd)
+	{
+		return;
+	}
+
+	m_pFunction = pFunction;
+	m_pParam = pParam;
+	m_nFirst = nFirst;
+	m_nGrain = nGrain;
+
+	// the secondary cores are idle, the deques can be set up without synchronization
+	for (unsigned i = 0; i < PARALLEL_CORES; i++)
+	{
+		m_Deques[i].nTop = 0;
+		m_Deques[i].nBottom = 0;
+	}
+
+	TRange Range = {nFirst, nEnd};
+	m_Deques[0].Ranges[0] = Range;
+	m_Deques[0].nBottom = 1;
+
+	AtomicSet (&m_nRemaining, (int) (nEnd - nFirst));
+
+	m_pParallel->Execute (WorkStub, this);
+
+	assert (AtomicGet (&m_nRemaining) == 0);
+}
+
+void CTaskPool::WorkStub (unsigned nCore, void *pParam)
+{
+	CTaskPool *pThis = (CTaskPool *) pParam;
+	assert (pThis != 0);
+
+	pThis->Work (nCore);
+}
+
+void CTaskPool::Work (unsigned nCore)
+{
+	assert (nCore < PARALLEL_CORES);
+
+	while (AtomicGet (&m_nRemaining) > 0)
+	{
+		TRange Range;
+		if (Take (nCore, &Range))
+		{
+			Run (nCore, Range);
+
+			continue;
+		}
+
+		boolean bStolen = FALSE;
+		for (unsigned i = 1; i < PARALLEL_CORES && !bStolen; i++)
+		{
+			bStolen = Steal ((nCore + i) % PARALLEL_CORES, &Range);
+		}
+
+		if (bStolen)
+		{
+			Run (nCore, Range);
+
+			continue;
+		}
+
+#ifdef PARALLEL_MULTI_CORE
+		// a Push() or the completion after the test above sets the event register,
+		// so that WFE returns immediately
+		WaitForEvent ();
+#endif
+	}
+}
+
+void CTaskPool::Run (unsigned nCore, TRange Range)
+{
+	// split at the chunk boundaries, push the upper half for the other cores
+	unsigned nChunks;
+	while ((nChunks = (Range.nEnd - Range.nFirst + m_nGrain-1) / m_nGrain) > 1)
+	{
+		unsigned nMiddle = Range.nFirst + nChunks/2 * m_nGrain;
+
+		TRange Upper = {nMiddle, Range.nEnd};
+		if (!Push (nCore, Upper))
+		{
+			break;			// deque is full, process the whole range
+		}
+
+		Range.nEnd = nMiddle;
+	}
+
+	assert (m_pFunction != 0);
+	for (unsigned nFirst = Range.nFirst; nFirst < Range.nEnd; nFirst += m_nGrain)
+	{
+		unsigned nEnd = Range.nEnd - nFirst > m_nGrain ? nFirst + m_nGrain : Range.nEnd;
+
+		(*m_pFunction) (nFirst, nEnd, nCore, m_pParam);
+	}
+
+	if (AtomicSub (&m_nRemaining, (int) (Range.nEnd - Range.nFirst)) == 0)
+	{
+#ifdef PARALLEL_MULTI_CORE
+		DataSyncBarrier ();
+		SendEvent ();			// wake the waiting cores to leave Work()
+#endif
+	}
+}
+
+// The atomic operations are sequentially consistent, the owner is the only
+// one who writes nBottom. The range read by Steal() is valid only if the
+// compare-and-swap of nTop succeeds.
+
+boolean CTaskPool::Push (unsigned nCore, const TRange &Range)
+{
+	TDeque *pDeque = &m_Deques[nCore];
+
+	int nBottom = pDeque->nBottom;
+	if (nBottom - AtomicGet (&pDeque->nTop) >= TASKPOOL_DEQUE_SIZE)
+	{
+		return FALSE;
+	}
+
+	pDeque->Ranges[nBottom % TASKPOOL_DEQUE_SIZE] = Range;
+	AtomicSet (&pDeque->nBottom, nBottom+1);
+
+#ifdef PARALLEL_MULTI_CORE
+	DataSyncBarrier ();
+	SendEvent ();
+#endif
+
+	return TRUE;
+}
+
+boolean CTaskPool::Take (unsigned nCore, TRange *pRange)
+{
+	TDeque *pDeque = &m_Deques[nCore];
+
+	// reserve the bottom range before looking at the thieves
+	int nBottom = pDeque->nBottom - 1;
+	AtomicSet (&pDeque->nBottom, nBottom);
+
+	int nTop = AtomicGet (&pDeque->nTop);
+	if (nTop > nBottom)
+	{
+		AtomicSet (&pDeque->nBottom, nBottom+1);	// empty
+
+		return FALSE;
+	}
+
+	*pRange = pDeque->Ranges[nBottom % TASKPOOL_DEQUE_SIZE];
+	if (nTop < nBottom)
+	{
+		return TRUE;
+	}
+
+	// the last range, a thief may take it at the same time
+	boolean bTaken = AtomicCompareExchange (&pDeque->nTop, nTop, nTop+1) == nTop;
+	AtomicSet (&pDeque->nBottom, nBottom+1);
+
+	return bTaken;
+}
+
+boolean CTaskPool::Steal (unsigned nVictim, TRange *pRange)
+{
+	TDeque *pDeque = &m_Deques[nVictim];
+
+	int nTop = AtomicGet (&pDeque->nTop);
+	int nBottom = AtomicGet (&pDeque->nBottom);
+	if (nTop >= nBottom)
+	{
+		return FALSE;
+	}
+
+	TRange Range = pDeque->Ranges[nTop % TASKPOOL_DEQUE_SIZE];
+	if (AtomicCompareExchange (&pDeque->nTop, nTop, nTop+1) != nTop)
+	{
+		return FALSE;				// taken by the owner or another thief
+	}
+
+	*pRange = Range;
+
+	return TRUE;
+}
@@ -0,0 +1,152 @@
+//
+// taskpool.h
+//
+// Work-stealing task pool on the cores of CParallel, for loops with an
+// uneven amount of work per index. Each core owns a deque of index ranges
+// (Chase-Lev): the owner pushes and takes ranges at the bottom, the other
+// cores steal the oldest (largest) ranges from the top with a
+// compare-and-swap. A core splits its range in halves and pushes the upper
+// half, until the range is not larger than the grain size. Cores, which find
+// nothing to steal, wait with WFE and are woken with SEV, when a range is
+// pushed or the loop is complete, so they do not heat up the SoC.
+//
+// ParallelReduce() computes one partial result per grain-sized chunk and
+// combines them in the order of the chunks, so that the result does not
+// depend on which core has processed which chunk.
+//
+#ifndef _taskpool_h
+#define _taskpool_h
+
+#include <parallel.h>
+#include <circle/macros.h>
+#include <circle/types.h>
+#include <assert.h>
+
+#define TASKPOOL_DEQUE_SIZE	64		// ranges, the halving of 2^32 indices needs 32
+
+/// \param nFirst, nEnd Chunk of the indices (at most the grain size)
+/// \param nCore Number of the calling core
+typedef void TTaskRangeFunction (unsigned nFirst, unsigned nEnd, unsigned nCore, void *pParam);
+
+class CTaskPool
+{
+public:
+	CTaskPool (CParallel *pParallel);
+	~CTaskPool (void);
+
+	/// \brief Call pFunction for the chunks of nFirst .. nEnd-1 on all cores
+	/// \param nGrain Size of the chunks (the last chunk may be smaller)
+	/// \note Must be called on core 0, not from CParallel::Execute().
+	void For (unsigned nFirst, unsigned nEnd, unsigned nGrain,
+		  TTaskRangeFunction *pFunction, void *pParam);
+
+	/// \brief Call Function (i) for i = nFirst .. nEnd-1 on all cores
+	/// \param Function Function object with void operator() (unsigned)
+	template <class TFunction>
+	void ParallelFor (unsigned nFirst, unsigned nEnd, unsigned nGrain, TFunction &Function)
+	{
+		For (nFirst, nEnd, nGrain, ForStub<TFunction>, &Function);
+	}
+
+	/// \brief Reduce nFirst .. nEnd-1 with Combine (... Combine (Identity, Map (chunk 0)), ...)
+	/// \param Map Function object with T operator() (unsigned nFirst, unsigned nEnd) for a chunk
+	/// \param Combine Function object with T operator() (const T &, const T &)
+	template <class T, class TMap, class TCombine>
+	T ParallelReduce (unsigned nFirst, unsigned nEnd, unsigned nGrain, const T &Identity,
+			  TMap &Map, TCombine &Combine)
+	{
+		assert (nFirst <= nEnd);
+		assert (nGrain > 0);
+
+		TReduce<T, TMap> Reduce;
+		Reduce.pMap = &Map;
+		Reduce.nFirst = nFirst;
+		Reduce.nGrain = nGrain;
+
+		unsigned nChunks = (nEnd - nFirst + nGrain-1) / nGrain;
+		Reduce.pPartial = new T[nChunks];
+		assert (Reduce.pPartial != 0);
+
+		For (nFirst, nEnd, nGrain, ReduceStub<T, TMap>, &Reduce);
+
+		T Result = Identity;
+		for (unsigned i = 0; i < nChunks; i++)
+		{
+			Result = Combine (Result, Reduce.pPartial[i]);
+		}
+
+		delete [] Reduce.pPartial;
+
+		return Result;
+	}
+
+private:
+	struct TRange
+	{
+		unsigned nFirst;
+		unsigned nEnd;
+	};
+
+	struct TDeque			// owned by one core
+	{
+		volatile int nTop;	// stealing end
+		volatile int nBottom;	// owner end
+		TRange Ranges[TASKPOOL_DEQUE_SIZE];
+	}
+	ALIGN (64);
+
+	static void WorkStub (unsigned nCore, void *pParam);
+	void Work (unsigned nCore);
+
+	/// \brief Split Range down to the grain size and call the function for the chunks
+	void Run (unsigned nCore, TRange Range);
+
+	boolean Push (unsigned nCore, const TRange &Range);
+	boolean Take (unsigned nCore, TRange *pRange);
+	boolean Steal (unsigned nVictim, TRange *pRange);
+
+	template <class TFunction>
+	static void ForStub (unsigned nFirst, unsigned nEnd, unsigned /* nCore */, void *pParam)
+	{
+		TFunction *pFunction = (TFunction *) pParam;
+		assert (pFunction != 0);
+
+		for (unsigned i = nFirst; i < nEnd; i++)
+		{
+			(*pFunction) (i);
+		}
+	}
+
+	template <class T, class TMap>
+	struct TReduce
+	{
+		TMap *pMap;
+		T *pPartial;		// one result per chunk
+		unsigned nFirst;
+		unsigned nGrain;
+	};
+
+	template <class T, class TMap>
+	static void ReduceStub (unsigned nFirst, unsigned nEnd, unsigned /* nCore */, void *pParam)
+	{
+		TReduce<T, TMap> *pReduce = (TReduce<T, TMap> *) pParam;
+		assert (pReduce != 0);
+
+		pReduce->pPartial[(nFirst - pReduce->nFirst) / pReduce->nGrain] =
+			(*pReduce->pMap) (nFirst, nEnd);
+	}
+
+private:
+	CParallel *m_pParallel;
+
+	TTaskRangeFunction *m_pFunction;
+	void *m_pParam;
+	unsigned m_nFirst;		// the chunks start at m_nFirst + k * m_nGrain
+	unsigned m_nGrain;
+
+	volatile int m_nRemaining;	// indices, which have not been processed yet
+
+	TDeque m_Deques[PARALLEL_CORES];
+};
+
+#endif
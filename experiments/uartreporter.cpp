@@ -0,0 +1,141 @@
+//
+// uartreporter.cpp
+//
+#include "uartreporter.h"
+#include <circle/bcm2835.h>
+#include <circle/memio.h>
+#include <circle/synchronize.h>
+#include <circle/new.h>
+#include <assert.h>
+
+#define UART0_DMACR		(ARM_UART0_BASE + 0x48)
+	#define DMACR_TXDMAE		(1 << 1)
+
+#define RING_MASK		(UART_REPORTER_RING_SIZE-1)
+
+CUARTReporter::CUARTReporter (CInterruptSystem *pInterruptSystem)
+:	m_DMA (DMA_CHANNEL_LITE, pInterruptSystem),
+	m_pRing (0),
+	m_nInPtr (0),
+	m_nOutPtr (0),
+	m_nTransferLength (0),
+	m_nOverflows (0)
+{
+}
+
+CUARTReporter::~CUARTReporter (void)
+{
+	Flush ();
+
+	PeripheralEntry ();
+	write32 (UART0_DMACR, 0);
+	PeripheralExit ();
+
+	delete [] m_pRing;
+	m_pRing = 0;
+}
+
+boolean CUARTReporter::Initialize (void)
+{
+	m_pRing = new (HEAP_DMA30) u32[UART_REPORTER_RING_SIZE];
+	if (m_pRing == 0)
+	{
+		return FALSE;
+	}
+
+	m_DMA.SetCompletionRoutine (DMACompletionStub, this);
+
+	PeripheralEntry ();
+	write32 (UART0_DMACR, DMACR_TXDMAE);
+	PeripheralExit ();
+
+	return TRUE;
+}
+
+int CUARTReporter::Write (const void *pBuffer, unsigned nCount)
+{
+	assert (pBuffer != 0);
+	assert (m_pRing != 0);
+	const u8 *pFrom = (const u8 *) pBuffer;
+
+	m_SpinLock.Acquire ();
+
+	unsigned nFree = UART_REPORTER_RING_SIZE - (m_nInPtr - m_nOutPtr);
+	if (nCount > nFree)
+	{
+		m_nOverflows++;
+
+		m_SpinLock.Release ();
+
+		return 0;
+	}
+
+	unsigned nInPtr = m_nInPtr;
+	for (unsigned i = 0; i < nCount; i++)
+	{
+		m_pRing[nInPtr++ & RING_MASK] = pFrom[i];
+	}
+	m_nInPtr = nInPtr;
+
+	if (m_nTransferLength == 0)
+	{
+		StartTransfer ();
+	}
+
+	m_SpinLock.Release ();
+
+	return nCount;
+}
+
+void CUARTReporter::Flush (void)
+{
+	while (m_nInPtr != m_nOutPtr)
+	{
+		// wait for DMA
+	}
+}
+
+void CUARTReporter::StartTransfer (void)
+{
+	assert (m_nTransferLength == 0);
+
+	unsigned nLength = m_nInPtr - m_nOutPtr;
+	if (nLength == 0)
+	{
+		return;
+	}
+
+	// transfer up to the end of the ring, the rest follows on completion
+	unsigned nOffset = m_nOutPtr & RING_MASK;
+	if (nLength > UART_REPORTER_RING_SIZE - nOffset)
+	{
+		nLength = UART_REPORTER_RING_SIZE - nOffset;
+	}
+
+	m_nTransferLength = nLength;
+
+	m_DMA.SetupIOWrite (ARM_UART0_DR, &m_pRing[nOffset], nLength * sizeof (u32),
+			    DREQSourceUARTTX);
+	m_DMA.Start ();
+}
+
+void CUARTReporter::DMACompletionRoutine (boolean bStatus)
+{
+	m_SpinLock.Acquire ();
+
+	// on error the bytes are lost, but the ring keeps running
+	m_nOutPtr += m_nTransferLength;
+	m_nTransferLength = 0;
+
+	StartTransfer ();
+
+	m_SpinLock.Release ();
+}
+
+void CUARTReporter::DMACompletionStub (unsigned nChannel, boolean bStatus, void *pParam)
+{
+	CUARTReporter *pThis = (CUARTReporter *) pParam;
+	assert (pThis != 0);
+
+	pThis->DMACompletionRoutine (bStatus);
+}
@@ -0,0 +1,65 @@
+//
+// uartreporter.h
+//
+// Asynchronous transmitter for the report records of the experiments.
+// Uses the PL011 UART0 (TXD on GPIO 14), which must have been initialized
+// by CSerialDevice before, and feeds its TX FIFO from a ring buffer via DMA
+// (DREQ paced). Write() only copies into the ring and returns immediately.
+//
+// The reporter must be the only writer of the UART0. CSerialDevice must not
+// be written afterwards and must not be the target of the CLogger, otherwise
+// its text would be mixed into the records.
+//
+// The legacy DMA engine writes at least 32 bits per transfer and the UART
+// sends the low byte of each write to its data register. Therefore every
+// byte occupies one 32-bit word in the ring.
+//
+#ifndef _uartreporter_h
+#define _uartreporter_h
+
+#include <circle/dmachannel.h>
+#include <circle/interrupt.h>
+#include <circle/spinlock.h>
+#include <circle/types.h>
+
+#define UART_REPORTER_RING_SIZE		4096		// bytes, must be a power of 2
+
+class CUARTReporter
+{
+public:
+	CUARTReporter (CInterruptSystem *pInterruptSystem);
+	~CUARTReporter (void);
+
+	boolean Initialize (void);
+
+	/// \brief Queue a record for transmission, does not wait
+	/// \return nCount, or 0 if the record did not fit into the ring and was dropped
+	/// \note Records are never split, a dropped record is counted as overflow.
+	int Write (const void *pBuffer, unsigned nCount);
+
+	/// \brief Wait until all queued bytes have been sent
+	void Flush (void);
+
+	/// \return Number of dropped records since Initialize()
+	unsigned GetOverflows (void) const		{ return m_nOverflows; }
+
+private:
+	void StartTransfer (void);			// spin lock must be held
+
+	void DMACompletionRoutine (boolean bStatus);
+	static void DMACompletionStub (unsigned nChannel, boolean bStatus, void *pParam);
+
+private:
+	CDMAChannel m_DMA;
+
+	u32 *m_pRing;					// one word per byte
+	volatile unsigned m_nInPtr;
+	volatile unsigned m_nOutPtr;
+	volatile unsigned m_nTransferLength;		// bytes in flight, 0 if DMA idle
+
+	volatile unsigned m_nOverflows;
+
+	CSpinLock m_SpinLock;
+};
+
+#endif
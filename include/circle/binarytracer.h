@@ -0,0 +1,231 @@
+//
+// binarytracer.h
+//
+// Lock-free event tracer with one trace buffer per core. The records are
+// time-stamped with the ARM generic timer (CNTVCT) and are written as a
+// binary stream to a device (e.g. serial) or a memory buffer (e.g. to be
+// saved to a file). The host tool experiments/host/trace2json converts
+// this stream into the Chrome trace event format (chrome://tracing,
+// https://ui.perfetto.dev).
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#ifndef _circle_binarytracer_h
+#define _circle_binarytracer_h
+
+#include <circle/macros.h>
+#include <circle/sysconfig.h>
+#include <circle/types.h>
+
+#ifdef ARM_ALLOW_MULTI_CORE
+	#include <circle/multicore.h>
+
+	#define TRACE_CORES		CORES
+#else
+	#define TRACE_CORES		1
+#endif
+
+#define TRACE_MAX_EVENTS	256		// event IDs 0..TRACE_MAX_EVENTS-1
+
+// system event IDs, recorded with TRACE_SYSTEM_EVENTS defined in sysconfig.h
+#define TRACE_EVENT_IRQ		1		// param: IRQ number
+#define TRACE_EVENT_TASK_SWITCH	2		// param: address of the next task (low word)
+#define TRACE_EVENT_FAT_READ	3		// param: number of bytes
+#define TRACE_EVENT_NET_PROCESS	4
+#define TRACE_EVENT_USER	32		// first event ID for applications
+
+enum TTraceRecordType
+{
+	TraceRecordEnter,			// begin of a scope
+	TraceRecordExit,			// end of a scope
+	TraceRecordInstant,			// single point in time
+	TraceRecordCounter,			// param is a counter value
+	TraceRecordUnknown
+};
+
+struct TTraceRecord			// 16 bytes
+{
+	u64	nTimestamp;			// CNTVCT
+	u16	nEvent;
+	u8	nType;				// TTraceRecordType
+	u8	nCore;
+	u32	nParam;
+};
+
+// Binary stream (all values little endian):
+//	TTraceStreamHeader
+//	nNames x (u16 nEvent, u16 nLength, char Name[nLength])
+//	nCores x (u32 nCore, u32 nRecords, TTraceRecord Record[nRecords])
+// Records of one core are in write order, which is not strictly in time
+// order, if an IRQ has interrupted the writing of a record.
+struct TTraceStreamHeader
+{
+	u32	nMagic;
+#define TRACE_STREAM_MAGIC	0x43525443	// "CTRC"
+	u16	nVersion;
+#define TRACE_STREAM_VERSION	1
+	u16	nRecordSize;			// sizeof (TTraceRecord)
+	u32	nFrequency;			// of the timestamps in Hz
+	u32	nCores;
+	u32	nNames;
+}
+PACKED;
+
+class CDevice;
+
+class CBinaryTracer	/// Lock-free per-core event tracer with binary output
+{
+public:
+	/// \param nDepth Number of records per core (will be rounded up to a power of 2)
+	/// \param bStopIfFull Stop recording on a core, if its buffer is full (otherwise overwrite)
+	CBinaryTracer (unsigned nDepth, boolean bStopIfFull = FALSE);
+
+	~CBinaryTracer (void);
+
+	/// \brief Clears the buffers and starts recording on all cores
+	void Start (void);
+	/// \brief Stops recording on all cores
+	void Stop (void);
+
+	/// \param nEvent Event ID (< TRACE_MAX_EVENTS)
+	/// \param pName Event name, shown by the trace viewer (must remain valid)
+	void SetEventName (unsigned nEvent, const char *pName);
+
+	/// \brief Write all records as binary stream to a device
+	/// \param pDevice Device to be written (e.g. CSerialDevice with SERIAL_OPTION_ONLCR cleared)
+	/// \return Operation successful?
+	/// \note Stops recording. Must be called on TASK_LEVEL.
+	boolean Dump (CDevice *pDevice);
+
+	/// \return Size of the binary stream in bytes (for Dump() to a memory buffer)
+	size_t GetDumpSize (void) const;
+	/// \brief Write all records as binary stream to a memory buffer
+	/// \param pBuffer Destination buffer (e.g. to be written to a file afterwards)
+	/// \param nSize Size of the buffer
+	/// \return Number of bytes written, 0 if the buffer is too small
+	/// \note Stops recording.
+	size_t Dump (void *pBuffer, size_t nSize);
+
+	/// \return Number of records, which have been overwritten or dropped on a core
+	unsigned GetLostRecords (unsigned nCore) const;
+
+	/// \brief Write a record on the current core
+	/// \note Can be called from any execution level and is reentrant.
+	static void Record (unsigned nEvent, TTraceRecordType Type, u32 nParam = 0)
+	{
+		CBinaryTracer *pThis = s_pThis;
+		if (   pThis != 0
+		    && pThis->m_bActive)
+		{
+			pThis->Write (nEvent, Type, nParam);
+		}
+	}
+
+	static CBinaryTracer *Get (void);
+
+	/// \return Current timestamp (CNTVCT)
+	static u64 GetTimestamp (void)
+	{
+#if AARCH == 64
+		u64 nCNTVCT;
+		asm volatile ("mrs %0, CNTVCT_EL0" : "=r" (nCNTVCT));
+
+		return nCNTVCT;
+#elif RASPPI >= 2
+		u32 nCNTVCTLow, nCNTVCTHigh;
+		asm volatile ("mrrc p15, 1, %0, %1, c14" : "=r" (nCNTVCTLow), "=r" (nCNTVCTHigh));
+
+		return (u64) nCNTVCTHigh << 32 | nCNTVCTLow;
+#else
+		return GetSystemTimer ();	// no generic timer on ARMv6
+#endif
+	}
+
+	/// \return Frequency of the timestamps in Hz
+	static u32 GetFrequency (void);
+
+private:
+	void Write (unsigned nEvent, TTraceRecordType Type, u32 nParam);
+
+	typedef boolean TOutputFunction (const void *pData, size_t nLength, void *pParam);
+	boolean Output (TOutputFunction *pOutput, void *pParam);
+	static boolean DeviceOutput (const void *pData, size_t nLength, void *pParam);
+	static boolean BufferOutput (const void *pData, size_t nLength, void *pParam);
+
+	unsigned GetRecordCount (unsigned nCore) const;
+
+#if AARCH == 32 && RASPPI == 1
+	static u64 GetSystemTimer (void);
+#endif
+
+private:
+	unsigned m_nDepth;
+	unsigned m_nMask;
+	boolean m_bStopIfFull;
+	volatile boolean m_bActive;
+
+	struct TCoreBuffer
+	{
+		TTraceRecord	*pRecord;
+		u32		 nWritten;		// total number of reserved records
+		u8		 Padding[64 - sizeof (TTraceRecord *) - sizeof (u32)];
+	}
+	ALIGN (64);
+
+	TCoreBuffer m_Core[TRACE_CORES];		// one cache line each, no line is shared
+
+	const char *m_pEventName[TRACE_MAX_EVENTS];
+
+	static CBinaryTracer *s_pThis;
+};
+
+class CTraceScope	/// Records the enter and exit of a C++ scope
+{
+public:
+	CTraceScope (unsigned nEvent, u32 nParam = 0)
+	:	m_nEvent (nEvent)
+	{
+		CBinaryTracer::Record (nEvent, TraceRecordEnter, nParam);
+	}
+
+	~CTraceScope (void)
+	{
+		CBinaryTracer::Record (m_nEvent, TraceRecordExit);
+	}
+
+private:
+	unsigned m_nEvent;
+};
+
+#define TRACE_CONCAT2(a, b)		a##b
+#define TRACE_CONCAT(a, b)		TRACE_CONCAT2 (a, b)
+
+#define TRACE_SCOPE(event, param)	CTraceScope TRACE_CONCAT (TraceScope, __LINE__) (event, param)
+#define TRACE_ENTER(event, param)	CBinaryTracer::Record (event, TraceRecordEnter, param)
+#define TRACE_EXIT(event)		CBinaryTracer::Record (event, TraceRecordExit)
+#define TRACE_EVENT(event, param)	CBinaryTracer::Record (event, TraceRecordInstant, param)
+#define TRACE_COUNTER(event, value)	CBinaryTracer::Record (event, TraceRecordCounter, value)
+
+// used in the library for the system events
+#ifdef TRACE_SYSTEM_EVENTS
+	#define TRACE_SYSTEM_SCOPE(event, param)	TRACE_SCOPE (event, param)
+	#define TRACE_SYSTEM_EVENT(event, param)	TRACE_EVENT (event, param)
+#else
+	#define TRACE_SYSTEM_SCOPE(event, param)
+	#define TRACE_SYSTEM_EVENT(event, param)
+#endif
+
+#endif
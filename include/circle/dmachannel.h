@@ -72,7 +72,20 @@ public:
 	boolean Wait (void);		// for synchronous call without completion routine
 	boolean GetStatus (void);
 
+	// start a chain of control blocks, which are linked with nNextControlBlockAddress,
+	// 32-byte aligned in DMA-able memory and written back from the data cache,
+	// TI_INTEN should be set in the last control block to call the completion routine,
+	// cache maintenance of the data buffers has to be done by the caller
+	// (this method is not supported with DMA_CHANNEL_EXTENDED)
+	void StartChain (TDMAControlBlock *pFirstControlBlock);
+	// a DMA error stops a chain without an interrupt, if the current control block
+	// does not have TI_INTEN set, this has to be polled then, while a chain is running,
+	// returns TRUE and resets the channel, if the chain has been stopped this way
+	boolean CheckChainError (void);
+
 private:
+	void StartControlBlock (TDMAControlBlock *pControlBlock);
+
 	void InterruptHandler (void);
 	static void InterruptStub (void *pParam);
 
@@ -90,6 +90,9 @@ typedef void TDMACompletionRoutine (unsigned nChannel, boolean bStatus, void *pP
 #define ARM_DMACHAN_NEXTCONBK(chan)	(ARM_DMA_BASE + ((chan) * 0x100) + 0x1C)
 #define ARM_DMACHAN_DEBUG(chan)		(ARM_DMA_BASE + ((chan) * 0x100) + 0x20)
 	#define DEBUG_LITE			(1 << 28)
+	#define DEBUG_READ_ERROR		(1 << 2)
+	#define DEBUG_FIFO_ERROR		(1 << 1)
+	#define DEBUG_READ_LAST_NOT_SET_ERROR	(1 << 0)
 #define ARM_DMA_INT_STATUS		(ARM_DMA_BASE + 0xFE0)
 #define ARM_DMA_ENABLE			(ARM_DMA_BASE + 0xFF0)
 
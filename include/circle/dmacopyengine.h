@@ -0,0 +1,153 @@
+//
+// dmacopyengine.h
+//
+// Asynchronous memory copy service on top of the legacy DMA channels. Copy
+// requests are queued as chains of control blocks on the channels, large
+// requests are split over all channels. Each request returns a handle, which
+// can be polled or waited on. Small copies and buffers, which are not
+// DMA-able, are done by the CPU immediately.
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#ifndef _circle_dmacopyengine_h
+#define _circle_dmacopyengine_h
+
+#include <circle/dmachannel.h>
+#include <circle/interrupt.h>
+#include <circle/spinlock.h>
+#include <circle/types.h>
+
+#define DMA_COPY_MAX_CHANNELS	4
+#define DMA_COPY_MAX_REQUESTS	64		// in flight, status is kept until slot is reused
+#define DMA_COPY_MAX_BLOCKS	64		// control blocks
+#define DMA_COPY_CPU_THRESHOLD	4096		// smaller copies are done by the CPU
+#define DMA_COPY_SPLIT_SIZE	0x40000		// min. size of a part of a split request
+
+typedef u32 TDMACopyHandle;
+#define DMA_COPY_HANDLE_DONE	0		// returned, if the copy has already been done
+
+class CDMACopyEngine	/// Asynchronous memory copy with DMA
+{
+public:
+	/// \param pInterruptSystem Pointer to the interrupt system object
+	CDMACopyEngine (CInterruptSystem *pInterruptSystem);
+
+	~CDMACopyEngine (void);
+
+	/// \brief Allocates the DMA channels and the control blocks
+	/// \param nChannels Number of DMA channels to be used (<= DMA_COPY_MAX_CHANNELS)
+	/// \return FALSE, if no DMA channel is available (all copies done by CPU then)
+	/// \note Less channels than requested may be allocated, see GetChannelCount().
+	boolean Initialize (unsigned nChannels = 2);
+
+	/// \brief Queue a copy request
+	/// \param pDestination Destination buffer, must not be accessed until completion
+	/// \param pSource Source buffer, must not be modified until completion
+	/// \param nLength Number of bytes to be copied
+	/// \return Handle of the request or DMA_COPY_HANDLE_DONE
+	/// \note Does the cache maintenance of both buffers. The bytes in the first and last\n
+	///	  cache line of the destination, which may be shared with other data, are\n
+	///	  copied by the CPU before return, the DMA controller copies the rest.
+	/// \note Falls back to memcpy(), if nLength is smaller than DMA_COPY_CPU_THRESHOLD,
+	///	  a buffer is not DMA-able or all request slots or control blocks are in use.
+	TDMACopyHandle Copy (void *pDestination, const void *pSource, size_t nLength);
+
+	/// \param hCopy Handle returned by Copy()
+	/// \return TRUE, if the request has been completed
+	boolean IsComplete (TDMACopyHandle hCopy);
+
+	/// \brief Wait for the completion of a request
+	/// \param hCopy Handle returned by Copy()
+	/// \return FALSE, if a DMA error occurred
+	/// \note Must be called with IRQs enabled.
+	/// \note Polls the channels for a DMA error, which stops a chain without interrupt.
+	boolean Wait (TDMACopyHandle hCopy);
+
+	/// \brief Wait for the completion of all queued requests
+	/// \return FALSE, if a DMA error occurred since the last call
+	/// \note Polls the channels for a DMA error like Wait().
+	boolean WaitAll (void);
+
+	unsigned GetChannelCount (void) const		{ return m_nChannels; }
+
+	/// \return Number of requests, which have been done by the CPU
+	unsigned GetCPUCopies (void) const		{ return m_nCPUCopies; }
+
+private:
+	boolean IsDMAable (const void *pBuffer, size_t nLength) const;
+
+	unsigned AllocateRequest (void);		// returns DMA_COPY_MAX_REQUESTS on failure
+	unsigned AllocateBlock (void);			// returns DMA_COPY_MAX_BLOCKS on failure
+
+	void QueueBlock (unsigned nChannel, unsigned nBlock);
+	void StartChain (unsigned nChannel);		// if channel is idle
+
+	void PollErrors (void);
+
+	void CompleteChain (unsigned nChannel, boolean bStatus);	// spin lock held
+	void CompletionHandler (unsigned nChannel, boolean bStatus);
+	static void CompletionStub (unsigned nChannel, boolean bStatus, void *pParam);
+
+private:
+	CInterruptSystem *m_pInterruptSystem;
+
+	struct TChannel
+	{
+		CDMAChannel	*pChannel;
+		CDMACopyEngine	*pThis;
+		unsigned	 nIndex;
+		unsigned	 nPendingHead;		// blocks waiting for the next chain
+		unsigned	 nPendingTail;
+		unsigned	 nActiveHead;		// chain in progress
+		size_t		 nQueuedBytes;		// pending and active
+	};
+
+	TChannel m_Channel[DMA_COPY_MAX_CHANNELS];
+	unsigned m_nChannels;
+
+	struct TRequest
+	{
+		volatile boolean bComplete;
+		boolean		 bStatus;
+		unsigned	 nGeneration;		// is incremented on each allocation
+		unsigned	 nPendingBlocks;
+		uintptr		 nDestination;
+		size_t		 nLength;
+	};
+
+	TRequest m_Request[DMA_COPY_MAX_REQUESTS];
+	unsigned m_nNextRequest;			// slot to be tried first
+
+	u8 *m_pControlBlockBuffer;
+	TDMAControlBlock *m_pControlBlock;		// DMA_COPY_MAX_BLOCKS entries
+
+	struct TBlock
+	{
+		unsigned	nRequest;
+		unsigned	nNext;			// next in free list, pending list or chain
+		size_t		nLength;
+	};
+
+	TBlock m_Block[DMA_COPY_MAX_BLOCKS];
+	unsigned m_nFreeBlock;				// head of free list
+
+	boolean m_bErrors;				// since last WaitAll()
+	unsigned m_nCPUCopies;				// protected by m_SpinLock
+
+	CSpinLock m_SpinLock;
+};
+
+#endif
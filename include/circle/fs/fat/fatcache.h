@@ -100,6 +100,16 @@ public:
 	 */
 	void MarkDirty (TFATBuffer *pBuffer);
 
+	/*
+	 * Read consecutive sectors directly into a buffer, bypassing the cache
+	 *
+	 * Params:  nSector	First sector number
+	 *	    nCount	Number of sectors
+	 *	    pBuffer	Destination buffer (nCount * FAT_SECTOR_SIZE bytes)
+	 * Returns: Nonzero on success
+	 */
+	int ReadSectors (unsigned nSector, unsigned nCount, void *pBuffer);
+
 private:
 	void MoveBufferFirst (TFATBuffer *pBuffer);
 	void MoveBufferLast (TFATBuffer *pBuffer);
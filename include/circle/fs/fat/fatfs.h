@@ -37,13 +37,15 @@ struct TFile
 	unsigned	 nSize;
 	unsigned	 nOffset;		/* current position */
 	unsigned	 nCluster;		/* current cluster */
-	unsigned	 nFirstCluster;		/* first cluster in chain, for write only */
+	unsigned	 nFirstCluster;		/* first cluster in chain */
 	TFATBuffer	*pBuffer;		/* current buffer if available */
 	boolean		 bWrite;		/* open for write */
 };
 
 #define FILE(handle)	m_Files[handle-1]
 
+#define FAT_MAX_SECTOR_RUN	0x4000		// sectors per direct read (8 MB)
+
 class CFATFileSystem
 {
 public:
@@ -133,6 +135,16 @@ public:
 	*/
 	unsigned FileRead (unsigned hFile, void *pBuffer, unsigned nCount);
 
+	/*
+	* Set position of file opened for read
+	*
+	* Params:  hFile	File handle
+	*	    nOffset	New position (<= file size)
+	* Returns: != 0	Success
+	*	    0		Failure
+	*/
+	unsigned FileSeek (unsigned hFile, unsigned nOffset);
+
 	/*
 	* Write to file sequentially
 	*
@@ -154,6 +166,11 @@ public:
 	*/
 	int FileDelete (const char *pTitle);
 
+private:
+	// read up to nSectors consecutive sectors from the current (sector aligned) position,
+	// returns the number of sectors read (0 on error), the position is not updated
+	unsigned ReadSectorRun (TFile *pFile, void *pBuffer, unsigned nSectors);
+
 private:
 	CFATCache	m_Cache;
 	CFATInfo	m_FATInfo;
@@ -20,6 +20,7 @@
 #ifndef _circle_heapallocator_h
 #define _circle_heapallocator_h
 
+#include <circle/memorymap.h>
 #include <circle/spinlock.h>
 #include <circle/synchronize.h>
 #include <circle/sysconfig.h>
@@ -36,6 +37,16 @@ ASSERT_STATIC (DATA_CACHE_LINE_LENGTH_MAX >= 16);
 
 #define HEAP_BLOCK_MAX_BUCKETS	20
 
+#define HEAP_MAGAZINE_SIZE	16		// max. free blocks per core and bucket
+#define HEAP_MAGAZINE_MAX_SIZE	0x4000		// buckets up to this size have magazines
+#define HEAP_MAGAZINE_BUCKETS	8		// max. number of buckets with magazines
+
+#ifdef ARM_ALLOW_MULTI_CORE
+	#define HEAP_CORES	CORES
+#else
+	#define HEAP_CORES	1
+#endif
+
 struct THeapBlockHeader
 {
 	u32			 nMagic;
@@ -53,13 +64,33 @@ PACKED;
 struct THeapBlockBucket
 {
 	u32			 nSize;
-#ifdef HEAP_DEBUG
-	unsigned		 nCount;
-	unsigned		 nMaxCount;
-#endif
+	unsigned		 nFreeCount;		// blocks on pFreeList
 	THeapBlockHeader	*pFreeList;
 };
 
+struct THeapBucketStats
+{
+	size_t		nSize;			// block size (0 for large blocks)
+	unsigned long	nAllocations;		// total number of allocated blocks
+	unsigned long	nFrees;			// total number of freed blocks
+	unsigned	nFreeBlocks;		// currently on the free lists (incl. magazines)
+};
+
+struct THeapStats
+{
+	unsigned		nBuckets;
+	THeapBucketStats	Bucket[HEAP_BLOCK_MAX_BUCKETS];
+	THeapBucketStats	Large;		// blocks bigger than the largest bucket size
+	size_t			nLargeFreeBytes;	// on the free list of large blocks
+	size_t			nFreeSpace;		// see GetFreeSpace()
+};
+
+/// \note Freed blocks of the small buckets are kept in a magazine (a short free list) of\n
+///	  the calling core, so that most allocations do not need the global spin lock.\n
+///	  Blocks, which are bigger than the largest bucket size, are kept on a free list\n
+///	  sorted by address, where adjacent blocks are merged. A free large block at the\n
+///	  end of the allocated area is returned to the free space.
+
 class CHeapAllocator	/// Allocates blocks from a flat memory region
 {
 public:
@@ -90,20 +121,56 @@ public:
 	void *ReAllocate (void *pBlock, size_t nSize);
 
 	/// \param pBlock Memory block to be freed
-	/// \note Memory space of blocks, which are bigger than the largest bucket size,\n
-	///	  cannot be returned to a free list and is lost.
 	void Free (void *pBlock);
 
+	/// \param pStats Receives the counters of all buckets
+	/// \note The counters of the other cores may be slightly out of date.
+	void GetStats (THeapStats *pStats);
+
 #ifdef HEAP_DEBUG
 	void DumpStatus (void);
 #endif
 
+private:
+	void *AllocateLarge (size_t nSize);
+	void FreeLarge (THeapBlockHeader *pBlockHeader);
+
+	// returns 0, if the memory region is full
+	THeapBlockHeader *AllocateFromRegion (size_t nSize);	// with m_SpinLock acquired
+
+	// with m_SpinLock acquired and IRQs disabled
+	void RefillMagazine (unsigned nCore, unsigned nBucket);
+	void FlushMagazine (unsigned nCore, unsigned nBucket);
+
+	void OutOfMemory (void);
+
+	static unsigned GetCoreNumber (void);
+
 private:
 	const char	*m_pHeapName;
 	u8		*m_pNext;
 	u8		*m_pLimit;
 	size_t	 	 m_nReserve;
 	THeapBlockBucket m_Bucket[HEAP_BLOCK_MAX_BUCKETS+1];
+	unsigned	 m_nBuckets;
+	unsigned	 m_nMagazineBuckets;	// the first buckets have magazines
+
+	THeapBlockHeader *m_pLargeFreeList;	// sorted by address
+	unsigned	 m_nLargeFreeCount;
+	size_t		 m_nLargeFreeBytes;
+
+	struct TCoreCache			// accessed by its core only, with IRQs disabled
+	{
+		THeapBlockHeader *pMagazine[HEAP_MAGAZINE_BUCKETS];
+		unsigned	  nMagazineCount[HEAP_MAGAZINE_BUCKETS];
+
+		unsigned long	  nAllocations[HEAP_BLOCK_MAX_BUCKETS+1];	// the last for large
+		unsigned long	  nFrees[HEAP_BLOCK_MAX_BUCKETS+1];
+	}
+	CACHE_ALIGN;
+
+	TCoreCache	 m_CoreCache[HEAP_CORES];
+
 	CSpinLock	 m_SpinLock;
 
 	static u32 s_nBucketSize[];
@@ -53,6 +53,8 @@ public:
 #if RASPPI >= 4
 	static void InitializeSecondary (void);
 
+	static void RouteIRQ (unsigned nIRQ, unsigned nCore);	// SPI to core (default core 0)
+
 	static void SendIPI (unsigned nCore, unsigned nIPI);
 
 	static void CallSecureMonitor (u32 nFunction, u32 nParam);
@@ -22,9 +22,28 @@
 
 #include <circle/interrupt.h>
 #include <circle/spinlock.h>
+#include <circle/sysconfig.h>
 #include <circle/types.h>
 
-/// \note CLatencyTester blocks the system timer 1, which is used by the class CUserTimer too.
+#ifdef ARM_ALLOW_MULTI_CORE
+	#define LATENCY_CORES		CORES
+#else
+	#define LATENCY_CORES		1
+#endif
+
+#define LATENCY_ALL_CORES		LATENCY_CORES
+
+// log-linear histogram of the latency in nanoseconds: values below
+// LATENCY_SUB_BUCKETS have one bucket each, each following power of two
+// range is divided into LATENCY_SUB_BUCKETS buckets (max. error 6.25%)
+#define LATENCY_SUB_BUCKETS_SHIFT	4
+#define LATENCY_SUB_BUCKETS		(1 << LATENCY_SUB_BUCKETS_SHIFT)
+#define LATENCY_BUCKETS			((32 - LATENCY_SUB_BUCKETS_SHIFT + 1) * LATENCY_SUB_BUCKETS)
+
+/// \note On the Raspberry Pi 2-4 CLatencyTester uses the virtual timer (CNTV)\n
+///	  of the ARM generic timer of each measured core, which is not used otherwise.
+/// \note On the Raspberry Pi 1 CLatencyTester blocks the system timer 1, which is\n
+///	  used by the class CUserTimer too.
 
 class CLatencyTester		/// Measures the IRQ latency of the running code
 {
@@ -32,12 +51,18 @@ public:
 	CLatencyTester (CInterruptSystem *pInterruptSystem);
 	~CLatencyTester (void);
 
-	/// \brief Start measurement
+	/// \brief Start measurement on this core
 	/// \param nSampleRateHZ Sample rate in Hz
+	/// \note Can be called on each core (from CMultiCoreSupport::Run()), while the\n
+	///	  workload to be measured is running there or on other cores.
 	void Start (unsigned nSampleRateHZ);
-	/// \brief Stop measurement
+	/// \brief Stop measurement on this core
 	void Stop (void);
 
+	/// \brief Clear the results of all cores, a running measurement continues
+	/// \note Can be used to measure the same system in different load situations.
+	void Clear (void);
+
 	/// \return Minimum IRQ latency in microseconds
 	unsigned GetMin (void) const;
 	/// \return Maximum IRQ latency in microseconds
@@ -45,25 +70,59 @@ public:
 	/// \return Average IRQ latency in microseconds
 	unsigned GetAvg (void);
 
+	/// \param nCore Core number or LATENCY_ALL_CORES
+	/// \return Number of samples taken
+	unsigned GetSamples (unsigned nCore = LATENCY_ALL_CORES) const;
+
+	/// \param nPermyriad Percentile in 1/100 percent (e.g. 9990 for p99.9, 10000 for the maximum)
+	/// \param nCore Core number or LATENCY_ALL_CORES
+	/// \return IRQ latency in nanoseconds, which is not exceeded by this share of the samples
+	/// \note The result is the upper limit of the histogram bucket (max. 6.25% above).
+	unsigned GetPercentile (unsigned nPermyriad, unsigned nCore = LATENCY_ALL_CORES) const;
+
+	/// \param pBuckets Array of LATENCY_BUCKETS entries, receives the sample counts
+	/// \param nCore Core number or LATENCY_ALL_CORES
+	void GetHistogram (unsigned *pBuckets, unsigned nCore = LATENCY_ALL_CORES) const;
+	/// \return Upper limit of a histogram bucket in nanoseconds (inclusive)
+	static unsigned GetBucketLimit (unsigned nBucket);
+
 	/// \brief Dump results to logger
-	void Dump (void);
+	/// \param bHistogram Dump the non-empty histogram buckets too
+	void Dump (boolean bHistogram = FALSE);
 
 private:
+	struct TCoreData;
+
+	void ClearCore (TCoreData *pCore);
+	void DumpCore (unsigned nCore, boolean bHistogram);
+
 	void InterruptHandler (void);
 	static void InterruptStub (void *pParam);
 
+	static unsigned GetBucket (unsigned nLatency);
+
 private:
 	CInterruptSystem *m_pInterruptSystem;
 
-	boolean m_bRunning;
-	unsigned m_nWantedDelay;
+	u32 m_nFrequency;				// of the timer in Hz
+	u64 m_nLatencyScale;				// see constructor
+	unsigned m_nRunningCores;
+
+	struct TCoreData
+	{
+		boolean		 bRunning;
+		volatile boolean bClear;		// request from Clear()
+		u64		 nInterval;		// timer ticks
+		u64		 nCompare;		// timer ticks
 
-	unsigned m_nMinDelay;
-	unsigned m_nMaxDelay;
+		unsigned	 nMinLatency;		// nanoseconds
+		unsigned	 nMaxLatency;
+		u64		 nLatencySum;
+		unsigned	 nSamples;
+		unsigned	 Histogram[LATENCY_BUCKETS];
+	};
 
-	unsigned m_nDelayAccu;
-	unsigned m_nSamples;
-	boolean  m_bOverflow;
+	TCoreData m_Core[LATENCY_CORES];
 
 	CSpinLock m_SpinLock;
 };
@@ -142,9 +142,31 @@ public:
 #endif
 	}
 
+	/// \param nType HEAP_LOW or HEAP_HIGH
+	/// \return FALSE, if the heap is not available
+	static boolean GetHeapStats (THeapStats *pStats, int nType)
+	{
+		switch (nType)
+		{
+		case HEAP_LOW:	s_pThis->m_HeapLow.GetStats (pStats);	return TRUE;
+#if RASPPI >= 4
+		case HEAP_HIGH: s_pThis->m_HeapHigh.GetStats (pStats);	return TRUE;
+#endif
+		default:	return FALSE;
+		}
+	}
+
 	static void *PageAllocate (void)	{ return s_pThis->m_Pager.Allocate (); }
 	static void PageFree (void *pPage)	{ s_pThis->m_Pager.Free (pPage); }
 
+	/// \return Contiguous block of at least nSize bytes, aligned to its size (0 on failure)
+	/// \note Free the block with PageFree().
+	/// \note Is not used by Circle itself yet, it is there for applications.
+	static void *PageAllocateBlock (size_t nSize)
+	{
+		return s_pThis->m_Pager.AllocateBlock (nSize);
+	}
+
 	static void DumpStatus (void)
 	{
 #ifdef HEAP_DEBUG
@@ -164,6 +186,9 @@ private:
 
 private:
 	boolean m_bEnableMMU;
+#if AARCH == 64
+	boolean m_bEnableECC;			// for EnableMMU() on the secondary cores
+#endif
 	size_t m_nMemSize;
 	size_t m_nMemSizeHigh;
 
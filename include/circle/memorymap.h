@@ -42,7 +42,9 @@
 #define KERNEL_STACK_SIZE	0x20000				// all sizes must be a multiple of 16K
 #define EXCEPTION_STACK_SIZE	0x8000
 #define PAGE_TABLE1_SIZE	0x4000
-#define PAGE_RESERVE		(4 * MEGABYTE)
+#ifndef PAGE_RESERVE
+#define PAGE_RESERVE		(4 * MEGABYTE)		// can be increased for large page blocks
+#endif
 
 #define MEM_KERNEL_START	0x8000
 #define MEM_KERNEL_END		(MEM_KERNEL_START + KERNEL_MAX_SIZE)
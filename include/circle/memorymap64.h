@@ -43,7 +43,9 @@
 
 #define KERNEL_STACK_SIZE	0x20000
 #define EXCEPTION_STACK_SIZE	0x8000
-#define PAGE_RESERVE		(16 * MEGABYTE)
+#ifndef PAGE_RESERVE
+#define PAGE_RESERVE		(16 * MEGABYTE)		// can be increased for large page blocks
+#endif
 
 #define MEM_KERNEL_START	0x80000					// main code starts here
 #define MEM_KERNEL_END		(MEM_KERNEL_START + KERNEL_MAX_SIZE)
@@ -21,19 +21,42 @@
 #define _circle_pageallocator_h
 
 #include <circle/sysconfig.h>
+#include <circle/memorymap.h>
 #include <circle/spinlock.h>
+#include <circle/synchronize.h>
 #include <circle/macros.h>
 #include <circle/types.h>
 
 //#define PAGE_DEBUG
 
+#define PAGE_MAX_ORDER		13		// blocks of up to PAGE_SIZE << 13 (AArch64: 512 MB)
+
+#define PAGE_CACHE_SIZE		8		// max. free single pages per core
+
+#ifdef ARM_ALLOW_MULTI_CORE
+	#define PAGE_CORES	CORES
+#else
+	#define PAGE_CORES	1
+#endif
+
 struct TFreePage
 {
 	u32		 nMagic;
 #define FREEPAGE_MAGIC	0x50474D43
+	u32		 nOrder;
+	TFreePage	*pPrev;
 	TFreePage	*pNext;
 };
 
+/// \note This is a buddy allocator. A block of order n has a size of PAGE_SIZE << n and\n
+///	  is aligned to its size. With the 64 KB granule on AArch64 a 2 MB block can be\n
+///	  mapped with 32 level 3 descriptors with the contiguous hint and a 512 MB block\n
+///	  with a single level 2 block descriptor (see lib/translationtable64.cpp). Nothing\n
+///	  maps or allocates such blocks yet (see CMemorySystem::PageAllocateBlock()).\n
+///	  Freed blocks are merged with their free buddies.\n
+///	  Single pages are cached per core, so that they can be allocated and freed\n
+///	  without the spin lock most of the time.
+
 class CPageAllocator	/// Allocates aligned pages from a flat memory region
 {
 public:
@@ -42,31 +65,75 @@ public:
 
 	/// \param nBase Base address of memory region
 	/// \param nSize Size of memory region
+	/// \note The first pages of the region are used for the page map.
 	void Setup (uintptr nBase, size_t nSize) NOOPT;
 
 	/// \return Free space of the memory region, which is not allocated by pages
-	/// \note Unused pages on the free list do not count here.
+	/// \note Pages in the per-core caches do not count here.
 	size_t GetFreeSpace (void) const;
 
 	/// \return Pointer to a page with a size of PAGE_SIZE
 	/// \note Resulting page is always aligned to PAGE_SIZE
+	/// \note The system panics, if no page is available.
 	void *Allocate (void);
 
-	/// \param pPage Memory page to be freed
+	/// \param nOrder Order of the block (0 .. PAGE_MAX_ORDER)
+	/// \return Pointer to a contiguous block of PAGE_SIZE << nOrder bytes (0 if not available)
+	/// \note Resulting block is always aligned to its size
+	void *AllocateOrder (unsigned nOrder);
+
+	/// \param nSize Size of the block in bytes (is rounded up to PAGE_SIZE << n)
+	/// \return Pointer to a contiguous block aligned to its size (0 if not available)
+	void *AllocateBlock (size_t nSize);
+
+	/// \param pPage Memory page or block to be freed
 	void Free (void *pPage);
 
+	/// \return Order of the smallest block, which is not smaller than nSize
+	static unsigned GetOrder (size_t nSize);
+
 #ifdef PAGE_DEBUG
 	void DumpStatus (void);
 #endif
 
 private:
-	u8		*m_pNext;
-	u8		*m_pLimit;
+	void *AllocateOrderLocked (unsigned nOrder);	// with m_SpinLock acquired
+	void FreeLocked (void *pPage);
+
+	void AddFree (uintptr nBlock, unsigned nOrder);
+	void RemoveFree (TFreePage *pFreePage, unsigned nOrder);
+
+	void DrainCache (void);			// with IRQs disabled, for this core
+
+	unsigned GetPageIndex (uintptr nAddress) const
+	{
+		return (nAddress - m_nBase) / PAGE_SIZE;
+	}
+
+	static unsigned GetCoreNumber (void);
+
+private:
+	uintptr		 m_nBase;		// of the managed pages
+	uintptr		 m_nLimit;
+	u8		*m_pPageMap;		// per page: order of the block, which starts here
+#define PAGE_MAP_NONE		0xFF		// not the first page of a block
+#define PAGE_MAP_FREE		0x80		// set for free blocks
+	size_t		 m_nFreeSpace;
 #ifdef PAGE_DEBUG
 	unsigned	 m_nCount;
 	unsigned	 m_nMaxCount;
 #endif
-	TFreePage	*m_pFreeList;
+	TFreePage	*m_pFreeList[PAGE_MAX_ORDER+1];
+
+	struct TCoreCache			// accessed by its core only, with IRQs disabled
+	{
+		TFreePage	*pList;
+		unsigned	 nCount;
+	}
+	CACHE_ALIGN;
+
+	TCoreCache	 m_CoreCache[PAGE_CORES];
+
 	CSpinLock	 m_SpinLock;
 };
 
@@ -0,0 +1,128 @@
+//
+// perfcounters.h
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#ifndef _circle_perfcounters_h
+#define _circle_perfcounters_h
+
+#include <circle/interrupt.h>
+#include <circle/types.h>
+
+#if AARCH == 32
+	#error CPerfCounters is available for AArch64 only
+#endif
+
+enum TPerfEvent			// ARMv8 common event numbers
+{
+	PerfEventL1ICacheRefill		= 0x01,
+	PerfEventL1ITLBRefill		= 0x02,
+	PerfEventL1DCacheRefill		= 0x03,
+	PerfEventL1DCache		= 0x04,		// accesses
+	PerfEventL1DTLBRefill		= 0x05,
+	PerfEventInstRetired		= 0x08,
+	PerfEventBranchMispredicted	= 0x10,
+	PerfEventCPUCycles		= 0x11,
+	PerfEventMemAccess		= 0x13,
+	PerfEventL2DCache		= 0x16,		// accesses
+	PerfEventL2DCacheRefill		= 0x17,
+	PerfEventBusAccess		= 0x19,
+	PerfEventStallFrontend		= 0x23,		// ARMv8.1, check IsSupported()
+	PerfEventStallBackend		= 0x24,
+	PerfEventL2DTLBRefill		= 0x2D		// check IsSupported()
+};
+
+#define PERF_MAX_COUNTERS	6			// event counters of Cortex-A53/A72
+
+struct TPerfSample
+{
+	u64	nCycles;
+	u64	Count[PERF_MAX_COUNTERS];		// of the event counters
+};
+
+class CPerfCounters		/// Cycle counter and event counters of the PMU of one core
+{
+public:
+	/// \param pInterruptSystem For the overflow interrupt (RPi 4 only, 0 to poll the overflows)
+	/// \note Without interrupt GetCount() or Read() has to be called at least once per 2^31 events.
+	CPerfCounters (CInterruptSystem *pInterruptSystem = 0);
+	~CPerfCounters (void);
+
+	/// \brief Program the events, counter n counts pEvents[n]
+	/// \param nEvents Number of events (up to PERF_MAX_COUNTERS and GetCounters())
+	/// \return FALSE if the PMU has not enough event counters
+	/// \note Has to be called on the measured core, the other methods too.
+	boolean Initialize (const TPerfEvent *pEvents, unsigned nEvents);
+
+	/// \brief Clear the counts and start counting
+	void Start (void);
+	/// \brief Stop counting, the counts are kept
+	void Stop (void);
+	/// \brief Continue counting after Stop()
+	void Resume (void);
+
+	/// \brief Get all counts since Start()
+	void Read (TPerfSample *pSample);
+
+	u64 GetCycles (void) const;
+	/// \return 64-bit count of event counter nCounter since Start()
+	u64 GetCount (unsigned nCounter);
+
+	unsigned GetEvents (void) const			{ return m_nEvents; }
+	TPerfEvent GetEvent (unsigned nCounter) const;
+
+	/// \return Number of event counters implemented by the PMU
+	static unsigned GetCounters (void);
+	/// \return Is Event implemented by the PMU?
+	static boolean IsSupported (TPerfEvent Event);
+
+	static void ClearSample (TPerfSample *pSample);
+
+private:
+	void UpdateOverflows (void);
+
+	void InterruptHandler (void);
+	static void InterruptStub (void *pParam);
+
+	static u32 ReadCounter (unsigned nCounter);
+
+private:
+	CInterruptSystem *m_pInterruptSystem;
+	unsigned m_nIRQ;				// 0 if not connected
+	unsigned m_nCore;
+
+	TPerfEvent m_Events[PERF_MAX_COUNTERS];
+	unsigned m_nEvents;
+	u32 m_nEventMask;				// bits of the event counters in PMCNTENSET_EL0
+
+	u32 m_Overflows[PERF_MAX_COUNTERS];		// upper 32 bits of the event counts
+};
+
+class CPerfScope		/// Adds the counts of a code region to a sample
+{
+public:
+	/// \param pSum Sample, to which the counts of the region are added on destruction
+	CPerfScope (CPerfCounters *pCounters, TPerfSample *pSum);
+	~CPerfScope (void);
+
+private:
+	CPerfCounters *m_pCounters;
+	TPerfSample *m_pSum;
+
+	TPerfSample m_Start;
+};
+
+#endif
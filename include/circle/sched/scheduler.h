@@ -25,11 +25,29 @@
 #include <circle/sysconfig.h>
 #include <circle/types.h>
 
-typedef void TSchedulerTaskHandler (CTask *pTask);
+#ifdef ARM_ALLOW_MULTI_CORE
+	#include <circle/multicore.h>
 
-/// \note This scheduler uses the round-robin policy, without priorities.
+	#define SCHED_CORES	CORES
+#else
+	#define SCHED_CORES	1
+#endif
 
-class CScheduler /// Cooperative non-preemtive scheduler, which controls which task runs at a time
+typedef void TSchedulerTaskHandler (CTask *pTask);
+
+/// \note Each core has its own ready queues, one per priority level. The ready task with the\n
+///	  highest priority is selected with a bitmap of the non-empty queues, the tasks with\n
+///	  the same priority run round-robin. A task runs on the core, on which it has been\n
+///	  created, unless it is allowed to run on other cores with CTask::SetAffinity().\n
+///	  Idle cores take over ready tasks from other cores, which are allowed to run there.\n
+///	  Sleeping tasks and tasks blocked with timeout are woken by any core, which\n
+///	  calls Yield(), when their time has expired.
+/// \note The secondary cores have to call RunSecondary() to run tasks.
+/// \note Tasks are switched in Yield() and in the blocking calls only. With SetTimeSlice() the\n
+///	  timer marks a task, which has run for a time slice, so that it gives up the core on\n
+///	  the next call to PreemptionPoint().
+
+class CScheduler /// Cooperative scheduler with priorities and per-core ready queues
 {
 public:
 	CScheduler (void);
@@ -69,6 +87,31 @@ public:
 	///	   and starts any tasks that were created suspended.
 	void ResumeNewTasks (void);
 
+#ifdef ARM_ALLOW_MULTI_CORE
+	/// \brief Run the tasks of this secondary core, never returns
+	/// \note Has to be called from CMultiCoreSupport::Run() of the core.
+	void RunSecondary (void);
+#endif
+
+	/// \brief Enable time slicing
+	/// \param nTicks Length of a time slice in timer ticks (HZ), 0 to disable
+	void SetTimeSlice (unsigned nTicks);
+
+	/// \brief Switch to the next task, if the time slice of the current task has expired\n
+	///	   or a task with a higher priority has become ready on this core
+	/// \note This is cheap and can be called in the inner loops of longer calculations.
+	/// \note Does nothing on a core, which does not run scheduler tasks (has no current task,\n
+	///	  e.g. a secondary core, which has not called RunSecondary()).
+	void PreemptionPoint (void)
+	{
+		TCore *pCore = &m_Core[GetCoreNumber ()];
+		if (   pCore->bPreempt
+		    && pCore->pCurrent != 0)
+		{
+			Yield ();
+		}
+	}
+
 	/// \return Pointer to the only scheduler object in the system
 	static CScheduler *Get (void);
 
@@ -81,6 +124,9 @@ public:
 
 private:
 	void AddTask (CTask *pTask);
+	void StartTask (CTask *pTask);
+	void ChangeTask (CTask *pTask, unsigned nPriority, unsigned nAffinity);
+	void FinishTaskSwitch (void);		// called by the task, which gets control
 	friend class CTask;
 
 	boolean BlockTask (CTask **ppWaitListHead, unsigned nMicroSeconds);
@@ -88,21 +134,55 @@ private:
 	friend class CSynchronizationEvent;
 
 	void RemoveTask (CTask *pTask);
-	unsigned GetNextTask (void); // returns index into m_pTask or MAX_TASKS if no task was found
+
+	// the following methods have to be called with m_SpinLock acquired
+	void Enqueue (CTask *pTask);		// appends a ready task to the queue of its core
+	void Dequeue (CTask *pTask);		// removes a task from the queue of its core
+	CTask *GetNextTask (unsigned nCore, unsigned nMinPriority); // 0 if no task is ready
+	CTask *StealTask (unsigned nCore);	// 0 if no task can be taken from other cores
+	void AddTimedTask (CTask *pTask);
+	void RemoveTimedTask (CTask *pTask);
+	void WakeTimedTasks (unsigned nCore, unsigned nTicks);
+	boolean HasTimedTasks (unsigned nCore);	// which are allowed to run on this core
+	void MakeReady (CTask *pTask);
+
+	static void TimerHandler (void);
+
+	static unsigned GetCoreNumber (void)
+	{
+#ifdef ARM_ALLOW_MULTI_CORE
+		return CMultiCoreSupport::ThisCore ();
+#else
+		return 0;
+#endif
+	}
 
 private:
 	CTask *m_pTask[MAX_TASKS];
 	unsigned m_nTasks;
 
-	CTask *m_pCurrent;
-	unsigned m_nCurrent;	// index into m_pTask
+	struct TCore
+	{
+		CTask *pCurrent;
+		CTask *pPrevious;		// until FinishTaskSwitch() has been called
+		CTask *pReadyHead[TASK_PRIORITIES];
+		CTask *pReadyTail[TASK_PRIORITIES];
+		u32 nReadyMask;			// bit n is set, if the queue of priority n is not empty
+		CTask *pTimedList;		// sleeping and blocked with timeout, sorted by wake time
+		volatile int nSliceTicks;	// the current task has run for (atomic access)
+		volatile boolean bPreempt;	// set by the timer, polled in PreemptionPoint()
+	}
+	m_Core[SCHED_CORES];
+
+	unsigned m_nTimeSlice;			// in ticks, 0 if disabled
+	boolean m_bTimerHandler;
 
 	TSchedulerTaskHandler *m_pTaskSwitchHandler;
 	TSchedulerTaskHandler *m_pTaskTerminationHandler;
 
 	int m_iSuspendNewTasks;
 
-	CSpinLock m_SpinLock;
+	CSpinLock m_SpinLock;			// protects the tasks, queues and wait lists
 
 	static CScheduler *s_pThis;
 };
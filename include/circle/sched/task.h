@@ -36,6 +36,11 @@ enum TTaskState
 	TaskStateUnknown
 };
 
+#define TASK_PRIORITY_IDLE	0		// lowest priority, used by the idle tasks
+#define TASK_PRIORITY_DEFAULT	16
+#define TASK_PRIORITY_HIGHEST	31
+#define TASK_PRIORITIES		32
+
 class CScheduler;
 
 class CTask	/// Overload this class, define the Run() method, and call new on it to start it.
@@ -75,6 +80,19 @@ public:
 	/// \return Any user pointer, previously set with SetUserData()
 	void *GetUserData (unsigned nSlot);
 
+	/// \brief Set the priority of this task
+	/// \param nPriority TASK_PRIORITY_IDLE .. TASK_PRIORITY_HIGHEST (default TASK_PRIORITY_DEFAULT)
+	/// \note A ready task with a higher priority always runs before this task.
+	void SetPriority (unsigned nPriority);
+	unsigned GetPriority (void) const	{ return m_nPriority; }
+
+	/// \brief Set the cores, on which this task is allowed to run
+	/// \param nCoreMask Bit n is set, if the task may run on core n
+	/// \note By default a task runs on the core, on which it has been created. If this core\n
+	///	  is not in nCoreMask, the task migrates to the first core in nCoreMask.
+	void SetAffinity (unsigned nCoreMask);
+	unsigned GetAffinity (void) const	{ return m_nAffinity; }
+
 private:
 	TTaskState GetState (void) const	{ return m_State; }
 	void SetState (TTaskState State)	{ m_State = State; }
@@ -84,6 +102,12 @@ private:
 
 	TTaskRegisters *GetRegs (void)		{ return &m_Regs; }
 
+	boolean IsTimed (void) const
+	{
+		return    m_State == TaskStateSleeping
+		       || m_State == TaskStateBlockedWithTimeout;
+	}
+
 	friend class CScheduler;
 
 private:
@@ -100,6 +124,15 @@ private:
 	void		   *m_pUserData[TASK_USER_DATA_SLOTS];
 	CSynchronizationEvent m_Event;
 	CTask		   *m_pWaitListNext;	// next in list of tasks waiting on an event
+
+	// managed by the scheduler
+	unsigned	    m_nPriority;
+	unsigned	    m_nAffinity;	// mask of allowed cores
+	unsigned	    m_nCore;		// core, to which the task is assigned
+	CTask		   *m_pRunNext;		// next in ready queue or in list of timed tasks
+	boolean		    m_bQueued;		// in a ready queue
+	boolean		    m_bTimed;		// in the list of timed tasks of its core
+	boolean		    m_bOnCore;		// running or its registers are being saved
 };
 
 #endif
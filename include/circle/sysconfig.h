@@ -68,8 +68,9 @@
 // (buckets). Each free list contains blocks of a specific size. On
 // block allocation the requested block size is rounded up to the
 // size of next available bucket size. If the requested size is greater
-// than the largest available bucket size, the block can be allocated,
-// but the memory space is lost, if the block will be freed later.
+// than the largest available bucket size, the block is allocated from
+// a separate free list of large blocks, which are merged with their
+// free neighbours, when they are freed.
 // Because the block buckets have to be walked through on each allocate
 // and free operation, it is preferable to have only a few buckets.
 // With this option you can configure the bucket sizes, so that they
@@ -160,6 +161,16 @@
 #define USE_PHYSICAL_COUNTER
 #endif
 
+// NO_MMU_BLOCK_MAPPINGS disables the large mappings in the translation
+// table (AArch64 only). By default 512 MB regions with the same memory
+// attributes are mapped with one block descriptor and 2 MB ranges of
+// 64 KB pages with the same attributes get the contiguous hint, so that
+// they need one TLB entry each. With this option defined all memory is
+// mapped with single 64 KB pages. This can be used to compare the TLB
+// refills with CPerfCounters.
+
+//#define NO_MMU_BLOCK_MAPPINGS
+
 #endif
 
 #if RASPPI >= 4
@@ -345,6 +356,15 @@
 
 //#define SAVE_VFP_REGS_ON_FIQ
 
+// TRACE_SYSTEM_EVENTS enables the recording of system events (IRQ
+// handlers, task switches, FAT file reads and network processing) with
+// CBinaryTracer (see include/circle/binarytracer.h). If no tracer
+// object has been created or it has not been started, each event costs
+// one load and compare only, but it should not be defined in production
+// builds nevertheless.
+
+//#define TRACE_SYSTEM_EVENTS
+
 // LEAVE_QEMU_ON_HALT can be defined to exit QEMU when halt() is
 // called or main() returns EXIT_HALT. QEMU has to be started with the
 // -semihosting option, so that this works. This option must not be
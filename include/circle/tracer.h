@@ -30,7 +30,7 @@ struct TTraceEntry
 	unsigned nParam[4];
 };
 
-class CTracer
+class CTracer		/// Event tracer with text output (see binarytracer.h for a lock-free one)
 {
 public:
 	CTracer (unsigned nDepth, boolean bStopIfFull);
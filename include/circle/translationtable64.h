@@ -40,6 +40,11 @@ public:
 private:
 	TARMV8MMU_LEVEL3_DESCRIPTOR *CreateLevel3Table (uintptr nBaseAddress) NOOPT;
 
+	// returns TRUE, if all pages in the range have the same attributes
+	boolean IsUniform (uintptr nBaseAddress, size_t nSize) NOOPT;
+
+	void GetPageDescriptor (TARMV8MMU_LEVEL3_PAGE_DESCRIPTOR *pDesc, uintptr nBaseAddress) NOOPT;
+
 private:
 	size_t m_nMemSize;
 
@@ -30,12 +30,32 @@ extern "C" {
 void *memset (void *pBuffer, int nValue, size_t nLength) NOOPT;
 
 void *memcpy (void *pDest, const void *pSrc, size_t nLength);
+
+// Aligned accesses only, for Device memory (e.g. the frame buffer)
+#if AARCH == 64
+void *memcpyblk (void *pDest, const void *pSrc, size_t nLength);
+void *memsetblk (void *pBuffer, int nValue, size_t nLength);
+#else
 #define memcpyblk memcpy
+#define memsetblk memset
+#endif
+
+// Non-temporal variants for large buffers, which are not used again soon
+// (the written data does not evict the working set from the caches)
+#if AARCH == 64
+void *memcpy_nt (void *pDest, const void *pSrc, size_t nLength);
+void *memset_nt (void *pBuffer, int nValue, size_t nLength);
+#else
+#define memcpy_nt memcpy
+#define memset_nt memset
+#endif
 
 void *memmove (void *pDest, const void *pSrc, size_t nLength);
 
 int memcmp (const void *pBuffer1, const void *pBuffer2, size_t nLength);
 
+void *memchr (const void *pBuffer, int nChar, size_t nLength);
+
 size_t strlen (const char *pString);
 
 int strcmp (const char *pString1, const char *pString2);
@@ -310,7 +310,7 @@ void C2DGraphics::UpdateDisplay()
 	}
 	else
 	{
-		memcpy(m_baseBuffer, m_Buffer, m_nWidth * m_nHeight * sizeof(TScreenColor));
+		memcpyblk(m_baseBuffer, m_Buffer, m_nWidth * m_nHeight * sizeof(TScreenColor));
 	}
 	
 }
@@ -82,7 +82,7 @@ boolean CBcmPropertyTags::GetTags (void *pTags, unsigned nTagsSize)
 
 	pBuffer->nBufferSize = nBufferSize;
 	pBuffer->nCode = CODE_REQUEST;
-	memcpy (pBuffer->Tags, pTags, nTagsSize);
+	memcpyblk (pBuffer->Tags, pTags, nTagsSize);
 
 	u32 *pEndTag = (u32 *) (pBuffer->Tags + nTagsSize);
 	*pEndTag = PROPTAG_END;
@@ -102,7 +102,7 @@ boolean CBcmPropertyTags::GetTags (void *pTags, unsigned nTagsSize)
 		return FALSE;
 	}
 
-	memcpy (pTags, pBuffer->Tags, nTagsSize);
+	memcpyblk (pTags, pBuffer->Tags, nTagsSize);
 
 	return TRUE;
 }
@@ -0,0 +1,347 @@
+//
+// binarytracer.cpp
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include <circle/binarytracer.h>
+#include <circle/device.h>
+#include <circle/synchronize.h>
+#include <circle/util.h>
+#include <assert.h>
+
+#if AARCH == 32 && RASPPI == 1
+	#include <circle/bcm2835.h>
+	#include <circle/memio.h>
+	#include <circle/timer.h>
+#endif
+
+#define DEVICE_CHUNK_SIZE	256
+
+struct TBufferOutput
+{
+	u8	*pBuffer;
+	size_t	 nSize;
+	size_t	 nOffset;
+};
+
+CBinaryTracer *CBinaryTracer::s_pThis = 0;
+
+CBinaryTracer::CBinaryTracer (unsigned nDepth, boolean bStopIfFull)
+:	m_nDepth (1),
+	m_bStopIfFull (bStopIfFull),
+	m_bActive (FALSE)
+{
+	assert (nDepth > 0);
+	while (m_nDepth < nDepth)
+	{
+		m_nDepth <<= 1;
+	}
+	m_nMask = m_nDepth-1;
+
+	TTraceRecord *pRecord = new TTraceRecord[m_nDepth * TRACE_CORES];
+	assert (pRecord != 0);
+
+	for (unsigned nCore = 0; nCore < TRACE_CORES; nCore++)
+	{
+		m_Core[nCore].pRecord = pRecord + m_nDepth * nCore;
+		m_Core[nCore].nWritten = 0;
+	}
+
+	for (unsigned nEvent = 0; nEvent < TRACE_MAX_EVENTS; nEvent++)
+	{
+		m_pEventName[nEvent] = 0;
+	}
+
+	m_pEventName[TRACE_EVENT_IRQ] = "IRQ";
+	m_pEventName[TRACE_EVENT_TASK_SWITCH] = "TaskSwitch";
+	m_pEventName[TRACE_EVENT_FAT_READ] = "FATRead";
+	m_pEventName[TRACE_EVENT_NET_PROCESS] = "NetProcess";
+
+	assert (s_pThis == 0);
+	s_pThis = this;
+}
+
+CBinaryTracer::~CBinaryTracer (void)
+{
+	Stop ();
+
+	s_pThis = 0;
+	DataSyncBarrier ();
+
+	delete [] m_Core[0].pRecord;
+	m_Core[0].pRecord = 0;
+}
+
+void CBinaryTracer::Start (void)
+{
+	m_bActive = FALSE;
+	DataSyncBarrier ();
+
+	for (unsigned nCore = 0; nCore < TRACE_CORES; nCore++)
+	{
+		m_Core[nCore].nWritten = 0;
+	}
+
+	DataSyncBarrier ();
+	m_bActive = TRUE;
+}
+
+void CBinaryTracer::Stop (void)
+{
+	m_bActive = FALSE;
+	DataSyncBarrier ();
+}
+
+void CBinaryTracer::SetEventName (unsigned nEvent, const char *pName)
+{
+	assert (nEvent < TRACE_MAX_EVENTS);
+	m_pEventName[nEvent] = pName;
+}
+
+boolean CBinaryTracer::Dump (CDevice *pDevice)
+{
+	assert (pDevice != 0);
+
+	return Output (DeviceOutput, pDevice);
+}
+
+size_t CBinaryTracer::GetDumpSize (void) const
+{
+	size_t nSize = sizeof (TTraceStreamHeader);
+
+	for (unsigned nEvent = 0; nEvent < TRACE_MAX_EVENTS; nEvent++)
+	{
+		if (m_pEventName[nEvent] != 0)
+		{
+			nSize += 2 * sizeof (u16) + strlen (m_pEventName[nEvent]);
+		}
+	}
+
+	for (unsigned nCore = 0; nCore < TRACE_CORES; nCore++)
+	{
+		nSize += 2 * sizeof (u32) + GetRecordCount (nCore) * sizeof (TTraceRecord);
+	}
+
+	return nSize;
+}
+
+size_t CBinaryTracer::Dump (void *pBuffer, size_t nSize)
+{
+	assert (pBuffer != 0);
+
+	TBufferOutput Buffer = {(u8 *) pBuffer, nSize, 0};
+	if (!Output (BufferOutput, &Buffer))
+	{
+		return 0;
+	}
+
+	return Buffer.nOffset;
+}
+
+unsigned CBinaryTracer::GetLostRecords (unsigned nCore) const
+{
+	assert (nCore < TRACE_CORES);
+	u32 nWritten = m_Core[nCore].nWritten;
+
+	return nWritten > m_nDepth ? nWritten - m_nDepth : 0;
+}
+
+CBinaryTracer *CBinaryTracer::Get (void)
+{
+	return s_pThis;
+}
+
+u32 CBinaryTracer::GetFrequency (void)
+{
+#if AARCH == 64
+	u64 nCNTFRQ;
+	asm volatile ("mrs %0, CNTFRQ_EL0" : "=r" (nCNTFRQ));
+
+	return (u32) nCNTFRQ;
+#elif RASPPI >= 2
+	u32 nCNTFRQ;
+	asm volatile ("mrc p15, 0, %0, c14, c0, 0" : "=r" (nCNTFRQ));
+
+	return nCNTFRQ;
+#else
+	return CLOCKHZ;
+#endif
+}
+
+void CBinaryTracer::Write (unsigned nEvent, TTraceRecordType Type, u32 nParam)
+{
+#ifdef ARM_ALLOW_MULTI_CORE
+	unsigned nCore = CMultiCoreSupport::ThisCore ();
+#else
+	unsigned nCore = 0;
+#endif
+	TCoreBuffer *pCore = &m_Core[nCore];
+
+	// Only this core writes to its buffer, so there is no contention here. The
+	// atomic increment reserves the record against IRQs and FIQs on this core.
+	u32 nIndex = __atomic_fetch_add (&pCore->nWritten, 1, __ATOMIC_RELAXED);
+	if (   m_bStopIfFull
+	    && nIndex >= m_nDepth)
+	{
+		return;
+	}
+
+	TTraceRecord *pRecord = &pCore->pRecord[nIndex & m_nMask];
+
+	pRecord->nTimestamp = GetTimestamp ();
+	pRecord->nEvent = (u16) nEvent;
+	pRecord->nType = (u8) Type;
+	pRecord->nCore = (u8) nCore;
+	pRecord->nParam = nParam;
+}
+
+boolean CBinaryTracer::Output (TOutputFunction *pOutput, void *pParam)
+{
+	Stop ();
+
+	TTraceStreamHeader Header;
+	Header.nMagic = TRACE_STREAM_MAGIC;
+	Header.nVersion = TRACE_STREAM_VERSION;
+	Header.nRecordSize = sizeof (TTraceRecord);
+	Header.nFrequency = GetFrequency ();
+	Header.nCores = TRACE_CORES;
+	Header.nNames = 0;
+
+	for (unsigned nEvent = 0; nEvent < TRACE_MAX_EVENTS; nEvent++)
+	{
+		if (m_pEventName[nEvent] != 0)
+		{
+			Header.nNames++;
+		}
+	}
+
+	if (!(*pOutput) (&Header, sizeof Header, pParam))
+	{
+		return FALSE;
+	}
+
+	for (unsigned nEvent = 0; nEvent < TRACE_MAX_EVENTS; nEvent++)
+	{
+		if (m_pEventName[nEvent] != 0)
+		{
+			u16 NameHeader[2] = {(u16) nEvent, (u16) strlen (m_pEventName[nEvent])};
+
+			if (   !(*pOutput) (NameHeader, sizeof NameHeader, pParam)
+			    || !(*pOutput) (m_pEventName[nEvent], NameHeader[1], pParam))
+			{
+				return FALSE;
+			}
+		}
+	}
+
+	for (unsigned nCore = 0; nCore < TRACE_CORES; nCore++)
+	{
+		unsigned nRecords = GetRecordCount (nCore);
+		u32 CoreHeader[2] = {nCore, nRecords};
+		if (!(*pOutput) (CoreHeader, sizeof CoreHeader, pParam))
+		{
+			return FALSE;
+		}
+
+		// oldest record first, the buffer has wrapped around, if records have been lost
+		const TTraceRecord *pRecord = m_Core[nCore].pRecord;
+		unsigned nFirst = 0;
+		if (   !m_bStopIfFull
+		    && GetLostRecords (nCore) > 0)
+		{
+			nFirst = m_Core[nCore].nWritten & m_nMask;
+		}
+
+		unsigned nFirstPart = m_nDepth - nFirst;
+		if (nFirstPart > nRecords)
+		{
+			nFirstPart = nRecords;
+		}
+
+		if (   !(*pOutput) (pRecord + nFirst, nFirstPart * sizeof (TTraceRecord), pParam)
+		    || !(*pOutput) (pRecord, (nRecords - nFirstPart) * sizeof (TTraceRecord), pParam))
+		{
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+boolean CBinaryTracer::DeviceOutput (const void *pData, size_t nLength, void *pParam)
+{
+	CDevice *pDevice = (CDevice *) pParam;
+	assert (pDevice != 0);
+
+	const u8 *pBuffer = (const u8 *) pData;
+	while (nLength > 0)
+	{
+		size_t nChunk = nLength < DEVICE_CHUNK_SIZE ? nLength : DEVICE_CHUNK_SIZE;
+
+		// the device may accept less bytes, if its transmit buffer is full
+		int nResult = pDevice->Write (pBuffer, nChunk);
+		if (nResult < 0)
+		{
+			return FALSE;
+		}
+
+		pBuffer += nResult;
+		nLength -= nResult;
+	}
+
+	return TRUE;
+}
+
+boolean CBinaryTracer::BufferOutput (const void *pData, size_t nLength, void *pParam)
+{
+	TBufferOutput *pBuffer = (TBufferOutput *) pParam;
+	assert (pBuffer != 0);
+
+	if (pBuffer->nOffset + nLength > pBuffer->nSize)
+	{
+		return FALSE;
+	}
+
+	memcpy (pBuffer->pBuffer + pBuffer->nOffset, pData, nLength);
+	pBuffer->nOffset += nLength;
+
+	return TRUE;
+}
+
+unsigned CBinaryTracer::GetRecordCount (unsigned nCore) const
+{
+	assert (nCore < TRACE_CORES);
+	u32 nWritten = m_Core[nCore].nWritten;
+
+	return nWritten < m_nDepth ? nWritten : m_nDepth;
+}
+
+#if AARCH == 32 && RASPPI == 1
+
+u64 CBinaryTracer::GetSystemTimer (void)
+{
+	u32 nHigh, nLow;
+	do
+	{
+		nHigh = read32 (ARM_SYSTIMER_CHI);
+		nLow = read32 (ARM_SYSTIMER_CLO);
+	}
+	while (nHigh != read32 (ARM_SYSTIMER_CHI));
+
+	return (u64) nHigh << 32 | nLow;
+}
+
+#endif
@@ -347,14 +347,34 @@ void CDMAChannel::Start (void)
 		m_pControlBlock->nTransferInformation |= TI_INTEN;
 	}
 
+	CleanAndInvalidateDataCacheRange ((uintptr) m_pControlBlock, sizeof *m_pControlBlock);
+
+	StartControlBlock (m_pControlBlock);
+}
+
+void CDMAChannel::StartChain (TDMAControlBlock *pFirstControlBlock)
+{
+#if RASPPI >= 4
+	assert (m_pDMA4Channel == 0);
+#endif
+
+	assert (m_nChannel < DMA_CHANNELS);
+	assert (pFirstControlBlock != 0);
+	assert (((uintptr) pFirstControlBlock & 31) == 0);
+
+	m_nDestinationAddress = 0;
+
+	StartControlBlock (pFirstControlBlock);
+}
+
+void CDMAChannel::StartControlBlock (TDMAControlBlock *pControlBlock)
+{
 	PeripheralEntry ();
 
 	assert (!(read32 (ARM_DMACHAN_CS (m_nChannel)) & CS_INT));
 	assert (!(read32 (ARM_DMA_INT_STATUS) & (1 << m_nChannel)));
 
-	write32 (ARM_DMACHAN_CONBLK_AD (m_nChannel), BUS_ADDRESS ((uintptr) m_pControlBlock));
-
-	CleanAndInvalidateDataCacheRange ((uintptr) m_pControlBlock, sizeof *m_pControlBlock);
+	write32 (ARM_DMACHAN_CONBLK_AD (m_nChannel), BUS_ADDRESS ((uintptr) pControlBlock));
 
 	write32 (ARM_DMACHAN_CS (m_nChannel),   CS_WAIT_FOR_OUTSTANDING_WRITES
 					      | (DEFAULT_PANIC_PRIORITY << CS_PANIC_PRIORITY_SHIFT)
@@ -364,6 +384,37 @@ void CDMAChannel::Start (void)
 	PeripheralExit ();
 }
 
+boolean CDMAChannel::CheckChainError (void)
+{
+#if RASPPI >= 4
+	assert (m_pDMA4Channel == 0);
+#endif
+
+	assert (m_nChannel < DMA_CHANNELS);
+
+	PeripheralEntry ();
+
+	// with CS_INT set the interrupt handler reports the error
+	u32 nCS = read32 (ARM_DMACHAN_CS (m_nChannel));
+	boolean bError = (nCS & (CS_ERROR | CS_INT)) == CS_ERROR;
+	if (bError)
+	{
+		write32 (ARM_DMACHAN_CS (m_nChannel), CS_RESET);
+		while (read32 (ARM_DMACHAN_CS (m_nChannel)) & CS_RESET)
+		{
+			// do nothing
+		}
+
+		write32 (ARM_DMACHAN_DEBUG (m_nChannel),   DEBUG_READ_ERROR
+							 | DEBUG_FIFO_ERROR
+							 | DEBUG_READ_LAST_NOT_SET_ERROR);
+	}
+
+	PeripheralExit ();
+
+	return bError;
+}
+
 boolean CDMAChannel::Wait (void)
 {
 #if RASPPI >= 4
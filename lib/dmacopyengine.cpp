@@ -0,0 +1,533 @@
+//
+// dmacopyengine.cpp
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include <circle/dmacopyengine.h>
+#include <circle/machineinfo.h>
+#include <circle/memorymap.h>
+#include <circle/synchronize.h>
+#include <circle/util.h>
+#include <circle/new.h>
+#include <assert.h>
+
+#define NO_BLOCK	DMA_COPY_MAX_BLOCKS
+
+// the legacy DMA channels can access the first GB only
+#if RASPPI >= 4
+	#define DMA_ADDRESS_LIMIT	MEM_HIGHMEM_START
+#else
+	#define DMA_ADDRESS_LIMIT	0x40000000UL
+#endif
+
+CDMACopyEngine::CDMACopyEngine (CInterruptSystem *pInterruptSystem)
+:	m_pInterruptSystem (pInterruptSystem),
+	m_nChannels (0),
+	m_nNextRequest (0),
+	m_pControlBlockBuffer (0),
+	m_pControlBlock (0),
+	m_nFreeBlock (NO_BLOCK),
+	m_bErrors (FALSE),
+	m_nCPUCopies (0)
+{
+	for (unsigned i = 0; i < DMA_COPY_MAX_REQUESTS; i++)
+	{
+		m_Request[i].bComplete = TRUE;
+		m_Request[i].bStatus = TRUE;
+		m_Request[i].nGeneration = 0;
+		m_Request[i].nPendingBlocks = 0;
+	}
+}
+
+CDMACopyEngine::~CDMACopyEngine (void)
+{
+	WaitAll ();
+
+	for (unsigned i = 0; i < m_nChannels; i++)
+	{
+		delete m_Channel[i].pChannel;
+		m_Channel[i].pChannel = 0;
+	}
+
+	m_nChannels = 0;
+
+	delete [] m_pControlBlockBuffer;
+	m_pControlBlockBuffer = 0;
+	m_pControlBlock = 0;
+
+	m_pInterruptSystem = 0;
+}
+
+boolean CDMACopyEngine::Initialize (unsigned nChannels)
+{
+	assert (m_nChannels == 0);
+	assert (nChannels > 0);
+	assert (nChannels <= DMA_COPY_MAX_CHANNELS);
+	assert (m_pInterruptSystem != 0);
+
+	m_pControlBlockBuffer = new (HEAP_DMA30) u8[DMA_COPY_MAX_BLOCKS * sizeof (TDMAControlBlock) + 31];
+	if (m_pControlBlockBuffer == 0)
+	{
+		return FALSE;
+	}
+
+	m_pControlBlock = (TDMAControlBlock *) (((uintptr) m_pControlBlockBuffer + 31) & ~31);
+
+	for (unsigned i = 0; i < DMA_COPY_MAX_BLOCKS; i++)
+	{
+		m_pControlBlock[i].n2DModeStride = 0;
+		m_pControlBlock[i].nReserved[0] = 0;
+		m_pControlBlock[i].nReserved[1] = 0;
+
+		m_Block[i].nNext = i+1 < DMA_COPY_MAX_BLOCKS ? i+1 : NO_BLOCK;
+	}
+
+	m_nFreeBlock = 0;
+
+	CMachineInfo *pMachineInfo = CMachineInfo::Get ();
+	assert (pMachineInfo != 0);
+
+	while (m_nChannels < nChannels)
+	{
+		// CDMAChannel asserts, if no channel is available, so check it before
+		unsigned nChannel = pMachineInfo->AllocateDMAChannel (DMA_CHANNEL_NORMAL);
+		if (nChannel == DMA_CHANNEL_NONE)
+		{
+			break;
+		}
+
+		pMachineInfo->FreeDMAChannel (nChannel);
+
+		TChannel *pChannel = &m_Channel[m_nChannels];
+
+		pChannel->pChannel = new CDMAChannel (nChannel, m_pInterruptSystem);
+		if (pChannel->pChannel == 0)
+		{
+			break;
+		}
+
+		pChannel->pThis = this;
+		pChannel->nIndex = m_nChannels;
+		pChannel->nPendingHead = NO_BLOCK;
+		pChannel->nPendingTail = NO_BLOCK;
+		pChannel->nActiveHead = NO_BLOCK;
+		pChannel->nQueuedBytes = 0;
+
+		pChannel->pChannel->SetCompletionRoutine (CompletionStub, pChannel);
+
+		m_nChannels++;
+	}
+
+	return m_nChannels > 0;
+}
+
+TDMACopyHandle CDMACopyEngine::Copy (void *pDestination, const void *pSource, size_t nLength)
+{
+	if (   nLength < DMA_COPY_CPU_THRESHOLD
+	    || m_nChannels == 0
+	    || !IsDMAable (pDestination, nLength)
+	    || !IsDMAable (pSource, nLength))
+	{
+		memcpy (pDestination, pSource, nLength);
+
+		m_SpinLock.Acquire ();
+		m_nCPUCopies++;
+		m_SpinLock.Release ();
+
+		return DMA_COPY_HANDLE_DONE;
+	}
+
+	// The first and last cache line of the destination may be shared with other
+	// data, which may be written by the CPU during the transfer. Its write-back on
+	// completion would overwrite the DMA result, so the CPU copies the bytes in
+	// these lines and the DMA controller gets the cache line aligned middle only.
+	size_t nHead = -(uintptr) pDestination & (DATA_CACHE_LINE_LENGTH_MAX-1);
+	size_t nTail = ((uintptr) pDestination + nLength) & (DATA_CACHE_LINE_LENGTH_MAX-1);
+	assert (nHead + nTail < nLength);
+
+	memcpy (pDestination, pSource, nHead);
+	memcpy ((u8 *) pDestination + nLength - nTail, (const u8 *) pSource + nLength - nTail, nTail);
+
+	pDestination = (u8 *) pDestination + nHead;
+	pSource = (const u8 *) pSource + nHead;
+	nLength -= nHead + nTail;
+	assert (IS_CACHE_ALIGNED (pDestination, nLength));
+
+	unsigned nParts = nLength / DMA_COPY_SPLIT_SIZE;
+	if (nParts > m_nChannels)
+	{
+		nParts = m_nChannels;
+	}
+	else if (nParts == 0)
+	{
+		nParts = 1;
+	}
+
+	// write back the source and drop the destination from the cache, before the
+	// DMA controller accesses the memory
+	CleanAndInvalidateDataCacheRange ((uintptr) pSource, nLength);
+	CleanAndInvalidateDataCacheRange ((uintptr) pDestination, nLength);
+
+	m_SpinLock.Acquire ();
+
+	unsigned nRequest = AllocateRequest ();
+	if (nRequest == DMA_COPY_MAX_REQUESTS)
+	{
+		m_nCPUCopies++;
+
+		m_SpinLock.Release ();
+
+		memcpy (pDestination, pSource, nLength);
+
+		return DMA_COPY_HANDLE_DONE;
+	}
+
+	unsigned Blocks[DMA_COPY_MAX_CHANNELS];
+	for (unsigned i = 0; i < nParts; i++)
+	{
+		Blocks[i] = AllocateBlock ();
+		if (Blocks[i] == NO_BLOCK)
+		{
+			while (i-- > 0)
+			{
+				m_Block[Blocks[i]].nNext = m_nFreeBlock;
+				m_nFreeBlock = Blocks[i];
+			}
+
+			m_Request[nRequest].bComplete = TRUE;
+			m_nCPUCopies++;
+
+			m_SpinLock.Release ();
+
+			memcpy (pDestination, pSource, nLength);
+
+			return DMA_COPY_HANDLE_DONE;
+		}
+	}
+
+	TRequest *pRequest = &m_Request[nRequest];
+	pRequest->bStatus = TRUE;
+	pRequest->nPendingBlocks = nParts;
+	pRequest->nDestination = (uintptr) pDestination;
+	pRequest->nLength = nLength;
+
+	// the parts are multiples of 64 bytes, the last part takes the rest
+	size_t nPartLength = (nLength / nParts) & ~(size_t) 63;
+	size_t nOffset = 0;
+
+	for (unsigned i = 0; i < nParts; i++)
+	{
+		size_t nBlockLength = i < nParts-1 ? nPartLength : nLength - nOffset;
+		assert (nBlockLength <= TXFR_LEN_MAX);
+
+		unsigned nBlock = Blocks[i];
+		m_Block[nBlock].nRequest = nRequest;
+		m_Block[nBlock].nLength = nBlockLength;
+
+		TDMAControlBlock *pControlBlock = &m_pControlBlock[nBlock];
+		pControlBlock->nTransferInformation     =   TI_SRC_WIDTH
+							  | TI_SRC_INC
+							  | TI_DEST_WIDTH
+							  | TI_DEST_INC;
+		pControlBlock->nSourceAddress           = BUS_ADDRESS ((uintptr) pSource + nOffset);
+		pControlBlock->nDestinationAddress      = BUS_ADDRESS ((uintptr) pDestination + nOffset);
+		pControlBlock->nTransferLength          = nBlockLength;
+		pControlBlock->nNextControlBlockAddress = 0;
+
+		// the channel with the least queued bytes gets the part
+		unsigned nChannel = 0;
+		for (unsigned j = 1; j < m_nChannels; j++)
+		{
+			if (m_Channel[j].nQueuedBytes < m_Channel[nChannel].nQueuedBytes)
+			{
+				nChannel = j;
+			}
+		}
+
+		QueueBlock (nChannel, nBlock);
+
+		nOffset += nBlockLength;
+	}
+
+	for (unsigned i = 0; i < m_nChannels; i++)
+	{
+		StartChain (i);
+	}
+
+	TDMACopyHandle hCopy = pRequest->nGeneration << 8 | nRequest;
+
+	m_SpinLock.Release ();
+
+	return hCopy;
+}
+
+boolean CDMACopyEngine::IsComplete (TDMACopyHandle hCopy)
+{
+	if (hCopy == DMA_COPY_HANDLE_DONE)
+	{
+		return TRUE;
+	}
+
+	unsigned nRequest = hCopy & 0xFF;
+	assert (nRequest < DMA_COPY_MAX_REQUESTS);
+
+	m_SpinLock.Acquire ();
+
+	// the slot may have been reused already
+	boolean bComplete =    m_Request[nRequest].bComplete
+			    || m_Request[nRequest].nGeneration != hCopy >> 8;
+
+	m_SpinLock.Release ();
+
+	return bComplete;
+}
+
+boolean CDMACopyEngine::Wait (TDMACopyHandle hCopy)
+{
+	while (!IsComplete (hCopy))
+	{
+		PollErrors ();
+	}
+
+	if (hCopy == DMA_COPY_HANDLE_DONE)
+	{
+		return TRUE;
+	}
+
+	unsigned nRequest = hCopy & 0xFF;
+
+	m_SpinLock.Acquire ();
+
+	boolean bStatus =    m_Request[nRequest].nGeneration != hCopy >> 8
+			  || m_Request[nRequest].bStatus;
+
+	m_SpinLock.Release ();
+
+	return bStatus;
+}
+
+boolean CDMACopyEngine::WaitAll (void)
+{
+	for (unsigned i = 0; i < DMA_COPY_MAX_REQUESTS; i++)
+	{
+		while (!m_Request[i].bComplete)
+		{
+			PollErrors ();
+		}
+	}
+
+	m_SpinLock.Acquire ();
+
+	boolean bStatus = !m_bErrors;
+	m_bErrors = FALSE;
+
+	m_SpinLock.Release ();
+
+	return bStatus;
+}
+
+boolean CDMACopyEngine::IsDMAable (const void *pBuffer, size_t nLength) const
+{
+	uintptr nAddress = (uintptr) pBuffer;
+
+	return    nAddress < DMA_ADDRESS_LIMIT
+	       && nLength <= DMA_ADDRESS_LIMIT - nAddress;
+}
+
+unsigned CDMACopyEngine::AllocateRequest (void)
+{
+	for (unsigned i = 0; i < DMA_COPY_MAX_REQUESTS; i++)
+	{
+		// round robin, so that the status of a request is kept as long as possible
+		unsigned nRequest = m_nNextRequest;
+		if (++m_nNextRequest == DMA_COPY_MAX_REQUESTS)
+		{
+			m_nNextRequest = 0;
+		}
+
+		TRequest *pRequest = &m_Request[nRequest];
+		if (pRequest->bComplete)
+		{
+			pRequest->bComplete = FALSE;
+
+			// generation 0 is not used, so that a handle is never DMA_COPY_HANDLE_DONE
+			pRequest->nGeneration = (pRequest->nGeneration + 1) & 0xFFFFFF;
+			if (pRequest->nGeneration == 0)
+			{
+				pRequest->nGeneration = 1;
+			}
+
+			return nRequest;
+		}
+	}
+
+	return DMA_COPY_MAX_REQUESTS;
+}
+
+unsigned CDMACopyEngine::AllocateBlock (void)
+{
+	unsigned nBlock = m_nFreeBlock;
+	if (nBlock != NO_BLOCK)
+	{
+		m_nFreeBlock = m_Block[nBlock].nNext;
+	}
+
+	return nBlock;
+}
+
+void CDMACopyEngine::QueueBlock (unsigned nChannel, unsigned nBlock)
+{
+	assert (nChannel < m_nChannels);
+	TChannel *pChannel = &m_Channel[nChannel];
+
+	m_Block[nBlock].nNext = NO_BLOCK;
+
+	if (pChannel->nPendingHead == NO_BLOCK)
+	{
+		pChannel->nPendingHead = nBlock;
+	}
+	else
+	{
+		m_Block[pChannel->nPendingTail].nNext = nBlock;
+	}
+
+	pChannel->nPendingTail = nBlock;
+	pChannel->nQueuedBytes += m_Block[nBlock].nLength;
+}
+
+void CDMACopyEngine::StartChain (unsigned nChannel)
+{
+	assert (nChannel < m_nChannels);
+	TChannel *pChannel = &m_Channel[nChannel];
+
+	if (   pChannel->nActiveHead != NO_BLOCK
+	    || pChannel->nPendingHead == NO_BLOCK)
+	{
+		return;
+	}
+
+	// link the pending blocks, the last one generates the interrupt
+	for (unsigned nBlock = pChannel->nPendingHead; nBlock != NO_BLOCK; nBlock = m_Block[nBlock].nNext)
+	{
+		TDMAControlBlock *pControlBlock = &m_pControlBlock[nBlock];
+
+		unsigned nNext = m_Block[nBlock].nNext;
+		if (nNext != NO_BLOCK)
+		{
+			pControlBlock->nTransferInformation &= ~TI_INTEN;
+			pControlBlock->nNextControlBlockAddress =
+				BUS_ADDRESS ((uintptr) &m_pControlBlock[nNext]);
+		}
+		else
+		{
+			pControlBlock->nTransferInformation |= TI_INTEN;
+			pControlBlock->nNextControlBlockAddress = 0;
+		}
+
+		CleanAndInvalidateDataCacheRange ((uintptr) pControlBlock, sizeof *pControlBlock);
+	}
+
+	pChannel->nActiveHead = pChannel->nPendingHead;
+	pChannel->nPendingHead = NO_BLOCK;
+	pChannel->nPendingTail = NO_BLOCK;
+
+	pChannel->pChannel->StartChain (&m_pControlBlock[pChannel->nActiveHead]);
+}
+
+void CDMACopyEngine::PollErrors (void)
+{
+	m_SpinLock.Acquire ();
+
+	for (unsigned i = 0; i < m_nChannels; i++)
+	{
+		// only the last block of a chain generates an interrupt
+		if (   m_Channel[i].nActiveHead != NO_BLOCK
+		    && m_Channel[i].pChannel->CheckChainError ())
+		{
+			CompleteChain (i, FALSE);
+		}
+	}
+
+	m_SpinLock.Release ();
+}
+
+void CDMACopyEngine::CompleteChain (unsigned nChannel, boolean bStatus)
+{
+	assert (nChannel < m_nChannels);
+	TChannel *pChannel = &m_Channel[nChannel];
+
+	unsigned nBlock = pChannel->nActiveHead;
+	assert (nBlock != NO_BLOCK);
+
+	while (nBlock != NO_BLOCK)
+	{
+		unsigned nNext = m_Block[nBlock].nNext;
+
+		assert (pChannel->nQueuedBytes >= m_Block[nBlock].nLength);
+		pChannel->nQueuedBytes -= m_Block[nBlock].nLength;
+
+		unsigned nRequest = m_Block[nBlock].nRequest;
+		assert (nRequest < DMA_COPY_MAX_REQUESTS);
+		TRequest *pRequest = &m_Request[nRequest];
+
+		if (!bStatus)
+		{
+			pRequest->bStatus = FALSE;
+			m_bErrors = TRUE;
+		}
+
+		assert (pRequest->nPendingBlocks > 0);
+		if (--pRequest->nPendingBlocks == 0)
+		{
+			// drop lines, which have been loaded speculatively during the transfer,
+			// the range is cache line aligned, so that no CPU write gets lost here
+			CleanAndInvalidateDataCacheRange (pRequest->nDestination, pRequest->nLength);
+
+			DataMemBarrier ();
+
+			pRequest->bComplete = TRUE;
+		}
+
+		m_Block[nBlock].nNext = m_nFreeBlock;
+		m_nFreeBlock = nBlock;
+
+		nBlock = nNext;
+	}
+
+	pChannel->nActiveHead = NO_BLOCK;
+
+	StartChain (nChannel);
+}
+
+void CDMACopyEngine::CompletionHandler (unsigned nChannel, boolean bStatus)
+{
+	m_SpinLock.Acquire ();
+
+	CompleteChain (nChannel, bStatus);
+
+	m_SpinLock.Release ();
+}
+
+void CDMACopyEngine::CompletionStub (unsigned nChannel, boolean bStatus, void *pParam)
+{
+	TChannel *pChannel = (TChannel *) pParam;
+	assert (pChannel != 0);
+
+	CDMACopyEngine *pThis = pChannel->pThis;
+	assert (pThis != 0);
+
+	pThis->CompletionHandler (pChannel->nIndex, bStatus);
+}
@@ -246,6 +246,52 @@ TFATBuffer *CFATCache::GetSector (unsigned nSector, int bWriteOnly)
 	return pBuffer;
 }
 
+int CFATCache::ReadSectors (unsigned nSector, unsigned nCount, void *pBuffer)
+{
+	assert (nCount > 0);
+	assert (pBuffer != 0);
+
+	m_BufferListLock.Acquire ();
+	m_DiskLock.Acquire ();
+
+	// write back dirty buffers in the range, so that the device has the current data
+	for (TFATBuffer *pCached = m_BufferList.pFirst; pCached != 0; pCached = pCached->pNext)
+	{
+		assert (pCached->nMagic == BUFFER_MAGIC);
+
+		if (   pCached->bDirty
+		    && pCached->nSector != BUFFER_NOSECTOR
+		    && nSector <= pCached->nSector && pCached->nSector < nSector + nCount)
+		{
+			m_pPartition->Seek ((u64) pCached->nSector * FAT_SECTOR_SIZE);
+			if (m_pPartition->Write (pCached->Data, FAT_SECTOR_SIZE) != FAT_SECTOR_SIZE)
+			{
+				Fault (FAULT_WRITE_ERROR);
+				m_DiskLock.Release ();
+				m_BufferListLock.Release ();
+				return 0;
+			}
+
+			pCached->bDirty = 0;
+		}
+	}
+
+	m_BufferListLock.Release ();
+
+	size_t nBytes = (size_t) nCount * FAT_SECTOR_SIZE;
+	m_pPartition->Seek ((u64) nSector * FAT_SECTOR_SIZE);
+	if (m_pPartition->Read (pBuffer, nBytes) != (int) nBytes)
+	{
+		Fault (FAULT_READ_ERROR);
+		m_DiskLock.Release ();
+		return 0;
+	}
+
+	m_DiskLock.Release ();
+
+	return 1;
+}
+
 void CFATCache::FreeSector (TFATBuffer *pBuffer, int bCritical)
 {
 	assert (pBuffer->nMagic == BUFFER_MAGIC);
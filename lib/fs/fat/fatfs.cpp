@@ -20,6 +20,8 @@
 #include <circle/fs/fat/fatfs.h>
 #include <circle/timer.h>
 #include <circle/util.h>
+#include <circle/synchronize.h>
+#include <circle/binarytracer.h>
 #include <assert.h>
 
 CFATFileSystem::CFATFileSystem (void)
@@ -111,7 +113,7 @@ unsigned CFATFileSystem::FileOpen (const char *pTitle)
 	pFile->nSize = pEntry->nFileSize;
 	pFile->nOffset = 0;
 	pFile->nCluster = (unsigned) pEntry->nFirstClusterHigh << 16 | pEntry->nFirstClusterLow;
-	pFile->nFirstCluster = 0;
+	pFile->nFirstCluster = pFile->nCluster;
 	pFile->pBuffer = 0;
 	pFile->bWrite = FALSE;
 
@@ -238,6 +240,8 @@ unsigned CFATFileSystem::FileClose (unsigned hFile)
 
 unsigned CFATFileSystem::FileRead (unsigned hFile, void *pBuffer, unsigned ulBytes)
 {
+	TRACE_SYSTEM_SCOPE (TRACE_EVENT_FAT_READ, ulBytes);
+
 	unsigned ulBytesRead = 0;
 	TFile *pFile;
 
@@ -271,7 +275,50 @@ unsigned CFATFileSystem::FileRead (unsigned hFile, void *pBuffer, unsigned ulByt
 			m_FileTableLock.Release ();
 			return ulBytesRead;
 		}
-	
+
+		// read whole sectors directly into the caller's buffer
+		if (   pFile->pBuffer == 0
+		    && pFile->nOffset % FAT_SECTOR_SIZE == 0
+		    && ((uintptr) pBuffer & 3) == 0)
+		{
+			ulCopyBytes = ulBytes < ulBytesLeft ? ulBytes : ulBytesLeft;
+			unsigned nSectors = ulCopyBytes / FAT_SECTOR_SIZE;
+
+			// The device may transfer the sectors with DMA. If the buffer is not cache
+			// line aligned, its first and last cache line may be shared with other data,
+			// so the first and the last sector are read through the cache then. The run
+			// in between starts and ends in cache lines, which belong to the buffer.
+			if (!IS_CACHE_ALIGNED (pBuffer, FAT_SECTOR_SIZE))
+			{
+				if (ulBytesRead < DATA_CACHE_LINE_LENGTH_MAX)
+				{
+					nSectors = 0;
+				}
+				else if (nSectors > 0)
+				{
+					nSectors--;
+				}
+			}
+
+			if (nSectors > 0)
+			{
+				nSectors = ReadSectorRun (pFile, pBuffer, nSectors);
+				if (nSectors == 0)
+				{
+					m_FileTableLock.Release ();
+					return FS_ERROR;
+				}
+
+				ulCopyBytes = nSectors * FAT_SECTOR_SIZE;
+				pBuffer = (void *) (((unsigned char *) pBuffer) + ulCopyBytes);
+				pFile->nOffset += ulCopyBytes;
+				ulBytes -= ulCopyBytes;
+				ulBytesRead += ulCopyBytes;
+
+				continue;
+			}
+		}
+
 		if (pFile->pBuffer == 0)
 		{
 			unsigned nSectorOffset = pFile->nOffset / FAT_SECTOR_SIZE;
@@ -336,6 +383,130 @@ unsigned CFATFileSystem::FileRead (unsigned hFile, void *pBuffer, unsigned ulByt
 	return ulBytesRead;
 }
 
+unsigned CFATFileSystem::FileSeek (unsigned hFile, unsigned nOffset)
+{
+	if (!(   1 <= hFile
+	      && hFile <= FAT_FILES))
+	{
+		return 0;
+	}
+
+	m_FileTableLock.Acquire ();
+
+	TFile *pFile = &FILE (hFile);
+	if (   !pFile->nUseCount
+	    || pFile->bWrite
+	    || nOffset > pFile->nSize)
+	{
+		m_FileTableLock.Release ();
+		return 0;
+	}
+
+	if (pFile->pBuffer != 0)
+	{
+		m_Cache.FreeSector (pFile->pBuffer, 0);
+		pFile->pBuffer = 0;
+	}
+
+	// FileRead() expects the previous cluster at the start of a cluster,
+	// unless the sector buffer is already loaded (offset inside a sector)
+	unsigned nSectorsPerCluster = m_FATInfo.GetSectorsPerCluster ();
+	unsigned nSector = nOffset / FAT_SECTOR_SIZE;
+	unsigned nClusters = nSector / nSectorsPerCluster;
+	if (   nOffset % FAT_SECTOR_SIZE == 0
+	    && nSector % nSectorsPerCluster == 0
+	    && nSector > 0)
+	{
+		nClusters--;
+	}
+
+	unsigned nCluster = pFile->nFirstCluster;
+	while (nClusters-- > 0)
+	{
+		nCluster = m_FAT.GetClusterEntry (nCluster);
+		if (m_FAT.IsEOC (nCluster))
+		{
+			m_FileTableLock.Release ();
+			return 0;
+		}
+	}
+
+	if (nOffset % FAT_SECTOR_SIZE != 0)
+	{
+		pFile->pBuffer = m_Cache.GetSector (  m_FATInfo.GetFirstSector (nCluster)
+						    + nSector % nSectorsPerCluster, 0);
+		if (pFile->pBuffer == 0)
+		{
+			m_FileTableLock.Release ();
+			return 0;
+		}
+	}
+
+	pFile->nCluster = nCluster;
+	pFile->nOffset = nOffset;
+
+	m_FileTableLock.Release ();
+
+	return 1;
+}
+
+unsigned CFATFileSystem::ReadSectorRun (TFile *pFile, void *pBuffer, unsigned nSectors)
+{
+	assert (pFile != 0);
+	assert (pFile->pBuffer == 0);
+	assert (pFile->nOffset % FAT_SECTOR_SIZE == 0);
+	assert (nSectors > 0);
+
+	if (nSectors > FAT_MAX_SECTOR_RUN)
+	{
+		nSectors = FAT_MAX_SECTOR_RUN;
+	}
+
+	unsigned nSectorsPerCluster = m_FATInfo.GetSectorsPerCluster ();
+	unsigned nClusterOffset = pFile->nOffset / FAT_SECTOR_SIZE % nSectorsPerCluster;
+	unsigned nCluster = pFile->nCluster;
+	if (   nClusterOffset == 0
+	    && pFile->nOffset > 0)
+	{
+		nCluster = m_FAT.GetClusterEntry (nCluster);
+		if (m_FAT.IsEOC (nCluster))
+		{
+			return 0;
+		}
+	}
+
+	unsigned nFirstSector = m_FATInfo.GetFirstSector (nCluster) + nClusterOffset;
+
+	// extend the run as long as the following clusters are consecutive
+	unsigned nRun = nSectorsPerCluster - nClusterOffset;
+	while (nRun < nSectors)
+	{
+		unsigned nNextCluster = m_FAT.GetClusterEntry (nCluster);
+		if (   m_FAT.IsEOC (nNextCluster)
+		    || nNextCluster != nCluster+1)
+		{
+			break;
+		}
+
+		nCluster = nNextCluster;
+		nRun += nSectorsPerCluster;
+	}
+
+	if (nRun > nSectors)
+	{
+		nRun = nSectors;
+	}
+
+	if (!m_Cache.ReadSectors (nFirstSector, nRun, pBuffer))
+	{
+		return 0;
+	}
+
+	pFile->nCluster = nCluster;		// cluster of the last sector read
+
+	return nRun;
+}
+
 unsigned CFATFileSystem::FileWrite (unsigned hFile, const void *pBuffer, unsigned ulBytes)
 {
 	unsigned int ulBytesWritten = 0;
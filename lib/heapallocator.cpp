@@ -18,29 +18,44 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 #include <circle/heapallocator.h>
+#include <circle/multicore.h>
 #include <circle/logger.h>
 #include <circle/util.h>
 #include <assert.h>
 
+#define LARGE_SPLIT_MIN		0x1000		// min. size of the rest of a split large block
+
 u32 CHeapAllocator::s_nBucketSize[] = { HEAP_BLOCK_BUCKET_SIZES };
 
 CHeapAllocator::CHeapAllocator (const char *pHeapName)
 :	m_pHeapName (pHeapName),
 	m_pNext (0),
 	m_pLimit (0),
-	m_nReserve (0)
+	m_nReserve (0),
+	m_nBuckets (0),
+	m_nMagazineBuckets (0),
+	m_pLargeFreeList (0),
+	m_nLargeFreeCount (0),
+	m_nLargeFreeBytes (0)
 {
 	memset (m_Bucket, 0, sizeof m_Bucket);
+	memset (m_CoreCache, 0, sizeof m_CoreCache);
 
-	unsigned nBuckets = sizeof s_nBucketSize / sizeof s_nBucketSize[0];
-	if (nBuckets > HEAP_BLOCK_MAX_BUCKETS)
+	m_nBuckets = sizeof s_nBucketSize / sizeof s_nBucketSize[0];
+	if (m_nBuckets > HEAP_BLOCK_MAX_BUCKETS)
 	{
-		nBuckets = HEAP_BLOCK_MAX_BUCKETS;
+		m_nBuckets = HEAP_BLOCK_MAX_BUCKETS;
 	}
 
-	for (unsigned i = 0; i < nBuckets; i++)
+	for (unsigned i = 0; i < m_nBuckets; i++)
 	{
 		m_Bucket[i].nSize = s_nBucketSize[i];
+
+		if (   s_nBucketSize[i] <= HEAP_MAGAZINE_MAX_SIZE
+		    && i < HEAP_MAGAZINE_BUCKETS)
+		{
+			m_nMagazineBuckets = i+1;
+		}
 	}
 }
 
@@ -67,74 +82,77 @@ void *CHeapAllocator::Allocate (size_t nSize)
 		return 0;
 	}
 
-	m_SpinLock.Acquire ();
-
-	THeapBlockBucket *pBucket;
-	for (pBucket = m_Bucket; pBucket->nSize > 0; pBucket++)
+	unsigned nBucket;
+	for (nBucket = 0; nBucket < m_nBuckets; nBucket++)
 	{
-		if (nSize <= pBucket->nSize)
+		if (nSize <= m_Bucket[nBucket].nSize)
 		{
-			nSize = pBucket->nSize;
-
-#ifdef HEAP_DEBUG
-			if (++pBucket->nCount > pBucket->nMaxCount)
-			{
-				pBucket->nMaxCount = pBucket->nCount;
-			}
-#endif
-
 			break;
 		}
 	}
 
-	THeapBlockHeader *pBlockHeader;
-	if (   pBucket->nSize > 0
-	    && (pBlockHeader = pBucket->pFreeList) != 0)
+	if (nBucket == m_nBuckets)
 	{
-		assert (pBlockHeader->nMagic == HEAP_BLOCK_MAGIC);
-		pBucket->pFreeList = pBlockHeader->pNext;
+		return AllocateLarge (nSize);
 	}
-	else
-	{
-		pBlockHeader = (THeapBlockHeader *) m_pNext;
 
-		u8 *pNextBlock = m_pNext;
-		pNextBlock += (sizeof (THeapBlockHeader) + nSize + HEAP_BLOCK_ALIGN-1) & ~HEAP_ALIGN_MASK;
+	THeapBlockBucket *pBucket = &m_Bucket[nBucket];
+	THeapBlockHeader *pBlockHeader = 0;
 
-		if (   pNextBlock <= m_pNext			// may have wrapped
-		    || pNextBlock > m_pLimit-m_nReserve)
-		{
-			if (m_nReserve == 0)
-			{
-				m_SpinLock.Release ();
+	EnterCritical ();
 
-				return 0;
-			}
+	unsigned nCore = GetCoreNumber ();
+	TCoreCache *pCache = &m_CoreCache[nCore];
 
-			m_nReserve = 0;
+	if (nBucket < m_nMagazineBuckets)
+	{
+		if (pCache->nMagazineCount[nBucket] == 0)
+		{
+			m_SpinLock.Acquire ();
+
+			RefillMagazine (nCore, nBucket);
 
 			m_SpinLock.Release ();
+		}
 
-#ifdef HEAP_DEBUG
-			DumpStatus ();
-#endif
-#if STDLIB_SUPPORT == 3
-			// C++ exception should be thrown after returning 0
-			CLogger::Get ()->WriteNoAlloc (m_pHeapName, LogWarning, "Out of memory");
-#else
-			CLogger::Get ()->Write (m_pHeapName, LogPanic, "Out of memory");
-#endif
+		if ((pBlockHeader = pCache->pMagazine[nBucket]) != 0)
+		{
+			assert (pBlockHeader->nMagic == HEAP_BLOCK_MAGIC);
+			pCache->pMagazine[nBucket] = pBlockHeader->pNext;
+			pCache->nMagazineCount[nBucket]--;
+		}
+	}
 
-			return 0;
+	if (pBlockHeader == 0)
+	{
+		m_SpinLock.Acquire ();
+
+		if ((pBlockHeader = pBucket->pFreeList) != 0)
+		{
+			assert (pBlockHeader->nMagic == HEAP_BLOCK_MAGIC);
+			pBucket->pFreeList = pBlockHeader->pNext;
+			pBucket->nFreeCount--;
 		}
+		else
+		{
+			pBlockHeader = AllocateFromRegion (pBucket->nSize);
+		}
+
+		m_SpinLock.Release ();
+
+		if (pBlockHeader == 0)
+		{
+			LeaveCritical ();
 
-		m_pNext = pNextBlock;
+			OutOfMemory ();
 
-		pBlockHeader->nMagic = HEAP_BLOCK_MAGIC;
-		pBlockHeader->nSize = (u32) nSize;
+			return 0;
+		}
 	}
 
-	m_SpinLock.Release ();
+	pCache->nAllocations[nBucket]++;
+
+	LeaveCritical ();
 
 	pBlockHeader->pNext = 0;
 
@@ -190,40 +208,386 @@ void CHeapAllocator::Free (void *pBlock)
 		(THeapBlockHeader *) ((uintptr) pBlock - sizeof (THeapBlockHeader));
 	assert (pBlockHeader->nMagic == HEAP_BLOCK_MAGIC);
 
-	for (THeapBlockBucket *pBucket = m_Bucket; pBucket->nSize > 0; pBucket++)
+	unsigned nBucket;
+	for (nBucket = 0; nBucket < m_nBuckets; nBucket++)
 	{
-		if (pBlockHeader->nSize == pBucket->nSize)
+		if (pBlockHeader->nSize == m_Bucket[nBucket].nSize)
 		{
-			m_SpinLock.Acquire ();
+			break;
+		}
+	}
 
-			pBlockHeader->pNext = pBucket->pFreeList;
-			pBucket->pFreeList = pBlockHeader;
+	if (nBucket == m_nBuckets)
+	{
+		FreeLarge (pBlockHeader);
 
-#ifdef HEAP_DEBUG
-			pBucket->nCount--;
-#endif
+		return;
+	}
+
+	EnterCritical ();
+
+	unsigned nCore = GetCoreNumber ();
+	TCoreCache *pCache = &m_CoreCache[nCore];
+
+	if (nBucket < m_nMagazineBuckets)
+	{
+		if (pCache->nMagazineCount[nBucket] >= HEAP_MAGAZINE_SIZE)
+		{
+			m_SpinLock.Acquire ();
+
+			FlushMagazine (nCore, nBucket);
 
 			m_SpinLock.Release ();
+		}
+
+		pBlockHeader->pNext = pCache->pMagazine[nBucket];
+		pCache->pMagazine[nBucket] = pBlockHeader;
+		pCache->nMagazineCount[nBucket]++;
+	}
+	else
+	{
+		THeapBlockBucket *pBucket = &m_Bucket[nBucket];
+
+		m_SpinLock.Acquire ();
+
+		pBlockHeader->pNext = pBucket->pFreeList;
+		pBucket->pFreeList = pBlockHeader;
+		pBucket->nFreeCount++;
+
+		m_SpinLock.Release ();
+	}
+
+	pCache->nFrees[nBucket]++;
+
+	LeaveCritical ();
+}
 
-			return;
+void CHeapAllocator::GetStats (THeapStats *pStats)
+{
+	assert (pStats != 0);
+	memset (pStats, 0, sizeof *pStats);
+
+	m_SpinLock.Acquire ();
+
+	pStats->nBuckets = m_nBuckets;
+
+	for (unsigned i = 0; i <= m_nBuckets; i++)
+	{
+		THeapBucketStats *pBucketStats = i < m_nBuckets ? &pStats->Bucket[i] : &pStats->Large;
+
+		pBucketStats->nSize = m_Bucket[i].nSize;
+		pBucketStats->nFreeBlocks = i < m_nBuckets ? m_Bucket[i].nFreeCount
+							   : m_nLargeFreeCount;
+
+		for (unsigned nCore = 0; nCore < HEAP_CORES; nCore++)
+		{
+			const TCoreCache *pCache = &m_CoreCache[nCore];
+
+			pBucketStats->nAllocations += pCache->nAllocations[i];
+			pBucketStats->nFrees += pCache->nFrees[i];
+
+			if (i < m_nMagazineBuckets)
+			{
+				pBucketStats->nFreeBlocks += pCache->nMagazineCount[i];
+			}
 		}
 	}
 
-#ifdef HEAP_DEBUG
-	CLogger::Get ()->Write (m_pHeapName, LogDebug, "Trying to free large block (size %u)",
-				pBlockHeader->nSize);
-#endif
+	pStats->nLargeFreeBytes = m_nLargeFreeBytes;
+	pStats->nFreeSpace = GetFreeSpace ();
+
+	m_SpinLock.Release ();
 }
 
 #ifdef HEAP_DEBUG
 
 void CHeapAllocator::DumpStatus (void)
 {
-	for (THeapBlockBucket *pBucket = m_Bucket; pBucket->nSize > 0; pBucket++)
+	THeapStats Stats;
+	GetStats (&Stats);
+
+	for (unsigned i = 0; i <= Stats.nBuckets; i++)
+	{
+		const THeapBucketStats *pBucket = i < Stats.nBuckets ? &Stats.Bucket[i] : &Stats.Large;
+
+		CLogger::Get ()->Write (m_pHeapName, LogDebug,
+					"malloc(%lu): %lu blocks (%lu allocated, %u free)",
+					pBucket->nSize, pBucket->nAllocations - pBucket->nFrees,
+					pBucket->nAllocations, pBucket->nFreeBlocks);
+	}
+
+	CLogger::Get ()->Write (m_pHeapName, LogDebug, "%lu bytes free in large blocks",
+				Stats.nLargeFreeBytes);
+}
+
+#endif
+
+void *CHeapAllocator::AllocateLarge (size_t nSize)
+{
+	nSize = (nSize + HEAP_ALIGN_MASK) & ~HEAP_ALIGN_MASK;
+	if (nSize > 0xFFFFFFFFU - HEAP_BLOCK_ALIGN)
+	{
+		return 0;
+	}
+
+	m_SpinLock.Acquire ();
+
+	// first fit
+	THeapBlockHeader *pPrev = 0;
+	THeapBlockHeader *pBlockHeader = m_pLargeFreeList;
+	while (   pBlockHeader != 0
+	       && pBlockHeader->nSize < nSize)
+	{
+		pPrev = pBlockHeader;
+		pBlockHeader = pBlockHeader->pNext;
+	}
+
+	if (pBlockHeader != 0)
+	{
+		assert (pBlockHeader->nMagic == HEAP_BLOCK_MAGIC);
+
+		size_t nRest = pBlockHeader->nSize - nSize;
+		if (nRest >= sizeof (THeapBlockHeader) + LARGE_SPLIT_MIN)
+		{
+			// the upper part remains on the free list
+			THeapBlockHeader *pRest = (THeapBlockHeader *) (pBlockHeader->Data + nSize);
+			pRest->nMagic = HEAP_BLOCK_MAGIC;
+			pRest->nSize = (u32) (nRest - sizeof (THeapBlockHeader));
+			pRest->pNext = pBlockHeader->pNext;
+			if (pPrev != 0)
+			{
+				pPrev->pNext = pRest;
+			}
+			else
+			{
+				m_pLargeFreeList = pRest;
+			}
+
+			pBlockHeader->nSize = (u32) nSize;
+
+			m_nLargeFreeBytes -= nSize + sizeof (THeapBlockHeader);
+		}
+		else
+		{
+			if (pPrev != 0)
+			{
+				pPrev->pNext = pBlockHeader->pNext;
+			}
+			else
+			{
+				m_pLargeFreeList = pBlockHeader->pNext;
+			}
+
+			m_nLargeFreeCount--;
+			m_nLargeFreeBytes -= pBlockHeader->nSize;
+		}
+	}
+	else
+	{
+		pBlockHeader = AllocateFromRegion (nSize);
+	}
+
+	if (pBlockHeader != 0)
+	{
+		m_CoreCache[GetCoreNumber ()].nAllocations[m_nBuckets]++;
+	}
+
+	m_SpinLock.Release ();
+
+	if (pBlockHeader == 0)
+	{
+		OutOfMemory ();
+
+		return 0;
+	}
+
+	pBlockHeader->pNext = 0;
+
+	void *pResult = pBlockHeader->Data;
+	assert (((uintptr) pResult & HEAP_ALIGN_MASK) == 0);
+
+	return pResult;
+}
+
+void CHeapAllocator::FreeLarge (THeapBlockHeader *pBlockHeader)
+{
+	assert (pBlockHeader != 0);
+	assert ((pBlockHeader->nSize & HEAP_ALIGN_MASK) == 0);
+
+	m_SpinLock.Acquire ();
+
+	m_CoreCache[GetCoreNumber ()].nFrees[m_nBuckets]++;
+
+	// insert sorted by address
+	THeapBlockHeader *pPrev = 0;
+	THeapBlockHeader *pNext = m_pLargeFreeList;
+	while (   pNext != 0
+	       && pNext < pBlockHeader)
+	{
+		pPrev = pNext;
+		pNext = pNext->pNext;
+	}
+
+	pBlockHeader->pNext = pNext;
+	if (pPrev != 0)
+	{
+		pPrev->pNext = pBlockHeader;
+	}
+	else
 	{
-		CLogger::Get ()->Write (m_pHeapName, LogDebug, "malloc(%lu): %u blocks (max %u)",
-					pBucket->nSize, pBucket->nCount, pBucket->nMaxCount);
+		m_pLargeFreeList = pBlockHeader;
+	}
+
+	m_nLargeFreeCount++;
+	m_nLargeFreeBytes += pBlockHeader->nSize;
+
+	// merge with the following block
+	if (   pNext != 0
+	    && pBlockHeader->Data + pBlockHeader->nSize == (u8 *) pNext
+	    && (size_t) pBlockHeader->nSize + sizeof (THeapBlockHeader) + pNext->nSize
+		<= 0xFFFFFFFFU - HEAP_BLOCK_ALIGN)
+	{
+		pBlockHeader->nSize += sizeof (THeapBlockHeader) + pNext->nSize;
+		pBlockHeader->pNext = pNext->pNext;
+		pNext->nMagic = 0;
+
+		m_nLargeFreeCount--;
+		m_nLargeFreeBytes += sizeof (THeapBlockHeader);
+	}
+
+	// merge with the preceding block
+	if (   pPrev != 0
+	    && pPrev->Data + pPrev->nSize == (u8 *) pBlockHeader
+	    && (size_t) pPrev->nSize + sizeof (THeapBlockHeader) + pBlockHeader->nSize
+		<= 0xFFFFFFFFU - HEAP_BLOCK_ALIGN)
+	{
+		pPrev->nSize += sizeof (THeapBlockHeader) + pBlockHeader->nSize;
+		pPrev->pNext = pBlockHeader->pNext;
+		pBlockHeader->nMagic = 0;
+
+		m_nLargeFreeCount--;
+		m_nLargeFreeBytes += sizeof (THeapBlockHeader);
+
+		pBlockHeader = pPrev;
+	}
+
+	// return the last block to the free space of the region
+	if (   pBlockHeader->pNext == 0
+	    && pBlockHeader->Data + pBlockHeader->nSize == m_pNext)
+	{
+		if (m_pLargeFreeList == pBlockHeader)
+		{
+			m_pLargeFreeList = 0;
+		}
+		else
+		{
+			THeapBlockHeader *pLast = m_pLargeFreeList;
+			while (pLast->pNext != pBlockHeader)
+			{
+				pLast = pLast->pNext;
+				assert (pLast != 0);
+			}
+			pLast->pNext = 0;
+		}
+
+		m_nLargeFreeCount--;
+		m_nLargeFreeBytes -= pBlockHeader->nSize;
+
+		pBlockHeader->nMagic = 0;
+		m_pNext = (u8 *) pBlockHeader;
+	}
+
+	m_SpinLock.Release ();
+}
+
+THeapBlockHeader *CHeapAllocator::AllocateFromRegion (size_t nSize)
+{
+	THeapBlockHeader *pBlockHeader = (THeapBlockHeader *) m_pNext;
+
+	u8 *pNextBlock = m_pNext;
+	pNextBlock += (sizeof (THeapBlockHeader) + nSize + HEAP_BLOCK_ALIGN-1) & ~HEAP_ALIGN_MASK;
+
+	if (   pNextBlock <= m_pNext			// may have wrapped
+	    || pNextBlock > m_pLimit-m_nReserve)
+	{
+		return 0;
+	}
+
+	m_pNext = pNextBlock;
+
+	pBlockHeader->nMagic = HEAP_BLOCK_MAGIC;
+	pBlockHeader->nSize = (u32) nSize;
+
+	return pBlockHeader;
+}
+
+void CHeapAllocator::RefillMagazine (unsigned nCore, unsigned nBucket)
+{
+	THeapBlockBucket *pBucket = &m_Bucket[nBucket];
+	TCoreCache *pCache = &m_CoreCache[nCore];
+
+	THeapBlockHeader *pBlockHeader;
+	while (   pCache->nMagazineCount[nBucket] < HEAP_MAGAZINE_SIZE/2
+	       && (pBlockHeader = pBucket->pFreeList) != 0)
+	{
+		pBucket->pFreeList = pBlockHeader->pNext;
+		pBucket->nFreeCount--;
+
+		pBlockHeader->pNext = pCache->pMagazine[nBucket];
+		pCache->pMagazine[nBucket] = pBlockHeader;
+		pCache->nMagazineCount[nBucket]++;
 	}
 }
 
+void CHeapAllocator::FlushMagazine (unsigned nCore, unsigned nBucket)
+{
+	THeapBlockBucket *pBucket = &m_Bucket[nBucket];
+	TCoreCache *pCache = &m_CoreCache[nCore];
+
+	THeapBlockHeader *pBlockHeader;
+	while (   pCache->nMagazineCount[nBucket] > HEAP_MAGAZINE_SIZE/2
+	       && (pBlockHeader = pCache->pMagazine[nBucket]) != 0)
+	{
+		pCache->pMagazine[nBucket] = pBlockHeader->pNext;
+		pCache->nMagazineCount[nBucket]--;
+
+		pBlockHeader->pNext = pBucket->pFreeList;
+		pBucket->pFreeList = pBlockHeader;
+		pBucket->nFreeCount++;
+	}
+}
+
+void CHeapAllocator::OutOfMemory (void)
+{
+	m_SpinLock.Acquire ();
+
+	if (m_nReserve == 0)
+	{
+		m_SpinLock.Release ();
+
+		return;
+	}
+
+	m_nReserve = 0;
+
+	m_SpinLock.Release ();
+
+#ifdef HEAP_DEBUG
+	DumpStatus ();
+#endif
+#if STDLIB_SUPPORT == 3
+	// C++ exception should be thrown after returning 0
+	CLogger::Get ()->WriteNoAlloc (m_pHeapName, LogWarning, "Out of memory");
+#else
+	CLogger::Get ()->Write (m_pHeapName, LogPanic, "Out of memory");
 #endif
+}
+
+unsigned CHeapAllocator::GetCoreNumber (void)
+{
+#ifdef ARM_ALLOW_MULTI_CORE
+	return CMultiCoreSupport::ThisCore ();
+#else
+	return 0;
+#endif
+}
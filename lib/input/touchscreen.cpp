@@ -99,7 +99,7 @@ void CTouchScreenDevice::Update (void)
 {
 	TFT5406Buffer Regs;
 	assert (m_pFT5406Buffer != 0);
-	memcpy (&Regs, m_pFT5406Buffer, sizeof *m_pFT5406Buffer);
+	memcpyblk (&Regs, m_pFT5406Buffer, sizeof *m_pFT5406Buffer);
 	*(volatile u8 *) &m_pFT5406Buffer->NumPoints = 99;
 
 	// Do not output if theres no new information (NumPoints is 99)
@@ -18,6 +18,7 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 #include <circle/interrupt.h>
+#include <circle/binarytracer.h>
 #include <circle/synchronize.h>
 #include <circle/multicore.h>
 #include <circle/bcm2835.h>
@@ -45,6 +46,19 @@
 				   ? ARM_IC_DISABLE_IRQS_2	\
 				   : ARM_IC_DISABLE_BASIC_IRQS))
 #define ARM_IRQ_MASK(irq)	(1 << ((irq) & (ARM_IRQS_PER_REG-1)))
+
+#if RASPPI >= 2
+
+static inline unsigned GetCoreNumber (void)
+{
+#ifdef ARM_ALLOW_MULTI_CORE
+	return CMultiCoreSupport::ThisCore ();
+#else
+	return 0;
+#endif
+}
+
+#endif
 				   
 CInterruptSystem *CInterruptSystem::s_pThis = 0;
 
@@ -173,9 +187,11 @@ void CInterruptSystem::EnableIRQ (unsigned nIRQ)
 	else
 	{
 #if RASPPI >= 2
-		assert (nIRQ == ARM_IRQLOCAL0_CNTPNS);	// the only implemented local IRQ so far
-		write32 (ARM_LOCAL_TIMER_INT_CONTROL0,
-			 read32 (ARM_LOCAL_TIMER_INT_CONTROL0) | (1 << 1));
+		// the generic timer IRQs are private per core
+		assert (   nIRQ == ARM_IRQLOCAL0_CNTPNS
+			|| nIRQ == ARM_IRQLOCAL0_CNTV);
+		uintptr nControl = ARM_LOCAL_TIMER_INT_CONTROL0 + 4 * GetCoreNumber ();
+		write32 (nControl, read32 (nControl) | (1 << (nIRQ - ARM_IRQLOCAL_BASE)));
 #else
 		assert (0);
 #endif
@@ -197,9 +213,11 @@ void CInterruptSystem::DisableIRQ (unsigned nIRQ)
 	else
 	{
 #if RASPPI >= 2
-		assert (nIRQ == ARM_IRQLOCAL0_CNTPNS);	// the only implemented local IRQ so far
-		write32 (ARM_LOCAL_TIMER_INT_CONTROL0,
-			 read32 (ARM_LOCAL_TIMER_INT_CONTROL0) & ~(1 << 1));
+		// the generic timer IRQs are private per core
+		assert (   nIRQ == ARM_IRQLOCAL0_CNTPNS
+			|| nIRQ == ARM_IRQLOCAL0_CNTV);
+		uintptr nControl = ARM_LOCAL_TIMER_INT_CONTROL0 + 4 * GetCoreNumber ();
+		write32 (nControl, read32 (nControl) & ~(1 << (nIRQ - ARM_IRQLOCAL_BASE)));
 #else
 		assert (0);
 #endif
@@ -241,6 +259,8 @@ boolean CInterruptSystem::CallIRQHandler (unsigned nIRQ)
 
 	if (pHandler != 0)
 	{
+		TRACE_SYSTEM_SCOPE (TRACE_EVENT_IRQ, nIRQ);
+
 		(*pHandler) (m_pParam[nIRQ]);
 		
 		return TRUE;
@@ -258,14 +278,21 @@ void CInterruptSystem::InterruptHandler (void)
 	assert (s_pThis != 0);
 
 #if RASPPI >= 2
-	u32 nLocalPending = read32 (ARM_LOCAL_IRQ_PENDING0);
-	assert (!(nLocalPending & ~(1 << 1 | 0xF << 4 | 1 << 8)));
-	if (nLocalPending & (1 << 1))		// the only implemented local IRQ so far
+	u32 nLocalPending = read32 (ARM_LOCAL_IRQ_PENDING0 + 4 * GetCoreNumber ());
+	assert (!(nLocalPending & ~(1 << 1 | 1 << 3 | 0xF << 4 | 1 << 8)));
+	if (nLocalPending & (1 << 1))		// CNTPNS
 	{
 		s_pThis->CallIRQHandler (ARM_IRQLOCAL0_CNTPNS);
 
 		return;
 	}
+
+	if (nLocalPending & (1 << 3))		// CNTV
+	{
+		s_pThis->CallIRQHandler (ARM_IRQLOCAL0_CNTV);
+
+		return;
+	}
 #endif
 
 #ifdef ARM_ALLOW_MULTI_CORE
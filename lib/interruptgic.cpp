@@ -20,6 +20,7 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 #include <circle/interrupt.h>
+#include <circle/binarytracer.h>
 #include <circle/synchronize.h>
 #include <circle/multicore.h>
 #include <circle/bcm2711.h>
@@ -279,6 +280,8 @@ boolean CInterruptSystem::CallIRQHandler (unsigned nIRQ)
 
 	if (pHandler != 0)
 	{
+		TRACE_SYSTEM_SCOPE (TRACE_EVENT_IRQ, nIRQ);
+
 		(*pHandler) (m_pParam[nIRQ]);
 		
 		return TRUE;
@@ -336,6 +339,15 @@ void CInterruptSystem::InitializeSecondary (void)
 	write32 (GICC_CTLR, GICC_CTLR_ENABLE);
 }
 
+void CInterruptSystem::RouteIRQ (unsigned nIRQ, unsigned nCore)
+{
+	assert (GIC_SPI (0) <= nIRQ && nIRQ < IRQ_LINES);
+	assert (nCore < CORES);
+
+	// the target registers are byte accessible, other cores may route their SPIs concurrently
+	write8 (GICD_ITARGETSR0 + nIRQ, GICD_ITARGETSR_CORE0 << nCore);
+}
+
 void CInterruptSystem::SendIPI (unsigned nCore, unsigned nIPI)
 {
 	assert (nCore <= 7);
@@ -18,138 +18,497 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 #include <circle/latencytester.h>
+#include <circle/multicore.h>
 #include <circle/bcm2835.h>
 #include <circle/memio.h>
 #include <circle/synchronize.h>
 #include <circle/logger.h>
+#include <circle/string.h>
 #include <circle/debug.h>
 #include <assert.h>
 
+#if RASPPI == 1
+	#define LATENCY_IRQ	ARM_IRQ_TIMER1
+#else
+	#define LATENCY_IRQ	ARM_IRQLOCAL0_CNTV
+#endif
+
+#define CNTV_CTL_ENABLE		(1 << 0)
+
+static const char FromLatency[] = "latency";
+
+#if RASPPI != 1
+
+static inline u64 ReadCounter (void)
+{
+#if AARCH == 32
+	u32 nCNTVCTLow, nCNTVCTHigh;
+	asm volatile ("isb; mrrc p15, 1, %0, %1, c14" : "=r" (nCNTVCTLow), "=r" (nCNTVCTHigh));
+
+	return (u64) nCNTVCTHigh << 32 | nCNTVCTLow;
+#else
+	u64 nCNTVCT;
+	asm volatile ("isb; mrs %0, CNTVCT_EL0" : "=r" (nCNTVCT));
+
+	return nCNTVCT;
+#endif
+}
+
+static inline void SetCompare (u64 nCompare)
+{
+#if AARCH == 32
+	asm volatile ("mcrr p15, 3, %0, %1, c14" :: "r" ((u32) nCompare), "r" ((u32) (nCompare >> 32)));
+#else
+	asm volatile ("msr CNTV_CVAL_EL0, %0" :: "r" (nCompare));
+#endif
+}
+
+static inline void SetControl (u32 nControl)
+{
+#if AARCH == 32
+	asm volatile ("mcr p15, 0, %0, c14, c3, 1; isb" :: "r" (nControl));
+#else
+	asm volatile ("msr CNTV_CTL_EL0, %0; isb" :: "r" ((u64) nControl));
+#endif
+}
+
+static inline u32 ReadFrequency (void)
+{
+#if AARCH == 32
+	u32 nCNTFRQ;
+	asm volatile ("mrc p15, 0, %0, c14, c0, 0" : "=r" (nCNTFRQ));
+
+	return nCNTFRQ;
+#else
+	u64 nCNTFRQ;
+	asm volatile ("mrs %0, CNTFRQ_EL0" : "=r" (nCNTFRQ));
+
+	return (u32) nCNTFRQ;
+#endif
+}
+
+#endif
+
+static inline unsigned GetCoreNumber (void)
+{
+#ifdef ARM_ALLOW_MULTI_CORE
+	return CMultiCoreSupport::ThisCore ();
+#else
+	return 0;
+#endif
+}
+
 CLatencyTester::CLatencyTester (CInterruptSystem *pInterruptSystem)
 :	m_pInterruptSystem (pInterruptSystem),
-	m_bRunning (FALSE)
+	m_nRunningCores (0)
 {
+#if RASPPI == 1
+	m_nFrequency = 1000000;
+#else
+	m_nFrequency = ReadFrequency ();
+#endif
+	assert (m_nFrequency > 0);
+
+	// nanoseconds per timer tick, shifted left by 24 bits
+	m_nLatencyScale = ((u64) 1000000000U << 24) / m_nFrequency;
+
+	for (unsigned nCore = 0; nCore < LATENCY_CORES; nCore++)
+	{
+		m_Core[nCore].bRunning = FALSE;
+		m_Core[nCore].bClear = FALSE;
+
+		ClearCore (&m_Core[nCore]);
+	}
 }
 
 CLatencyTester::~CLatencyTester (void)
 {
-	if (m_bRunning)
+	// only the measurement on this core can be stopped here
+	if (m_Core[GetCoreNumber ()].bRunning)
 	{
 		Stop ();
 	}
+
+	assert (m_nRunningCores == 0);
 }
 
 void CLatencyTester::Start (unsigned nSampleRateHZ)
 {
-	assert (!m_bRunning);
+	assert (nSampleRateHZ > 0);
 
-	m_nWantedDelay = (1000000 + nSampleRateHZ/2) / nSampleRateHZ;
+	unsigned nCore = GetCoreNumber ();
+	TCoreData *pCore = &m_Core[nCore];
+	assert (!pCore->bRunning);
 
-	m_nMinDelay = (unsigned) -1;
-	m_nMaxDelay = 0;
-	m_nDelayAccu = 0;
-	m_nSamples = 0;
-	m_bOverflow = FALSE;
+	ClearCore (pCore);
+	pCore->bClear = FALSE;
 
-	m_bRunning = TRUE;
+	pCore->nInterval = (m_nFrequency + nSampleRateHZ/2) / nSampleRateHZ;
+	assert (pCore->nInterval > 0);
 
+	m_SpinLock.Acquire ();
+
+	pCore->bRunning = TRUE;
+
+#if RASPPI == 1
 	PeripheralEntry ();
 
-	write32 (ARM_SYSTIMER_C1, read32 (ARM_SYSTIMER_CLO) + m_nWantedDelay);
-	
+	pCore->nCompare = (u32) (read32 (ARM_SYSTIMER_CLO) + pCore->nInterval);
+	write32 (ARM_SYSTIMER_C1, (u32) pCore->nCompare);
+
 	PeripheralExit ();
+#else
+	pCore->nCompare = ReadCounter () + pCore->nInterval;
+	SetCompare (pCore->nCompare);
+	SetControl (CNTV_CTL_ENABLE);
+#endif
+
+	// the IRQ line is private per core on RPi 2-4, it has to be enabled on each core
+	if (m_nRunningCores++ == 0)
+	{
+		m_pInterruptSystem->ConnectIRQ (LATENCY_IRQ, InterruptStub, this);
+	}
+	else
+	{
+		CInterruptSystem::EnableIRQ (LATENCY_IRQ);
+	}
 
-	m_pInterruptSystem->ConnectIRQ (ARM_IRQ_TIMER1, InterruptStub, this);
+	m_SpinLock.Release ();
 }
 
 void CLatencyTester::Stop (void)
 {
-	assert (m_bRunning);
+	TCoreData *pCore = &m_Core[GetCoreNumber ()];
+	assert (pCore->bRunning);
 
-	m_pInterruptSystem->DisconnectIRQ (ARM_IRQ_TIMER1);
+	m_SpinLock.Acquire ();
 
-	m_bRunning = FALSE;
+#if RASPPI != 1
+	SetControl (0);
+#endif
+
+	assert (m_nRunningCores > 0);
+	if (--m_nRunningCores == 0)
+	{
+		m_pInterruptSystem->DisconnectIRQ (LATENCY_IRQ);
+	}
+	else
+	{
+		CInterruptSystem::DisableIRQ (LATENCY_IRQ);
+	}
+
+	pCore->bRunning = FALSE;
+
+	m_SpinLock.Release ();
+}
+
+void CLatencyTester::Clear (void)
+{
+	m_SpinLock.Acquire ();
+
+	// the data of a running core is cleared by its interrupt handler
+	for (unsigned nCore = 0; nCore < LATENCY_CORES; nCore++)
+	{
+		if (m_Core[nCore].bRunning)
+		{
+			m_Core[nCore].bClear = TRUE;
+		}
+		else
+		{
+			ClearCore (&m_Core[nCore]);
+		}
+	}
+
+	m_SpinLock.Release ();
 }
 
 unsigned CLatencyTester::GetMin (void) const
 {
-	return m_nMinDelay;
+	unsigned nMin = (unsigned) -1;
+
+	for (unsigned nCore = 0; nCore < LATENCY_CORES; nCore++)
+	{
+		if (m_Core[nCore].nMinLatency < nMin)
+		{
+			nMin = m_Core[nCore].nMinLatency;
+		}
+	}
+
+	return nMin != (unsigned) -1 ? nMin / 1000 : nMin;
 }
 
 unsigned CLatencyTester::GetMax (void) const
 {
-	return m_nMaxDelay;
+	unsigned nMax = 0;
+
+	for (unsigned nCore = 0; nCore < LATENCY_CORES; nCore++)
+	{
+		if (m_Core[nCore].nMaxLatency > nMax)
+		{
+			nMax = m_Core[nCore].nMaxLatency;
+		}
+	}
+
+	return nMax / 1000;
 }
 
 unsigned CLatencyTester::GetAvg (void)
 {
-	m_SpinLock.Acquire ();
+	u64 nSum = 0;
+	u64 nSamples = 0;
 
-	if (m_bOverflow)
+	for (unsigned nCore = 0; nCore < LATENCY_CORES; nCore++)
 	{
-		m_SpinLock.Release ();
+		nSum += m_Core[nCore].nLatencySum;
+		nSamples += m_Core[nCore].nSamples;
+	}
+
+	return nSamples > 0 ? (unsigned) (nSum / nSamples / 1000) : 0;
+}
 
-		return (unsigned) -1;
+unsigned CLatencyTester::GetSamples (unsigned nCore) const
+{
+	if (nCore < LATENCY_CORES)
+	{
+		return m_Core[nCore].nSamples;
 	}
 
-	unsigned nDelayAccu = m_nDelayAccu;
-	unsigned nSamples = m_nSamples;
+	assert (nCore == LATENCY_ALL_CORES);
 
-	m_SpinLock.Release ();
+	unsigned nSamples = 0;
+	for (unsigned i = 0; i < LATENCY_CORES; i++)
+	{
+		nSamples += m_Core[i].nSamples;
+	}
 
-	return nSamples > 0 ? nDelayAccu / nSamples : 0;
+	return nSamples;
 }
 
-void CLatencyTester::Dump (void)
+unsigned CLatencyTester::GetPercentile (unsigned nPermyriad, unsigned nCore) const
 {
-	CLogger::Get ()->Write ("latency", LogNotice, "IRQ latency: Min %u Max %u Avg %u (us)",
-				GetMin (), GetMax (), GetAvg ());
+	assert (nPermyriad <= 10000);
+
+	unsigned Histogram[LATENCY_BUCKETS];
+	GetHistogram (Histogram, nCore);
+
+	u64 nTotal = 0;
+	for (unsigned i = 0; i < LATENCY_BUCKETS; i++)
+	{
+		nTotal += Histogram[i];
+	}
+
+	if (nTotal == 0)
+	{
+		return 0;
+	}
+
+	// rank of the wanted sample, rounded up
+	u64 nRank = (nTotal * nPermyriad + 9999) / 10000;
+	if (nRank == 0)
+	{
+		nRank = 1;
+	}
+
+	unsigned nMax = 0;
+	for (unsigned i = 0; i < LATENCY_CORES; i++)
+	{
+		if (   (nCore == LATENCY_ALL_CORES || nCore == i)
+		    && m_Core[i].nMaxLatency > nMax)
+		{
+			nMax = m_Core[i].nMaxLatency;
+		}
+	}
+
+	u64 nCount = 0;
+	for (unsigned i = 0; i < LATENCY_BUCKETS; i++)
+	{
+		nCount += Histogram[i];
+		if (nCount >= nRank)
+		{
+			unsigned nLimit = GetBucketLimit (i);
+
+			return nLimit < nMax ? nLimit : nMax;
+		}
+	}
+
+	return nMax;
 }
 
-void CLatencyTester::InterruptHandler (void)
+void CLatencyTester::GetHistogram (unsigned *pBuckets, unsigned nCore) const
 {
-	PeripheralEntry ();
+	assert (pBuckets != 0);
+	assert (nCore <= LATENCY_ALL_CORES);
 
-	u32 nClock = read32 (ARM_SYSTIMER_CLO);
-	u32 nCompare = read32 (ARM_SYSTIMER_C1);
-	u32 nDelay = nClock - nCompare;
+	for (unsigned i = 0; i < LATENCY_BUCKETS; i++)
+	{
+		pBuckets[i] = 0;
+	}
 
-#ifndef NDEBUG
-	//debug_click ();
+	for (unsigned i = 0; i < LATENCY_CORES; i++)
+	{
+		if (   nCore == LATENCY_ALL_CORES
+		    || nCore == i)
+		{
+			for (unsigned j = 0; j < LATENCY_BUCKETS; j++)
+			{
+				pBuckets[j] += m_Core[i].Histogram[j];
+			}
+		}
+	}
+}
+
+unsigned CLatencyTester::GetBucketLimit (unsigned nBucket)
+{
+	assert (nBucket < LATENCY_BUCKETS);
+
+	if (nBucket < LATENCY_SUB_BUCKETS)
+	{
+		return nBucket;
+	}
+
+	unsigned nShift = nBucket / LATENCY_SUB_BUCKETS - 1;
+	unsigned nSubBucket = nBucket % LATENCY_SUB_BUCKETS;
+
+	u64 nLimit = ((u64) (LATENCY_SUB_BUCKETS + nSubBucket + 1) << nShift) - 1;
+
+	return (unsigned) nLimit;
+}
+
+void CLatencyTester::Dump (boolean bHistogram)
+{
+	for (unsigned nCore = 0; nCore < LATENCY_CORES; nCore++)
+	{
+		if (m_Core[nCore].nSamples > 0)
+		{
+			DumpCore (nCore, bHistogram);
+		}
+	}
+
+#if LATENCY_CORES > 1
+	DumpCore (LATENCY_ALL_CORES, bHistogram);
 #endif
+}
 
-	m_SpinLock.Acquire ();
+void CLatencyTester::DumpCore (unsigned nCore, boolean bHistogram)
+{
+	CLogger *pLogger = CLogger::Get ();
+	assert (pLogger != 0);
 
-	if (nDelay < m_nMinDelay)
+	CString Source;
+	if (nCore < LATENCY_CORES)
+	{
+		Source.Format ("Core %u", nCore);
+	}
+	else
 	{
-		m_nMinDelay = nDelay;
+		Source = "All cores";
 	}
 
-	if (nDelay > m_nMaxDelay)
+	pLogger->Write (FromLatency, LogNotice,
+			"%s: IRQ latency: p50 %u p99 %u p99.9 %u Max %u (ns, %u samples)",
+			(const char *) Source,
+			GetPercentile (5000, nCore), GetPercentile (9900, nCore),
+			GetPercentile (9990, nCore), GetPercentile (10000, nCore),
+			GetSamples (nCore));
+
+	if (!bHistogram)
 	{
-		m_nMaxDelay = nDelay;
+		return;
 	}
 
-	if (!m_bOverflow)
+	unsigned Histogram[LATENCY_BUCKETS];
+	GetHistogram (Histogram, nCore);
+
+	for (unsigned i = 0; i < LATENCY_BUCKETS; i++)
 	{
-		if (   m_nDelayAccu + nDelay >= m_nDelayAccu
-		    && m_nSamples + 1 != 0)
-		{
-			m_nDelayAccu += nDelay;
-			m_nSamples++;
-		}
-		else
+		if (Histogram[i] > 0)
 		{
-			m_bOverflow = TRUE;
+			unsigned nLow = i > 0 ? GetBucketLimit (i-1) + 1 : 0;
+
+			pLogger->Write (FromLatency, LogNotice, "%10u-%10u ns: %u",
+					nLow, GetBucketLimit (i), Histogram[i]);
 		}
 	}
+}
 
-	m_SpinLock.Release ();
+void CLatencyTester::ClearCore (TCoreData *pCore)
+{
+	assert (pCore != 0);
+
+	pCore->nMinLatency = (unsigned) -1;
+	pCore->nMaxLatency = 0;
+	pCore->nLatencySum = 0;
+	pCore->nSamples = 0;
 
-	write32 (ARM_SYSTIMER_C1, read32 (ARM_SYSTIMER_CLO) + m_nWantedDelay);
+	for (unsigned i = 0; i < LATENCY_BUCKETS; i++)
+	{
+		pCore->Histogram[i] = 0;
+	}
+}
+
+void CLatencyTester::InterruptHandler (void)
+{
+	TCoreData *pCore = &m_Core[GetCoreNumber ()];
+
+#if RASPPI == 1
+	PeripheralEntry ();
+
+	u32 nCounter = read32 (ARM_SYSTIMER_CLO);
+	u32 nDelay = nCounter - (u32) pCore->nCompare;
+
+	pCore->nCompare = (u32) (pCore->nCompare + pCore->nInterval);
+	if ((int) ((u32) pCore->nCompare - nCounter) <= 0)
+	{
+		pCore->nCompare = nCounter + pCore->nInterval;	// do not catch up missed samples
+	}
+
+	write32 (ARM_SYSTIMER_C1, (u32) pCore->nCompare);
 	write32 (ARM_SYSTIMER_CS, 1 << 1);
 
 	PeripheralExit ();
+#else
+	u64 nCounter = ReadCounter ();
+	u64 nDelay = nCounter - pCore->nCompare;
+
+	pCore->nCompare += pCore->nInterval;
+	if ((s64) (pCore->nCompare - nCounter) <= 0)
+	{
+		pCore->nCompare = nCounter + pCore->nInterval;	// do not catch up missed samples
+	}
+
+	SetCompare (pCore->nCompare);				// clears the interrupt
+#endif
+
+#ifndef NDEBUG
+	//debug_click ();
+#endif
+
+	if (nDelay > m_nFrequency)				// limit to 1 second
+	{
+		nDelay = m_nFrequency;
+	}
+
+	unsigned nLatency = (unsigned) (((u64) nDelay * m_nLatencyScale) >> 24);
+
+	if (pCore->bClear)
+	{
+		ClearCore (pCore);
+		pCore->bClear = FALSE;
+	}
+
+	if (nLatency < pCore->nMinLatency)
+	{
+		pCore->nMinLatency = nLatency;
+	}
+
+	if (nLatency > pCore->nMaxLatency)
+	{
+		pCore->nMaxLatency = nLatency;
+	}
+
+	pCore->nLatencySum += nLatency;
+	pCore->nSamples++;
+	pCore->Histogram[GetBucket (nLatency)]++;
 }
 
 void CLatencyTester::InterruptStub (void *pParam)
@@ -158,3 +517,17 @@ void CLatencyTester::InterruptStub (void *pParam)
 
 	pTimer->InterruptHandler ();
 }
+
+unsigned CLatencyTester::GetBucket (unsigned nLatency)
+{
+	if (nLatency < LATENCY_SUB_BUCKETS)
+	{
+		return nLatency;
+	}
+
+	unsigned nMSB = 31 - __builtin_clz (nLatency);
+	unsigned nShift = nMSB - LATENCY_SUB_BUCKETS_SHIFT;
+
+	return   (nShift + 1) * LATENCY_SUB_BUCKETS
+	       + ((nLatency >> nShift) & (LATENCY_SUB_BUCKETS-1));
+}
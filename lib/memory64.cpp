@@ -30,6 +30,7 @@ CMemorySystem *CMemorySystem::s_pThis = 0;
 
 CMemorySystem::CMemorySystem (boolean bEnableMMU, boolean enable_ECC)
 :	m_bEnableMMU (bEnableMMU),
+	m_bEnableECC (enable_ECC),
 	m_nMemSize (0),
 	m_nMemSizeHigh (0),
 	m_HeapLow ("heaplow"),
@@ -129,7 +130,7 @@ void CMemorySystem::InitializeSecondary (void)
 	assert (s_pThis != 0);
 	assert (s_pThis->m_bEnableMMU);		// required to use spin locks
 
-	s_pThis->EnableMMU ();
+	s_pThis->EnableMMU (s_pThis->m_bEnableECC);
 }
 
 #endif
@@ -21,6 +21,7 @@
 #include <circle/net/nettask.h>
 #include <circle/net/dhcpclient.h>
 #include <circle/sched/scheduler.h>
+#include <circle/binarytracer.h>
 #include <assert.h>
 
 CNetSubSystem *CNetSubSystem::s_pThis = 0;
@@ -118,6 +119,8 @@ void CNetSubSystem::Process (void)
 		return;
 	}
 
+	TRACE_SYSTEM_SCOPE (TRACE_EVENT_NET_PROCESS, 0);
+
 	if (   m_bUseDHCP
 	    && m_pDHCPClient == 0
 	    && m_NetDevLayer.IsRunning ())
@@ -18,20 +18,34 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 #include <circle/pageallocator.h>
+#include <circle/multicore.h>
 #include <circle/logger.h>
 #include <assert.h>
 
 #define PAGE_MASK	(PAGE_SIZE-1)
 
+#define BLOCK_SIZE(order)	((size_t) PAGE_SIZE << (order))
+
 CPageAllocator::CPageAllocator (void)
-:	m_pNext (0),
-	m_pLimit (0),
+:	m_nBase (0),
+	m_nLimit (0),
+	m_pPageMap (0),
+	m_nFreeSpace (0)
 #ifdef PAGE_DEBUG
-	m_nCount (0),
-	m_nMaxCount (0),
+	, m_nCount (0),
+	m_nMaxCount (0)
 #endif
-	m_pFreeList (0)
 {
+	for (unsigned i = 0; i <= PAGE_MAX_ORDER; i++)
+	{
+		m_pFreeList[i] = 0;
+	}
+
+	for (unsigned i = 0; i < PAGE_CORES; i++)
+	{
+		m_CoreCache[i].pList = 0;
+		m_CoreCache[i].nCount = 0;
+	}
 }
 
 CPageAllocator::~CPageAllocator (void)
@@ -40,52 +54,138 @@ CPageAllocator::~CPageAllocator (void)
 
 void CPageAllocator::Setup (uintptr nBase, size_t nSize)
 {
-	m_pNext = (u8 *) ((nBase + PAGE_SIZE-1) & ~PAGE_MASK);
-	m_pLimit = (u8 *) ((nBase + nSize) & ~PAGE_MASK);
+	uintptr nStart = (nBase + PAGE_SIZE-1) & ~PAGE_MASK;
+	m_nLimit = (nBase + nSize) & ~PAGE_MASK;
+	assert (nStart < m_nLimit);
+
+	// the page map is placed at the beginning of the region
+	size_t nPages = (m_nLimit - nStart) / PAGE_SIZE;
+	size_t nMapPages = (nPages + PAGE_SIZE-1) / PAGE_SIZE;
+	assert (nMapPages < nPages);
+
+	m_pPageMap = (u8 *) nStart;
+	m_nBase = nStart + nMapPages * PAGE_SIZE;
+
+	// may be called with MMU off, so use aligned single byte accesses only
+	for (size_t i = 0; i < nPages - nMapPages; i++)
+	{
+		m_pPageMap[i] = PAGE_MAP_NONE;
+	}
+
+	// divide the region into the largest blocks, which are aligned to their size
+	for (uintptr nBlock = m_nBase; nBlock < m_nLimit; )
+	{
+		unsigned nOrder = PAGE_MAX_ORDER;
+		while (   nOrder > 0
+		       && (   (nBlock & (BLOCK_SIZE (nOrder)-1))
+			   || nBlock + BLOCK_SIZE (nOrder) > m_nLimit))
+		{
+			nOrder--;
+		}
+
+		AddFree (nBlock, nOrder);
+
+		nBlock += BLOCK_SIZE (nOrder);
+	}
 }
 
 size_t CPageAllocator::GetFreeSpace (void) const
 {
-	return m_pLimit - m_pNext;
+	return m_nFreeSpace;
 }
 
 void *CPageAllocator::Allocate (void)
 {
-	assert (m_pNext != 0);
+	assert (m_pPageMap != 0);
 
-	m_SpinLock.Acquire ();
+	EnterCritical ();
 
-#ifdef PAGE_DEBUG
-	if (++m_nCount > m_nMaxCount)
+	TCoreCache *pCache = &m_CoreCache[GetCoreNumber ()];
+
+	if (pCache->nCount == 0)
 	{
-		m_nMaxCount = m_nCount;
+		m_SpinLock.Acquire ();
+
+		while (pCache->nCount < PAGE_CACHE_SIZE/2)
+		{
+			TFreePage *pFreePage = (TFreePage *) AllocateOrderLocked (0);
+			if (pFreePage == 0)
+			{
+				break;
+			}
+
+			pFreePage->nMagic = FREEPAGE_MAGIC;
+			pFreePage->pNext = pCache->pList;
+			pCache->pList = pFreePage;
+			pCache->nCount++;
+		}
+
+		m_SpinLock.Release ();
 	}
-#endif
 
 	TFreePage *pFreePage;
-	if ((pFreePage = m_pFreeList) != 0)
+	if ((pFreePage = pCache->pList) != 0)
 	{
 		assert (pFreePage->nMagic == FREEPAGE_MAGIC);
-		m_pFreeList = pFreePage->pNext;
+		pCache->pList = pFreePage->pNext;
+		pCache->nCount--;
+
 		pFreePage->nMagic = 0;
 	}
-	else
+
+	LeaveCritical ();
+
+	// the callers of palloc() do not check the result
+	if (pFreePage == 0)
 	{
-		pFreePage = (TFreePage *) m_pNext;
+		CLogger::Get ()->Write ("pager", LogPanic, "Out of pages");
+	}
 
-		m_pNext += PAGE_SIZE;
+	return pFreePage;
+}
 
-		if (m_pNext > m_pLimit)
-		{
-			m_SpinLock.Release ();
+void *CPageAllocator::AllocateOrder (unsigned nOrder)
+{
+	assert (m_pPageMap != 0);
 
-			return 0;		// TODO: system should panic here
-		}
+	if (nOrder == 0)
+	{
+		return Allocate ();
 	}
 
+	if (nOrder > PAGE_MAX_ORDER)
+	{
+		return 0;
+	}
+
+	m_SpinLock.Acquire ();
+
+	void *pBlock = AllocateOrderLocked (nOrder);
+
 	m_SpinLock.Release ();
 
-	return pFreePage;
+	if (pBlock == 0)
+	{
+		// the cached pages of this core may prevent the buddies from being merged
+		EnterCritical ();
+
+		DrainCache ();
+
+		m_SpinLock.Acquire ();
+
+		pBlock = AllocateOrderLocked (nOrder);
+
+		m_SpinLock.Release ();
+
+		LeaveCritical ();
+	}
+
+	return pBlock;
+}
+
+void *CPageAllocator::AllocateBlock (size_t nSize)
+{
+	return AllocateOrder (GetOrder (nSize));
 }
 
 void CPageAllocator::Free (void *pPage)
@@ -95,27 +195,251 @@ void CPageAllocator::Free (void *pPage)
 		return;
 	}
 
+	uintptr nPage = (uintptr) pPage;
+	assert (!(nPage & PAGE_MASK));
+	assert (m_nBase <= nPage && nPage < m_nLimit);
+
+	// the entry of an allocated block does not change, until it is freed
+	if (m_pPageMap[GetPageIndex (nPage)] != 0)
+	{
+		m_SpinLock.Acquire ();
+
+		FreeLocked (pPage);
+
+		m_SpinLock.Release ();
+
+		return;
+	}
+
+	EnterCritical ();
+
+	TCoreCache *pCache = &m_CoreCache[GetCoreNumber ()];
+
+	if (pCache->nCount >= PAGE_CACHE_SIZE)
+	{
+		m_SpinLock.Acquire ();
+
+		while (pCache->nCount > PAGE_CACHE_SIZE/2)
+		{
+			TFreePage *pFreePage = pCache->pList;
+			assert (pFreePage != 0);
+			pCache->pList = pFreePage->pNext;
+			pCache->nCount--;
+
+			FreeLocked (pFreePage);
+		}
+
+		m_SpinLock.Release ();
+	}
+
 	TFreePage *pFreePage = (TFreePage *) pPage;
+	pFreePage->nMagic = FREEPAGE_MAGIC;
+	pFreePage->pNext = pCache->pList;
+	pCache->pList = pFreePage;
+	pCache->nCount++;
+
+	LeaveCritical ();
+}
+
+unsigned CPageAllocator::GetOrder (size_t nSize)
+{
+	unsigned nOrder = 0;
+	while (   BLOCK_SIZE (nOrder) < nSize
+	       && nOrder <= PAGE_MAX_ORDER)
+	{
+		nOrder++;
+	}
+
+	return nOrder;
+}
+
+#ifdef PAGE_DEBUG
+
+void CPageAllocator::DumpStatus (void)
+{
+	CLogger::Get ()->Write ("pager", LogDebug, "%u blocks (max %u), %lu KB free",
+				m_nCount, m_nMaxCount, (unsigned long) (m_nFreeSpace / 1024));
 
 	m_SpinLock.Acquire ();
 
-	pFreePage->nMagic = FREEPAGE_MAGIC;
+	unsigned Count[PAGE_MAX_ORDER+1];
+	for (unsigned i = 0; i <= PAGE_MAX_ORDER; i++)
+	{
+		Count[i] = 0;
+		for (TFreePage *pFreePage = m_pFreeList[i]; pFreePage != 0;
+		     pFreePage = pFreePage->pNext)
+		{
+			Count[i]++;
+		}
+	}
+
+	m_SpinLock.Release ();
+
+	for (unsigned i = 0; i <= PAGE_MAX_ORDER; i++)
+	{
+		if (Count[i] != 0)
+		{
+			CLogger::Get ()->Write ("pager", LogDebug, "order %u (%lu KB): %u free",
+						i, (unsigned long) (BLOCK_SIZE (i) / 1024), Count[i]);
+		}
+	}
+}
+
+#endif
+
+void *CPageAllocator::AllocateOrderLocked (unsigned nOrder)
+{
+	assert (nOrder <= PAGE_MAX_ORDER);
+
+	unsigned nFreeOrder = nOrder;
+	while (m_pFreeList[nFreeOrder] == 0)
+	{
+		if (++nFreeOrder > PAGE_MAX_ORDER)
+		{
+			return 0;
+		}
+	}
+
+	TFreePage *pFreePage = m_pFreeList[nFreeOrder];
+	RemoveFree (pFreePage, nFreeOrder);
+
+	// split the block, the upper halves remain free
+	uintptr nBlock = (uintptr) pFreePage;
+	while (nFreeOrder > nOrder)
+	{
+		nFreeOrder--;
+
+		AddFree (nBlock + BLOCK_SIZE (nFreeOrder), nFreeOrder);
+	}
 
-	pFreePage->pNext = m_pFreeList;
-	m_pFreeList = pFreePage;
+	m_pPageMap[GetPageIndex (nBlock)] = (u8) nOrder;
 
 #ifdef PAGE_DEBUG
-	m_nCount--;
+	if (++m_nCount > m_nMaxCount)
+	{
+		m_nMaxCount = m_nCount;
+	}
 #endif
 
-	m_SpinLock.Release ();
+	return pFreePage;
 }
 
+void CPageAllocator::FreeLocked (void *pPage)
+{
+	uintptr nBlock = (uintptr) pPage;
+	unsigned nIndex = GetPageIndex (nBlock);
+
+	unsigned nOrder = m_pPageMap[nIndex];
+	if (nOrder > PAGE_MAX_ORDER)		// PAGE_MAP_NONE or free
+	{
+		CLogger::Get ()->Write ("pager", LogPanic, "Invalid page freed (0x%lX)",
+					(unsigned long) nBlock);
+	}
+
+	m_pPageMap[nIndex] = PAGE_MAP_NONE;
+
 #ifdef PAGE_DEBUG
+	m_nCount--;
+#endif
 
-void CPageAllocator::DumpStatus (void)
+	// merge with the free buddies
+	while (nOrder < PAGE_MAX_ORDER)
+	{
+		uintptr nBuddy = nBlock ^ BLOCK_SIZE (nOrder);
+		if (   nBuddy < m_nBase
+		    || nBuddy + BLOCK_SIZE (nOrder) > m_nLimit
+		    || m_pPageMap[GetPageIndex (nBuddy)] != (PAGE_MAP_FREE | nOrder))
+		{
+			break;
+		}
+
+		RemoveFree ((TFreePage *) nBuddy, nOrder);
+
+		if (nBuddy < nBlock)
+		{
+			nBlock = nBuddy;
+		}
+
+		nOrder++;
+	}
+
+	AddFree (nBlock, nOrder);
+}
+
+void CPageAllocator::AddFree (uintptr nBlock, unsigned nOrder)
 {
-	CLogger::Get ()->Write ("pager", LogDebug, "%u pages (max %u)", m_nCount, m_nMaxCount);
+	assert (nOrder <= PAGE_MAX_ORDER);
+	assert (!(nBlock & (BLOCK_SIZE (nOrder)-1)));
+
+	TFreePage *pFreePage = (TFreePage *) nBlock;
+	pFreePage->nMagic = FREEPAGE_MAGIC;
+	pFreePage->nOrder = nOrder;
+	pFreePage->pPrev = 0;
+	pFreePage->pNext = m_pFreeList[nOrder];
+
+	if (m_pFreeList[nOrder] != 0)
+	{
+		m_pFreeList[nOrder]->pPrev = pFreePage;
+	}
+	m_pFreeList[nOrder] = pFreePage;
+
+	m_pPageMap[GetPageIndex (nBlock)] = PAGE_MAP_FREE | nOrder;
+
+	m_nFreeSpace += BLOCK_SIZE (nOrder);
 }
 
+void CPageAllocator::RemoveFree (TFreePage *pFreePage, unsigned nOrder)
+{
+	assert (pFreePage != 0);
+	assert (pFreePage->nMagic == FREEPAGE_MAGIC);
+	assert (pFreePage->nOrder == nOrder);
+
+	if (pFreePage->pPrev != 0)
+	{
+		pFreePage->pPrev->pNext = pFreePage->pNext;
+	}
+	else
+	{
+		assert (m_pFreeList[nOrder] == pFreePage);
+		m_pFreeList[nOrder] = pFreePage->pNext;
+	}
+
+	if (pFreePage->pNext != 0)
+	{
+		pFreePage->pNext->pPrev = pFreePage->pPrev;
+	}
+
+	pFreePage->nMagic = 0;
+
+	m_pPageMap[GetPageIndex ((uintptr) pFreePage)] = PAGE_MAP_NONE;
+
+	m_nFreeSpace -= BLOCK_SIZE (nOrder);
+}
+
+void CPageAllocator::DrainCache (void)
+{
+	TCoreCache *pCache = &m_CoreCache[GetCoreNumber ()];
+
+	m_SpinLock.Acquire ();
+
+	TFreePage *pFreePage;
+	while ((pFreePage = pCache->pList) != 0)
+	{
+		assert (pFreePage->nMagic == FREEPAGE_MAGIC);
+		pCache->pList = pFreePage->pNext;
+		pCache->nCount--;
+
+		FreeLocked (pFreePage);
+	}
+
+	m_SpinLock.Release ();
+}
+
+unsigned CPageAllocator::GetCoreNumber (void)
+{
+#ifdef ARM_ALLOW_MULTI_CORE
+	return CMultiCoreSupport::ThisCore ();
+#else
+	return 0;
 #endif
+}
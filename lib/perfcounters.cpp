@@ -0,0 +1,335 @@
+//
+// perfcounters.cpp
+//
+// Circle - A C++ bare metal environment for Raspberry Pi
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+#include <circle/perfcounters.h>
+#include <circle/multicore.h>
+#include <circle/synchronize.h>
+#include <circle/sysconfig.h>
+#include <assert.h>
+
+// PMCR_EL0
+#define PMCR_ENABLE		(1 << 0)
+#define PMCR_RESET_EVENTS	(1 << 1)
+#define PMCR_RESET_CYCLES	(1 << 2)
+#define PMCR_LONG_CYCLES	(1 << 6)		// 64-bit overflow of PMCCNTR_EL0
+#define PMCR_N__SHIFT		11
+#define PMCR_N__MASK		(0x1F << 11)
+
+// PMCNTENSET_EL0, PMCNTENCLR_EL0, PMOVSSET_EL0, PMOVSCLR_EL0, PMINTENSET_EL1, PMINTENCLR_EL1
+#define PMU_CYCLES_BIT		(1U << 31)
+
+// PMEVTYPER<n>_EL0 with the filter bits 0 counts at EL0 and EL1
+#define PMEVTYPER_EVENT__MASK	0xFFFF
+
+#define OVERFLOW_HALF		0x80000000U
+
+CPerfCounters::CPerfCounters (CInterruptSystem *pInterruptSystem)
+:	m_pInterruptSystem (pInterruptSystem),
+	m_nIRQ (0),
+	m_nCore (0),
+	m_nEvents (0),
+	m_nEventMask (0)
+{
+	for (unsigned i = 0; i < PERF_MAX_COUNTERS; i++)
+	{
+		m_Overflows[i] = 0;
+	}
+}
+
+CPerfCounters::~CPerfCounters (void)
+{
+	Stop ();
+
+	asm volatile ("msr pmintenclr_el1, %0" :: "r" ((u64) m_nEventMask));
+
+#if RASPPI >= 4
+	if (m_nIRQ != 0)
+	{
+		assert (m_pInterruptSystem != 0);
+		m_pInterruptSystem->DisconnectIRQ (m_nIRQ);
+		CInterruptSystem::RouteIRQ (m_nIRQ, 0);
+
+		m_nIRQ = 0;
+	}
+#endif
+
+	m_pInterruptSystem = 0;
+}
+
+boolean CPerfCounters::Initialize (const TPerfEvent *pEvents, unsigned nEvents)
+{
+	assert (m_nEvents == 0);
+	assert (nEvents <= PERF_MAX_COUNTERS);
+	assert (pEvents != 0 || nEvents == 0);
+
+	if (nEvents > GetCounters ())
+	{
+		return FALSE;
+	}
+
+#ifdef ARM_ALLOW_MULTI_CORE
+	m_nCore = CMultiCoreSupport::ThisCore ();
+#endif
+
+	m_nEvents = nEvents;
+	m_nEventMask = (1U << nEvents) - 1;
+
+	u64 nMask = m_nEventMask | PMU_CYCLES_BIT;
+	asm volatile ("msr pmcntenclr_el0, %0" :: "r" (nMask));
+	asm volatile ("msr pmintenclr_el1, %0" :: "r" (nMask));
+	asm volatile ("msr pmovsclr_el0, %0" :: "r" (nMask));
+
+	for (unsigned i = 0; i < nEvents; i++)
+	{
+		m_Events[i] = pEvents[i];
+
+		asm volatile ("msr pmselr_el0, %0; isb" :: "r" ((u64) i));
+		asm volatile ("msr pmxevtyper_el0, %0"
+			      :: "r" ((u64) (pEvents[i] & PMEVTYPER_EVENT__MASK)));
+	}
+
+	asm volatile ("msr pmccfiltr_el0, %0" :: "r" (0UL));
+
+	u64 nPMCR;
+	asm volatile ("mrs %0, pmcr_el0" : "=r" (nPMCR));
+	nPMCR |= PMCR_ENABLE | PMCR_LONG_CYCLES;
+	asm volatile ("msr pmcr_el0, %0; isb" :: "r" (nPMCR));
+
+#if RASPPI >= 4
+	// each core has its own PMU interrupt, which is directed to this core
+	if (   m_pInterruptSystem != 0
+	    && nEvents > 0)
+	{
+		m_nIRQ = ARM_IRQ_PMU0 + m_nCore;
+
+		CInterruptSystem::RouteIRQ (m_nIRQ, m_nCore);
+		m_pInterruptSystem->ConnectIRQ (m_nIRQ, InterruptStub, this);
+
+		asm volatile ("msr pmintenset_el1, %0" :: "r" ((u64) m_nEventMask));
+	}
+#endif
+
+	return TRUE;
+}
+
+void CPerfCounters::Start (void)
+{
+	u64 nMask = m_nEventMask | PMU_CYCLES_BIT;
+	asm volatile ("msr pmcntenclr_el0, %0; isb" :: "r" (nMask));
+
+	EnterCritical ();
+
+	u64 nPMCR;
+	asm volatile ("mrs %0, pmcr_el0" : "=r" (nPMCR));
+	nPMCR |= PMCR_RESET_EVENTS | PMCR_RESET_CYCLES;
+	asm volatile ("msr pmcr_el0, %0; isb" :: "r" (nPMCR));
+
+	asm volatile ("msr pmovsclr_el0, %0" :: "r" (nMask));
+
+	for (unsigned i = 0; i < m_nEvents; i++)
+	{
+		m_Overflows[i] = 0;
+	}
+
+	LeaveCritical ();
+
+	asm volatile ("msr pmcntenset_el0, %0; isb" :: "r" (nMask));
+}
+
+void CPerfCounters::Stop (void)
+{
+	asm volatile ("msr pmcntenclr_el0, %0; isb"
+		      :: "r" ((u64) (m_nEventMask | PMU_CYCLES_BIT)) : "memory");
+}
+
+void CPerfCounters::Resume (void)
+{
+	asm volatile ("msr pmcntenset_el0, %0; isb"
+		      :: "r" ((u64) (m_nEventMask | PMU_CYCLES_BIT)) : "memory");
+}
+
+void CPerfCounters::Read (TPerfSample *pSample)
+{
+	assert (pSample != 0);
+
+	EnterCritical ();
+
+	pSample->nCycles = GetCycles ();
+
+	for (unsigned i = 0; i < PERF_MAX_COUNTERS; i++)
+	{
+		pSample->Count[i] = i < m_nEvents ? GetCount (i) : 0;
+	}
+
+	LeaveCritical ();
+}
+
+u64 CPerfCounters::GetCycles (void) const
+{
+	u64 nCycles;
+	asm volatile ("isb; mrs %0, pmccntr_el0" : "=r" (nCycles) :: "memory");
+
+	return nCycles;
+}
+
+u64 CPerfCounters::GetCount (unsigned nCounter)
+{
+	assert (nCounter < m_nEvents);
+
+	EnterCritical ();
+
+	UpdateOverflows ();
+
+	u32 nLow = ReadCounter (nCounter);
+
+	u64 nPending;
+	asm volatile ("mrs %0, pmovsset_el0" : "=r" (nPending));
+
+	u64 nHigh = m_Overflows[nCounter];
+
+	LeaveCritical ();
+
+	// the counter may have wrapped after UpdateOverflows(), this is not counted yet
+	if (   (nPending & (1U << nCounter))
+	    && nLow < OVERFLOW_HALF)
+	{
+		nHigh++;
+	}
+
+	return nHigh << 32 | nLow;
+}
+
+TPerfEvent CPerfCounters::GetEvent (unsigned nCounter) const
+{
+	assert (nCounter < m_nEvents);
+
+	return m_Events[nCounter];
+}
+
+unsigned CPerfCounters::GetCounters (void)
+{
+	u64 nPMCR;
+	asm volatile ("mrs %0, pmcr_el0" : "=r" (nPMCR));
+
+	return (nPMCR & PMCR_N__MASK) >> PMCR_N__SHIFT;
+}
+
+boolean CPerfCounters::IsSupported (TPerfEvent Event)
+{
+	u64 nEventIDs;
+	if (Event < 32)
+	{
+		asm volatile ("mrs %0, pmceid0_el0" : "=r" (nEventIDs));
+	}
+	else if (Event < 64)
+	{
+		asm volatile ("mrs %0, pmceid1_el0" : "=r" (nEventIDs));
+	}
+	else
+	{
+		return FALSE;
+	}
+
+	return nEventIDs & (1U << (Event % 32)) ? TRUE : FALSE;
+}
+
+void CPerfCounters::ClearSample (TPerfSample *pSample)
+{
+	assert (pSample != 0);
+
+	pSample->nCycles = 0;
+
+	for (unsigned i = 0; i < PERF_MAX_COUNTERS; i++)
+	{
+		pSample->Count[i] = 0;
+	}
+}
+
+void CPerfCounters::UpdateOverflows (void)
+{
+	u64 nStatus;
+	asm volatile ("mrs %0, pmovsset_el0" : "=r" (nStatus));
+
+	nStatus &= m_nEventMask;
+	if (nStatus == 0)
+	{
+		return;
+	}
+
+	asm volatile ("msr pmovsclr_el0, %0; isb" :: "r" (nStatus));
+
+	for (unsigned i = 0; i < m_nEvents; i++)
+	{
+		if (nStatus & (1U << i))
+		{
+			m_Overflows[i]++;
+		}
+	}
+}
+
+void CPerfCounters::InterruptHandler (void)
+{
+#ifdef ARM_ALLOW_MULTI_CORE
+	assert (CMultiCoreSupport::ThisCore () == m_nCore);
+#endif
+
+	UpdateOverflows ();
+}
+
+void CPerfCounters::InterruptStub (void *pParam)
+{
+	CPerfCounters *pThis = (CPerfCounters *) pParam;
+	assert (pThis != 0);
+
+	pThis->InterruptHandler ();
+}
+
+u32 CPerfCounters::ReadCounter (unsigned nCounter)
+{
+	u64 nValue;
+	asm volatile ("msr pmselr_el0, %1; isb; mrs %0, pmxevcntr_el0"
+		      : "=r" (nValue) : "r" ((u64) nCounter) : "memory");
+
+	return (u32) nValue;
+}
+
+CPerfScope::CPerfScope (CPerfCounters *pCounters, TPerfSample *pSum)
+:	m_pCounters (pCounters),
+	m_pSum (pSum)
+{
+	assert (m_pCounters != 0);
+	assert (m_pSum != 0);
+
+	m_pCounters->Read (&m_Start);
+}
+
+CPerfScope::~CPerfScope (void)
+{
+	TPerfSample End;
+	m_pCounters->Read (&End);
+
+	m_pSum->nCycles += End.nCycles - m_Start.nCycles;
+
+	for (unsigned i = 0; i < PERF_MAX_COUNTERS; i++)
+	{
+		m_pSum->Count[i] += End.Count[i] - m_Start.Count[i];
+	}
+
+	m_pCounters = 0;
+	m_pSum = 0;
+}
@@ -20,6 +20,9 @@
 #include <circle/sched/scheduler.h>
 #include <circle/timer.h>
 #include <circle/logger.h>
+#include <circle/synchronize.h>
+#include <circle/atomic.h>
+#include <circle/binarytracer.h>
 #include <assert.h>
 
 static const char FromScheduler[] = "sched";
@@ -28,8 +31,8 @@ CScheduler *CScheduler::s_pThis = 0;
 
 CScheduler::CScheduler (void)
 :	m_nTasks (0),
-	m_pCurrent (0),
-	m_nCurrent (0),
+	m_nTimeSlice (0),
+	m_bTimerHandler (FALSE),
 	m_pTaskSwitchHandler (0),
 	m_pTaskTerminationHandler (0),
 	m_iSuspendNewTasks (0)
@@ -37,8 +40,28 @@ CScheduler::CScheduler (void)
 	assert (s_pThis == 0);
 	s_pThis = this;
 
-	m_pCurrent = new CTask (0);		// main task currently running
-	assert (m_pCurrent != 0);
+	for (unsigned nCore = 0; nCore < SCHED_CORES; nCore++)
+	{
+		TCore *pCore = &m_Core[nCore];
+
+		pCore->pCurrent = 0;
+		pCore->pPrevious = 0;
+
+		for (unsigned i = 0; i < TASK_PRIORITIES; i++)
+		{
+			pCore->pReadyHead[i] = 0;
+			pCore->pReadyTail[i] = 0;
+		}
+		pCore->nReadyMask = 0;
+
+		pCore->pTimedList = 0;
+		pCore->nSliceTicks = 0;
+		pCore->bPreempt = FALSE;
+	}
+
+	CTask *pMainTask = new CTask (0);	// main task currently running
+	assert (pMainTask != 0);
+	assert (m_Core[GetCoreNumber ()].pCurrent == pMainTask);
 }
 
 CScheduler::~CScheduler (void)
@@ -51,31 +74,112 @@ CScheduler::~CScheduler (void)
 
 void CScheduler::Yield (void)
 {
-	while ((m_nCurrent = GetNextTask ()) == MAX_TASKS)	// no task is ready
-	{
-		assert (m_nTasks > 0);
-	}
+	unsigned nCore = GetCoreNumber ();
+	TCore *pCore = &m_Core[nCore];
 
-	assert (m_nCurrent < MAX_TASKS);
-	CTask *pNext = m_pTask[m_nCurrent];
-	assert (pNext != 0);
-	if (m_pCurrent == pNext)
+	CTask *pCurrent;
+	CTask *pNext;
+	for (;;)
 	{
-		return;
+		m_SpinLock.Acquire ();
+
+		pCurrent = pCore->pCurrent;
+		assert (pCurrent != 0);
+
+		// the timed tasks of a core, which does not yield (e.g. runs a longer
+		// calculation), are woken here too, so that other cores can take them
+		unsigned nTicks = CTimer::Get ()->GetClockTicks ();
+		for (unsigned i = 0; i < SCHED_CORES; i++)
+		{
+			WakeTimedTasks (i, nTicks);
+		}
+
+		// the current task is not in the list of timed tasks yet
+		if (   pCurrent->IsTimed ()
+		    && (int) (pCurrent->GetWakeTicks () - nTicks) <= 0)
+		{
+			if (pCurrent->GetState () == TaskStateBlockedWithTimeout)
+			{
+				pCurrent->SetWakeTicks (0);	// Use as flag that timeout expired
+			}
+
+			pCurrent->SetState (TaskStateReady);
+		}
+
+		boolean bReady = pCurrent->GetState () == TaskStateReady;
+
+		// A ready task, which is not allowed on this core any more (see ChangeTask()),
+		// gives up the core to any other task (e.g. the idle task of this core).
+		// FinishTaskSwitch() queues it on an allowed core then.
+		boolean bRunnable =    bReady
+				    && (pCurrent->m_nAffinity & (1 << nCore));
+
+		pNext = GetNextTask (nCore, bRunnable ? pCurrent->m_nPriority : TASK_PRIORITY_IDLE);
+		if (   pNext == 0
+		    && (   !bRunnable
+			|| pCurrent->m_nPriority == TASK_PRIORITY_IDLE))
+		{
+			pNext = StealTask (nCore);
+		}
+
+		if (pNext != 0)
+		{
+			break;
+		}
+
+		pCore->bPreempt = FALSE;
+
+		// without another task on this core, a task which has to leave continues here
+		if (bReady)
+		{
+			AtomicSet (&pCore->nSliceTicks, 0);
+
+			m_SpinLock.Release ();
+
+			return;
+		}
+
+		boolean bTimed = HasTimedTasks (nCore) || pCurrent->IsTimed ();
+
+		m_SpinLock.Release ();
+
+		// no task is ready on this core, wait for an interrupt or another core
+#ifdef ARM_ALLOW_MULTI_CORE
+		if (!bTimed)
+		{
+			WaitForEvent ();
+		}
+#else
+		(void) bTimed;
+#endif
 	}
-	
-	TTaskRegisters *pOldRegs = m_pCurrent->GetRegs ();
-	m_pCurrent = pNext;
-	TTaskRegisters *pNewRegs = m_pCurrent->GetRegs ();
+
+	assert (pNext != pCurrent);
+	assert (!pNext->m_bOnCore);
+
+	pCore->pPrevious = pCurrent;
+	pCore->pCurrent = pNext;
+	pNext->m_bOnCore = TRUE;
+
+	AtomicSet (&pCore->nSliceTicks, 0);
+	pCore->bPreempt = FALSE;
+
+	m_SpinLock.Release ();
+
+	TRACE_SYSTEM_EVENT (TRACE_EVENT_TASK_SWITCH, (u32) (uintptr) pNext);
 
 	if (m_pTaskSwitchHandler != 0)
 	{
-		(*m_pTaskSwitchHandler) (m_pCurrent);
+		(*m_pTaskSwitchHandler) (pNext);
 	}
 
+	TTaskRegisters *pOldRegs = pCurrent->GetRegs ();
+	TTaskRegisters *pNewRegs = pNext->GetRegs ();
 	assert (pOldRegs != 0);
 	assert (pNewRegs != 0);
 	TaskSwitch (pOldRegs, pNewRegs);
+
+	FinishTaskSwitch ();
 }
 
 void CScheduler::Sleep (unsigned nSeconds)
@@ -108,10 +212,16 @@ void CScheduler::usSleep (unsigned nMicroSeconds)
 
 		unsigned nStartTicks = CTimer::Get ()->GetClockTicks ();
 
-		assert (m_pCurrent != 0);
-		assert (m_pCurrent->GetState () == TaskStateReady);
-		m_pCurrent->SetWakeTicks (nStartTicks + nTicks);
-		m_pCurrent->SetState (TaskStateSleeping);
+		CTask *pCurrent = GetCurrentTask ();
+		assert (pCurrent != 0);
+
+		m_SpinLock.Acquire ();
+
+		assert (pCurrent->GetState () == TaskStateReady);
+		pCurrent->SetWakeTicks (nStartTicks + nTicks);
+		pCurrent->SetState (TaskStateSleeping);
+
+		m_SpinLock.Release ();
 
 		Yield ();
 	}
@@ -119,19 +229,29 @@ void CScheduler::usSleep (unsigned nMicroSeconds)
 
 CTask *CScheduler::GetCurrentTask (void)
 {
-	return m_pCurrent;
+	return m_Core[GetCoreNumber ()].pCurrent;
 }
 
 boolean CScheduler::IsValidTask (CTask *pTask)
 {
+	boolean bResult = FALSE;
+
+	m_SpinLock.Acquire ();
+
 	unsigned i;
 	for (i = 0; i < m_nTasks; i++)
 	{
 		if (m_pTask[i] != 0 && m_pTask[i] == pTask)
-			return TRUE;
+		{
+			bResult = TRUE;
+
+			break;
+		}
 	}
 
-	return FALSE;
+	m_SpinLock.Release ();
+
+	return bResult;
 }
 
 void CScheduler::RegisterTaskSwitchHandler (TSchedulerTaskHandler *pHandler)
@@ -172,32 +292,202 @@ void CScheduler::ResumeNewTasks (void)
 	}
 }
 
+#ifdef ARM_ALLOW_MULTI_CORE
+
+void CScheduler::RunSecondary (void)
+{
+	unsigned nCore = GetCoreNumber ();
+	assert (nCore > 0);
+
+	// the code of this core continues as its main task, which runs when no other task is ready
+	CTask *pIdleTask = new CTask (0);
+	assert (pIdleTask != 0);
+	assert (m_Core[nCore].pCurrent == pIdleTask);
+	pIdleTask->SetPriority (TASK_PRIORITY_IDLE);
+
+	while (1)
+	{
+		Yield ();
+
+		m_SpinLock.Acquire ();
+
+		boolean bTimed = HasTimedTasks (nCore);
+
+		m_SpinLock.Release ();
+
+		if (!bTimed)
+		{
+			WaitForEvent ();
+		}
+	}
+}
+
+#endif
+
+void CScheduler::SetTimeSlice (unsigned nTicks)
+{
+	m_nTimeSlice = nTicks;
+
+	if (   m_nTimeSlice != 0
+	    && !m_bTimerHandler)
+	{
+		CTimer::Get ()->RegisterPeriodicHandler (TimerHandler);
+
+		m_bTimerHandler = TRUE;
+	}
+}
+
 void CScheduler::AddTask (CTask *pTask)
 {
 	assert (pTask != 0);
 
+	unsigned nCore = GetCoreNumber ();
+
+	m_SpinLock.Acquire ();
+
 	if (m_iSuspendNewTasks)
 	{
 		pTask->SetState(TaskStateNew);
 	}
 
+	pTask->m_nCore = nCore;
+	pTask->m_nAffinity = 1 << nCore;
+
 	unsigned i;
 	for (i = 0; i < m_nTasks; i++)
 	{
 		if (m_pTask[i] == 0)
 		{
-			m_pTask[i] = pTask;
+			break;
+		}
+	}
+
+	if (i == m_nTasks)
+	{
+		if (m_nTasks >= MAX_TASKS)
+		{
+			m_SpinLock.Release ();
 
-			return;
+			CLogger::Get ()->Write (FromScheduler, LogPanic, "System limit of tasks exceeded");
 		}
+
+		m_nTasks++;
 	}
 
-	if (m_nTasks >= MAX_TASKS)
+	m_pTask[i] = pTask;
+
+	if (pTask->m_nStackSize == 0)		// main task of this core, which is running
 	{
-		CLogger::Get ()->Write (FromScheduler, LogPanic, "System limit of tasks exceeded");
+		assert (m_Core[nCore].pCurrent == 0);
+		m_Core[nCore].pCurrent = pTask;
+
+		pTask->SetState (TaskStateReady);
+		pTask->m_bOnCore = TRUE;
+	}
+	else if (pTask->GetState () == TaskStateReady)
+	{
+		Enqueue (pTask);
 	}
 
-	m_pTask[m_nTasks++] = pTask;
+	m_SpinLock.Release ();
+}
+
+void CScheduler::StartTask (CTask *pTask)
+{
+	assert (pTask != 0);
+
+	m_SpinLock.Acquire ();
+
+	assert (pTask->GetState () == TaskStateNew);
+	pTask->SetState (TaskStateReady);
+
+	Enqueue (pTask);
+
+	m_SpinLock.Release ();
+}
+
+void CScheduler::ChangeTask (CTask *pTask, unsigned nPriority, unsigned nAffinity)
+{
+	assert (pTask != 0);
+	assert (nPriority < TASK_PRIORITIES);
+
+	nAffinity &= (1U << SCHED_CORES) - 1;
+	assert (nAffinity != 0);
+
+	m_SpinLock.Acquire ();
+
+	boolean bQueued = pTask->m_bQueued;
+	if (bQueued)
+	{
+		Dequeue (pTask);
+	}
+
+	pTask->m_nPriority = nPriority;
+	pTask->m_nAffinity = nAffinity;
+
+	if (bQueued)
+	{
+		Enqueue (pTask);
+	}
+	else if (   pTask->m_bOnCore
+		 && pTask == m_Core[pTask->m_nCore].pCurrent
+		 && !(nAffinity & (1 << pTask->m_nCore)))
+	{
+		// a running task leaves its core on the next Yield()
+		m_Core[pTask->m_nCore].bPreempt = TRUE;
+	}
+
+	m_SpinLock.Release ();
+}
+
+void CScheduler::FinishTaskSwitch (void)
+{
+	TCore *pCore = &m_Core[GetCoreNumber ()];
+
+	m_SpinLock.Acquire ();
+
+	CTask *pPrevious = pCore->pPrevious;
+	assert (pPrevious != 0);
+	pCore->pPrevious = 0;
+
+	// the registers of the previous task have been saved, it can run on another core now
+	assert (pPrevious->m_bOnCore);
+	pPrevious->m_bOnCore = FALSE;
+
+	switch (pPrevious->GetState ())
+	{
+	case TaskStateReady:
+		Enqueue (pPrevious);
+		break;
+
+	case TaskStateSleeping:
+	case TaskStateBlockedWithTimeout:
+		AddTimedTask (pPrevious);
+		break;
+
+	case TaskStateBlocked:
+	case TaskStateNew:
+		break;
+
+	case TaskStateTerminated:
+		RemoveTask (pPrevious);
+
+		m_SpinLock.Release ();
+
+		if (m_pTaskTerminationHandler != 0)
+		{
+			(*m_pTaskTerminationHandler) (pPrevious);
+		}
+		delete pPrevious;
+
+		return;
+
+	default:
+		assert (0);
+		break;
+	}
+
+	m_SpinLock.Release ();
 }
 
 void CScheduler::RemoveTask (CTask *pTask)
@@ -223,33 +513,37 @@ void CScheduler::RemoveTask (CTask *pTask)
 boolean CScheduler::BlockTask (CTask **ppWaitListHead, unsigned nMicroSeconds)
 {
 	assert (ppWaitListHead != 0);
-	assert (m_pCurrent->m_pWaitListNext == 0);
-	assert (m_pCurrent != 0);
-	assert (m_pCurrent->GetState () == TaskStateReady);
+	CTask *pCurrent = GetCurrentTask ();
+	assert (pCurrent != 0);
+	assert (pCurrent->m_pWaitListNext == 0);
+	assert (pCurrent->GetState () == TaskStateReady);
 
 	m_SpinLock.Acquire ();
 
 	// Add current task to waiting task list
-	m_pCurrent->m_pWaitListNext = *ppWaitListHead;
-	*ppWaitListHead = m_pCurrent;
+	pCurrent->m_pWaitListNext = *ppWaitListHead;
+	*ppWaitListHead = pCurrent;
 
 	if (nMicroSeconds == 0)
 	{
-		m_pCurrent->SetState (TaskStateBlocked);
+		pCurrent->SetState (TaskStateBlocked);
 	}
 	else
 	{
 		unsigned nTicks = nMicroSeconds * (CLOCKHZ / 1000000);
 		unsigned nStartTicks = CTimer::Get ()->GetClockTicks ();
 
-		m_pCurrent->SetWakeTicks (nStartTicks + nTicks);
-		m_pCurrent->SetState (TaskStateBlockedWithTimeout);
+		pCurrent->SetWakeTicks (nStartTicks + nTicks);
+		pCurrent->SetState (TaskStateBlockedWithTimeout);
 	}
 	
 	m_SpinLock.Release ();
 
 	Yield ();
 
+	// the task may continue on another core
+	assert (pCurrent == GetCurrentTask ());
+
 	m_SpinLock.Acquire ();
 
 	// Remove this task from the wait list in case was woken by timeout and
@@ -259,7 +553,7 @@ boolean CScheduler::BlockTask (CTask **ppWaitListHead, unsigned nMicroSeconds)
 	CTask* p = *ppWaitListHead;
 	while (p)
 	{
-		if (p == m_pCurrent)
+		if (p == pCurrent)
 		{
 			if (pPrev)
 				pPrev->m_pWaitListNext = p->m_pWaitListNext;
@@ -269,12 +563,12 @@ boolean CScheduler::BlockTask (CTask **ppWaitListHead, unsigned nMicroSeconds)
 		pPrev = p;
 		p = p->m_pWaitListNext;
 	}
-	m_pCurrent->m_pWaitListNext = nullptr;
+	pCurrent->m_pWaitListNext = nullptr;
 
 	m_SpinLock.Release ();
 
 	// GetWakeTicks Will be zero if timeout expired, non-zero if event signalled
-	return m_pCurrent->GetWakeTicks() == 0;		
+	return pCurrent->GetWakeTicks() == 0;		
 }
 
 void CScheduler::WakeTasks (CTask **ppWaitListHead)
@@ -288,20 +582,27 @@ void CScheduler::WakeTasks (CTask **ppWaitListHead)
 
 	while (pTask)
 	{
-#ifdef NDEBUG
-		if (   pTask == 0
-		    ||    (pTask->GetState () != TaskStateBlocked
-		       && pTask->GetState () != TaskStateBlockedWithTimeout))
+		// a task, which has been woken by timeout, but has not run yet, is ready already
+		if (pTask->GetState () != TaskStateReady)
 		{
-			CLogger::Get ()->Write (FromScheduler, LogPanic, "Tried to wake non-blocked task");
-		}
+#ifdef NDEBUG
+			if (   pTask == 0
+			    ||    (pTask->GetState () != TaskStateBlocked
+			       && pTask->GetState () != TaskStateBlockedWithTimeout))
+			{
+				m_SpinLock.Release ();
+
+				CLogger::Get ()->Write (FromScheduler, LogPanic,
+							"Tried to wake non-blocked task");
+			}
 #else
-		assert (pTask != 0);
-		assert (   pTask->GetState () == TaskStateBlocked
-		        || pTask->GetState () == TaskStateBlockedWithTimeout);
+			assert (pTask != 0);
+			assert (   pTask->GetState () == TaskStateBlocked
+				|| pTask->GetState () == TaskStateBlockedWithTimeout);
 #endif
 
-		pTask->SetState (TaskStateReady);
+			MakeReady (pTask);
+		}
 
 		CTask* pNext = pTask->m_pWaitListNext;
 		pTask->m_pWaitListNext = 0;
@@ -311,68 +612,285 @@ void CScheduler::WakeTasks (CTask **ppWaitListHead)
 	m_SpinLock.Release ();
 }
 
-unsigned CScheduler::GetNextTask (void)
+void CScheduler::MakeReady (CTask *pTask)
 {
-	unsigned nTask = m_nCurrent < MAX_TASKS ? m_nCurrent : 0;
+	assert (pTask != 0);
+
+	if (pTask->m_bTimed)
+	{
+		RemoveTimedTask (pTask);
+	}
 
-	unsigned nTicks = CTimer::Get ()->GetClockTicks ();
+	pTask->SetState (TaskStateReady);
 
-	for (unsigned i = 1; i <= m_nTasks; i++)
+	// a task, which is still on its core, is queued by FinishTaskSwitch()
+	if (!pTask->m_bOnCore)
 	{
-		if (++nTask >= m_nTasks)
-		{
-			nTask = 0;
-		}
+		Enqueue (pTask);
+	}
+#ifdef ARM_ALLOW_MULTI_CORE
+	else
+	{
+		// it may be the current task of a core, which waits in Yield()
+		DataSyncBarrier ();
+		SendEvent ();
+	}
+#endif
+}
 
-		CTask *pTask = m_pTask[nTask];
-		if (pTask == 0)
-		{
-			continue;
-		}
+void CScheduler::Enqueue (CTask *pTask)
+{
+	assert (pTask != 0);
+	assert (pTask->GetState () == TaskStateReady);
+	assert (!pTask->m_bQueued);
+	assert (!pTask->m_bOnCore);
+	assert (pTask->m_nAffinity != 0);
+
+	// migrate to the first allowed core, if the task is not allowed on its core
+	unsigned nCore = pTask->m_nCore;
+	if (!(pTask->m_nAffinity & (1 << nCore)))
+	{
+		nCore = __builtin_ctz (pTask->m_nAffinity);
+		pTask->m_nCore = nCore;
+	}
+	assert (nCore < SCHED_CORES);
 
-		switch (pTask->GetState ())
-		{
-		case TaskStateReady:
-			return nTask;
+	TCore *pCore = &m_Core[nCore];
+	unsigned nPriority = pTask->m_nPriority;
+	assert (nPriority < TASK_PRIORITIES);
 
-		case TaskStateBlocked:
-		case TaskStateNew:
-			continue;
+	pTask->m_pRunNext = 0;
+	if (pCore->pReadyTail[nPriority] != 0)
+	{
+		pCore->pReadyTail[nPriority]->m_pRunNext = pTask;
+	}
+	else
+	{
+		pCore->pReadyHead[nPriority] = pTask;
+	}
+	pCore->pReadyTail[nPriority] = pTask;
 
-		case TaskStateBlockedWithTimeout:
-			if ((int) (pTask->GetWakeTicks () - nTicks) > 0)
-			{
-				continue;
-			}
-			pTask->SetState (TaskStateReady);
-			pTask->SetWakeTicks(0);		// Use as flag that timeout expired
-			return nTask;
+	pCore->nReadyMask |= 1U << nPriority;
+	pTask->m_bQueued = TRUE;
 
+	if (   pCore->pCurrent != 0
+	    && nPriority > pCore->pCurrent->m_nPriority)
+	{
+		pCore->bPreempt = TRUE;
+	}
+
+#ifdef ARM_ALLOW_MULTI_CORE
+	// wake the target core or another allowed core, if it is waiting
+	DataSyncBarrier ();
+	SendEvent ();
+#endif
+}
+
+void CScheduler::Dequeue (CTask *pTask)
+{
+	assert (pTask != 0);
+	assert (pTask->m_bQueued);
+
+	TCore *pCore = &m_Core[pTask->m_nCore];
+	unsigned nPriority = pTask->m_nPriority;
+
+	CTask *pPrev = 0;
+	CTask *p = pCore->pReadyHead[nPriority];
+	while (p != pTask)
+	{
+		assert (p != 0);
+		pPrev = p;
+		p = p->m_pRunNext;
+	}
 
-		case TaskStateSleeping:
-			if ((int) (pTask->GetWakeTicks () - nTicks) > 0)
+	if (pPrev != 0)
+	{
+		pPrev->m_pRunNext = pTask->m_pRunNext;
+	}
+	else
+	{
+		pCore->pReadyHead[nPriority] = pTask->m_pRunNext;
+	}
+
+	if (pCore->pReadyTail[nPriority] == pTask)
+	{
+		pCore->pReadyTail[nPriority] = pPrev;
+	}
+
+	if (pCore->pReadyHead[nPriority] == 0)
+	{
+		pCore->nReadyMask &= ~(1U << nPriority);
+	}
+
+	pTask->m_pRunNext = 0;
+	pTask->m_bQueued = FALSE;
+}
+
+CTask *CScheduler::GetNextTask (unsigned nCore, unsigned nMinPriority)
+{
+	TCore *pCore = &m_Core[nCore];
+
+	u32 nMask = pCore->nReadyMask;
+	if (nMask == 0)
+	{
+		return 0;
+	}
+
+	unsigned nPriority = 31 - __builtin_clz (nMask);
+	if (nPriority < nMinPriority)
+	{
+		return 0;
+	}
+
+	CTask *pTask = pCore->pReadyHead[nPriority];
+	assert (pTask != 0);
+
+	Dequeue (pTask);
+
+	return pTask;
+}
+
+CTask *CScheduler::StealTask (unsigned nCore)
+{
+	CTask *pResult = 0;
+
+	// take the ready task with the highest priority, which is allowed on this core
+	for (unsigned i = 1; i < SCHED_CORES; i++)
+	{
+		TCore *pVictim = &m_Core[(nCore + i) % SCHED_CORES];
+
+		for (u32 nMask = pVictim->nReadyMask; nMask != 0; )
+		{
+			unsigned nPriority = 31 - __builtin_clz (nMask);
+			nMask &= ~(1U << nPriority);
+
+			if (   pResult != 0
+			    && nPriority <= pResult->m_nPriority)
 			{
-				continue;
+				break;
 			}
-			pTask->SetState (TaskStateReady);
-			return nTask;
 
-		case TaskStateTerminated:
-			if (m_pTaskTerminationHandler != 0)
+			for (CTask *pTask = pVictim->pReadyHead[nPriority]; pTask != 0;
+			     pTask = pTask->m_pRunNext)
 			{
-				(*m_pTaskTerminationHandler) (pTask);
+				if (pTask->m_nAffinity & (1 << nCore))
+				{
+					pResult = pTask;
+
+					break;
+				}
 			}
-			RemoveTask (pTask);
-			delete pTask;
-			return MAX_TASKS;
+		}
+	}
 
-		default:
-			assert (0);
-			break;
+	if (pResult != 0)
+	{
+		Dequeue (pResult);
+
+		pResult->m_nCore = nCore;
+	}
+
+	return pResult;
+}
+
+void CScheduler::AddTimedTask (CTask *pTask)
+{
+	assert (pTask != 0);
+	assert (pTask->IsTimed ());
+	assert (!pTask->m_bTimed);
+
+	// sorted by wake time, the earliest first
+	CTask **ppLink = &m_Core[pTask->m_nCore].pTimedList;
+	while (   *ppLink != 0
+	       && (int) ((*ppLink)->GetWakeTicks () - pTask->GetWakeTicks ()) <= 0)
+	{
+		ppLink = &(*ppLink)->m_pRunNext;
+	}
+
+	pTask->m_pRunNext = *ppLink;
+	*ppLink = pTask;
+
+	pTask->m_bTimed = TRUE;
+}
+
+void CScheduler::RemoveTimedTask (CTask *pTask)
+{
+	assert (pTask != 0);
+	assert (pTask->m_bTimed);
+
+	CTask **ppLink = &m_Core[pTask->m_nCore].pTimedList;
+	while (*ppLink != pTask)
+	{
+		assert (*ppLink != 0);
+		ppLink = &(*ppLink)->m_pRunNext;
+	}
+
+	*ppLink = pTask->m_pRunNext;
+
+	pTask->m_pRunNext = 0;
+	pTask->m_bTimed = FALSE;
+}
+
+void CScheduler::WakeTimedTasks (unsigned nCore, unsigned nTicks)
+{
+	TCore *pCore = &m_Core[nCore];
+
+	CTask *pTask;
+	while (   (pTask = pCore->pTimedList) != 0
+	       && (int) (pTask->GetWakeTicks () - nTicks) <= 0)
+	{
+		if (pTask->GetState () == TaskStateBlockedWithTimeout)
+		{
+			pTask->SetWakeTicks (0);	// Use as flag that timeout expired
 		}
+
+		MakeReady (pTask);
 	}
+}
 
-	return MAX_TASKS;
+boolean CScheduler::HasTimedTasks (unsigned nCore)
+{
+	// a timed task may be woken on this core, if it is allowed to run here
+	for (unsigned i = 0; i < SCHED_CORES; i++)
+	{
+		for (CTask *pTask = m_Core[i].pTimedList; pTask != 0; pTask = pTask->m_pRunNext)
+		{
+			if (pTask->m_nAffinity & (1 << nCore))
+			{
+				return TRUE;
+			}
+		}
+	}
+
+	return FALSE;
+}
+
+void CScheduler::TimerHandler (void)
+{
+	CScheduler *pThis = s_pThis;
+	if (   pThis == 0
+	    || pThis->m_nTimeSlice == 0)
+	{
+		return;
+	}
+
+	// the flags are polled by the cores in PreemptionPoint(), the counters are
+	// reset by the cores concurrently, because m_SpinLock is not acquired here
+	for (unsigned nCore = 0; nCore < SCHED_CORES; nCore++)
+	{
+		TCore *pCore = &pThis->m_Core[nCore];
+
+		// a core without tasks does not run Yield(), which resets the counter
+		if (pCore->pCurrent == 0)
+		{
+			continue;
+		}
+
+		if (AtomicIncrement (&pCore->nSliceTicks) >= (int) pThis->m_nTimeSlice)
+		{
+			pCore->bPreempt = TRUE;
+		}
+	}
 }
 
 CScheduler *CScheduler::Get (void)
@@ -26,7 +26,14 @@ CTask::CTask (unsigned nStackSize, boolean bCreateSuspended)
 :	m_State (bCreateSuspended ? TaskStateNew : TaskStateReady),
 	m_nStackSize (nStackSize),
 	m_pStack (0),
-	m_pWaitListNext (0)
+	m_pWaitListNext (0),
+	m_nPriority (TASK_PRIORITY_DEFAULT),
+	m_nAffinity (0),
+	m_nCore (0),
+	m_pRunNext (0),
+	m_bQueued (FALSE),
+	m_bTimed (FALSE),
+	m_bOnCore (FALSE)
 {
 	for (unsigned i = 0; i < TASK_USER_DATA_SLOTS; i++)
 	{
@@ -62,7 +69,8 @@ CTask::~CTask (void)
 void CTask::Start (void)
 {
 	assert(m_State == TaskStateNew);
-	m_State = TaskStateReady;
+
+	CScheduler::Get ()->StartTask (this);
 }
 
 void CTask::Run (void)		// dummy method which is never called
@@ -102,6 +110,18 @@ void *CTask::GetUserData (unsigned nSlot)
 	return m_pUserData[nSlot];
 }
 
+void CTask::SetPriority (unsigned nPriority)
+{
+	assert (nPriority <= TASK_PRIORITY_HIGHEST);
+
+	CScheduler::Get ()->ChangeTask (this, nPriority, m_nAffinity);
+}
+
+void CTask::SetAffinity (unsigned nCoreMask)
+{
+	CScheduler::Get ()->ChangeTask (this, m_nPriority, nCoreMask);
+}
+
 #if AARCH == 32
 
 void CTask::InitializeRegs (void)
@@ -146,6 +166,8 @@ void CTask::TaskEntry (void *pParam)
 	CTask *pThis = (CTask *) pParam;
 	assert (pThis != 0);
 
+	CScheduler::Get ()->FinishTaskSwitch ();	// we have been switched to from Yield()
+
 	pThis->Run ();
 
 	pThis->m_State = TaskStateTerminated;
@@ -776,11 +776,8 @@ void CScreenDevice::Scroll (void)
 		m_DMAChannel.Start ();
 		m_DMAChannel.Wait ();
 #else
-		unsigned nSizeBlk = nSize & ~0xF;
-		memcpyblk (pTo, pFrom, nSizeBlk);
-
-		// Handle framebuffers with row lengths not aligned to 16 bytes
-		memcpy ((u8 *) pTo + nSizeBlk, (u8 *) pFrom + nSizeBlk, nSize & 0xF);
+		// rows, which are not aligned to 16 bytes, are copied word by word
+		memcpyblk (pTo, pFrom, nSize);
 #endif
 
 		pTo += nSize / sizeof (u32);
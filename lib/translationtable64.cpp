@@ -39,6 +39,13 @@
 #define LEVEL2_TABLE_ENTRIES	128
 #endif
 
+// Level 2 entries, which cover a region with the same attributes, are mapped
+// as 512MB blocks. In the level 3 tables each aligned group of 32 pages with
+// the same attributes gets the contiguous hint, so that it uses one TLB entry
+// (2MB). This does not apply, if NO_MMU_BLOCK_MAPPINGS is defined.
+
+#define ATTRIBUTES_MASK		(~((u64) 0xFFFFFFFF << 16))	// without OutputAddress
+
 CTranslationTable::CTranslationTable (size_t nMemSize)
 :	m_nMemSize (nMemSize),
 	m_pTable (0)
@@ -61,6 +68,33 @@ CTranslationTable::CTranslationTable (size_t nMemSize)
 		}
 #endif
 
+#ifndef NO_MMU_BLOCK_MAPPINGS
+		if (IsUniform (nBaseAddress, ARMV8MMU_LEVEL2_BLOCK_SIZE))
+		{
+			TARMV8MMU_LEVEL3_PAGE_DESCRIPTOR Page;
+			GetPageDescriptor (&Page, nBaseAddress);
+
+			TARMV8MMU_LEVEL2_BLOCK_DESCRIPTOR *pDesc = &m_pTable[nEntry].Block;
+
+			pDesc->Value01	     = 1;
+			pDesc->AttrIndx	     = Page.AttrIndx;
+			pDesc->NS	     = 0;
+			pDesc->AP	     = Page.AP;
+			pDesc->SH	     = Page.SH;
+			pDesc->AF	     = 1;
+			pDesc->nG	     = 0;
+			pDesc->Reserved0_1   = 0;
+			pDesc->OutputAddress = ARMV8MMUL2BLOCKADDR (nBaseAddress);
+			pDesc->Reserved0_2   = 0;
+			pDesc->Continous     = 0;
+			pDesc->PXN	     = Page.PXN;
+			pDesc->UXN	     = Page.UXN;
+			pDesc->Ignored	     = 0;
+
+			continue;
+		}
+#endif
+
 		TARMV8MMU_LEVEL3_DESCRIPTOR *pTable = CreateLevel3Table (nBaseAddress);
 		assert (pTable != 0);
 
@@ -99,49 +133,92 @@ TARMV8MMU_LEVEL3_DESCRIPTOR *CTranslationTable::CreateLevel3Table (uintptr nBase
 
 	for (unsigned nPage = 0; nPage < ARMV8MMU_TABLE_ENTRIES; nPage++)	// 8192 entries a 64KB
 	{
-		TARMV8MMU_LEVEL3_PAGE_DESCRIPTOR *pDesc = &pTable[nPage].Page;
-
-		pDesc->Value11	     = 3;
-		pDesc->AttrIndx	     = ATTRINDX_NORMAL;
-		pDesc->NS	     = 0;
-		pDesc->AP	     = ATTRIB_AP_RW_EL1;
-		pDesc->SH	     = ATTRIB_SH_INNER_SHAREABLE;
-		pDesc->AF	     = 1;
-		pDesc->nG	     = 0;
-		pDesc->Reserved0_1   = 0;
-		pDesc->OutputAddress = ARMV8MMUL3PAGEADDR (nBaseAddress);
-		pDesc->Reserved0_2   = 0;
-		pDesc->Continous     = 0;
-		pDesc->PXN	     = 0;
-		pDesc->UXN	     = 1;
-		pDesc->Ignored	     = 0;
-
-		extern u8 _etext;
-		if (nBaseAddress >= (u64) &_etext)
-		{
-			pDesc->PXN = 1;
+		GetPageDescriptor (&pTable[nPage].Page, nBaseAddress);
 
-#if RASPPI >= 4
-			if (   (   nBaseAddress >= m_nMemSize
-			        && nBaseAddress < MEM_HIGHMEM_START)
-			    || nBaseAddress > MEM_HIGHMEM_END)
-#else
-			if (nBaseAddress >= m_nMemSize)
-#endif
-			{
-				pDesc->AttrIndx = ATTRINDX_DEVICE;
-				pDesc->SH	= ATTRIB_SH_OUTER_SHAREABLE;
-			}
-			else if (   nBaseAddress >= MEM_COHERENT_REGION
-				 && nBaseAddress <  MEM_HEAP_START)
+#ifndef NO_MMU_BLOCK_MAPPINGS
+		if (   nPage % ARMV8MMU_LEVEL3_CONTIGUOUS == 0
+		    && IsUniform (nBaseAddress, ARMV8MMU_LEVEL3_CONTIGUOUS * ARMV8MMU_LEVEL3_PAGE_SIZE))
+		{
+			for (unsigned i = 0; i < ARMV8MMU_LEVEL3_CONTIGUOUS; i++)
 			{
-				pDesc->AttrIndx = ATTRINDX_COHERENT;
-				pDesc->SH	= ATTRIB_SH_OUTER_SHAREABLE;
+				GetPageDescriptor (&pTable[nPage+i].Page, nBaseAddress);
+				pTable[nPage+i].Page.Continous = 1;
+
+				nBaseAddress += ARMV8MMU_LEVEL3_PAGE_SIZE;
 			}
+
+			nPage += ARMV8MMU_LEVEL3_CONTIGUOUS-1;
+
+			continue;
 		}
+#endif
 
 		nBaseAddress += ARMV8MMU_LEVEL3_PAGE_SIZE;
 	}
 
 	return pTable;
 }
+
+boolean CTranslationTable::IsUniform (uintptr nBaseAddress, size_t nSize)
+{
+	TARMV8MMU_LEVEL3_DESCRIPTOR First;
+	GetPageDescriptor (&First.Page, nBaseAddress);
+
+	for (size_t nOffset = ARMV8MMU_LEVEL3_PAGE_SIZE; nOffset < nSize;
+	     nOffset += ARMV8MMU_LEVEL3_PAGE_SIZE)
+	{
+		TARMV8MMU_LEVEL3_DESCRIPTOR Desc;
+		GetPageDescriptor (&Desc.Page, nBaseAddress + nOffset);
+
+		if (   (*(u64 *) &Desc & ATTRIBUTES_MASK)
+		    != (*(u64 *) &First & ATTRIBUTES_MASK))
+		{
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+void CTranslationTable::GetPageDescriptor (TARMV8MMU_LEVEL3_PAGE_DESCRIPTOR *pDesc,
+					   uintptr nBaseAddress)
+{
+	pDesc->Value11	     = 3;
+	pDesc->AttrIndx	     = ATTRINDX_NORMAL;
+	pDesc->NS	     = 0;
+	pDesc->AP	     = ATTRIB_AP_RW_EL1;
+	pDesc->SH	     = ATTRIB_SH_INNER_SHAREABLE;
+	pDesc->AF	     = 1;
+	pDesc->nG	     = 0;
+	pDesc->Reserved0_1   = 0;
+	pDesc->OutputAddress = ARMV8MMUL3PAGEADDR (nBaseAddress);
+	pDesc->Reserved0_2   = 0;
+	pDesc->Continous     = 0;
+	pDesc->PXN	     = 0;
+	pDesc->UXN	     = 1;
+	pDesc->Ignored	     = 0;
+
+	extern u8 _etext;
+	if (nBaseAddress >= (u64) &_etext)
+	{
+		pDesc->PXN = 1;
+
+#if RASPPI >= 4
+		if (   (   nBaseAddress >= m_nMemSize
+		        && nBaseAddress < MEM_HIGHMEM_START)
+		    || nBaseAddress > MEM_HIGHMEM_END)
+#else
+		if (nBaseAddress >= m_nMemSize)
+#endif
+		{
+			pDesc->AttrIndx = ATTRINDX_DEVICE;
+			pDesc->SH	= ATTRIB_SH_OUTER_SHAREABLE;
+		}
+		else if (   nBaseAddress >= MEM_COHERENT_REGION
+			 && nBaseAddress <  MEM_HEAP_START)
+		{
+			pDesc->AttrIndx = ATTRINDX_COHERENT;
+			pDesc->SH	= ATTRIB_SH_OUTER_SHAREABLE;
+		}
+	}
+}
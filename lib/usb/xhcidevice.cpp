@@ -325,7 +325,7 @@ void *CXHCIDevice::AllocateSharedMem (size_t nSize, size_t nAlign, size_t nBound
 	void *pResult = m_SharedMemAllocator.Allocate (nSize, nAlign, nBoundary);
 	if (pResult != 0)
 	{
-		memset (pResult, 0, nSize);
+		memsetblk (pResult, 0, nSize);
 	}
 	else
 	{
@@ -468,7 +468,7 @@ TXHCIInputContext *CXHCIEndpoint::GetInputContextSetMaxPacketSize (void)
 
 	assert (m_pDevice != 0);
 	memset (&pInputContext->Control, 0, sizeof pInputContext->Control);
-	memcpy (&pInputContext->Device, m_pDevice->GetDeviceContext (),
+	memcpyblk (&pInputContext->Device, m_pDevice->GetDeviceContext (),
 		sizeof pInputContext->Device);
 
 	// set input control context
@@ -299,7 +299,7 @@ TXHCIInputContext *CXHCIUSBDevice::GetInputContextEnableHubFunction (void)
 
 	assert (m_pDeviceContext != 0);
 	memset (&pInputContext->Control, 0, sizeof pInputContext->Control);
-	memcpy (&pInputContext->Device, m_pDeviceContext, sizeof pInputContext->Device);
+	memcpyblk (&pInputContext->Device, m_pDeviceContext, sizeof pInputContext->Device);
 
 	// set input control context
 	pInputContext->Control.AddContextFlags = 1;	// set A0
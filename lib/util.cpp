@@ -19,6 +19,8 @@
 //
 #include <circle/util.h>
 
+#if AARCH == 32
+
 void *memset (void *pBuffer, int nValue, size_t nLength)
 {
 	u32 *p32 = (u32 *) pBuffer;
@@ -73,8 +75,12 @@ void *memmove (void *pDest, const void *pSrc, size_t nLength)
 	return memcpy (pDest, pSrc, nLength);
 }
 
+#endif
+
 #if STDLIB_SUPPORT <= 1
 
+#if AARCH == 32		// AArch64: see util_fast.S
+
 int memcmp (const void *pBuffer1, const void *pBuffer2, size_t nLength)
 {
 	const unsigned char *p1 = (const unsigned char *) pBuffer1;
@@ -110,6 +116,25 @@ size_t strlen (const char *pString)
 	return nResult;
 }
 
+void *memchr (const void *pBuffer, int nChar, size_t nLength)
+{
+	const unsigned char *p = (const unsigned char *) pBuffer;
+
+	while (nLength-- > 0)
+	{
+		if (*p == (unsigned char) nChar)
+		{
+			return (void *) p;
+		}
+
+		p++;
+	}
+
+	return 0;
+}
+
+#endif
+
 int strcmp (const char *pString1, const char *pString2)
 {
 	while (   *pString1 != '\0'